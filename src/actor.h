@@ -1018,6 +1018,8 @@ public:
 
 // interaction info
 	FBlockNode		*BlockNode;			// links in blocks (if needed)
+	int				GridCell;			// cell in ActorGrid + 1, 0 if not in the grid
+	unsigned		GridSlot;			// index in that cell's arrays
 	struct sector_t	*Sector;
 	subsector_t *		subsector;
 	double			floorz, ceilingz;	// closest together of contacted secs
@@ -1089,6 +1091,7 @@ public:
 	int		accuracy, stamina;		// [RH] Strife stats -- [XA] moved here for DECORATE/ACS access.
 
 	AActor			*inext, **iprev;// Links to other mobjs in same bucket
+	AActor			*cnext, **cprev;// Links to other live actors of the same class
 	TObjPtr<AActor*> goal;			// Monster's goal if not chasing anything
 	int				waterlevel;		// 0=none, 1=feet, 2=waist, 3=eyes
 	uint8_t			boomwaterlevel;	// splash information for non-swimmable water sectors
@@ -1195,13 +1198,23 @@ public:
 
 	// ThingIDs
 	static void ClearTIDHashes ();
+	static FString GetTIDHashStats ();
 	void AddToHash ();
 	void RemoveFromHash ();
 
+	// Live instances of each class
+	void LinkToClass ();
+	void UnlinkFromClass ();
+
 
 private:
-	static AActor *TIDHash[128];
-	static inline int TIDHASH (int key) { return key & 127; }
+	static void GrowTIDHash ();
+	static AActor *FirstInTIDChain (int key)
+	{
+		return TIDHash.Size() > 0 ? TIDHash[key & (TIDHash.Size() - 1)] : nullptr;
+	}
+	static TArray<AActor *> TIDHash;	// the size is always a power of 2
+	static unsigned NumHashedTIDs;
 public:
 	static FSharedStringArena mStringPropertyData;
 private:
@@ -1457,7 +1470,7 @@ public:
 		if (id == 0)
 			return NULL;
 		if (!base)
-			base = AActor::TIDHash[id & 127];
+			base = AActor::FirstInTIDChain(id);
 		else
 			base = base->inext;
 
@@ -1510,6 +1523,36 @@ public:
 	}
 };
 
+//==========================================================================
+//
+// Iterates over all live actors of exactly the given class, without
+// going through the thinker lists.
+//
+//==========================================================================
+
+class FClassActorIterator
+{
+public:
+	FClassActorIterator (PClassActor *cls) : base (nullptr), type (cls)
+	{
+	}
+	AActor *Next ()
+	{
+		if (type == nullptr)
+			return nullptr;
+		if (!base)
+			base = type->Instances;
+		else
+			base = base->cnext;
+		if (!base)
+			type = nullptr;
+		return base;
+	}
+private:
+	AActor *base;
+	PClassActor *type;
+};
+
 bool P_IsTIDUsed(int tid);
 int P_FindUniqueTID(int start_tid, int limit);
 
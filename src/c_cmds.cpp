@@ -1152,8 +1152,18 @@ CCMD(vmengine)
 			VMSelectEngine(VMEngine_Unchecked);
 			return;
 		}
+		else if (stricmp(argv[1], "jit") == 0)
+		{
+			VMSelectEngine(VMEngine_JIT);
+			return;
+		}
+		else if (stricmp(argv[1], "jitcompare") == 0)
+		{
+			VMSelectEngine(VMEngine_JITCompare);
+			return;
+		}
 	}
-	Printf("Usage: vmengine <default|checked|unchecked>\n");
+	Printf("Usage: vmengine <default|checked|unchecked|jit|jitcompare>\n");
 }
 
 //-----------------------------------------------------------------------------
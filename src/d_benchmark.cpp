@@ -0,0 +1,407 @@
+/*
+** d_benchmark.cpp
+** Headless benchmark runs with a machine readable report
+**
+** -benchmark plays each map given with -benchmarkmaps for -benchmarktics
+** tics without any input, followed by the demo given with -timedemo. Every
+** frame is drawn by the software renderer into an offscreen canvas, so no
+** window is needed. When all runs are done the timings are written as JSON
+** to the file given with -benchmarkout and the program exits.
+**
+*/
+
+#include <stdlib.h>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "doomstat.h"
+#include "d_event.h"
+#include "d_player.h"
+#include "d_benchmark.h"
+#include "g_game.h"
+#include "g_level.h"
+#include "m_argv.h"
+#include "c_cvars.h"
+#include "i_system.h"
+#include "files.h"
+#include "stats.h"
+#include "version.h"
+#include "v_video.h"
+#include "r_renderer.h"
+#include "swrenderer/scene/r_scene.h"
+
+EXTERN_CVAR(Int, vid_renderer)
+EXTERN_CVAR(Bool, swtruecolor)
+
+typedef rapidjson::PrettyWriter<rapidjson::StringBuffer, rapidjson::UTF8<> > FBenchmarkWriter;
+
+struct FBenchmarkRun
+{
+	FString Name;
+	bool IsDemo;
+	bool Started;
+	int Tics;
+
+	TArray<double> PlaysimTimes;
+	TArray<double> FrameTimes;
+	TArray<double> WallTimes;
+	TArray<double> PlaneTimes;
+	TArray<double> MaskedTimes;
+	TArray<double> DrawerTimes;
+};
+
+bool benchmarking;
+
+static TArray<FBenchmarkRun> BenchmarkRuns;
+static unsigned int CurrentRun;
+static int TicsPerMap;
+static FString ReportPath;
+static DSimpleCanvas *BenchmarkCanvas;
+static int SavedRenderer;
+
+//==========================================================================
+//
+// D_BenchmarkInitRenderer
+//
+// The benchmark only works with the software renderer, which must be
+// selected before the video system is started. The user's choice is put
+// back on the way out, however that happens, so that it gets saved in
+// the config instead of the forced one.
+//
+//==========================================================================
+
+static void RestoreRenderer ()
+{
+	vid_renderer = SavedRenderer;
+}
+
+void D_BenchmarkInitRenderer ()
+{
+	SavedRenderer = vid_renderer;
+	vid_renderer = 0;
+	atterm (RestoreRenderer);
+}
+
+//==========================================================================
+//
+// StartRun
+//
+//==========================================================================
+
+static void StartRun (unsigned int index)
+{
+	FBenchmarkRun &run = BenchmarkRuns[index];
+	CurrentRun = index;
+	Printf ("Benchmark: running %s\n", run.Name.GetChars());
+
+	if (run.IsDemo)
+	{
+		G_TimeDemo (run.Name);
+	}
+	else
+	{
+		G_DeferedInitNew (run.Name);
+	}
+
+	// G_TimeDemo resets these from the command line
+	nodrawers = true;
+	singletics = true;
+}
+
+//==========================================================================
+//
+// D_StartBenchmark
+//
+//==========================================================================
+
+void D_StartBenchmark ()
+{
+	FString *maps;
+	int nummaps = Args->CheckParmList ("-benchmarkmaps", &maps);
+	for (int i = 0; i < nummaps; i++)
+	{
+		FBenchmarkRun run;
+		run.Name = maps[i];
+		run.IsDemo = false;
+		run.Started = false;
+		run.Tics = 0;
+		BenchmarkRuns.Push (run);
+	}
+
+	// The demo goes last because the game is not in a usable state after a timed demo
+	const char *v = Args->CheckValue ("-timedemo");
+	if (v != NULL)
+	{
+		FBenchmarkRun run;
+		run.Name = v;
+		run.IsDemo = true;
+		run.Started = false;
+		run.Tics = 0;
+		BenchmarkRuns.Push (run);
+	}
+
+	if (BenchmarkRuns.Size() == 0)
+	{
+		I_FatalError ("-benchmark needs maps from -benchmarkmaps or a demo from -timedemo\n");
+	}
+
+	v = Args->CheckValue ("-benchmarktics");
+	TicsPerMap = v != NULL ? MAX (atoi (v), 1) : 10 * TICRATE;
+
+	v = Args->CheckValue ("-benchmarkout");
+	ReportPath = v != NULL ? v : "benchmark.json";
+
+	v = Args->CheckValue ("-benchmarkwidth");
+	int width = clamp (v != NULL ? atoi (v) : 1920, 320, MAXWIDTH);
+	v = Args->CheckValue ("-benchmarkheight");
+	int height = clamp (v != NULL ? atoi (v) : 1080, 200, MAXHEIGHT);
+
+	BenchmarkCanvas = new DSimpleCanvas (width, height, swtruecolor);
+	BenchmarkCanvas->ObjectFlags |= OF_Fixed;
+
+	benchmarking = true;
+	StartRun (0);
+}
+
+//==========================================================================
+//
+// GetPeakMemory
+//
+// Returns the peak resident set size of the process in bytes.
+//
+//==========================================================================
+
+static uint64_t GetPeakMemory ()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage;
+	if (getrusage (RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return usage.ru_maxrss;
+#else
+		return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+	}
+	return 0;
+#endif
+}
+
+//==========================================================================
+//
+// WriteTimes
+//
+// Writes the summary and all samples of one timing series in milliseconds.
+//
+//==========================================================================
+
+static void WriteTimes (FBenchmarkWriter &writer, const char *name, const TArray<double> &times)
+{
+	writer.Key (name);
+	writer.StartObject ();
+
+	unsigned int count = times.Size();
+	TArray<double> sorted = times;
+	double total = 0;
+	if (count > 0)
+	{
+		std::sort (&sorted[0], &sorted[0] + count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			total += sorted[i];
+		}
+	}
+
+	// Nearest rank percentiles
+	auto percentile = [&](double p) -> double
+	{
+		if (count == 0) return 0;
+		unsigned int rank = (unsigned int)ceil (p * count);
+		return sorted[clamp (rank, 1u, count) - 1];
+	};
+
+	writer.Key ("mean");	writer.Double (count > 0 ? total / count : 0);
+	writer.Key ("min");		writer.Double (count > 0 ? sorted[0] : 0);
+	writer.Key ("p50");		writer.Double (percentile (0.5));
+	writer.Key ("p90");		writer.Double (percentile (0.9));
+	writer.Key ("p99");		writer.Double (percentile (0.99));
+	writer.Key ("max");		writer.Double (count > 0 ? sorted[count - 1] : 0);
+
+	writer.Key ("samples");
+	writer.StartArray ();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		writer.Double (times[i]);
+	}
+	writer.EndArray ();
+
+	writer.EndObject ();
+}
+
+//==========================================================================
+//
+// WriteReport
+//
+//==========================================================================
+
+static void WriteReport ()
+{
+	rapidjson::StringBuffer buffer;
+	FBenchmarkWriter writer (buffer);
+
+	writer.StartObject ();
+	writer.Key ("version");		writer.String (GetVersionString());
+	writer.Key ("git");			writer.String (GetGitDescription());
+	writer.Key ("renderer");	writer.String ("software");
+	writer.Key ("width");		writer.Int (BenchmarkCanvas->GetWidth());
+	writer.Key ("height");		writer.Int (BenchmarkCanvas->GetHeight());
+	writer.Key ("truecolor");	writer.Bool (BenchmarkCanvas->IsBgra());
+	writer.Key ("peakmemory");	writer.Uint64 (GetPeakMemory());
+
+	writer.Key ("runs");
+	writer.StartArray ();
+	for (auto &run : BenchmarkRuns)
+	{
+		writer.StartObject ();
+		writer.Key ("name");	writer.String (run.Name);
+		writer.Key ("type");	writer.String (run.IsDemo ? "demo" : "map");
+		writer.Key ("tics");	writer.Int (run.PlaysimTimes.Size());
+		writer.Key ("frames");	writer.Int (run.FrameTimes.Size());
+		WriteTimes (writer, "playsim", run.PlaysimTimes);
+		writer.Key ("render");
+		writer.StartObject ();
+		WriteTimes (writer, "frame", run.FrameTimes);
+		WriteTimes (writer, "bsp", run.WallTimes);
+		WriteTimes (writer, "planes", run.PlaneTimes);
+		WriteTimes (writer, "masked", run.MaskedTimes);
+		WriteTimes (writer, "drawers", run.DrawerTimes);
+		writer.EndObject ();
+		writer.EndObject ();
+	}
+	writer.EndArray ();
+	writer.EndObject ();
+
+	FileWriter *file = FileWriter::Open (ReportPath);
+	if (file == NULL)
+	{
+		I_FatalError ("Could not write benchmark report %s\n", ReportPath.GetChars());
+	}
+	file->Write (buffer.GetString(), buffer.GetSize());
+	delete file;
+
+	Printf ("Benchmark report written to %s\n", ReportPath.GetChars());
+}
+
+//==========================================================================
+//
+// FinishRun
+//
+// Starts the next run, or writes the report and quits after the last one.
+//
+//==========================================================================
+
+static void FinishRun ()
+{
+	if (CurrentRun + 1 < BenchmarkRuns.Size())
+	{
+		StartRun (CurrentRun + 1);
+		return;
+	}
+
+	WriteReport ();
+	exit (0);
+}
+
+//==========================================================================
+//
+// D_BenchmarkTicker
+//
+//==========================================================================
+
+void D_BenchmarkTicker ()
+{
+	// Tics that load a level are not part of the measurement
+	bool record = gamestate == GS_LEVEL && gameaction == ga_nothing;
+
+	cycle_t cycles;
+	cycles.Reset();
+	cycles.Clock();
+	G_Ticker ();
+	cycles.Unclock();
+
+	FBenchmarkRun &run = BenchmarkRuns[CurrentRun];
+	if (record)
+	{
+		run.Started = true;
+		run.PlaysimTimes.Push (cycles.TimeMS());
+	}
+
+	// Map runs end after a fixed number of tics, even if the level was left in the meantime
+	if (run.Started && !run.IsDemo && ++run.Tics >= TicsPerMap)
+	{
+		FinishRun ();
+	}
+}
+
+//==========================================================================
+//
+// D_BenchmarkDisplay
+//
+//==========================================================================
+
+void D_BenchmarkDisplay ()
+{
+	FBenchmarkRun &run = BenchmarkRuns[CurrentRun];
+	if (!run.Started || gamestate != GS_LEVEL || gameaction != ga_nothing)
+		return;
+
+	player_t *player = &players[consoleplayer];
+	AActor *viewpoint = player->camera != NULL ? player->camera : player->mo;
+	if (viewpoint == NULL)
+		return;
+
+	cycle_t cycles;
+	cycles.Reset();
+	cycles.Clock();
+	if (!Renderer->RenderViewToCanvas (viewpoint, BenchmarkCanvas))
+	{
+		I_FatalError ("-benchmark requires the software renderer\n");
+	}
+	cycles.Unclock();
+
+	run.FrameTimes.Push (cycles.TimeMS());
+	run.WallTimes.Push (swrenderer::WallCycles.TimeMS());
+	run.PlaneTimes.Push (swrenderer::PlaneCycles.TimeMS());
+	run.MaskedTimes.Push (swrenderer::MaskedCycles.TimeMS());
+	run.DrawerTimes.Push (swrenderer::DrawerCycles.TimeMS());
+}
+
+//==========================================================================
+//
+// D_BenchmarkDemoEnded
+//
+//==========================================================================
+
+void D_BenchmarkDemoEnded ()
+{
+	FinishRun ();
+}
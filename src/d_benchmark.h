@@ -0,0 +1,22 @@
+#ifndef __D_BENCHMARK_H__
+#define __D_BENCHMARK_H__
+
+// Set while -benchmark is running
+extern bool benchmarking;
+
+// Selects the software renderer before the video system is started
+void D_BenchmarkInitRenderer ();
+
+// Parses the benchmark parameters and queues the first run
+void D_StartBenchmark ();
+
+// Runs one game tic and records the time spent in the playsim
+void D_BenchmarkTicker ();
+
+// Renders the current view into the offscreen canvas and records the render phases
+void D_BenchmarkDisplay ();
+
+// Called by G_CheckDemoStatus when the timed demo reaches its end
+void D_BenchmarkDemoEnded ();
+
+#endif //__D_BENCHMARK_H__
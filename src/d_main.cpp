@@ -77,6 +77,8 @@
 #include "r_utility.h"
 #include "r_sky.h"
 #include "d_main.h"
+#include "d_benchmark.h"
+#include "profiler.h"
 #include "d_dehacked.h"
 #include "cmdlib.h"
 #include "s_sound.h"
@@ -114,6 +116,7 @@
 #include "events.h"
 
 EXTERN_CVAR(Bool, hud_althud)
+EXTERN_CVAR(Bool, gc_generational)
 void DrawHUD();
 
 // MACROS ------------------------------------------------------------------
@@ -658,6 +661,8 @@ void D_Display ()
 
 	if (nodrawers || screen == NULL)
 		return; 				// for comparative timing / profiling
+
+	PROFILE_ZONE("D_Display");
 	
 	cycle_t cycles;
 	
@@ -993,6 +998,8 @@ void D_DoomLoop ()
 
 	vid_cursor.Callback();
 
+	FProfiler::SetThreadName("Main thread");
+
 	for (;;)
 	{
 		try
@@ -1014,7 +1021,10 @@ void D_DoomLoop ()
 					D_DoAdvanceDemo ();
 				C_Ticker ();
 				M_Ticker ();
-				G_Ticker ();
+				if (benchmarking)
+					D_BenchmarkTicker ();
+				else
+					G_Ticker ();
 				// [RH] Use the consoleplayer's camera to update sounds
 				S_UpdateSounds (players[consoleplayer].camera);	// move positional sounds
 				gametic++;
@@ -1029,6 +1039,9 @@ void D_DoomLoop ()
 			// Update display, next frame, with current state.
 			I_StartTic ();
 			D_Display ();
+			if (benchmarking)
+				D_BenchmarkDisplay ();
+			FProfiler::EndFrame ();
 			if (wantToRestart)
 			{
 				wantToRestart = false;
@@ -2035,6 +2048,12 @@ static void D_DoomInit()
 		use_staticrng = true;
 		if (!batchrun) Printf("D_DoomInit: Static RNGseed %d set.\n", rngseed);
 	}
+	else if (Args->CheckParm("-benchmark"))
+	{
+		// Benchmark runs must be repeatable
+		rngseed = staticrngseed = 0;
+		use_staticrng = true;
+	}
 	else
 	{
 		rngseed = I_MakeRNGSeed();
@@ -2331,6 +2350,7 @@ void D_DoomMain (void)
 
 	do
 	{
+		GC::Generational = gc_generational;
 		PClass::StaticInit();
 		PType::StaticInit();
 
@@ -2432,6 +2452,8 @@ void D_DoomMain (void)
 		{
 			if (!batchrun) Printf ("I_Init: Setting up machine state.\n");
 			I_Init ();
+			if (Args->CheckParm("-benchmark"))
+				D_BenchmarkInitRenderer ();
 			I_CreateRenderer();
 		}
 
@@ -2633,6 +2655,12 @@ void D_DoomMain (void)
 				G_LoadGame (file);
 			}
 
+			if (Args->CheckParm("-benchmark"))
+			{
+				D_StartBenchmark ();
+				D_DoomLoop ();	// never returns
+			}
+
 			v = Args->CheckValue("-playdemo");
 			if (v != NULL)
 			{
@@ -491,6 +491,8 @@ size_t DObject::StaticPointerSubstitution (DObject *old, DObject *notOld, bool s
 	size_t changed = 0;
 	int i;
 
+	GC::Remember(notOld);
+
 	// Go through all objects.
 	i = 0;DObject *last=0;
 	for (probe = GC::Root; probe != NULL; probe = probe->ObjNext)
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include "doomtype.h"
 #include "i_system.h"
+#include "dobjpool.h"
 
 class PClass;
 class PType;
@@ -210,6 +211,11 @@ enum EObjectFlags
 	OF_Abstract			= 1 << 14,		// Marks a class that cannot be created with new() function at all
 	OF_UI				= 1 << 15,		// Marks a class that defaults to VARF_UI for it's fields/methods
 	OF_Play				= 1 << 16,		// Marks a class that defaults to VARF_Play for it's fields/methods
+
+	// Generational GC flags
+	OF_Survivor			= 1 << 17,		// Object survived one minor collection
+	OF_Old				= 1 << 18,		// Object survived two minor collections or a full cycle and is left to the incremental collector
+	OF_Remembered		= 1 << 19,		// A pointer to this object was stored somewhere, so a minor collection may not free it
 };
 
 template<class T> class TObjPtr;
@@ -230,6 +236,15 @@ namespace GC
 	// Amount of memory to allocate before triggering a collection.
 	extern size_t Threshold;
 
+	// Amount of memory to allocate before the next full cycle starts.
+	// Below this, generational mode only does minor collections.
+	extern size_t MajorThreshold;
+
+	// Whether generational mode is on. This is taken from gc_generational
+	// before the script types are set up, since scripts only store thinker
+	// pointers with a barrier when it is on, and stays fixed until restart.
+	extern bool Generational;
+
 	// List of gray objects.
 	extern DObject *Gray;
 
@@ -278,6 +293,11 @@ namespace GC
 	// Handles a write barrier for a pointer that isn't inside an object.
 	static inline void WriteBarrier(DObject *pointed);
 
+	// Records that a pointer to the object was stored, so that it can't be
+	// freed by a minor collection. This is done for every store through a
+	// TObjPtr or a write barrier, but only in generational mode.
+	static inline void Remember(DObject *obj);
+
 	// Handles a read barrier.
 	template<class T> inline T *ReadBarrier(T *&obj)
 	{
@@ -298,7 +318,7 @@ namespace GC
 	// Forces a collection to start now.
 	static inline void StartCollection()
 	{
-		Threshold = AllocBytes;
+		Threshold = MajorThreshold = AllocBytes;
 	}
 
 	// Marks a white object gray. If the object wants to die, the pointer
@@ -358,6 +378,7 @@ public:
 	TObjPtr(T q) throw()
 		: pp(q)
 	{
+		GC::Remember(o);
 	}
 	TObjPtr(const TObjPtr<T> &q) throw()
 		: pp(q.pp)
@@ -365,7 +386,9 @@ public:
 	}
 	T operator=(T q) throw()
 	{
-		return pp = q;
+		pp = q;
+		GC::Remember(o);
+		return q;
 		// The caller must now perform a write barrier.
 	}
 	operator T() throw()
@@ -501,12 +524,12 @@ public:
 
 	void *operator new(size_t len)
 	{
-		return M_Malloc(len);
+		return FObjectPool::Alloc(len);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		FObjectPool::Free(mem);
 	}
 
 	// GC fiddling
@@ -573,7 +596,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		FObjectPool::Free (mem);
 	}
 };
 
@@ -582,8 +605,17 @@ class AInventory;//
 // When you write to a pointer to an Object, you must call this for
 // proper bookkeeping in case the Object holding this pointer has
 // already been processed by the GC.
+static inline void GC::Remember(DObject *obj)
+{
+	if (Generational && obj != NULL)
+	{
+		obj->ObjectFlags |= OF_Remembered;
+	}
+}
+
 static inline void GC::WriteBarrier(DObject *pointing, DObject *pointed)
 {
+	Remember(pointed);
 	if (pointed != NULL && pointed->IsWhite() && pointing->IsBlack())
 	{
 		Barrier(pointing, pointed);
@@ -592,6 +624,7 @@ static inline void GC::WriteBarrier(DObject *pointing, DObject *pointed)
 
 static inline void GC::WriteBarrier(DObject *pointed)
 {
+	Remember(pointed);
 	if (pointed != NULL && State == GCS_Propagate && pointed->IsWhite())
 	{
 		Barrier(NULL, pointed);
@@ -65,6 +65,7 @@
 #include "sbar.h"
 #include "stats.h"
 #include "c_dispatch.h"
+#include "c_cvars.h"
 #include "p_acs.h"
 #include "s_sndseq.h"
 #include "r_data/r_interpolate.h"
@@ -79,6 +80,7 @@
 #include "intermission/intermission.h"
 #include "g_levellocals.h"
 #include "events.h"
+#include "version.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -101,6 +103,13 @@
 */
 #define DEFAULT_GCMUL		400 // GC runs 'quadruple the speed' of memory allocation
 
+/*
+@@ DEFAULT_GCMINORMUL defines how much memory may be allocated between two
+@* minor collections in generational mode, as a percentage of the memory in
+@* use after the last full cycle.
+*/
+#define DEFAULT_GCMINORMUL	20
+
 // Number of sectors to mark for each step.
 #define SECTORSTEPSIZE	32
 #define POLYSTEPSIZE 120
@@ -141,10 +150,24 @@ extern DThinker *NextToThink;
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+// In generational mode, destroyed objects that nothing ever pointed to are
+// freed by cheap minor collections, and the incremental collector only runs
+// once memory use has grown by the full pause. Changes take effect when the
+// game is restarted.
+CUSTOM_CVAR(Bool, gc_generational, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (gamestate != GS_STARTUP && self != GC::Generational)
+	{
+		Printf("This won't take effect until " GAMENAME " is restarted.\n");
+	}
+}
+
 namespace GC
 {
 size_t AllocBytes;
 size_t Threshold;
+size_t MajorThreshold;
+bool Generational;
 size_t Estimate;
 DObject *Gray;
 DObject *Root;
@@ -154,6 +177,7 @@ uint32_t CurrentWhite = OF_White0 | OF_Fixed;
 EGCState State = GCS_Pause;
 int Pause = DEFAULT_GCPAUSE;
 int StepMul = DEFAULT_GCMUL;
+int MinorMul = DEFAULT_GCMINORMUL;
 int StepCount;
 size_t Dept;
 bool FinalGC;
@@ -162,6 +186,12 @@ bool FinalGC;
 
 static DSectorMarker *SectorMarker;
 
+// Statistics for the gc stat
+static cycle_t MinorTime, MajorTime;
+static double MinorMax, MajorMax;
+static int MinorCount;
+static size_t MinorFreed;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -174,7 +204,15 @@ static DSectorMarker *SectorMarker;
 
 void SetThreshold()
 {
-	Threshold = (Estimate / 100) * Pause;
+	MajorThreshold = (Estimate / 100) * Pause;
+	if (Generational)
+	{
+		Threshold = MIN(AllocBytes + (Estimate / 100) * MinorMul + GCSTEPSIZE, MajorThreshold);
+	}
+	else
+	{
+		Threshold = MajorThreshold;
+	}
 }
 
 //==========================================================================
@@ -235,6 +273,7 @@ static DObject **SweepList(DObject **p, size_t count, size_t *finalize_count)
 		{
 			assert(!curr->IsDead() || (curr->ObjectFlags & OF_Fixed));
 			curr->MakeWhite();	// make it white (for next cycle)
+			curr->ObjectFlags |= OF_Old;
 			p = &curr->ObjNext;
 		}
 		else	// must erase 'curr'
@@ -462,17 +501,106 @@ static size_t SingleStep()
 	}
 }
 
+//==========================================================================
+//
+// RememberRoots
+//
+// A few roots hold plain pointers that are assigned without a barrier.
+// Whatever they point to may not be freed by a minor collection.
+//
+//==========================================================================
+
+static void RememberRoots()
+{
+	int i;
+
+	for (i = 0; i < BODYQUESIZE; ++i)
+	{
+		Remember(bodyque[i]);
+	}
+	for (i = 0; i < MAXPLAYERS; i++)
+	{
+		if (playeringame[i])
+		{
+			Remember(players[i].mo);
+			Remember(players[i].ReadyWeapon);
+			if (players[i].PendingWeapon != WP_NOCHANGE)
+			{
+				Remember(players[i].PendingWeapon);
+			}
+		}
+	}
+	Remember(E_FirstEventHandler);
+	Remember(E_LastEventHandler);
+}
+
+//==========================================================================
+//
+// MinorCollection
+//
+// Frees the young objects that were destroyed before anything stored a
+// pointer to them, which is what most short-lived actors like puffs and
+// blood look like. Nothing is traced: destroyed thinkers have already been
+// unlinked from every list that holds them without a barrier, and every
+// other pointer store marks its target as remembered. Young objects are
+// always at the head of the root list, since new objects are prepended to
+// it and every sweep makes its survivors old, so only the objects created
+// since the last two minor collections need to be looked at.
+//
+//==========================================================================
+
+static size_t MinorCollection()
+{
+	DObject **p = &Root;
+	DObject *curr;
+	size_t freed = 0;
+
+	RememberRoots();
+	while ((curr = *p) != NULL && !(curr->ObjectFlags & OF_Old))
+	{
+		if ((curr->ObjectFlags & (OF_EuthanizeMe | OF_Remembered | OF_Fixed | OF_Rooted)) == OF_EuthanizeMe &&
+			curr != NextToThink)
+		{
+			*p = curr->ObjNext;
+			curr->ObjectFlags |= OF_Cleanup;
+			delete curr;
+			freed++;
+		}
+		else
+		{
+			curr->ObjectFlags |= (curr->ObjectFlags & OF_Survivor) ? OF_Old : OF_Survivor;
+			p = &curr->ObjNext;
+		}
+	}
+	return freed;
+}
+
 //==========================================================================
 //
 // Step
 //
 // Performs enough single steps to cover GCSTEPSIZE * StepMul% bytes of
-// memory.
+// memory. In generational mode, does a minor collection instead until
+// it is time for the next full cycle.
 //
 //==========================================================================
 
 void Step()
 {
+	if (Generational && State == GCS_Pause && AllocBytes < MajorThreshold)
+	{
+		MinorTime.Reset();
+		MinorTime.Clock();
+		MinorFreed += MinorCollection();
+		MinorCount++;
+		SetThreshold();
+		MinorTime.Unclock();
+		MinorMax = MAX(MinorMax, MinorTime.TimeMS());
+		return;
+	}
+
+	MajorTime.Reset();
+	MajorTime.Clock();
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
 	if (lim == 0)
@@ -503,6 +631,8 @@ void Step()
 		SetThreshold();
 	}
 	StepCount++;
+	MajorTime.Unclock();
+	MajorMax = MAX(MajorMax, MajorTime.TimeMS());
 }
 
 //==========================================================================
@@ -751,6 +881,12 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("\nMajor step: %.3f ms (max %.3f)", GC::MajorTime.TimeMS(), GC::MajorMax);
+	if (GC::Generational)
+	{
+		out.AppendFormat("  Minor: %.3f ms (max %.3f)  Minors: %d  Freed: %zu  Next major:%6zuK",
+			GC::MinorTime.TimeMS(), GC::MinorMax, GC::MinorCount, GC::MinorFreed, (GC::MajorThreshold + 1023) >> 10);
+	}
 	return out;
 }
 
@@ -766,7 +902,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]|minormul [size]\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -775,7 +911,7 @@ CCMD(gc)
 	}
 	else if (stricmp(argv[1], "now") == 0)
 	{
-		GC::Threshold = GC::AllocBytes;
+		GC::StartCollection();
 	}
 	else if (stricmp(argv[1], "full") == 0)
 	{
@@ -809,5 +945,16 @@ CCMD(gc)
 			GC::StepMul = MAX(100, atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "minormul") == 0)
+	{
+		if (argv.argc() == 2)
+		{
+			Printf ("Current GC minormul is %d\n", GC::MinorMul);
+		}
+		else
+		{
+			GC::MinorMul = MAX(1, atoi(argv[2]));
+		}
+	}
 }
 
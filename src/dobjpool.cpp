@@ -0,0 +1,283 @@
+/*
+** dobjpool.cpp
+** Size-classed slab pools for DObject memory
+**
+*/
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include "dobjpool.h"
+#include "dobject.h"
+#include "m_alloc.h"
+#include "i_system.h"
+#include "stats.h"
+
+enum
+{
+	POOL_GRANULARITY = 32,
+	MAX_POOLED_SIZE = 4096,		// including the header
+	NUM_SIZE_CLASSES = MAX_POOLED_SIZE / POOL_GRANULARITY,
+	SLAB_SIZE = 64 * 1024,
+};
+
+// Keeps the object behind it as aligned as malloc would.
+struct alignas(16) FPoolHeader
+{
+	int SizeClass;		// -1 if the block came from M_Malloc
+};
+
+struct FPoolFreeSlot
+{
+	FPoolFreeSlot *Next;
+};
+
+// Starts every slab. The slots follow it.
+struct alignas(16) FPoolSlab
+{
+	FPoolSlab *Next;
+};
+
+struct FSizeClass
+{
+	FPoolSlab *Slabs;
+	FPoolFreeSlot *FreeList;
+	size_t Capacity;
+	size_t Live;
+	size_t Allocs;
+	size_t Frees;
+};
+
+// Objects are created during static initialization, so everything here
+// must work without constructors having been run.
+static FSizeClass SizeClasses[NUM_SIZE_CLASSES];
+static FSizeClass LargeObjects;
+static size_t SlabCount;
+
+static inline size_t SlotSize(int sizeclass)
+{
+	return size_t(sizeclass + 1) * POOL_GRANULARITY;
+}
+
+static inline size_t SlotsPerSlab(int sizeclass)
+{
+	return (SLAB_SIZE - sizeof(FPoolSlab)) / SlotSize(sizeclass);
+}
+
+//==========================================================================
+//
+// Cuts a new slab into slots for the given size class. The slots are
+// linked in address order, so objects allocated one after the other end
+// up next to each other.
+//
+//==========================================================================
+
+static void NewSlab(int sizeclass)
+{
+	FPoolSlab *slab = (FPoolSlab *)malloc(SLAB_SIZE);
+	if (slab == nullptr)
+	{
+		I_FatalError("Could not allocate object pool slab");
+	}
+	SlabCount++;
+
+	FSizeClass &pool = SizeClasses[sizeclass];
+	slab->Next = pool.Slabs;
+	pool.Slabs = slab;
+
+	uint8_t *slots = (uint8_t *)(slab + 1);
+	size_t slotsize = SlotSize(sizeclass);
+	size_t count = SlotsPerSlab(sizeclass);
+	FPoolFreeSlot *next = pool.FreeList;
+	for (size_t i = count; i-- > 0; )
+	{
+		FPoolFreeSlot *slot = (FPoolFreeSlot *)(slots + i * slotsize);
+		slot->Next = next;
+		next = slot;
+	}
+	pool.FreeList = next;
+	pool.Capacity += count;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void *FObjectPool::Alloc(size_t size)
+{
+	size_t blocksize = size + sizeof(FPoolHeader);
+	FPoolHeader *header;
+
+	if (blocksize > MAX_POOLED_SIZE)
+	{
+		header = (FPoolHeader *)M_Malloc(blocksize);
+		header->SizeClass = -1;
+		LargeObjects.Live++;
+		LargeObjects.Allocs++;
+	}
+	else
+	{
+		int sizeclass = int((blocksize - 1) / POOL_GRANULARITY);
+		FSizeClass &pool = SizeClasses[sizeclass];
+		if (pool.FreeList == nullptr)
+		{
+			NewSlab(sizeclass);
+		}
+		header = (FPoolHeader *)pool.FreeList;
+		pool.FreeList = pool.FreeList->Next;
+		header->SizeClass = sizeclass;
+		pool.Live++;
+		pool.Allocs++;
+		GC::AllocBytes += SlotSize(sizeclass);
+	}
+	return header + 1;
+}
+
+//==========================================================================
+//
+// The most recently freed slot is the first to be reused, since it is the
+// one most likely to still be in the cache.
+//
+//==========================================================================
+
+void FObjectPool::Free(void *mem)
+{
+	if (mem == nullptr)
+	{
+		return;
+	}
+
+	FPoolHeader *header = (FPoolHeader *)mem - 1;
+	int sizeclass = header->SizeClass;
+	if (sizeclass < 0)
+	{
+		LargeObjects.Live--;
+		LargeObjects.Frees++;
+		M_Free(header);
+		return;
+	}
+
+	FSizeClass &pool = SizeClasses[sizeclass];
+	FPoolFreeSlot *slot = (FPoolFreeSlot *)header;
+	slot->Next = pool.FreeList;
+	pool.FreeList = slot;
+	pool.Live--;
+	pool.Frees++;
+	GC::AllocBytes -= SlotSize(sizeclass);
+}
+
+//==========================================================================
+//
+// Frees the slabs none of whose slots are in use. Slots are counted per
+// slab by walking the free list, so Alloc and Free don't need to track
+// them. The remaining free slots keep their order.
+//
+//==========================================================================
+
+void FObjectPool::ReleaseEmptySlabs()
+{
+	TArray<FPoolSlab *> slabs;
+	TArray<size_t> freecounts;
+
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		FSizeClass &pool = SizeClasses[i];
+		if (pool.Slabs == nullptr || pool.Live + SlotsPerSlab(i) > pool.Capacity)
+		{
+			continue;
+		}
+
+		slabs.Clear();
+		for (FPoolSlab *slab = pool.Slabs; slab != nullptr; slab = slab->Next)
+		{
+			slabs.Push(slab);
+		}
+		std::sort(&slabs[0], &slabs[0] + slabs.Size());
+		freecounts.Resize(slabs.Size());
+		memset(&freecounts[0], 0, freecounts.Size() * sizeof(size_t));
+
+		auto slabindex = [&](FPoolFreeSlot *slot)
+		{
+			return unsigned(std::upper_bound(&slabs[0], &slabs[0] + slabs.Size(), (FPoolSlab *)slot) - &slabs[0]) - 1;
+		};
+
+		for (FPoolFreeSlot *slot = pool.FreeList; slot != nullptr; slot = slot->Next)
+		{
+			freecounts[slabindex(slot)]++;
+		}
+
+		size_t perslab = SlotsPerSlab(i);
+		FPoolFreeSlot **link = &pool.FreeList;
+		while (*link != nullptr)
+		{
+			if (freecounts[slabindex(*link)] == perslab) *link = (*link)->Next;
+			else link = &(*link)->Next;
+		}
+
+		pool.Slabs = nullptr;
+		for (unsigned j = slabs.Size(); j-- > 0; )
+		{
+			if (freecounts[j] == perslab)
+			{
+				free(slabs[j]);
+				pool.Capacity -= perslab;
+				SlabCount--;
+			}
+			else
+			{
+				slabs[j]->Next = pool.Slabs;
+				pool.Slabs = slabs[j];
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// Shows how full each size class is and how many objects were allocated
+// and freed per second, measured over the last second.
+//
+//==========================================================================
+
+ADD_STAT(objpool)
+{
+	static unsigned lasttime;
+	static size_t lastallocs, lastfrees;
+	static size_t allocrate, freerate;
+
+	size_t allocs = LargeObjects.Allocs, frees = LargeObjects.Frees;
+	size_t live = 0, capacity = 0;
+	for (auto &pool : SizeClasses)
+	{
+		allocs += pool.Allocs;
+		frees += pool.Frees;
+		live += pool.Live;
+		capacity += pool.Capacity;
+	}
+
+	unsigned now = I_FPSTime();
+	if (now - lasttime >= 1000)
+	{
+		allocrate = (allocs - lastallocs) * 1000 / (now - lasttime);
+		freerate = (frees - lastfrees) * 1000 / (now - lasttime);
+		lastallocs = allocs;
+		lastfrees = frees;
+		lasttime = now;
+	}
+
+	FString out;
+	out.Format("Pooled: %zu/%zu in %zu slabs (%zuK)  Large: %zu  Allocs/s: %zu  Frees/s: %zu\n",
+		live, capacity, SlabCount, SlabCount * SLAB_SIZE >> 10, LargeObjects.Live, allocrate, freerate);
+
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		FSizeClass &pool = SizeClasses[i];
+		if (pool.Capacity > 0)
+		{
+			out.AppendFormat("%5zu: %6zu/%-6zu ", SlotSize(i) - sizeof(FPoolHeader), pool.Live, pool.Capacity);
+		}
+	}
+	return out;
+}
@@ -0,0 +1,29 @@
+#ifndef __DOBJPOOL_H__
+#define __DOBJPOOL_H__
+
+#include <stddef.h>
+
+// Memory for DObjects. Objects are grouped by size and carved out of slabs,
+// so the many short-lived actors a level spawns don't fragment the heap and
+// a slot freed by the garbage collector is handed out again to the next
+// object of a similar size. Objects too big for the pool go to M_Malloc.
+//
+// Each block starts with a small header saying where it came from. Objects
+// are freed through DObject's operator delete, which doesn't know the real
+// size of a scripted class.
+//
+// Slabs are kept when their objects are freed, since the next level will
+// need them again. ReleaseEmptySlabs gives the completely unused ones back
+// to the system; it is called when a level is torn down.
+//
+// Only the main thread may create or free objects.
+
+class FObjectPool
+{
+public:
+	static void *Alloc(size_t size);
+	static void Free(void *mem);
+	static void ReleaseEmptySlabs();
+};
+
+#endif //__DOBJPOOL_H__
@@ -1329,8 +1329,9 @@ PPointer::PPointer(PType *pointsat, bool isconst)
 void PPointer::SetOps()
 {
 	loadOp = (PointedType && PointedType->IsKindOf(RUNTIME_CLASS(PClass))) ? OP_LO : OP_LP;
-	// Non-destroyed thinkers are always guaranteed to be linked into the thinker chain so we don't need the write barrier for them.
-	storeOp = (loadOp == OP_LO && !static_cast<PClass*>(PointedType)->IsDescendantOf(RUNTIME_CLASS(DThinker))) ? OP_SO : OP_SP;
+	// Non-destroyed thinkers are always guaranteed to be linked into the thinker chain so the incremental collector
+	// doesn't need the write barrier for them, but generational mode needs to know about every stored object pointer.
+	storeOp = (loadOp == OP_LO && (GC::Generational || !static_cast<PClass*>(PointedType)->IsDescendantOf(RUNTIME_CLASS(DThinker)))) ? OP_SO : OP_SP;
 	moveOp = OP_MOVEA;
 	RegType = REGT_POINTER;
 }
@@ -3073,7 +3074,7 @@ PClass *PClass::FindClass (FName zaname)
 
 DObject *PClass::CreateNew()
 {
-	uint8_t *mem = (uint8_t *)M_Malloc (Size);
+	uint8_t *mem = (uint8_t *)FObjectPool::Alloc (Size);
 	assert (mem != nullptr);
 
 	// Set this object's defaults before constructing it.
@@ -3084,7 +3085,7 @@ DObject *PClass::CreateNew()
 
 	if (ConstructNative == nullptr)
 	{
-		M_Free(mem);
+		FObjectPool::Free(mem);
 		I_Error("Attempt to instantiate abstract class %s.", TypeName.GetChars());
 	}
 	ConstructNative (mem);
@@ -34,6 +34,7 @@
 
 #include "dthinker.h"
 #include "stats.h"
+#include "profiler.h"
 #include "p_local.h"
 #include "statnums.h"
 #include "i_system.h"
@@ -195,6 +196,7 @@ void DThinker::SerializeThinkers(FSerializer &arc, bool hubLoad)
 							}
 							// Thinkers with the OF_JustSpawned flag set go in the FreshThinkers
 							// list. Anything else goes in the regular Thinkers list.
+							thinker->StatNum = i;
 							if (thinker->ObjectFlags & OF_EuthanizeMe)
 							{
 								// This thinker was destroyed during the loading process. Do
@@ -240,6 +242,7 @@ DThinker::DThinker (int statnum) throw()
 	{
 		statnum = MAX_STATNUM;
 	}
+	StatNum = statnum;
 	FreshThinkers[statnum].AddTail (this);
 }
 
@@ -376,6 +379,7 @@ void DThinker::ChangeStatNum (int statnum)
 		statnum = MAX_STATNUM;
 	}
 	Remove();
+	StatNum = statnum;
 	if ((ObjectFlags & OF_JustSpawned) && statnum >= STAT_FIRST_THINKING)
 	{
 		list = &FreshThinkers[statnum];
@@ -462,6 +466,8 @@ void DThinker::RunThinkers ()
 {
 	int i, count;
 
+	PROFILE_ZONE("RunThinkers");
+
 	ThinkCycles.Reset();
 	BotSupportCycles.Reset();
 	ActionCycles.Reset();
@@ -472,6 +478,9 @@ void DThinker::RunThinkers ()
 	// Tick every thinker left from last time
 	for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 	{
+		// Sense phase: the players have moved by now, so this is the best
+		// time to work out the sight checks the monsters are going to make.
+		if (i == STAT_DEFAULT) P_SenseMonsters();
 		TickThinkers (&Thinkers[i], NULL);
 	}
 
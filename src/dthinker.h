@@ -76,6 +76,7 @@ public:
 	size_t PropagateMark();
 	
 	void ChangeStatNum (int statnum);
+	int GetStatNum () const { return StatNum; }
 
 	static void RunThinkers ();
 	static void RunThinkers (int statnum);
@@ -108,6 +109,7 @@ private:
 	friend class FSerializer;
 
 	DThinker *NextThinker, *PrevThinker;
+	uint8_t StatNum;		// the list this thinker is linked into
 };
 
 class FThinkerIterator
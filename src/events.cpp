@@ -7,10 +7,70 @@
 #include "actor.h"
 #include "c_dispatch.h"
 #include "d_net.h"
+#include "stats.h"
+#include "i_system.h"
 
 DStaticEventHandler* E_FirstEventHandler = nullptr;
 DStaticEventHandler* E_LastEventHandler = nullptr;
 
+struct FEventSubscribers
+{
+	DStaticEventHandler* First;
+	DStaticEventHandler* Last;
+	// for stat events
+	cycle_t Time;
+	unsigned Calls;
+	int Depth;
+};
+
+static FEventSubscribers E_Subscribers[NUM_HANDLER_EVENTS];
+
+static const char* const E_EventNames[NUM_HANDLER_EVENTS] =
+{
+	"WorldLoaded", "WorldUnloaded", "WorldThingSpawned", "WorldThingDied", "WorldThingRevived",
+	"WorldThingDamaged", "WorldThingDestroyed", "WorldLightning", "WorldTick", "RenderFrame",
+	"RenderOverlay", "PlayerEntered", "PlayerRespawned", "PlayerDied", "PlayerDisconnected",
+	"UiTick", "ConsoleProcess", "NetworkProcess"
+};
+
+// times an event, but only once if it is sent again by one of its own handlers.
+struct FEventTimer
+{
+	FEventSubscribers& Sub;
+
+	FEventTimer(FEventSubscribers& sub) : Sub(sub)
+	{
+		if (Sub.Depth++ == 0) Sub.Time.Clock();
+	}
+	~FEventTimer()
+	{
+		if (--Sub.Depth == 0) Sub.Time.Unclock();
+	}
+};
+
+// rebuild the per-event lists from the main list, keeping its order.
+// handlers that are unlinked keep their pointers, so that an event that is being sent can continue.
+static void E_UpdateSubscribers()
+{
+	for (int i = 0; i < NUM_HANDLER_EVENTS; i++)
+		E_Subscribers[i].First = E_Subscribers[i].Last = nullptr;
+
+	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	{
+		for (int i = 0; i < NUM_HANDLER_EVENTS; i++)
+		{
+			FEventSubscribers& sub = E_Subscribers[i];
+			handler->EventNext[i] = handler->EventPrev[i] = nullptr;
+			if (!(handler->Subscriptions & (1u << i)))
+				continue;
+			handler->EventPrev[i] = sub.Last;
+			if (sub.Last != nullptr) sub.Last->EventNext[i] = handler;
+			else sub.First = handler;
+			sub.Last = handler;
+		}
+	}
+}
+
 bool E_RegisterHandler(DStaticEventHandler* handler)
 {
 	if (handler == nullptr || handler->ObjectFlags & OF_EuthanizeMe)
@@ -19,6 +79,7 @@ bool E_RegisterHandler(DStaticEventHandler* handler)
 		return false;
 
 	handler->OnRegister();
+	handler->Subscriptions = handler->GetOverriddenEvents();
 	
 	// link into normal list
 	// update: link at specific position based on order.
@@ -76,6 +137,7 @@ bool E_RegisterHandler(DStaticEventHandler* handler)
 		handler->ObjectFlags |= OF_Transient;
 	}
 
+	E_UpdateSubscribers();
 	return true;
 }
 
@@ -109,6 +171,7 @@ bool E_UnregisterHandler(DStaticEventHandler* handler)
 		E_LastEventHandler = handler->prev;
 		GC::WriteBarrier(handler->prev);
 	}
+	E_UpdateSubscribers();
 	if (handler->IsStatic())
 	{
 		handler->ObjectFlags &= ~OF_Transient;
@@ -285,10 +348,26 @@ void E_Shutdown(bool map)
 	}
 }
 
+// for (each handler that overrides the event, in order) and its reverse.
+// this returns from the function if nobody listens, so it must come last.
+#define FOR_EACH_SUBSCRIBER(ev, handler) \
+	FEventSubscribers& sub = E_Subscribers[ev]; \
+	if (sub.First == nullptr) return; \
+	FEventTimer timer(sub); \
+	for (DStaticEventHandler* handler = sub.First; handler; handler = handler->EventNext[ev])
+#define FOR_EACH_SUBSCRIBER_REVERSE(ev, handler) \
+	FEventSubscribers& sub = E_Subscribers[ev]; \
+	if (sub.Last == nullptr) return; \
+	FEventTimer timer(sub); \
+	for (DStaticEventHandler* handler = sub.Last; handler; handler = handler->EventPrev[ev])
+
 #define DEFINE_EVENT_LOOPER(name) void E_##name() \
 { \
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next) \
+	FOR_EACH_SUBSCRIBER(EHE_##name, handler) \
+	{ \
+		sub.Calls++; \
 		handler->name(); \
+	} \
 }
 
 // note for the functions below.
@@ -297,37 +376,41 @@ void E_Shutdown(bool map)
 // Because the main point of safe WorldLoaded/Unloading is that it will be preserved in savegames.
 void E_WorldLoaded()
 {
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldLoaded, handler)
 	{
 		if (handler->IsStatic()) continue;
 		if (savegamerestore) continue; // don't execute WorldLoaded for handlers loaded from the savegame.
+		sub.Calls++;
 		handler->WorldLoaded();
 	}
 }
 
 void E_WorldUnloaded()
 {
-	for (DStaticEventHandler* handler = E_LastEventHandler; handler; handler = handler->prev)
+	FOR_EACH_SUBSCRIBER_REVERSE(EHE_WorldUnloaded, handler)
 	{
 		if (handler->IsStatic()) continue;
+		sub.Calls++;
 		handler->WorldUnloaded();
 	}
 }
 
 void E_WorldLoadedUnsafe()
 {
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldLoaded, handler)
 	{
 		if (!handler->IsStatic()) continue;
+		sub.Calls++;
 		handler->WorldLoaded();
 	}
 }
 
 void E_WorldUnloadedUnsafe()
 {
-	for (DStaticEventHandler* handler = E_LastEventHandler; handler; handler = handler->prev)
+	FOR_EACH_SUBSCRIBER_REVERSE(EHE_WorldUnloaded, handler)
 	{
 		if (!handler->IsStatic()) continue;
+		sub.Calls++;
 		handler->WorldUnloaded();
 	}
 }
@@ -337,8 +420,11 @@ void E_WorldThingSpawned(AActor* actor)
 	// don't call anything if actor was destroyed on PostBeginPlay/BeginPlay/whatever.
 	if (actor->ObjectFlags & OF_EuthanizeMe)
 		return;
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldThingSpawned, handler)
+	{
+		sub.Calls++;
 		handler->WorldThingSpawned(actor);
+	}
 }
 
 void E_WorldThingDied(AActor* actor, AActor* inflictor)
@@ -346,8 +432,11 @@ void E_WorldThingDied(AActor* actor, AActor* inflictor)
 	// don't call anything if actor was destroyed on PostBeginPlay/BeginPlay/whatever.
 	if (actor->ObjectFlags & OF_EuthanizeMe)
 		return;
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldThingDied, handler)
+	{
+		sub.Calls++;
 		handler->WorldThingDied(actor, inflictor);
+	}
 }
 
 void E_WorldThingRevived(AActor* actor)
@@ -355,8 +444,11 @@ void E_WorldThingRevived(AActor* actor)
 	// don't call anything if actor was destroyed on PostBeginPlay/BeginPlay/whatever.
 	if (actor->ObjectFlags & OF_EuthanizeMe)
 		return;
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldThingRevived, handler)
+	{
+		sub.Calls++;
 		handler->WorldThingRevived(actor);
+	}
 }
 
 void E_WorldThingDamaged(AActor* actor, AActor* inflictor, AActor* source, int damage, FName mod, int flags, DAngle angle)
@@ -364,8 +456,11 @@ void E_WorldThingDamaged(AActor* actor, AActor* inflictor, AActor* source, int d
 	// don't call anything if actor was destroyed on PostBeginPlay/BeginPlay/whatever.
 	if (actor->ObjectFlags & OF_EuthanizeMe)
 		return;
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_WorldThingDamaged, handler)
+	{
+		sub.Calls++;
 		handler->WorldThingDamaged(actor, inflictor, source, damage, mod, flags, angle);
+	}
 }
 
 void E_WorldThingDestroyed(AActor* actor)
@@ -377,8 +472,11 @@ void E_WorldThingDestroyed(AActor* actor)
 	// this is because Destroyed should be reverse of Spawned. we don't want to catch random inventory give failures.
 	if (!(actor->ObjectFlags & OF_Spawned))
 		return;
-	for (DStaticEventHandler* handler = E_LastEventHandler; handler; handler = handler->prev)
+	FOR_EACH_SUBSCRIBER_REVERSE(EHE_WorldThingDestroyed, handler)
+	{
+		sub.Calls++;
 		handler->WorldThingDestroyed(actor);
+	}
 }
 
 void E_PlayerEntered(int num, bool fromhub)
@@ -388,26 +486,38 @@ void E_PlayerEntered(int num, bool fromhub)
 	if (savegamerestore && !fromhub)
 		return;
 
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_PlayerEntered, handler)
+	{
+		sub.Calls++;
 		handler->PlayerEntered(num, fromhub);
+	}
 }
 
 void E_PlayerRespawned(int num)
 {
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_PlayerRespawned, handler)
+	{
+		sub.Calls++;
 		handler->PlayerRespawned(num);
+	}
 }
 
 void E_PlayerDied(int num)
 {
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	FOR_EACH_SUBSCRIBER(EHE_PlayerDied, handler)
+	{
+		sub.Calls++;
 		handler->PlayerDied(num);
+	}
 }
 
 void E_PlayerDisconnected(int num)
 {
-	for (DStaticEventHandler* handler = E_LastEventHandler; handler; handler = handler->prev)
+	FOR_EACH_SUBSCRIBER_REVERSE(EHE_PlayerDisconnected, handler)
+	{
+		sub.Calls++;
 		handler->PlayerDisconnected(num);
+	}
 }
 
 bool E_Responder(const event_t* ev)
@@ -444,8 +554,12 @@ bool E_Responder(const event_t* ev)
 
 void E_Console(int player, FString name, int arg1, int arg2, int arg3, bool manual)
 {
-	for (DStaticEventHandler* handler = E_FirstEventHandler; handler; handler = handler->next)
+	// negative player means a local event, which goes to ConsoleProcess instead of NetworkProcess.
+	FOR_EACH_SUBSCRIBER(player < 0 ? EHE_ConsoleProcess : EHE_NetworkProcess, handler)
+	{
+		sub.Calls++;
 		handler->ConsoleProcess(player, name, arg1, arg2, arg3, manual);
+	}
 }
 
 bool E_CheckUiProcessors()
@@ -613,6 +727,40 @@ DEFINE_EMPTY_HANDLER(DStaticEventHandler, NetworkProcess);
 //
 // ===========================================
 
+// one bit for each EHandlerEvent this handler's class overrides.
+#define CHECK_OVERRIDE(name, ev) \
+	{ \
+		IFVIRTUAL(DStaticEventHandler, name) \
+		{ \
+			if (func != DStaticEventHandler_##name##_VMPtr) \
+				events |= 1u << ev; \
+		} \
+	}
+
+unsigned DStaticEventHandler::GetOverriddenEvents()
+{
+	unsigned events = 0;
+	CHECK_OVERRIDE(WorldLoaded, EHE_WorldLoaded);
+	CHECK_OVERRIDE(WorldUnloaded, EHE_WorldUnloaded);
+	CHECK_OVERRIDE(WorldThingSpawned, EHE_WorldThingSpawned);
+	CHECK_OVERRIDE(WorldThingDied, EHE_WorldThingDied);
+	CHECK_OVERRIDE(WorldThingRevived, EHE_WorldThingRevived);
+	CHECK_OVERRIDE(WorldThingDamaged, EHE_WorldThingDamaged);
+	CHECK_OVERRIDE(WorldThingDestroyed, EHE_WorldThingDestroyed);
+	CHECK_OVERRIDE(WorldLightning, EHE_WorldLightning);
+	CHECK_OVERRIDE(WorldTick, EHE_WorldTick);
+	CHECK_OVERRIDE(RenderFrame, EHE_RenderFrame);
+	CHECK_OVERRIDE(RenderOverlay, EHE_RenderOverlay);
+	CHECK_OVERRIDE(PlayerEntered, EHE_PlayerEntered);
+	CHECK_OVERRIDE(PlayerRespawned, EHE_PlayerRespawned);
+	CHECK_OVERRIDE(PlayerDied, EHE_PlayerDied);
+	CHECK_OVERRIDE(PlayerDisconnected, EHE_PlayerDisconnected);
+	CHECK_OVERRIDE(UiTick, EHE_UiTick);
+	CHECK_OVERRIDE(ConsoleProcess, EHE_ConsoleProcess);
+	CHECK_OVERRIDE(NetworkProcess, EHE_NetworkProcess);
+	return events;
+}
+
 void DStaticEventHandler::OnRegister()
 {
 	IFVIRTUAL(DStaticEventHandler, OnRegister)
@@ -1080,3 +1228,40 @@ CCMD(netevent)
 		E_SendNetworkEvent(argv[1], arg[0], arg[1], arg[2], true);
 	}
 }
+
+// handlers per event, and how often and how long they were called over the last second.
+ADD_STAT(events)
+{
+	static unsigned lasttime;
+	static unsigned lastcalls[NUM_HANDLER_EVENTS], callrate[NUM_HANDLER_EVENTS];
+	static double lastms[NUM_HANDLER_EVENTS], msrate[NUM_HANDLER_EVENTS];
+
+	unsigned now = I_FPSTime();
+	if (now - lasttime >= 1000)
+	{
+		for (int i = 0; i < NUM_HANDLER_EVENTS; i++)
+		{
+			FEventSubscribers& sub = E_Subscribers[i];
+			double ms = sub.Time.TimeMS();
+			callrate[i] = (sub.Calls - lastcalls[i]) * 1000 / (now - lasttime);
+			msrate[i] = (ms - lastms[i]) * 1000 / (now - lasttime);
+			lastcalls[i] = sub.Calls;
+			lastms[i] = ms;
+		}
+		lasttime = now;
+	}
+
+	FString out;
+	for (int i = 0; i < NUM_HANDLER_EVENTS; i++)
+	{
+		int count = 0;
+		for (DStaticEventHandler* handler = E_Subscribers[i].First; handler; handler = handler->EventNext[i])
+			count++;
+		if (count == 0 && callrate[i] == 0)
+			continue;
+		out.AppendFormat("%-20s %2d handlers %6u calls/s %7.3f ms/s\n", E_EventNames[i], count, callrate[i], msrate[i]);
+	}
+	if (out.IsEmpty())
+		out = "No event handlers are listening";
+	return out;
+}
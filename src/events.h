@@ -73,6 +73,31 @@ bool E_CheckRequireMouse();
 // serialization stuff
 void E_SerializeEvents(FSerializer& arc);
 
+// events that are only sent to the handlers that override them
+enum EHandlerEvent
+{
+	EHE_WorldLoaded,
+	EHE_WorldUnloaded,
+	EHE_WorldThingSpawned,
+	EHE_WorldThingDied,
+	EHE_WorldThingRevived,
+	EHE_WorldThingDamaged,
+	EHE_WorldThingDestroyed,
+	EHE_WorldLightning,
+	EHE_WorldTick,
+	EHE_RenderFrame,
+	EHE_RenderOverlay,
+	EHE_PlayerEntered,
+	EHE_PlayerRespawned,
+	EHE_PlayerDied,
+	EHE_PlayerDisconnected,
+	EHE_UiTick,
+	EHE_ConsoleProcess,
+	EHE_NetworkProcess,
+
+	NUM_HANDLER_EVENTS
+};
+
 // ==============================================
 //
 //  EventHandler - base class
@@ -90,12 +115,21 @@ public:
 		next = 0;
 		Order = 0;
 		IsUiProcessor = false;
+		Subscriptions = 0;
+		for (int i = 0; i < NUM_HANDLER_EVENTS; i++)
+			EventNext[i] = EventPrev[i] = nullptr;
 	}
 
 	DStaticEventHandler* prev;
 	DStaticEventHandler* next;
 	virtual bool IsStatic() { return true; }
 
+	// the same list, but only with the handlers that override each event. set up by E_RegisterHandler.
+	unsigned Subscriptions;
+	DStaticEventHandler* EventNext[NUM_HANDLER_EVENTS];
+	DStaticEventHandler* EventPrev[NUM_HANDLER_EVENTS];
+	unsigned GetOverriddenEvents();
+
 	//
 	int Order;
 	bool IsUiProcessor;
@@ -38,6 +38,14 @@
 #endif
 #include "LzmaDec.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+
 #include "files.h"
 #include "i_system.h"
 #include "templates.h"
@@ -601,6 +609,120 @@ char *MemoryArrayReader::Gets(char *strbuf, int len)
     return GetsFromBuffer((char*)&buf[0], strbuf, len);
 }
 
+//==========================================================================
+//
+// MappedFileReader
+//
+// reads data from a memory mapped file
+//
+//==========================================================================
+
+MappedFileReader::MappedFileReader (const char *filename)
+: FileReader(filename), Mapping(NULL)
+{
+	Map();
+}
+
+MappedFileReader::~MappedFileReader ()
+{
+	Unmap();
+}
+
+//==========================================================================
+//
+// The FILE stays open so that lumps can still be streamed from it and
+// the file can be reopened by name, but all reads through this object
+// come from the mapping.
+//
+//==========================================================================
+
+void MappedFileReader::Map ()
+{
+#ifdef _WIN32
+	MapHandle = NULL;
+#endif
+	if (Length <= 0)
+	{
+		return;
+	}
+#ifdef _WIN32
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(File));
+	MapHandle = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (MapHandle != NULL)
+	{
+		Mapping = (const char *)MapViewOfFile(MapHandle, FILE_MAP_READ, 0, 0, Length);
+		if (Mapping == NULL)
+		{
+			CloseHandle(MapHandle);
+			MapHandle = NULL;
+		}
+	}
+#else
+	void *map = mmap(NULL, Length, PROT_READ, MAP_PRIVATE, fileno(File), 0);
+	if (map != MAP_FAILED)
+	{
+		Mapping = (const char *)map;
+	}
+#endif
+	FilePos = 0;
+}
+
+void MappedFileReader::Unmap ()
+{
+	if (Mapping == NULL)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(Mapping);
+	CloseHandle(MapHandle);
+	MapHandle = NULL;
+#else
+	munmap((void *)Mapping, Length);
+#endif
+	Mapping = NULL;
+}
+
+long MappedFileReader::Tell () const
+{
+	if (Mapping == NULL) return FileReader::Tell();
+	return FilePos;
+}
+
+long MappedFileReader::Seek (long offset, int origin)
+{
+	if (Mapping == NULL) return FileReader::Seek(offset, origin);
+	switch (origin)
+	{
+	case SEEK_CUR:
+		offset+=FilePos;
+		break;
+
+	case SEEK_END:
+		offset+=Length;
+		break;
+
+	}
+	FilePos=clamp<long>(offset,0,Length);
+	return 0;
+}
+
+long MappedFileReader::Read (void *buffer, long len)
+{
+	if (Mapping == NULL) return FileReader::Read(buffer, len);
+	if (len>Length-FilePos) len=Length-FilePos;
+	if (len<0) len=0;
+	memcpy(buffer,Mapping+FilePos,len);
+	FilePos+=len;
+	return len;
+}
+
+char *MappedFileReader::Gets(char *strbuf, int len)
+{
+	if (Mapping == NULL) return FileReader::Gets(strbuf, len);
+	return GetsFromBuffer(Mapping, strbuf, len);
+}
+
 //==========================================================================
 //
 // FileWriter (the motivation here is to have a buffer writing subclass)
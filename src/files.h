@@ -336,6 +336,33 @@ protected:
 	const char * bufptr;
 };
 
+// Reads a file through a read-only memory mapping. GetBuffer() returns the
+// mapped file, so resource files opened with this can hand out views into
+// it instead of copying uncompressed lumps to the heap. The mapping is never
+// writable; code that needs to modify lump data must make its own copy.
+// If the file cannot be mapped this behaves like a plain FileReader.
+class MappedFileReader : public FileReader
+{
+public:
+	MappedFileReader (const char *filename);
+	~MappedFileReader ();
+
+	virtual long Tell () const;
+	virtual long Seek (long offset, int origin);
+	virtual long Read (void *buffer, long len);
+	virtual char *Gets(char *strbuf, int len);
+	virtual const char *GetBuffer() const { return Mapping; }
+
+protected:
+	void Map ();
+	void Unmap ();
+
+	const char *Mapping;
+#ifdef _WIN32
+	void *MapHandle;
+#endif
+};
+
 class MemoryArrayReader : public FileReader
 {
 public:
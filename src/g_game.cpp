@@ -29,6 +29,8 @@
 #include <stddef.h>
 #include <time.h>
 #include <memory>
+#include <thread>
+#include <atomic>
 #ifdef __APPLE__
 #include <CoreServices/CoreServices.h>
 #endif
@@ -50,6 +52,8 @@
 #include "p_saveg.h"
 #include "p_tick.h"
 #include "d_main.h"
+#include "d_benchmark.h"
+#include "profiler.h"
 #include "wi_stuff.h"
 #include "hu_stuff.h"
 #include "st_stuff.h"
@@ -93,6 +97,7 @@
 #include "g_hub.h"
 #include "g_levellocals.h"
 #include "events.h"
+#include "stats.h"
 
 
 static FRandom pr_dmspawn ("DMSpawn");
@@ -112,7 +117,7 @@ void	G_DoPlayDemo (void);
 void	G_DoCompleted (void);
 void	G_DoVictory (void);
 void	G_DoWorldDone (void);
-void	G_DoSaveGame (bool okForQuicksave, FString filename, const char *description);
+void	G_DoSaveGame (bool okForQuicksave, FString filename, const char *description, bool background = false);
 void	G_DoAutoSave ();
 
 void STAT_Serialize(FSerializer &file);
@@ -120,12 +125,14 @@ bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompress
 
 FIntCVar gameskill ("skill", 2, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR(Bool, save_formatted, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use formatted JSON for saves (more readable but a larger files and a bit slower.
+CVAR(Bool, save_binary, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use the binary format for the level and global data in saves. Smaller and a lot faster to write.
 CVAR (Int, deathmatch, 0, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR (Bool, chasedemo, false, 0);
 CVAR (Bool, storesavepic, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, longsavemessages, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (String, save_dir, "", CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 CVAR (Bool, cl_waitforsave, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR (Bool, autosaveasync, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);	// compress and write autosaves in the background
 EXTERN_CVAR (Float, con_midtime);
 
 //==========================================================================
@@ -1048,6 +1055,8 @@ extern FTexture *Page;
 
 void G_Ticker ()
 {
+	PROFILE_ZONE("G_Ticker");
+
 	int i;
 	gamestate_t	oldgamestate;
 
@@ -1074,6 +1083,8 @@ void G_Ticker ()
 		AddCommandString (toggle_fullscreen);
 	}
 
+	G_CheckAsyncSave(false);
+
 	// do things to change the game state
 	oldgamestate = gamestate;
 	while (gameaction != ga_nothing)
@@ -1933,6 +1944,9 @@ void G_DoLoadGame ()
 	hidecon = gameaction == ga_loadgamehidecon;
 	gameaction = ga_nothing;
 
+	// The savegame may still be in the process of being written.
+	G_CheckAsyncSave(true);
+
 	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile(savename.GetChars(), nullptr, true, true));
 	if (resfile == nullptr)
 	{
@@ -2186,7 +2200,7 @@ void G_DoAutoSave ()
 
 	readableTime = myasctime ();
 	description.Format("Autosave %.12s", readableTime + 4);
-	G_DoSaveGame (false, file, description);
+	G_DoSaveGame (false, file, description, autosaveasync);
 }
 
 
@@ -2251,7 +2265,165 @@ static void PutSavePic (FileWriter *file, int width, int height)
 	}
 }
 
-void G_DoSaveGame (bool okForQuicksave, FString filename, const char *description)
+//==========================================================================
+//
+// Background saving
+//
+// With autosaveasync set, autosaves only serialize the game on the game
+// thread. Compressing the data, packaging it into the zip and writing it
+// to disk is done by a worker thread while the game continues. Everything
+// the worker uses is owned by the FAsyncSave object, so nothing it touches
+// can change under its feet.
+//
+//==========================================================================
+
+struct FAsyncSave
+{
+	std::thread Thread;
+	std::atomic<bool> Done;
+	bool Success = false;
+	bool OkForQuicksave;
+	FString Filename;
+	FString Description;
+	TArray<FString> Filenames;
+	TArray<FCompressedBuffer> Content;
+	TArray<bool> Compress;
+	double BackgroundTime = 0;
+
+	~FAsyncSave()
+	{
+		for (auto &buff : Content)
+		{
+			buff.Clean();
+		}
+	}
+};
+
+static FAsyncSave *AsyncSave;
+static double LastSaveStall, LastSaveBackground;
+static bool LastSaveAsync;
+
+static void AsyncSaveProc(FAsyncSave *save)
+{
+	cycle_t time;
+	time.Reset();
+	time.Clock();
+	for (unsigned i = 0; i < save->Content.Size(); i++)
+	{
+		if (save->Compress[i])
+		{
+			FCompressedBuffer &buff = save->Content[i];
+			FCompressedBuffer packed = FSerializer::CompressBuffer(buff.mBuffer, buff.mSize);
+			buff.Clean();
+			buff = packed;
+		}
+	}
+	save->Success = WriteZip(save->Filename, save->Filenames, save->Content);
+	if (save->Success)
+	{
+		// Check whether the file is ok by trying to open it.
+		FResourceFile *test = FResourceFile::OpenResourceFile(save->Filename, nullptr, true);
+		save->Success = test != nullptr;
+		delete test;
+	}
+	time.Unclock();
+	save->BackgroundTime = time.TimeMS();
+	save->Done = true;
+}
+
+static void G_WaitForAsyncSave()
+{
+	if (AsyncSave != nullptr)
+	{
+		AsyncSave->Thread.join();
+		delete AsyncSave;
+		AsyncSave = nullptr;
+	}
+}
+
+//==========================================================================
+//
+// Hands the contents of a savegame over to a worker thread. Buffers that
+// still belong to someone else are copied, the others are taken over and
+// cleared in the passed array. Strings are copied as well because FString
+// is reference counted without any synchronization.
+//
+//==========================================================================
+
+static void G_StartAsyncSave(const FString &filename, const char *description, bool okForQuicksave,
+	TArray<FString> &filenames, TArray<FCompressedBuffer> &content, TArray<bool> &owned)
+{
+	static bool registered;
+	if (!registered)
+	{
+		atterm(G_WaitForAsyncSave);
+		registered = true;
+	}
+
+	auto save = new FAsyncSave;
+	save->Done = false;
+	save->OkForQuicksave = okForQuicksave;
+	save->Filename = filename.GetChars();
+	save->Description = description;
+	for (unsigned i = 0; i < content.Size(); i++)
+	{
+		FCompressedBuffer buff = content[i];
+		if (owned[i])
+		{
+			content[i].mBuffer = nullptr;
+		}
+		else
+		{
+			buff.mBuffer = new char[buff.mCompressedSize];
+			memcpy(buff.mBuffer, content[i].mBuffer, buff.mCompressedSize);
+		}
+		save->Filenames.Push(filenames[i].GetChars());
+		save->Content.Push(buff);
+		save->Compress.Push(owned[i] && buff.mMethod == METHOD_STORED);
+	}
+	AsyncSave = save;
+	save->Thread = std::thread(AsyncSaveProc, save);
+}
+
+//==========================================================================
+//
+// Reports a finished background save. If wait is true, this blocks until
+// the current one is done, which is needed before anything else accesses
+// the file.
+//
+//==========================================================================
+
+void G_CheckAsyncSave(bool wait)
+{
+	if (AsyncSave == nullptr || (!wait && !AsyncSave->Done))
+	{
+		return;
+	}
+
+	FAsyncSave *save = AsyncSave;
+	AsyncSave = nullptr;
+	save->Thread.join();
+	LastSaveBackground = save->BackgroundTime;
+
+	if (save->Success)
+	{
+		savegameManager.NotifyNewSave(save->Filename, save->Description, save->OkForQuicksave);
+		if (longsavemessages) Printf ("%s (%s)\n", GStrings("GGSAVED"), save->Filename.GetChars());
+		else Printf ("%s\n", GStrings("GGSAVED"));
+	}
+	else Printf(PRINT_HIGH, "Save failed\n");
+	delete save;
+}
+
+ADD_STAT(savegame)
+{
+	FString out;
+	out.Format("Last save: %s, game thread %.2f ms, background %.2f ms%s",
+		LastSaveAsync ? "async" : "sync", LastSaveStall, LastSaveBackground, AsyncSave != nullptr ? " (writing)" : "");
+	return out;
+}
+
+void G_DoSaveGame (bool okForQuicksave, FString filename, const char *description, bool background)
 {
 	TArray<FCompressedBuffer> savegame_content;
 	TArray<FString> savegame_filenames;
@@ -2265,6 +2437,13 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 		return;
 	}
 
+	// A previous save may still be writing to the same file.
+	G_CheckAsyncSave(true);
+
+	cycle_t savetime;
+	savetime.Reset();
+	savetime.Clock();
+
 	if (demoplayback)
 	{
 		filename = G_BuildSaveName ("demosave." SAVEGAME_EXT, -1);
@@ -2276,7 +2455,7 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 	insave = true;
 	try
 	{
-		G_SnapshotLevel();
+		G_SnapshotLevel(!background);
 	}
 	catch(CRecoverableError &err)
 	{
@@ -2303,7 +2482,7 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 	FSerializer savegameglobals;	// and this for non-level related info that must be saved.
 
 	savegameinfo.OpenWriter(true);
-	savegameglobals.OpenWriter(save_formatted);
+	savegameglobals.OpenSaveWriter();
 
 	SaveVersion = SAVEVER;
 	PutSavePic(&savepic, SAVEPICWIDTH, SAVEPICHEIGHT);
@@ -2357,13 +2536,37 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 
 	savegame_content.Push(bufpng);
 	savegame_filenames.Push("savepic.png");
-	savegame_content.Push(savegameinfo.GetCompressedOutput());
+	savegame_content.Push(background ? savegameinfo.GetStoredOutput() : savegameinfo.GetCompressedOutput());
 	savegame_filenames.Push("info.json");
-	savegame_content.Push(savegameglobals.GetCompressedOutput());
+	savegame_content.Push(background ? savegameglobals.GetStoredOutput() : savegameglobals.GetCompressedOutput());
 	savegame_filenames.Push("globals.json");
 
 	G_WriteSnapshots (savegame_filenames, savegame_content);
-	
+
+	if (background)
+	{
+		// The JSON buffers created above and the snapshot of the current level
+		// are not needed here anymore and can be given to the save thread.
+		TArray<bool> owned;
+		for (auto &buff : savegame_content)
+		{
+			owned.Push(buff.mBuffer == level.info->Snapshot.mBuffer);
+		}
+		owned[1] = owned[2] = true;
+		G_StartAsyncSave(filename, description, okForQuicksave, savegame_filenames, savegame_content, owned);
+		level.info->Snapshot.mBuffer = nullptr;
+		level.info->Snapshot.Clean();
+
+		BackupSaveName = filename;
+		insave = false;
+		I_FreezeTime(false);
+
+		savetime.Unclock();
+		LastSaveStall = savetime.TimeMS();
+		LastSaveBackground = 0;
+		LastSaveAsync = true;
+		return;
+	}
 
 	WriteZip(filename, savegame_filenames, savegame_content);
 
@@ -2392,6 +2595,11 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 		
 	insave = false;
 	I_FreezeTime(false);
+
+	savetime.Unclock();
+	LastSaveStall = savetime.TimeMS();
+	LastSaveBackground = 0;
+	LastSaveAsync = false;
 }
 
 
@@ -2916,6 +3124,11 @@ bool G_CheckDemoStatus (void)
 		{
 			if (timingdemo)
 			{
+				if (benchmarking)
+				{
+					D_BenchmarkDemoEnded ();
+				}
+
 				// Trying to get back to a stable state after timing a demo
 				// seems to cause problems. I don't feel like fixing that
 				// right now.
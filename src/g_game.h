@@ -49,6 +49,7 @@ void G_DoLoadGame (void);
 
 // Called by M_Responder.
 void G_SaveGame (const char *filename, const char *description);
+void G_CheckAsyncSave (bool wait);
 
 // Only called by startup code.
 void G_RecordDemo (const char* name);
@@ -466,7 +466,7 @@ void G_ParseMapInfo (FString basemapinfo);
 
 void G_ClearSnapshots (void);
 void P_RemoveDefereds ();
-void G_SnapshotLevel (void);
+void G_SnapshotLevel (bool compress = true);
 void G_UnSnapshotLevel (bool keepPlayers);
 void G_ReadSnapshots (FResourceFile *);
 void G_WriteSnapshots (TArray<FString> &, TArray<FCompressedBuffer> &);
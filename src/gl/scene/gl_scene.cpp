@@ -1196,8 +1196,14 @@ void FGLInterface::Precache(BYTE *texhitlist, TMap<PClassActor*, bool> &actorhit
 	if (gl_precache)
 	{
 		// cache all used textures
+		FTexturePrefetcher prefetch;
 		for (int i = cnt - 1; i >= 0; i--)
 		{
+			if (texhitlist[i] || spritehitlist[i] != nullptr) prefetch.Add(TexMan.ByIndex(i));
+		}
+		for (int i = cnt - 1; i >= 0; i--)
+		{
+			if (texhitlist[i] || spritehitlist[i] != nullptr) prefetch.Next();
 			FTexture *tex = TexMan.ByIndex(i);
 			if (tex != nullptr)
 			{
@@ -109,6 +109,7 @@ bool FSkyBox::UseBasePalette()
 void FSkyBox::Unload () 
 {
 	//for(int i=0;i<6;i++) if (faces[i]) faces[i]->Unload();
+	FTexture::Unload();
 }
 
 //-----------------------------------------------------------------------------
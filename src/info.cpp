@@ -252,6 +252,7 @@ PClassActor::PClassActor()
 	PainChances = NULL;
 
 	DropItems = NULL;
+	Instances = NULL;
 	// Record this in the master list.
 	AllActorClasses.Push(this);
 }
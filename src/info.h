@@ -301,6 +301,9 @@ public:
 	// This is from PClassPlayerPawn
 	FString DisplayName;
 
+	// Live actors of exactly this class, linked through AActor::cnext.
+	AActor *Instances;
+
 	// For those times when being able to scan every kind of actor is convenient
 	static TArray<PClassActor *> AllActorClasses;
 };
@@ -168,8 +168,22 @@ FRandom::FRandom ()
 //==========================================================================
 
 FRandom::FRandom (const char *name)
+: FRandom (CalcCRC32 ((const uint8_t *)name, (unsigned int)strlen (name)), name)
 {
-	NameCRC = CalcCRC32 ((const uint8_t *)name, (unsigned int)strlen (name));
+}
+
+//==========================================================================
+//
+// FRandom - CRC constructor
+//
+// For RNGs that are only known by their CRC. The name is only kept for
+// debugging and may be NULL.
+//
+//==========================================================================
+
+FRandom::FRandom (uint32_t crc, const char *name)
+{
+	NameCRC = crc;
 #ifndef NDEBUG
 	initialized = false;
 	Name = name;
@@ -377,8 +391,20 @@ void FRandom::StaticReadRNGState(FSerializer &arc)
 
 FRandom *FRandom::StaticFindRNG (const char *name)
 {
-	uint32_t NameCRC = CalcCRC32 ((const uint8_t *)name, (unsigned int)strlen (name));
+	return StaticFindRNG (CalcCRC32 ((const uint8_t *)name, (unsigned int)strlen (name)));
+}
 
+//==========================================================================
+//
+// FRandom :: StaticFindRNG
+//
+// Same as above, for an RNG whose name is only known by its CRC, as is
+// the case for the ones referenced by cached script code.
+//
+//==========================================================================
+
+FRandom *FRandom::StaticFindRNG (uint32_t NameCRC)
+{
 	// Use the default RNG if this one happens to have a CRC of 0.
 	if (NameCRC == 0) return &pr_exrandom;
 
@@ -394,7 +420,7 @@ FRandom *FRandom::StaticFindRNG (const char *name)
 	if (probe == NULL || probe->NameCRC != NameCRC)
 	{
 		// A matching RNG doesn't exist yet so create it.
-		probe = new FRandom(name);
+		probe = new FRandom(NameCRC, NULL);
 
 		// Store the new RNG for destruction when ZDoom quits.
 		NewRNGs.Push(probe);
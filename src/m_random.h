@@ -177,12 +177,16 @@ public:
 	static void StaticReadRNGState (FSerializer &arc);
 	static void StaticWriteRNGState (FSerializer &file);
 	static FRandom *StaticFindRNG(const char *name);
+	static FRandom *StaticFindRNG(uint32_t crc);
+	uint32_t GetNameCRC() const { return NameCRC; }
 
 #ifndef NDEBUG
 	static void StaticPrintSeeds ();
 #endif
 
 private:
+	FRandom (uint32_t crc, const char *name);
+
 #ifndef NDEBUG
 	const char *Name;
 #endif
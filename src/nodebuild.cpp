@@ -51,11 +51,19 @@
 #include "m_bbox.h"
 #include "c_console.h"
 #include "r_state.h"
+#include "workerpool.h"
 
 const int MaxSegs = 64;
 const int SplitCost = 8;
 const int AAPreference = 16;
 
+// Candidates * segs in a set before splitters are scored on multiple threads
+const int64_t PARALLEL_SPLITTER_WORK = 32768;
+
+// Splitters can be scored concurrently, so these are kept per thread.
+static thread_local TArray<int> Touched;	// Loops a splitter touches on a vertex
+static thread_local TArray<int> Colinear;	// Loops with edges colinear to a splitter
+
 #if 0
 #define D(x) x
 #else
@@ -112,8 +120,6 @@ void FNodeBuilder::Clear()
 	SegList.Clear();
 	PlaneChecked.Clear();
 	Planes.Clear();
-	Touched.Clear();
-	Colinear.Clear();
 	SplitSharers.Clear();
 	if (VertexMap == NULL)
 	{
@@ -453,6 +459,9 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	uint32_t bestseg;
 	uint32_t seg;
 	bool nosplitters = false;
+	TArray<uint32_t> candidates;
+	TArray<int> values;
+	int segsInSet = 0;
 
 	bestvalue = 0;
 	bestseg = DWORD_MAX;
@@ -481,26 +490,54 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 				}
 
 				stepleft = step;
-				SetNodeFromSeg (node, pseg);
+				candidates.Push (seg);
+			}
+		}
 
-				int value = Heuristic (node, set, nosplit);
+		segsInSet++;
+		seg = pseg->next;
+	}
 
-				D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
-					(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
+	// Scoring a splitter does not modify anything, so for large sets all
+	// candidates can be scored at once. The best one is still picked in
+	// the original order below, so the result is the same either way.
+	values.Resize (candidates.Size());
+	auto score = [&](int i)
+	{
+		node_t test;
+		SetNodeFromSeg (test, &Segs[candidates[i]]);
+		values[i] = Heuristic (test, set, nosplit);
+	};
 
-				if (value > bestvalue)
-				{
-					bestvalue = value;
-					bestseg = seg;
-				}
-				else if (value < 0)
-				{
-					nosplitters = true;
-				}
-			}
+	if ((int64_t)candidates.Size() * segsInSet >= PARALLEL_SPLITTER_WORK)
+	{
+		FWorkerPool::RunParallel (candidates.Size(), score);
+	}
+	else
+	{
+		for (unsigned i = 0; i < candidates.Size(); ++i)
+		{
+			score (i);
 		}
+	}
 
-		seg = pseg->next;
+	for (unsigned i = 0; i < candidates.Size(); ++i)
+	{
+		int value = values[i];
+
+		D(SetNodeFromSeg (node, &Segs[candidates[i]]));
+		D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", candidates[i], Segs[candidates[i]].linedef, node.x>>16, node.y>>16,
+			(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
+
+		if (value > bestvalue)
+		{
+			bestvalue = value;
+			bestseg = candidates[i];
+		}
+		else if (value < 0)
+		{
+			nosplitters = true;
+		}
 	}
 
 	if (bestseg == DWORD_MAX)
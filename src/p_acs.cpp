@@ -85,6 +85,7 @@
 #include "r_data/colormaps.h"
 #include "g_levellocals.h"
 #include "stats.h"
+#include "profiler.h"
 
 	// P-codes for ACS scripts
 	enum
@@ -477,7 +478,11 @@
 		PCD_TRANSLATIONRANGE4,
 		PCD_TRANSLATIONRANGE5,
 
-/*381*/	PCODE_COMMAND_COUNT
+/*381*/	PCODE_COMMAND_COUNT,
+
+		// Only appears in predecoded code. Pushes a counted list of words
+		// and replaces the PCD_PUSH*BYTES family.
+		PCD_PUSHNUMBERS = PCODE_COMMAND_COUNT
 	};
 
 	// Some constants used by ACS scripts
@@ -550,6 +555,10 @@ extern FILE *Logfile;
 
 FRandom pr_acs ("ACS");
 
+// Runs ACS modules from a copy of their code that was converted to
+// fixed-width instructions with resolved operands when they were loaded.
+CVAR (Bool, acs_predecode, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 // I imagine this much stack space is probably overkill, but it could
 // potentially get used with recursive functions.
 #define STACK_SIZE 4096
@@ -670,6 +679,7 @@ struct FBehavior::ArrayInfo
 };
 
 TArray<FBehavior *> FBehavior::StaticModules;
+bool FBehavior::CodePredecoded = true;
 TArray<FString> ACS_StringBuilderStack;
 
 #define STRINGBUILDER_START(Builder) if (Builder.IsNotEmpty() || ACS_StringBuilderStack.Size()) { ACS_StringBuilderStack.Push(Builder); Builder = ""; }
@@ -2232,6 +2242,10 @@ FBehavior::FBehavior()
 	ArrayStore = NULL;
 	Chunks = NULL;
 	Data = NULL;
+	Code = NULL;
+	Decoded = NULL;
+	DecodedOrigin = NULL;
+	NumDecoded = 0;
 	Format = ACS_Unknown;
 	LumpNum = -1;
 	memset (MapVarStore, 0, sizeof(MapVarStore));
@@ -2317,6 +2331,7 @@ bool FBehavior::Init(int lumpnum, FileReader * fr, int len)
 
 	Data = object;
 	DataSize = len;
+	Code = Data;
 
 	if (Format == ACS_Old)
 	{
@@ -2695,6 +2710,11 @@ bool FBehavior::Init(int lumpnum, FileReader * fr, int len)
 		}
 	}
 
+	if (Predecode() && CodePredecoded)
+	{
+		Code = (uint8_t *)Decoded;
+	}
+
 	DPrintf (DMSG_NOTIFY, "Loaded %d scripts, %d functions\n", NumScripts, NumFunctions);
 	return true;
 }
@@ -2734,11 +2754,505 @@ FBehavior::~FBehavior ()
 		delete[] FunctionProfileData;
 		FunctionProfileData = NULL;
 	}
+	if (Decoded != NULL)
+	{
+		delete[] Decoded;
+		Decoded = NULL;
+	}
+	if (DecodedOrigin != NULL)
+	{
+		delete[] DecodedOrigin;
+		DecodedOrigin = NULL;
+	}
 	if (Data != NULL)
 	{
 		delete[] Data;
 		Data = NULL;
 	}
+	Code = NULL;
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodeInstruction
+//
+// Appends the instruction at ofs to out in the form that is run for
+// predecoded modules: every opcode and operand is a full word, and byte
+// operands are widened so that RunScript never has to check the format.
+// Jump targets are left as lump offsets, and their positions in out are
+// added to jumps. Returns the instruction's length in the lump, or 0 if
+// it could not be decoded.
+//
+//==========================================================================
+
+int FBehavior::DecodeInstruction (uint32_t ofs, uint32_t limit, TArray<int> &out, TArray<unsigned> &jumps, bool &terminal) const
+{
+	const uint8_t *pc = Data + ofs;
+	const uint8_t *end = Data + limit;
+	const bool little = Format == ACS_LittleEnhanced;
+	bool ok = true;
+	int pcd, i, count;
+
+	auto readbyte = [&]() -> int
+	{
+		if (pc >= end) { ok = false; return 0; }
+		return *pc++;
+	};
+	auto readword = [&]() -> int
+	{
+		if (end - pc < 4) { ok = false; pc = end; return 0; }
+		int res = int(pc[0] | (pc[1] << 8) | (pc[2] << 16) | (uint32_t(pc[3]) << 24));
+		pc += 4;
+		return res;
+	};
+	auto readshort = [&]() -> int
+	{
+		if (!little) return readword();
+		if (end - pc < 2) { ok = false; pc = end; return 0; }
+		int res = int16_t(pc[0] | (pc[1] << 8));
+		pc += 2;
+		return res;
+	};
+	auto put = [&](int val) { out.Push(LittleLong(val)); };
+	auto putjump = [&](int target) { jumps.Push(out.Size()); out.Push(target); };
+
+	if (little)
+	{
+		pcd = readbyte();
+		if (pcd >= 256-16)
+		{
+			pcd = (256-16) + ((pcd - (256-16)) << 8) + readbyte();
+		}
+	}
+	else
+	{
+		pcd = readword();
+	}
+
+	terminal = false;
+	count = 0;
+	switch (pcd)
+	{
+	default:
+		// Nothing must be run that RunScript doesn't know about.
+		if (pcd < 0 || pcd >= PCODE_COMMAND_COUNT)
+		{
+			return 0;
+		}
+		put(pcd);
+		break;
+
+	// These are unknown to RunScript and end the script.
+	case PCD_PLAYERBLUESKULL:	case PCD_PLAYERREDSKULL:	case PCD_PLAYERYELLOWSKULL:
+	case PCD_PLAYERMASTERSKULL:	case PCD_PLAYERBLUECARD:	case PCD_PLAYERREDCARD:
+	case PCD_PLAYERYELLOWCARD:	case PCD_PLAYERMASTERCARD:	case PCD_PLAYERBLACKSKULL:
+	case PCD_PLAYERSILVERSKULL:	case PCD_PLAYERGOLDSKULL:	case PCD_PLAYERBLACKCARD:
+	case PCD_PLAYERSILVERCARD:	case PCD_PLAYEREXPERT:		case PCD_BLUETEAMCOUNT:
+	case PCD_REDTEAMCOUNT:		case PCD_BLUETEAMSCORE:		case PCD_REDTEAMSCORE:
+	case PCD_ISONEFLAGCTF:		case PCD_LSPEC6:			case PCD_LSPEC6DIRECT:
+	case PCD_SETSTYLE:			case PCD_SETSTYLEDIRECT:	case PCD_WRITETOINI:
+	case PCD_GETFROMINI:		case PCD_GRABINPUT:			case PCD_SETMOUSEPOINTER:
+	case PCD_MOVEMOUSEPOINTER:
+	case PCD_TERMINATE:
+	case PCD_RESTART:
+	case PCD_GOTOSTACK:
+	case PCD_RETURNVOID:
+	case PCD_RETURNVAL:
+		put(pcd);
+		terminal = true;
+		break;
+
+	case PCD_GOTO:
+		put(pcd);
+		putjump(readword());
+		terminal = true;
+		break;
+
+	case PCD_IFGOTO:
+	case PCD_IFNOTGOTO:
+		put(pcd);
+		putjump(readword());
+		break;
+
+	case PCD_CASEGOTO:
+		put(pcd);
+		put(readword());
+		putjump(readword());
+		break;
+
+	case PCD_CASEGOTOSORTED:
+		// The count and jump table are 4-byte aligned in the lump, but
+		// are always aligned in the decoded code.
+		put(pcd);
+		pc = Data + ((pc - Data + 3) & ~3);
+		count = readword();
+		if (count < 0 || count > (end - pc) / 8)
+		{
+			return 0;
+		}
+		put(count);
+		for (i = 0; i < count; ++i)
+		{
+			put(readword());
+			putjump(readword());
+		}
+		count = 0;
+		break;
+
+	case PCD_PUSHBYTE:
+		put(PCD_PUSHNUMBER);
+		put(readbyte());
+		break;
+
+	case PCD_PUSH2BYTES:
+	case PCD_PUSH3BYTES:
+	case PCD_PUSH4BYTES:
+	case PCD_PUSH5BYTES:
+	case PCD_PUSHBYTES:
+		// Keep them as one instruction, so that the runaway counter and the
+		// profiler see the same number of instructions as before.
+		count = pcd == PCD_PUSHBYTES ? readbyte() : pcd - PCD_PUSH2BYTES + 2;
+		put(PCD_PUSHNUMBERS);
+		put(count);
+		for (i = 0; i < count; ++i)
+		{
+			put(readbyte());
+		}
+		count = 0;
+		break;
+
+	case PCD_LSPEC1DIRECTB:
+	case PCD_LSPEC2DIRECTB:
+	case PCD_LSPEC3DIRECTB:
+	case PCD_LSPEC4DIRECTB:
+	case PCD_LSPEC5DIRECTB:
+		count = pcd - PCD_LSPEC1DIRECTB + 1;
+		put(PCD_LSPEC1DIRECT + count - 1);
+		for (i = 0; i <= count; ++i)
+		{
+			put(readbyte());
+		}
+		count = 0;
+		break;
+
+	case PCD_DELAYDIRECTB:
+		put(PCD_DELAYDIRECT);
+		put(readbyte());
+		break;
+
+	case PCD_RANDOMDIRECTB:
+		put(PCD_RANDOMDIRECT);
+		put(readbyte());
+		put(readbyte());
+		break;
+
+	case PCD_CALLFUNC:
+		put(pcd);
+		put(little ? readbyte() : readword());
+		put(readshort());
+		break;
+
+	case PCD_LSPEC1DIRECT:
+	case PCD_LSPEC2DIRECT:
+	case PCD_LSPEC3DIRECT:
+	case PCD_LSPEC4DIRECT:
+	case PCD_LSPEC5DIRECT:
+		count = pcd - PCD_LSPEC1DIRECT + 1;
+		// fall through
+	case PCD_LSPEC1:				case PCD_LSPEC2:				case PCD_LSPEC3:
+	case PCD_LSPEC4:				case PCD_LSPEC5:				case PCD_LSPEC5RESULT:
+	case PCD_CALL:					case PCD_CALLDISCARD:			case PCD_PUSHFUNCTION:
+	case PCD_ASSIGNSCRIPTVAR:		case PCD_ASSIGNMAPVAR:			case PCD_ASSIGNWORLDVAR:
+	case PCD_ASSIGNGLOBALVAR:		case PCD_ASSIGNSCRIPTARRAY:		case PCD_ASSIGNMAPARRAY:
+	case PCD_ASSIGNWORLDARRAY:		case PCD_ASSIGNGLOBALARRAY:		case PCD_PUSHSCRIPTVAR:
+	case PCD_PUSHMAPVAR:			case PCD_PUSHWORLDVAR:			case PCD_PUSHGLOBALVAR:
+	case PCD_PUSHSCRIPTARRAY:		case PCD_PUSHMAPARRAY:			case PCD_PUSHWORLDARRAY:
+	case PCD_PUSHGLOBALARRAY:		case PCD_ADDSCRIPTVAR:			case PCD_ADDMAPVAR:
+	case PCD_ADDWORLDVAR:			case PCD_ADDGLOBALVAR:			case PCD_ADDSCRIPTARRAY:
+	case PCD_ADDMAPARRAY:			case PCD_ADDWORLDARRAY:			case PCD_ADDGLOBALARRAY:
+	case PCD_SUBSCRIPTVAR:			case PCD_SUBMAPVAR:				case PCD_SUBWORLDVAR:
+	case PCD_SUBGLOBALVAR:			case PCD_SUBSCRIPTARRAY:		case PCD_SUBMAPARRAY:
+	case PCD_SUBWORLDARRAY:			case PCD_SUBGLOBALARRAY:		case PCD_MULSCRIPTVAR:
+	case PCD_MULMAPVAR:				case PCD_MULWORLDVAR:			case PCD_MULGLOBALVAR:
+	case PCD_MULSCRIPTARRAY:		case PCD_MULMAPARRAY:			case PCD_MULWORLDARRAY:
+	case PCD_MULGLOBALARRAY:		case PCD_DIVSCRIPTVAR:			case PCD_DIVMAPVAR:
+	case PCD_DIVWORLDVAR:			case PCD_DIVGLOBALVAR:			case PCD_DIVSCRIPTARRAY:
+	case PCD_DIVMAPARRAY:			case PCD_DIVWORLDARRAY:			case PCD_DIVGLOBALARRAY:
+	case PCD_MODSCRIPTVAR:			case PCD_MODMAPVAR:				case PCD_MODWORLDVAR:
+	case PCD_MODGLOBALVAR:			case PCD_MODSCRIPTARRAY:		case PCD_MODMAPARRAY:
+	case PCD_MODWORLDARRAY:			case PCD_MODGLOBALARRAY:		case PCD_ANDSCRIPTVAR:
+	case PCD_ANDMAPVAR:				case PCD_ANDWORLDVAR:			case PCD_ANDGLOBALVAR:
+	case PCD_ANDSCRIPTARRAY:		case PCD_ANDMAPARRAY:			case PCD_ANDWORLDARRAY:
+	case PCD_ANDGLOBALARRAY:		case PCD_EORSCRIPTVAR:			case PCD_EORMAPVAR:
+	case PCD_EORWORLDVAR:			case PCD_EORGLOBALVAR:			case PCD_EORSCRIPTARRAY:
+	case PCD_EORMAPARRAY:			case PCD_EORWORLDARRAY:			case PCD_EORGLOBALARRAY:
+	case PCD_ORSCRIPTVAR:			case PCD_ORMAPVAR:				case PCD_ORWORLDVAR:
+	case PCD_ORGLOBALVAR:			case PCD_ORSCRIPTARRAY:			case PCD_ORMAPARRAY:
+	case PCD_ORWORLDARRAY:			case PCD_ORGLOBALARRAY:			case PCD_LSSCRIPTVAR:
+	case PCD_LSMAPVAR:				case PCD_LSWORLDVAR:			case PCD_LSGLOBALVAR:
+	case PCD_LSSCRIPTARRAY:			case PCD_LSMAPARRAY:			case PCD_LSWORLDARRAY:
+	case PCD_LSGLOBALARRAY:			case PCD_RSSCRIPTVAR:			case PCD_RSMAPVAR:
+	case PCD_RSWORLDVAR:			case PCD_RSGLOBALVAR:			case PCD_RSSCRIPTARRAY:
+	case PCD_RSMAPARRAY:			case PCD_RSWORLDARRAY:			case PCD_RSGLOBALARRAY:
+	case PCD_INCSCRIPTVAR:			case PCD_INCMAPVAR:				case PCD_INCWORLDVAR:
+	case PCD_INCGLOBALVAR:			case PCD_INCSCRIPTARRAY:		case PCD_INCMAPARRAY:
+	case PCD_INCWORLDARRAY:			case PCD_INCGLOBALARRAY:		case PCD_DECSCRIPTVAR:
+	case PCD_DECMAPVAR:				case PCD_DECWORLDVAR:			case PCD_DECGLOBALVAR:
+	case PCD_DECSCRIPTARRAY:		case PCD_DECMAPARRAY:			case PCD_DECWORLDARRAY:
+	case PCD_DECGLOBALARRAY:
+		put(pcd);
+		put(little ? readbyte() : readword());
+		break;
+
+	case PCD_SPAWNDIRECT:
+		count = 6;
+		put(pcd);
+		break;
+
+	case PCD_SPAWNSPOTDIRECT:
+		count = 4;
+		put(pcd);
+		break;
+
+	case PCD_SETMUSICDIRECT:
+	case PCD_LOCALSETMUSICDIRECT:
+	case PCD_CONSOLECOMMANDDIRECT:
+		count = 3;
+		put(pcd);
+		break;
+
+	case PCD_RANDOMDIRECT:
+	case PCD_THINGCOUNTDIRECT:
+	case PCD_CHANGEFLOORDIRECT:
+	case PCD_CHANGECEILINGDIRECT:
+	case PCD_GIVEINVENTORYDIRECT:
+	case PCD_TAKEINVENTORYDIRECT:
+		count = 2;
+		put(pcd);
+		break;
+
+	case PCD_PUSHNUMBER:
+	case PCD_LSPEC5EX:
+	case PCD_LSPEC5EXRESULT:
+	case PCD_DELAYDIRECT:
+	case PCD_TAGWAITDIRECT:
+	case PCD_POLYWAITDIRECT:
+	case PCD_SCRIPTWAITDIRECT:
+	case PCD_SETFONTDIRECT:
+	case PCD_SETGRAVITYDIRECT:
+	case PCD_SETAIRCONTROLDIRECT:
+	case PCD_CHECKINVENTORYDIRECT:
+		count = 1;
+		put(pcd);
+		break;
+	}
+
+	// Operands that are a full word in every format
+	for (i = 0; i < count; ++i)
+	{
+		put(readword());
+	}
+	return ok ? int(pc - (Data + ofs)) : 0;
+}
+
+//==========================================================================
+//
+// FBehavior :: Predecode
+//
+// Creates a copy of the module's code that RunScript can run without
+// looking at the module's format. The code is found by following every
+// path from the scripts, functions and jump points, so that anything else
+// stored between them is never mistaken for code. If the paths disagree
+// about where an instruction starts, the module is left alone and will
+// be run directly from the lump.
+//
+//==========================================================================
+
+bool FBehavior::Predecode ()
+{
+	enum { CODE_Start = 1, CODE_Operand };
+
+	if (Format != ACS_Enhanced && Format != ACS_LittleEnhanced)
+	{
+		return false;
+	}
+
+	uint32_t limit = uint32_t(MIN<ptrdiff_t>(Chunks - Data, DataSize));
+	if (limit <= 8)
+	{
+		return false;
+	}
+
+	TArray<uint8_t> marks;
+	TArray<uint32_t> pending;
+	TArray<int> words;
+	TArray<unsigned> jumps;
+	unsigned total = 0;
+	uint32_t ofs;
+	bool terminal;
+	int i, len;
+
+	marks.Resize(limit);
+	memset(&marks[0], 0, limit);
+	for (i = 0; i < NumScripts; ++i)
+	{
+		pending.Push(Scripts[i].Address);
+	}
+	for (i = 0; i < NumFunctions; ++i)
+	{
+		if (Functions[i].ImportNum == 0 && Functions[i].Address != 0)
+		{
+			pending.Push(Functions[i].Address);
+		}
+	}
+	for (unsigned j = 0; j < JumpPoints.Size(); ++j)
+	{
+		pending.Push(JumpPoints[j]);
+	}
+
+	while (pending.Pop(ofs))
+	{
+		if (ofs >= limit || marks[ofs] == CODE_Operand)
+		{
+			return false;
+		}
+		if (marks[ofs] == CODE_Start)
+		{
+			continue;
+		}
+		words.Clear();
+		jumps.Clear();
+		len = DecodeInstruction(ofs, limit, words, jumps, terminal);
+		if (len == 0)
+		{
+			return false;
+		}
+		for (i = 1; i < len; ++i)
+		{
+			if (marks[ofs + i] != 0)
+			{
+				return false;
+			}
+			marks[ofs + i] = CODE_Operand;
+		}
+		marks[ofs] = CODE_Start;
+		total += words.Size();
+
+		for (unsigned j = 0; j < jumps.Size(); ++j)
+		{
+			pending.Push(words[jumps[j]]);
+		}
+		if (!terminal)
+		{
+			pending.Push(ofs + len);
+		}
+	}
+
+	// Instructions are stored in the same order as in the lump, so every
+	// instruction is still followed by the one it falls through to. The
+	// last word is for offsets that don't point to an instruction.
+	Decoded = new int[total + 1];
+	DecodedOrigin = new uint32_t[total + 1];
+	NumDecoded = 0;
+	TArray<unsigned> fixups;
+
+	for (ofs = 0; ofs < limit; ++ofs)
+	{
+		if (marks[ofs] != CODE_Start)
+		{
+			continue;
+		}
+		words.Clear();
+		jumps.Clear();
+		DecodeInstruction(ofs, limit, words, jumps, terminal);
+		DecodedIndex[ofs] = NumDecoded;
+		for (unsigned j = 0; j < jumps.Size(); ++j)
+		{
+			fixups.Push(NumDecoded + jumps[j]);
+		}
+		for (unsigned j = 0; j < words.Size(); ++j)
+		{
+			DecodedOrigin[NumDecoded] = ofs;
+			Decoded[NumDecoded++] = words[j];
+		}
+	}
+	DecodedOrigin[NumDecoded] = limit;
+	Decoded[NumDecoded++] = LittleLong(PCD_TERMINATE);
+
+	// Jumps go directly to the decoded instruction.
+	for (unsigned j = 0; j < fixups.Size(); ++j)
+	{
+		int &target = Decoded[fixups[j]];
+		target = LittleLong(int(DecodedIndex[target] * sizeof(int)));
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodedPC
+//
+//==========================================================================
+
+int *FBehavior::DecodedPC (uint32_t ofs) const
+{
+	const uint32_t *index = DecodedIndex.CheckKey(ofs);
+	return &Decoded[index != NULL ? *index : NumDecoded - 1];
+}
+
+//==========================================================================
+//
+// FBehavior :: StaticSetPredecoded
+//
+// Switches all modules between their predecoded and their original code.
+// Must not be called while a script is running.
+//
+//==========================================================================
+
+void FBehavior::StaticSetPredecoded (bool on)
+{
+	if (on == CodePredecoded)
+	{
+		return;
+	}
+
+	DACSThinker *controller = DACSThinker::ActiveThinker;
+	TArray<uint32_t> offsets;
+	DLevelScript *script;
+	unsigned i;
+
+	if (controller != NULL)
+	{
+		for (script = controller->Scripts; script != NULL; script = script->next)
+		{
+			offsets.Push(script->activeBehavior->PC2Ofs(script->pc));
+		}
+	}
+	for (i = 0; i < StaticModules.Size(); ++i)
+	{
+		FBehavior *module = StaticModules[i];
+		module->Code = (on && module->Decoded != NULL) ? (uint8_t *)module->Decoded : module->Data;
+	}
+	if (controller != NULL)
+	{
+		for (script = controller->Scripts, i = 0; script != NULL; script = script->next, ++i)
+		{
+			script->pc = script->activeBehavior->Ofs2PC(offsets[i]);
+		}
+	}
+	CodePredecoded = on;
+}
+
+int FBehavior::StaticCountPredecoded (int &total)
+{
+	int count = 0;
+
+	total = StaticModules.Size();
+	for (int i = 0; i < total; ++i)
+	{
+		count += StaticModules[i]->Decoded != NULL;
+	}
+	return count;
 }
 
 void FBehavior::LoadScriptsDirectory ()
@@ -3429,8 +3943,20 @@ void DACSThinker::Serialize(FSerializer &arc)
 
 cycle_t ACSTime;
 
+// acsbench state
+static int ACSBenchTics;
+static int ACSBenchCount[2];
+static double ACSBenchTime[2];
+
 void DACSThinker::Tick ()
 {
+	PROFILE_ZONE("ACS");
+
+	// While benchmarking, alternate between both ways to run the code, so
+	// that both see the same scripts.
+	bool predecoded = ACSBenchTics > 0 ? !!(ACSBenchTics & 1) : *acs_predecode;
+	FBehavior::StaticSetPredecoded(predecoded);
+
 	ACSTime.Reset();
 	ACSTime.Clock();
 	DLevelScript *script = Scripts;
@@ -3451,6 +3977,17 @@ void DACSThinker::Tick ()
 		I_Error("Error: %d garbage entries on ACS string builder stack.", size);
 	}
 	ACSTime.Unclock();
+
+	if (ACSBenchTics > 0)
+	{
+		ACSBenchTime[predecoded] += ACSTime.TimeMS();
+		ACSBenchCount[predecoded]++;
+		if (--ACSBenchTics == 0)
+		{
+			Printf("Original code:   %.4f ms per tic\n", ACSBenchTime[0] / MAX(ACSBenchCount[0], 1));
+			Printf("Predecoded code: %.4f ms per tic\n", ACSBenchTime[1] / MAX(ACSBenchCount[1], 1));
+		}
+	}
 }
 
 void DACSThinker::StopScriptsFor (AActor *actor)
@@ -3673,13 +4210,33 @@ do_count:
 			}
 		}
 	}
+	else if (kind != NULL)
+	{
+		// Only the actors of this class need to be looked at. Unlike the
+		// thinker iterator this also finds actors that don't think.
+		FClassActorIterator iterator (kind);
+		while ( (actor = iterator.Next ()) )
+		{
+			if (actor->GetStatNum() >= STAT_FIRST_THINKING && actor->health > 0)
+			{
+				if (tag == -1 || tagManager.SectorHasTag(actor->Sector, tag))
+				{
+					// Don't count items in somebody's inventory
+					if (!actor->IsKindOf (RUNTIME_CLASS(AInventory)) ||
+						static_cast<AInventory *>(actor)->Owner == NULL)
+					{
+						count++;
+					}
+				}
+			}
+		}
+	}
 	else
 	{
 		TThinkerIterator<AActor> iterator;
 		while ( (actor = iterator.Next ()) )
 		{
-			if (actor->health > 0 &&
-				(kind == NULL || actor->IsA (kind)))
+			if (actor->health > 0)
 			{
 				if (tag == -1 || tagManager.SectorHasTag(actor->Sector, tag))
 				{
@@ -6846,7 +7403,7 @@ int DLevelScript::RunScript ()
 	int &sp = stackobj.sp;
 
 	int *pc = this->pc;
-	ACSFormat fmt = activeBehavior->GetFormat();
+	ACSFormat fmt = activeBehavior->GetCodeFormat();
 	FBehavior* const savedActiveBehavior = activeBehavior;
 	unsigned int runaway = 0;	// used to prevent infinite loops
 	int pcd;
@@ -6944,6 +7501,14 @@ int DLevelScript::RunScript ()
 			pc = (int *)((uint8_t *)pc + 5);
 			break;
 
+		case PCD_PUSHNUMBERS:
+			temp = NEXTWORD;
+			for (; temp > 0; --temp)
+			{
+				PushToStack (NEXTWORD);
+			}
+			break;
+
 		case PCD_PUSHBYTES:
 			temp = *(uint8_t *)pc;
 			pc = (int *)((uint8_t *)pc + temp + 1);
@@ -7181,7 +7746,7 @@ int DLevelScript::RunScript ()
 				localarrays = &func->LocalArrays;
 				activeFunction = func;
 				activeBehavior = module;
-				fmt = module->GetFormat();
+				fmt = module->GetCodeFormat();
 			}
 			break;
 
@@ -7210,7 +7775,7 @@ int DLevelScript::RunScript ()
 				pc = ret->ReturnModule->Ofs2PC(ret->ReturnAddress);
 				activeFunction = ret->ReturnFunction;
 				activeBehavior = ret->ReturnModule;
-				fmt = activeBehavior->GetFormat();
+				fmt = activeBehavior->GetCodeFormat();
 				locals = ret->ReturnLocals;
 				localarrays = ret->ReturnArrays;
 				if (!ret->bDiscardResult)
@@ -8092,7 +8657,7 @@ int DLevelScript::RunScript ()
 			break;
 
 		case PCD_GOTO:
-			pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+			pc = activeBehavior->Branch2PC (LittleLong(*pc));
 			break;
 
 		case PCD_GOTOSTACK:
@@ -8102,7 +8667,7 @@ int DLevelScript::RunScript ()
 
 		case PCD_IFGOTO:
 			if (STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = activeBehavior->Branch2PC (LittleLong(*pc));
 			else
 				pc++;
 			sp--;
@@ -8286,7 +8851,7 @@ int DLevelScript::RunScript ()
 
 		case PCD_IFNOTGOTO:
 			if (!STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = activeBehavior->Branch2PC (LittleLong(*pc));
 			else
 				pc++;
 			sp--;
@@ -8328,7 +8893,7 @@ scriptwait:
 		case PCD_CASEGOTO:
 			if (STACK(1) == uallong(pc[0]))
 			{
-				pc = activeBehavior->Ofs2PC (uallong(pc[1]));
+				pc = activeBehavior->Branch2PC (uallong(pc[1]));
 				sp--;
 			}
 			else
@@ -8349,7 +8914,7 @@ scriptwait:
 					int32_t caseval = LittleLong(pc[mid*2]);
 					if (caseval == STACK(1))
 					{
-						pc = activeBehavior->Ofs2PC (LittleLong(pc[mid*2+1]));
+						pc = activeBehavior->Branch2PC (LittleLong(pc[mid*2+1]));
 						sp--;
 						break;
 					}
@@ -10863,7 +11428,41 @@ CCMD(acsprofile)
 	ShowProfileData(FuncProfiles, limit, sorter, true);
 }
 
+//==========================================================================
+//
+// CCMD acsbench
+//
+// Compares the time spent running scripts from the original and from the
+// predecoded code over the next few tics.
+//
+//==========================================================================
+
+CCMD(acsbench)
+{
+	int total;
+
+	if (gamestate != GS_LEVEL || DACSThinker::ActiveThinker == NULL)
+	{
+		Printf("You must be in a level to use this command.\n");
+		return;
+	}
+	if (FBehavior::StaticCountPredecoded(total) == 0)
+	{
+		Printf("None of the loaded ACS modules are predecoded.\n");
+		return;
+	}
+
+	int tics = argv.argc() > 1 ? atoi(argv[1]) : 10 * TICRATE;
+	ACSBenchTics = MAX(tics, 1) * 2;
+	ACSBenchCount[0] = ACSBenchCount[1] = 0;
+	ACSBenchTime[0] = ACSBenchTime[1] = 0;
+	Printf("Running ACS benchmark for %d tics...\n", ACSBenchTics);
+}
+
 ADD_STAT(ACS)
 {
-	return FStringf("ACS time: %f ms", ACSTime.TimeMS());
+	int total;
+	int count = FBehavior::StaticCountPredecoded(total);
+	return FStringf("ACS time: %f ms, %d/%d modules predecoded%s", ACSTime.TimeMS(), count, total,
+		*acs_predecode ? "" : " (off)");
 }
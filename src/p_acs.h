@@ -300,10 +300,14 @@ public:
 	uint8_t *NextChunk (uint8_t *chunk) const;
 	const ScriptPtr *FindScript (int number) const;
 	void StartTypedScripts (uint16_t type, AActor *activator, bool always, int arg1, bool runNow);
-	uint32_t PC2Ofs (int *pc) const { return (uint32_t)((uint8_t *)pc - Data); }
-	int *Ofs2PC (uint32_t ofs) const {	return (int *)(Data + ofs); }
+	// Offsets are always relative to the original lump, even if the code is run predecoded.
+	uint32_t PC2Ofs (int *pc) const { return Code == Data ? (uint32_t)((uint8_t *)pc - Data) : DecodedOrigin[pc - Decoded]; }
+	int *Ofs2PC (uint32_t ofs) const {	return Code == Data ? (int *)(Data + ofs) : DecodedPC(ofs); }
+	// For jump targets that are stored in the code being run.
+	int *Branch2PC (uint32_t ofs) const { return (int *)(Code + ofs); }
 	int *Jump2PC (uint32_t jumpPoint) const { return Ofs2PC(JumpPoints[jumpPoint]); }
 	ACSFormat GetFormat() const { return Format; }
+	ACSFormat GetCodeFormat() const { return Code == Data ? Format : ACS_Enhanced; }
 	ScriptFunction *GetFunction (int funcnum, FBehavior *&module) const;
 	int GetArrayVal (int arraynum, int index) const;
 	void SetArrayVal (int arraynum, int index, int value);
@@ -313,7 +317,7 @@ public:
 	int FindMapVarName (const char *varname) const;
 	int FindMapArray (const char *arrayname) const;
 	int GetLibraryID () const { return LibraryID; }
-	int *GetScriptAddress (const ScriptPtr *ptr) const { return (int *)(ptr->Address + Data); }
+	int *GetScriptAddress (const ScriptPtr *ptr) const { return Ofs2PC(ptr->Address); }
 	int GetScriptIndex (const ScriptPtr *ptr) const { ptrdiff_t index = ptr - Scripts; return index >= NumScripts ? -1 : (int)index; }
 	ScriptPtr *GetScriptPtr(int index) const { return index >= 0 && index < NumScripts ? &Scripts[index] : NULL; }
 	int GetLumpNum() const { return LumpNum; }
@@ -339,6 +343,8 @@ public:
 	static const char *StaticLookupString (uint32_t index);
 	static void StaticStartTypedScripts (uint16_t type, AActor *activator, bool always, int arg1=0, bool runNow=false);
 	static void StaticStopMyScripts (AActor *actor);
+	static void StaticSetPredecoded (bool on);
+	static int StaticCountPredecoded (int &total);
 
 private:
 	struct ArrayInfo;
@@ -349,6 +355,11 @@ private:
 	uint8_t *Data;
 	int DataSize;
 	uint8_t *Chunks;
+	uint8_t *Code;					// Either Data or Decoded
+	int *Decoded;
+	uint32_t *DecodedOrigin;		// Lump offset of each decoded word's instruction
+	TMap<uint32_t, uint32_t> DecodedIndex;
+	int NumDecoded;
 	ScriptPtr *Scripts;
 	int NumScripts;
 	ScriptFunction *Functions;
@@ -366,8 +377,12 @@ private:
 	TArray<int> JumpPoints;
 
 	static TArray<FBehavior *> StaticModules;
+	static bool CodePredecoded;
 
 	void LoadScriptsDirectory ();
+	bool Predecode ();
+	int DecodeInstruction (uint32_t ofs, uint32_t limit, TArray<int> &out, TArray<unsigned> &jumps, bool &terminal) const;
+	int *DecodedPC (uint32_t ofs) const;
 
 	static int SortScripts (const void *a, const void *b);
 	void UnencryptStrings ();
@@ -483,6 +498,7 @@ private:
 	DLevelScript ();
 
 	friend class DACSThinker;
+	friend class FBehavior;
 };
 
 class DACSThinker : public DThinker
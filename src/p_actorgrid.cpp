@@ -0,0 +1,192 @@
+/*
+** p_actorgrid.cpp
+** Uniform grid of actor positions for proximity queries
+**
+*/
+
+#include "p_actorgrid.h"
+#include "p_blockmap.h"
+#include "actor.h"
+#include "dthinker.h"
+#include "templates.h"
+
+FActorGrid ActorGrid;
+
+//==========================================================================
+//
+// Sets the area the grid will cover, which is the blockmap area. Actors
+// outside of it go into the nearest edge cell.
+//
+//==========================================================================
+
+void FActorGrid::Init(int width, int height, double orgx, double orgy)
+{
+	Clear();
+	Width = MAX(width, 1);
+	Height = MAX(height, 1);
+	OrgX = orgx;
+	OrgY = orgy;
+}
+
+//==========================================================================
+//
+// Adds all actors, the same ones a full thinker iteration would find.
+// Every actor in the level is linked into the world outside of the
+// moment it is being moved.
+//
+//==========================================================================
+
+void FActorGrid::Build()
+{
+	Cells.Resize(Width * Height);
+
+	TThinkerIterator<AActor> it;
+	AActor *mo;
+	while ((mo = it.Next()))
+	{
+		mo->GridCell = 0;
+		Link(mo);
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FActorGrid::Clear()
+{
+	Cells.Clear();
+	Cells.ShrinkToFit();
+	Width = Height = 0;
+	MaxRadius = 0;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FActorGrid::GetCellIndex(double x, double y) const
+{
+	int cx = clamp(int((x - OrgX) / MAPBLOCKUNITS), 0, Width - 1);
+	int cy = clamp(int((y - OrgY) / MAPBLOCKUNITS), 0, Height - 1);
+	return cy * Width + cx;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FActorGrid::Link(AActor *actor)
+{
+	if (Cells.Size() == 0)
+		return;
+
+	if (actor->GridCell != 0)
+		Unlink(actor);
+
+	int index = GetCellIndex(actor->X(), actor->Y());
+	Cell &cell = Cells[index];
+	actor->GridCell = index + 1;
+	actor->GridSlot = cell.Actors.Push(actor);
+	cell.X.Push(actor->X());
+	cell.Y.Push(actor->Y());
+	cell.Radius.Push(actor->radius);
+
+	if (actor->radius > MaxRadius)
+		MaxRadius = actor->radius;
+}
+
+//==========================================================================
+//
+// The actor's cell and slot are validated because its links can be stale
+// when it was carried over from a previous level.
+//
+//==========================================================================
+
+void FActorGrid::Unlink(AActor *actor)
+{
+	if (actor->GridCell == 0)
+		return;
+
+	unsigned index = actor->GridCell - 1;
+	unsigned slot = actor->GridSlot;
+	actor->GridCell = 0;
+
+	if (index < Cells.Size() && slot < Cells[index].Actors.Size() && Cells[index].Actors[slot] == actor)
+	{
+		RemoveAt(Cells[index], slot);
+	}
+}
+
+//==========================================================================
+//
+// Moves the cell's last entry into the freed slot.
+//
+//==========================================================================
+
+void FActorGrid::RemoveAt(Cell &cell, unsigned slot)
+{
+	unsigned last = cell.Actors.Size() - 1;
+	if (slot != last)
+	{
+		cell.Actors[slot] = cell.Actors[last];
+		cell.X[slot] = cell.X[last];
+		cell.Y[slot] = cell.Y[last];
+		cell.Radius[slot] = cell.Radius[last];
+		cell.Actors[slot]->GridSlot = slot;
+	}
+	cell.Actors.Pop();
+	cell.X.Pop();
+	cell.Y.Pop();
+	cell.Radius.Pop();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FActorGrid::CollectInRadius(const DVector2 &pos, double distance, bool addradius, TArray<AActor *> &out)
+{
+	if (Width == 0)
+		return;
+
+	if (Cells.Size() == 0)
+		Build();
+
+	// Actors are only stored in the cell of their center, so the searched
+	// area must be widened by the largest radius when it is included.
+	double range = addradius ? distance + MaxRadius : distance;
+	int x1 = GetCellIndex(pos.X - range, pos.Y - range);
+	int x2 = GetCellIndex(pos.X + range, pos.Y + range);
+	int y1 = x1 / Width, y2 = x2 / Width;
+	x1 %= Width;
+	x2 %= Width;
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+		{
+			const Cell &cell = Cells[y * Width + x];
+			unsigned count = cell.Actors.Size();
+
+			for (unsigned i = 0; i < count; i++)
+			{
+				double dx = cell.X[i] - pos.X;
+				double dy = cell.Y[i] - pos.Y;
+				double maxdist = addradius ? distance + cell.Radius[i] : distance;
+				if (dx * dx + dy * dy < maxdist * maxdist)
+				{
+					out.Push(cell.Actors[i]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __P_ACTORGRID_H
+#define __P_ACTORGRID_H
+
+#include "doomtype.h"
+#include "tarray.h"
+#include "vectors.h"
+
+class AActor;
+
+// Uniform grid of all actors linked into the world.
+//
+// Unlike the blockmap, every actor is stored exactly once, in the cell
+// that contains its center, and each cell keeps its actors' positions
+// and radii in contiguous arrays. Proximity queries can thus reject
+// actors without touching the AActor objects themselves.
+//
+// The order of actors within a cell changes whenever one is removed,
+// so this must not be used for anything whose result depends on the
+// iteration order. Portals are not taken into account either.
+//
+// The grid is only built when it is first queried, and kept up to date
+// from then on until the level ends. Until then, linking actors costs
+// nothing but a check.
+
+class FActorGrid
+{
+public:
+	void Init(int width, int height, double orgx, double orgy);
+	void Clear();
+
+	void Link(AActor *actor);
+	void Unlink(AActor *actor);
+
+	// Adds every actor whose center is less than 'distance' away from 'pos'
+	// to 'out'. If 'addradius' is set, the actor's radius is added to the distance.
+	void CollectInRadius(const DVector2 &pos, double distance, bool addradius, TArray<AActor *> &out);
+
+private:
+	struct Cell
+	{
+		TArray<AActor *> Actors;
+		TArray<double> X;
+		TArray<double> Y;
+		TArray<double> Radius;
+	};
+
+	void Build();
+	int GetCellIndex(double x, double y) const;
+	void RemoveAt(Cell &cell, unsigned slot);
+
+	TArray<Cell> Cells;
+	int Width = 0;
+	int Height = 0;
+	double OrgX = 0;
+	double OrgY = 0;
+	double MaxRadius = 0;
+};
+
+extern FActorGrid ActorGrid;
+
+#endif
@@ -34,6 +34,8 @@
 ** more useful.
 */
 
+#include <algorithm>
+
 #include "doomtype.h"
 #include "doomstat.h"
 #include "i_system.h"
@@ -54,6 +56,8 @@
 #include "d_player.h"
 #include "r_utility.h"
 #include "g_levellocals.h"
+#include "portal.h"
+#include "workerpool.h"
 
 CVAR (Int, cl_rockettrails, 1, CVAR_ARCHIVE);
 CVAR (Bool, r_rail_smartspiral, 0, CVAR_ARCHIVE);
@@ -66,11 +70,22 @@ FRandom pr_railtrail("RailTrail");
 #define FADEFROMTTL(a)	(1.f/(a))
 
 // [RH] particle globals
-uint16_t			NumParticles;
-uint16_t			ActiveParticles;
-uint16_t			InactiveParticles;
+uint32_t			NumParticles;
+uint32_t			ActiveParticles;
+uint32_t			InactiveParticles;
 particle_t		*Particles;
-TArray<uint16_t>	ParticlesInSubsec;
+TArray<uint32_t>	ParticlesInSubsec;
+
+// Upper limit for r_maxparticles. Only needs to stay below NO_PARTICLE,
+// this just keeps the particle array at a sane size.
+enum { MAX_PARTICLES = 1000000 };
+
+// Particles are handed to the worker threads in batches of this size.
+// Fewer particles than this are not worth waking the workers up for.
+enum { PARTICLE_BATCH = 2048 };
+
+static TArray<uint32_t>	ParticleWork;		// active particles, in list order
+static TArray<uint8_t>	ParticleExpired;	// set by the think pass for each entry in ParticleWork
 
 static int grey1, grey2, grey3, grey4, red, green, blue, yellow, black,
 		   red1, green1, blue1, yellow1, purple, purple1, white,
@@ -118,7 +133,7 @@ inline particle_t *NewParticle (void)
 		result = Particles + InactiveParticles;
 		InactiveParticles = result->tnext;
 		result->tnext = ActiveParticles;
-		ActiveParticles = uint16_t(result - Particles);
+		ActiveParticles = uint32_t(result - Particles);
 	}
 	return result;
 }
@@ -135,8 +150,8 @@ CUSTOM_CVAR( Int, r_maxparticles, 4000, CVAR_ARCHIVE )
 {
 	if ( self == 0 )
 		self = 4000;
-	else if (self > 65535)
-		self = 65535;
+	else if (self > MAX_PARTICLES)
+		self = MAX_PARTICLES;
 	else if (self < 100)
 		self = 100;
 
@@ -159,7 +174,7 @@ void P_InitParticles ()
 		num = r_maxparticles;
 
 	// This should be good, but eh...
-	NumParticles = (uint16_t)clamp<int>(num, 100, 65535);
+	NumParticles = (uint32_t)clamp<int>(num, 100, MAX_PARTICLES);
 
 	P_DeinitParticles();
 	Particles = new particle_t[NumParticles];
@@ -178,7 +193,7 @@ void P_DeinitParticles()
 
 void P_ClearParticles ()
 {
-	int i;
+	uint32_t i;
 
 	memset (Particles, 0, NumParticles * sizeof(particle_t));
 	ActiveParticles = NO_PARTICLE;
@@ -188,6 +203,47 @@ void P_ClearParticles ()
 	Particles[i].tnext = NO_PARTICLE;
 }
 
+//==========================================================================
+//
+// Collects the active particles into ParticleWork so that they can be
+// split into batches. Returns the number of active particles.
+//
+//==========================================================================
+
+static unsigned GatherActiveParticles ()
+{
+	ParticleWork.Clear();
+	for (uint32_t i = ActiveParticles; i != NO_PARTICLE; i = Particles[i].tnext)
+	{
+		ParticleWork.Push(i);
+	}
+	return ParticleWork.Size();
+}
+
+//==========================================================================
+//
+// Calls work(start, end) for consecutive ranges of ParticleWork, on the
+// worker threads if there are enough particles to make it worthwhile.
+//
+//==========================================================================
+
+template<typename Func>
+static void RunParticleBatches (unsigned count, const Func &work)
+{
+	if (count < 2 * PARTICLE_BATCH)
+	{
+		work(0, count);
+		return;
+	}
+
+	int numbatches = int((count + PARTICLE_BATCH - 1) / PARTICLE_BATCH);
+	FWorkerPool::RunParallel(numbatches, [&](int batch)
+	{
+		unsigned start = unsigned(batch) * PARTICLE_BATCH;
+		work(start, MIN<unsigned>(start + PARTICLE_BATCH, count));
+	});
+}
+
 // Group particles by subsectors. Because particles are always
 // in motion, there is little benefit to caching this information
 // from one frame to the next.
@@ -199,16 +255,32 @@ void P_FindParticleSubsectors ()
 		ParticlesInSubsec.Reserve (numsubsectors - ParticlesInSubsec.Size());
 	}
 
-	fillshort (&ParticlesInSubsec[0], numsubsectors, NO_PARTICLE);
+	std::fill_n (&ParticlesInSubsec[0], numsubsectors, NO_PARTICLE);
 
 	if (!r_particles)
 	{
 		return;
 	}
-	for (uint16_t i = ActiveParticles; i != NO_PARTICLE; i = Particles[i].tnext)
+
+	unsigned count = GatherActiveParticles();
+
+	// Looking up the subsectors is the expensive part, so that is done in
+	// parallel. Linking the particles is done afterwards on this thread, in
+	// list order, so the subsector lists always come out the same.
+	auto findsubsectors = [](unsigned start, unsigned end)
 	{
-		 // Try to reuse the subsector from the last portal check, if still valid.
-		if (Particles[i].subsector == NULL) Particles[i].subsector = R_PointInSubsector(Particles[i].Pos);
+		for (unsigned j = start; j < end; j++)
+		{
+			particle_t *particle = &Particles[ParticleWork[j]];
+			// Try to reuse the subsector from the last portal check, if still valid.
+			if (particle->subsector == NULL) particle->subsector = R_PointInSubsector(particle->Pos);
+		}
+	};
+	RunParticleBatches(count, findsubsectors);
+
+	for (unsigned j = 0; j < count; j++)
+	{
+		uint32_t i = ParticleWork[j];
 		int ssnum = int(Particles[i].subsector - subsectors);
 		Particles[i].snext = ParticlesInSubsec[ssnum];
 		ParticlesInSubsec[ssnum] = i;
@@ -253,64 +325,100 @@ void P_InitEffects ()
 	blood2 = ParticleColor(RPART(kind)/3, GPART(kind)/3, BPART(kind)/3);
 }
 
-void P_ThinkParticles ()
+//==========================================================================
+//
+// Moves a single particle. Returns false if it has expired. This only
+// modifies the particle itself, so it can run on any thread as long as
+// there are no interactive line portals (see P_ThinkParticles).
+//
+//==========================================================================
+
+static bool ThinkParticle (particle_t *particle, bool frozen)
 {
-	int i;
-	particle_t *particle, *prev;
+	if (!particle->notimefreeze && frozen)
+	{
+		return true;
+	}
 
-	i = ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
+	auto oldtrans = particle->alpha;
+	particle->alpha -= particle->fadestep;
+	particle->size += particle->sizestep;
+	if (particle->alpha <= 0 || oldtrans < particle->alpha || --particle->ttl <= 0 || (particle->size <= 0))
+	{ // The particle has expired
+		return false;
+	}
+
+	// Handle crossing a line portal
+	DVector2 newxy = P_GetOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
+	particle->Pos.X = newxy.X;
+	particle->Pos.Y = newxy.Y;
+	particle->Pos.Z += particle->Vel.Z;
+	particle->Vel += particle->Acc;
+	particle->subsector = R_PointInSubsector(particle->Pos);
+	sector_t *s = particle->subsector->sector;
+	// Handle crossing a sector portal.
+	if (!s->PortalBlocksMovement(sector_t::ceiling))
 	{
-		particle = Particles + i;
-		i = particle->tnext;
-		if (!particle->notimefreeze && ((bglobal.freeze) || (level.flags2 & LEVEL2_FROZEN)))
+		if (particle->Pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
 		{
-			prev = particle;
-			continue;
+			particle->Pos += s->GetPortalDisplacement(sector_t::ceiling);
+			particle->subsector = NULL;
 		}
-		
-		auto oldtrans = particle->alpha;
-		particle->alpha -= particle->fadestep;
-		particle->size += particle->sizestep;
-		if (particle->alpha <= 0 || oldtrans < particle->alpha || --particle->ttl <= 0 || (particle->size <= 0))
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				ActiveParticles = i;
-			particle->tnext = InactiveParticles;
-			InactiveParticles = (int)(particle - Particles);
-			continue;
+	}
+	else if (!s->PortalBlocksMovement(sector_t::floor))
+	{
+		if (particle->Pos.Z < s->GetPortalPlaneZ(sector_t::floor))
+		{
+			particle->Pos += s->GetPortalDisplacement(sector_t::floor);
+			particle->subsector = NULL;
+		}
+	}
+	return true;
+}
+
+void P_ThinkParticles ()
+{
+	bool frozen = bglobal.freeze || (level.flags2 & LEVEL2_FROZEN);
+	unsigned count = GatherActiveParticles();
+
+	ParticleExpired.Resize(count);
+	auto think = [frozen](unsigned start, unsigned end)
+	{
+		for (unsigned j = start; j < end; j++)
+		{
+			ParticleExpired[j] = !ThinkParticle(&Particles[ParticleWork[j]], frozen);
 		}
+	};
+
+	// The line portal traverser keeps its intercepts in a static array,
+	// so maps with line portals have to be done on this thread.
+	if (PortalBlockmap.containsLines)
+	{
+		think(0, count);
+	}
+	else
+	{
+		RunParticleBatches(count, think);
+	}
 
-		// Handle crossing a line portal
-		DVector2 newxy = P_GetOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
-		particle->Pos.X = newxy.X;
-		particle->Pos.Y = newxy.Y;
-		particle->Pos.Z += particle->Vel.Z;
-		particle->Vel += particle->Acc;
-		particle->subsector = R_PointInSubsector(particle->Pos);
-		sector_t *s = particle->subsector->sector;
-		// Handle crossing a sector portal.
-		if (!s->PortalBlocksMovement(sector_t::ceiling))
+	// Free the expired particles in list order, so that the free list ends
+	// up exactly as it would if everything had been done serially.
+	uint32_t *prevnext = &ActiveParticles;
+	for (unsigned j = 0; j < count; j++)
+	{
+		uint32_t i = ParticleWork[j];
+		particle_t *particle = &Particles[i];
+		if (ParticleExpired[j])
 		{
-			if (particle->Pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
-			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::ceiling);
-				particle->subsector = NULL;
-			}
+			*prevnext = particle->tnext;
+			memset (particle, 0, sizeof(particle_t));
+			particle->tnext = InactiveParticles;
+			InactiveParticles = i;
 		}
-		else if (!s->PortalBlocksMovement(sector_t::floor))
+		else
 		{
-			if (particle->Pos.Z < s->GetPortalPlaneZ(sector_t::floor))
-			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::floor);
-				particle->subsector = NULL;
-			}
+			prevnext = &particle->tnext;
 		}
-		prev = particle;
 	}
 }
 
@@ -54,6 +54,8 @@
 #include "math/cmath.h"
 #include "g_levellocals.h"
 #include "virtual.h"
+#include "workerpool.h"
+#include "profiler.h"
 
 #include "gi.h"
 
@@ -1349,6 +1351,91 @@ bool P_IsVisible(AActor *lookee, AActor *other, INTBOOL allaround, FLookExParams
 	return P_CheckSight(lookee, other, SF_SEEPASTSHOOTABLELINES);
 }
 
+//---------------------------------------------------------------------------
+//
+// Sense phase
+//
+// With parallelsense on, every tic is split in two before the monsters
+// think. The sense phase goes over the monsters whose next state is due and
+// collects the sight checks A_Look and A_Chase are going to make, which are
+// then traced on the worker threads by P_CheckSightBatch. The act phase is
+// the normal thinker loop: the monsters tick in list order as always and
+// each P_CheckSight takes its trace from the batch. The sight cache only
+// hands out a result while the trace would still come out the same, so
+// this never changes the game and the cvar doesn't need to be synced.
+//
+//---------------------------------------------------------------------------
+
+CVAR(Bool, parallelsense, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+// A_Look: the sound target of an ambusher and every player P_IsVisible
+// doesn't rule out by angle before tracing.
+static void SenseIdleMonster(AActor *mo, TArray<FSightQuery> &queries)
+{
+	AActor *heard = (i_compatflags & COMPATF_SOUNDTARGET || mo->flags & MF_NOSECTOR) ? mo->Sector->SoundTarget : mo->LastHeard;
+	if (heard != nullptr && heard->health > 0 && (heard->flags & MF_SHOOTABLE) && (mo->flags & MF_AMBUSH) && !mo->IsFriend(heard))
+	{
+		queries.Push({ mo, heard, SF_SEEPASTBLOCKEVERYTHING });
+	}
+
+	bool allaround = !!(mo->flags4 & MF4_LOOKALLAROUND);
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (!playeringame[i] || players[i].mo == nullptr || players[i].mo->health <= 0)
+			continue;
+
+		AActor *pmo = players[i].mo;
+		if (!allaround && absangle(mo->AngleTo(pmo), mo->Angles.Yaw) > 90. && mo->Distance2D(pmo) > mo->meleerange + mo->radius)
+			continue;
+
+		queries.Push({ mo, pmo, SF_SEEPASTSHOOTABLELINES });
+	}
+}
+
+// A_Chase: P_CheckMissileRange, plus the plain check CheckMeleeRange makes
+// when the target is close and the one for picking a new target.
+static void SenseChasingMonster(AActor *mo, TArray<FSightQuery> &queries)
+{
+	AActor *target = mo->target;
+	if (target->health <= 0)
+		return;
+
+	queries.Push({ mo, target, SF_SEEPASTBLOCKEVERYTHING });
+	if (mo->Distance2D(target) < mo->meleerange + target->radius || ((multiplayer || mo->TIDtoHate) && !mo->threshold))
+	{
+		queries.Push({ mo, target, 0 });
+	}
+}
+
+void P_SenseMonsters()
+{
+	if (!parallelsense || FWorkerPool::NumThreads() < 2)
+		return;
+
+	PROFILE_ZONE("P_SenseMonsters");
+
+	static TArray<FSightQuery> queries;
+	TThinkerIterator<AActor> it(STAT_DEFAULT);
+	AActor *mo;
+
+	queries.Clear();
+	while ((mo = it.Next()))
+	{
+		if (!(mo->flags3 & MF3_ISMONSTER) || (mo->flags2 & MF2_DORMANT) || mo->tics != 1 || mo->health <= 0)
+			continue;
+
+		if (mo->target != nullptr)
+		{
+			SenseChasingMonster(mo, queries);
+		}
+		else
+		{
+			SenseIdleMonster(mo, queries);
+		}
+	}
+	P_CheckSightBatch(queries);
+}
+
 DEFINE_ACTION_FUNCTION(AActor, IsVisible)
 {
 	PARAM_SELF_PROLOGUE(AActor);
@@ -281,6 +281,16 @@ enum ESightFlags
 	SF_IGNOREWATERBOUNDARY=8
 };
 
+struct FSightQuery
+{
+	AActor *t1;
+	AActor *t2;
+	int flags;
+};
+
+void	P_CheckSightBatch (const TArray<FSightQuery> &queries);
+void	P_ClearSightCache ();
+void	P_SenseMonsters ();
 void	P_ResetSightCounters (bool full);
 bool	P_TalkFacing (AActor *player);
 void	P_UseLines (player_t* player);
@@ -38,6 +38,7 @@
 #include "p_local.h"
 #include "p_maputl.h"
 #include "p_3dmidtex.h"
+#include "p_actorgrid.h"
 #include "p_blockmap.h"
 #include "r_utility.h"
 
@@ -307,6 +308,7 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 		}
 		BlockNode = NULL;
 	}
+	ActorGrid.Unlink(this);
 }
 
 
@@ -525,6 +527,8 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 			}
 		}
 	}
+	ActorGrid.Link(this);
+
 	// Portal links cannot be done unless the level is fully initialized.
 	if (!spawningmapthing) UpdateRenderSectorList();
 }
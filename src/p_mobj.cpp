@@ -509,6 +509,7 @@ void AActor::PostSerialize()
 	LinkToWorld(nullptr, false, Sector);
 
 	AddToHash();
+	LinkToClass();
 	if (player)
 	{
 		if (playeringame[player - players] &&
@@ -3285,7 +3286,14 @@ void P_NightmareRespawn (AActor *mobj)
 }
 
 
-AActor *AActor::TIDHash[128];
+TArray<AActor *> AActor::TIDHash;
+unsigned AActor::NumHashedTIDs;
+
+enum
+{
+	MIN_TID_BUCKETS = 128,
+	MAX_TID_CHAIN_LOAD = 2,		// average number of actors per bucket before the table grows
+};
 
 //
 // P_ClearTidHashes
@@ -3295,7 +3303,44 @@ AActor *AActor::TIDHash[128];
 
 void AActor::ClearTIDHashes ()
 {
-	memset(TIDHash, 0, sizeof(TIDHash));
+	TIDHash.Resize(MIN_TID_BUCKETS);
+	memset(&TIDHash[0], 0, MIN_TID_BUCKETS * sizeof(AActor *));
+	NumHashedTIDs = 0;
+}
+
+//
+// Doubles the number of buckets. All actors with the same tid keep their
+// order in the chains, so iterators that are in the middle of a chain
+// continue with the same actors they would have seen without it.
+//
+
+void AActor::GrowTIDHash ()
+{
+	unsigned newsize = MAX<unsigned>(TIDHash.Size() * 2, MIN_TID_BUCKETS);
+	TArray<AActor *> newhash;
+	TArray<AActor **> tails;
+
+	newhash.Resize(newsize);
+	tails.Resize(newsize);
+	for (unsigned i = 0; i < newsize; i++)
+	{
+		newhash[i] = nullptr;
+		tails[i] = &newhash[i];
+	}
+	for (auto probe : TIDHash)
+	{
+		while (probe != nullptr)
+		{
+			AActor *next = probe->inext;
+			AActor **&tail = tails[probe->tid & (newsize - 1)];
+			*tail = probe;
+			probe->iprev = tail;
+			probe->inext = nullptr;
+			tail = &probe->inext;
+			probe = next;
+		}
+	}
+	TIDHash = std::move(newhash);
 }
 
 //
@@ -3314,7 +3359,11 @@ void AActor::AddToHash ()
 	}
 	else
 	{
-		int hash = TIDHASH (tid);
+		if (NumHashedTIDs >= TIDHash.Size() * MAX_TID_CHAIN_LOAD)
+		{
+			GrowTIDHash();
+		}
+		int hash = tid & (TIDHash.Size() - 1);
 
 		inext = TIDHash[hash];
 		iprev = &TIDHash[hash];
@@ -3323,6 +3372,7 @@ void AActor::AddToHash ()
 		{
 			inext->iprev = &inext;
 		}
+		NumHashedTIDs++;
 	}
 }
 
@@ -3342,10 +3392,71 @@ void AActor::RemoveFromHash ()
 		}
 		iprev = NULL;
 		inext = NULL;
+		NumHashedTIDs--;
 	}
 	tid = 0;
 }
 
+//
+// Reports how well the actors are spread over the tid hash.
+//
+
+FString AActor::GetTIDHashStats ()
+{
+	unsigned used = 0, longest = 0;
+	for (auto probe : TIDHash)
+	{
+		unsigned length = 0;
+		for (; probe != nullptr; probe = probe->inext)
+		{
+			length++;
+		}
+		if (length > 0) used++;
+		longest = MAX(longest, length);
+	}
+	FString out;
+	out.Format("Actors: %u  Buckets: %u (%u used)  Average chain: %.2f  Longest chain: %u",
+		NumHashedTIDs, TIDHash.Size(), used, used > 0 ? double(NumHashedTIDs) / used : 0., longest);
+	return out;
+}
+
+ADD_STAT(tidhash)
+{
+	return AActor::GetTIDHashStats();
+}
+
+//
+// Links the actor into the list of live actors of its class.
+//
+void AActor::LinkToClass ()
+{
+	if (cprev == nullptr)
+	{
+		auto cls = GetClass();
+		cnext = cls->Instances;
+		cprev = &cls->Instances;
+		cls->Instances = this;
+		if (cnext)
+		{
+			cnext->cprev = &cnext;
+		}
+	}
+}
+
+void AActor::UnlinkFromClass ()
+{
+	if (cprev != nullptr)
+	{
+		*cprev = cnext;
+		if (cnext)
+		{
+			cnext->cprev = cprev;
+		}
+		cprev = nullptr;
+		cnext = nullptr;
+	}
+}
+
 DEFINE_ACTION_FUNCTION(AActor, RemoveFromHash)
 {
 	PARAM_SELF_PROLOGUE(AActor);
@@ -3376,7 +3487,7 @@ DEFINE_ACTION_FUNCTION(AActor, ChangeTid)
 
 bool P_IsTIDUsed(int tid)
 {
-	AActor *probe = AActor::TIDHash[tid & 127];
+	AActor *probe = AActor::FirstInTIDChain(tid);
 	while (probe != NULL)
 	{
 		if (probe->tid == tid)
@@ -4782,6 +4893,7 @@ AActor *AActor::StaticSpawn (PClassActor *type, const DVector3 &pos, replace_t a
 	AActor *actor;
 	
 	actor = static_cast<AActor *>(const_cast<PClassActor *>(type)->CreateNew ());
+	actor->LinkToClass();
 
 	// Set default dialogue
 	actor->ConversationRoot = GetConversation(actor->GetClass()->TypeName);
@@ -5233,6 +5345,7 @@ void AActor::OnDestroy ()
 
 	// [RH] Unlink from tid chain
 	RemoveFromHash ();
+	UnlinkFromClass ();
 
 	// unlink from sector and block lists
 	UnlinkFromWorld (nullptr);
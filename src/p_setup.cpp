@@ -41,6 +41,8 @@
 #include "w_wad.h"
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_actorgrid.h"
+#include "dobjpool.h"
 #include "p_effect.h"
 #include "p_terrain.h"
 #include "nodebuild.h"
@@ -3070,6 +3072,7 @@ void P_LoadBlockMap (MapData * map)
 	blocklinks = new FBlockNode *[count];
 	memset (blocklinks, 0, count*sizeof(*blocklinks));
 	blockmap = blockmaplump+4;
+	ActorGrid.Init(bmapwidth, bmapheight, bmaporgx, bmaporgy);
 }
 
 //
@@ -3438,6 +3441,7 @@ void P_FreeLevelData ()
 	E_Shutdown(true);
 	MapThingsConverted.Clear();
 	MapThingsUserDataIndex.Clear();
+	P_ClearSightCache();
 	MapThingsUserData.Clear();
 	linemap.Clear();
 	FCanvasTextureInfo::EmptyList();
@@ -3453,6 +3457,7 @@ void P_FreeLevelData ()
 	FPolyObj::ClearAllSubsectorLinks(); // can't be done as part of the polyobj deletion process.
 	SN_StopAllSequences ();
 	DThinker::DestroyAllThinkers ();
+	FObjectPool::ReleaseEmptySlabs();	// the thinkers were just collected
 	P_ClearPortals();
 	tagManager.Clear();
 	level.total_monsters = level.total_items = level.total_secrets =
@@ -3513,6 +3518,7 @@ void P_FreeLevelData ()
 		delete[] blocklinks;
 		blocklinks = NULL;
 	}
+	ActorGrid.Clear();
 	if (PolyBlockMap != NULL)
 	{
 		for (int i = bmapwidth*bmapheight-1; i >= 0; --i)
@@ -24,11 +24,14 @@
 #include "r_utility.h"
 #include "b_bot.h"
 #include "p_spec.h"
+#include "portal.h"
+#include "workerpool.h"
 
 // State.
 #include "r_state.h"
 
 #include "stats.h"
+#include "profiler.h"
 #include "g_levellocals.h"
 
 static FRandom pr_botchecksight ("BotCheckSight");
@@ -45,9 +48,10 @@ This uses specialized forms of the maputils routines for optimized performance
 */
 
 // Performance meters
-static int sightcounts[6];
 static cycle_t SightCycles;
 static cycle_t MaxSightCycles;
+static int sightbatched;
+static int sightcachehits;
 
 enum
 {
@@ -81,11 +85,68 @@ struct SightTask
 };
 
 
-static TArray<intercept_t> intercepts (128);
-static TArray<SightTask> portals(32);
+// The lines and sectors a trace looked at. A line that isn't crossed by the
+// line of sight only matters through its vertices, so as long as neither the
+// two actors nor any polyobject move, running the trace again would read
+// exactly these and nothing else.
+struct FSightRecord
+{
+	TArray<line_t *> lines;
+	TArray<sector_t *> sectors;
+	bool portals;					// went through portals, which isn't recorded
+};
+
+// Everything a sight check changes while it runs. Each thread has its own
+// copy so that several checks can be traced at once; the map is only read.
+struct FSightContext
+{
+	TArray<intercept_t> intercepts;
+	TArray<SightTask> portals;
+	TArray<int> linechecked;		// per-thread replacement for validcount
+	TArray<int> polychecked;
+	TArray<int> sectorchecked;
+	int checknum = 0;
+	int sightcounts[6] = {};
+	FSightRecord *record = nullptr;	// if set, the trace notes what it reads here
+
+	void NewCheck()
+	{
+		if (linechecked.Size() != level.lines.Size() || polychecked.Size() != (unsigned)po_NumPolyobjs ||
+			sectorchecked.Size() != level.sectors.Size())
+		{
+			linechecked.Resize(level.lines.Size());
+			polychecked.Resize(po_NumPolyobjs);
+			sectorchecked.Resize(level.sectors.Size());
+			for (auto &c : linechecked) c = 0;
+			for (auto &c : polychecked) c = 0;
+			for (auto &c : sectorchecked) c = 0;
+		}
+		checknum++;
+	}
+
+	void RecordSector(sector_t *sec)
+	{
+		int &checked = sectorchecked[sec->Index()];
+		if (checked != checknum)
+		{
+			checked = checknum;
+			record->sectors.Push(sec);
+		}
+	}
+
+	void RecordLine(line_t *ld)
+	{
+		record->lines.Push(ld);
+		RecordSector(ld->frontsector);
+		if (ld->backsector != nullptr) RecordSector(ld->backsector);
+	}
+};
+
+static thread_local FSightContext SightContext;
 
 class SightCheck
 {
+	FSightContext *Context;
 	DVector3 sightstart;
 	DVector2 sightend;
 	double Startfrac;
@@ -110,6 +171,8 @@ class SightCheck
 	bool LineBlocksSight(line_t *ld);
 
 public:
+	SightCheck(FSightContext *context) : Context(context) {}
+
 	bool P_SightPathTraverse ();
 
 	void init(AActor * t1, AActor * t2, sector_t *startsector, SightTask *task, int flags)
@@ -264,16 +327,16 @@ bool SightCheck::PTR_SightTraverse (intercept_t *in)
 
 		if (portaldir != sector_t::floor && (open.portalflags & SO_TOPBACK) && !(open.portalflags & SO_TOPFRONT))
 		{
-			portals.Push({ in->frac, topslope, bottomslope, sector_t::ceiling, backsec->GetOppositePortalGroup(sector_t::ceiling) });
+			Context->portals.Push({ in->frac, topslope, bottomslope, sector_t::ceiling, backsec->GetOppositePortalGroup(sector_t::ceiling) });
 		}
 		if (portaldir != sector_t::ceiling && (open.portalflags & SO_BOTTOMBACK) && !(open.portalflags & SO_BOTTOMFRONT))
 		{
-			portals.Push({ in->frac, topslope, bottomslope, sector_t::floor, backsec->GetOppositePortalGroup(sector_t::floor) });
+			Context->portals.Push({ in->frac, topslope, bottomslope, sector_t::floor, backsec->GetOppositePortalGroup(sector_t::floor) });
 		}
 	}
 	if (lport)
 	{
-		portals.Push({ in->frac, topslope, bottomslope, portaldir, lport->mDestination->frontsector->PortalGroup });
+		Context->portals.Push({ in->frac, topslope, bottomslope, portaldir, lport->mDestination->frontsector->PortalGroup });
 		return false;
 	}
 
@@ -419,11 +482,12 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 {
 	divline_t dl;
 
-	if (ld->validcount == validcount)
+	int &checked = Context->linechecked[ld->Index()];
+	if (checked == Context->checknum)
 	{
 		return true;
 	}
-	ld->validcount = validcount;
+	checked = Context->checknum;
 	if (P_PointOnDivlineSide (ld->v1->fPos(), &Trace) ==
 		P_PointOnDivlineSide (ld->v2->fPos(), &Trace))
 	{
@@ -436,17 +500,22 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 		return true;		// line isn't crossed
 	}
 
+	if (Context->record != nullptr)
+	{
+		Context->RecordLine(ld);
+	}
+
 	if (!portalfound)	// when portals come into play, the quick-outs here may not be performed
 	{
 		if (LineBlocksSight(ld)) return false;
 	}
 
-	sightcounts[3]++;
+	Context->sightcounts[3]++;
 	// store the line for later intersection testing
 	intercept_t newintercept;
 	newintercept.isaline = true;
 	newintercept.d.line = ld;
-	intercepts.Push (newintercept);
+	Context->intercepts.Push (newintercept);
 
 	return true;
 }
@@ -477,13 +546,18 @@ int SightCheck::P_SightBlockLinesIterator (int x, int y)
 
 	polyLink = PolyBlockMap[offset];
 	portalfound |= (polyLink && PortalBlockmap.hasLinkedPolyPortals);
+	if (portalfound && Context->record != nullptr)
+	{
+		Context->record->portals = true;
+	}
 	while (polyLink)
 	{
 		if (polyLink->polyobj)
 		{ // only check non-empty links
-			if (polyLink->polyobj->validcount != validcount)
+			int &checked = Context->polychecked[int(polyLink->polyobj - polyobjs)];
+			if (checked != Context->checknum)
 			{
-				polyLink->polyobj->validcount = validcount;
+				checked = Context->checknum;
 				for (i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
 				{
 					if (!P_SightCheckLine(polyLink->polyobj->Linedefs[i]))
@@ -527,6 +601,7 @@ bool SightCheck::P_SightTraverseIntercepts ()
 	intercept_t *scan, *in;
 	unsigned scanpos;
 	divline_t dl;
+	TArray<intercept_t> &intercepts = Context->intercepts;
 
 	count = intercepts.Size ();
 //
@@ -615,13 +690,14 @@ bool SightCheck::P_SightPathTraverse ()
 	int mapx, mapy, mapxstep, mapystep;
 	int count;
 
-	validcount++;
-	intercepts.Clear ();
+	Context->NewCheck();
+	Context->intercepts.Clear ();
 	x1 = sightstart.X + Startfrac * Trace.dx;
 	y1 = sightstart.Y + Startfrac * Trace.dy;
 	x2 = sightend.X;
 	y2 = sightend.Y;
 	if (lastsector == NULL) lastsector = P_PointInSector(x1, y1);
+	if (Context->record != nullptr) Context->RecordSector(lastsector);
 
 	// for FF_SEETHROUGH the following rule applies:
 	// If the viewer is in an area without FF_SEETHROUGH he can only see into areas without this flag
@@ -647,11 +723,11 @@ bool SightCheck::P_SightPathTraverse ()
 	// We also must check if the starting sector contains  portals, and start sight checks in those as well.
 	if (portaldir != sector_t::floor && checkceiling && !lastsector->PortalBlocksSight(sector_t::ceiling))
 	{
-		portals.Push({ 0, topslope, bottomslope, sector_t::ceiling, lastsector->GetOppositePortalGroup(sector_t::ceiling) });
+		Context->portals.Push({ 0, topslope, bottomslope, sector_t::ceiling, lastsector->GetOppositePortalGroup(sector_t::ceiling) });
 	}
 	if (portaldir != sector_t::ceiling && checkfloor && !lastsector->PortalBlocksSight(sector_t::floor))
 	{
-		portals.Push({ 0, topslope, bottomslope, sector_t::floor, lastsector->GetOppositePortalGroup(sector_t::floor) });
+		Context->portals.Push({ 0, topslope, bottomslope, sector_t::floor, lastsector->GetOppositePortalGroup(sector_t::floor) });
 	}
 
 	x1 -= bmaporgx;
@@ -747,7 +823,7 @@ bool SightCheck::P_SightPathTraverse ()
 		itres = P_SightBlockLinesIterator(mapx, mapy);
 		if (itres == 0)
 		{
-			sightcounts[1]++;
+			Context->sightcounts[1]++;
 			return false;	// early out
 		}
 
@@ -758,7 +834,7 @@ bool SightCheck::P_SightPathTraverse ()
 		switch (((xs_FloorToInt(yintercept) == mapy) << 1) | (xs_FloorToInt(xintercept) == mapx))
 		{
 		case 0:		// neither xintercept nor yintercept match!
-sightcounts[5]++;
+Context->sightcounts[5]++;
 			// Continuing won't make things any better, so we might as well stop right here
 			count = 1000;
 			break;
@@ -778,7 +854,7 @@ sightcounts[5]++;
 			break;
 
 		case 3:		// xintercept and yintercept both match
-			sightcounts[4]++;
+			Context->sightcounts[4]++;
 			// The trace is exiting a block through its corner. Not only does the block
 			// being entered need to be checked (which will happen when this loop
 			// continues), but the other two blocks adjacent to the corner also need to
@@ -786,7 +862,7 @@ sightcounts[5]++;
 			if (!P_SightBlockLinesIterator (mapx + mapxstep, mapy) ||
 				!P_SightBlockLinesIterator (mapx, mapy + mapystep))
 			{
-sightcounts[1]++;
+Context->sightcounts[1]++;
 				return false;
 			}
 			xintercept += xstep;
@@ -805,7 +881,7 @@ sightcounts[1]++;
 //
 // couldn't early out, so go through the sorted list
 //
-sightcounts[2]++;
+Context->sightcounts[2]++;
 
 	bool traverseres = P_SightTraverseIntercepts ( );
 	if (itres == -1) return false;	// if the iterator had an early out there was no line of sight. The traverser was only called to collect more portals.
@@ -813,45 +889,33 @@ sightcounts[2]++;
 	return traverseres;
 }
 
-/*
-=====================
-=
-= P_CheckSight
-=
-= Returns true if a straight line between t1 and t2 is unobstructed
-= look from eyes of t1 to any part of t2
-=
-= killough 4/20/98: cleaned up, made to use new LOS struct
-=
-=====================
-*/
+//==========================================================================
+//
+// SightPrecheck
+//
+// The checks that don't need a trace. Returns false if t1 cannot see t2,
+// true if the trace has to decide.
+//
+//==========================================================================
 
-bool P_CheckSight (AActor *t1, AActor *t2, int flags)
+static bool SightRejected(const sector_t *s1, const sector_t *s2)
 {
-	SightCycles.Clock();
-
-	bool res;
-
-	assert (t1 != NULL);
-	assert (t2 != NULL);
-	if (t1 == NULL || t2 == NULL)
-	{
-		return false;
-	}
+	int pnum = int(s1->Index()) * level.sectors.Size() + int(s2->Index());
+	return rejectmatrix != NULL && (rejectmatrix[pnum>>3] & (1 << (pnum & 7)));
+}
 
+static bool SightPrecheck(AActor *t1, AActor *t2, int flags)
+{
 	const sector_t *s1 = t1->Sector;
 	const sector_t *s2 = t2->Sector;
-	int pnum = int(s1->Index()) * level.sectors.Size() + int(s2->Index());
 
 //
 // check for trivial rejection
 //
-	if (rejectmatrix != NULL &&
-		(rejectmatrix[pnum>>3] & (1 << (pnum & 7))))
+	if (SightRejected(s1, s2))
 	{
-sightcounts[0]++;
-		res = false;			// can't possibly be connected
-		goto done;
+SightContext.sightcounts[0]++;
+		return false;			// can't possibly be connected
 	}
 
 //
@@ -863,8 +927,7 @@ sightcounts[0]++;
 	{ // small chance of an attack being made anyway
 		if ((bglobal.m_Thinking ? pr_botchecksight() : pr_checksight()) > 50)
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
 
@@ -884,46 +947,294 @@ sightcounts[0]++;
 			  (t2->Z() >= s2->heightsec->ceilingplane.ZatPoint(t2) &&
 			   t1->Top() <= s2->heightsec->ceilingplane.ZatPoint(t1)))))
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
+	return true;
+}
+
+//==========================================================================
+//
+// SightTrace
+//
+// Looks from the eyes of t1 to any part of t2. This only reads the map
+// and the two actors, so it can run on any thread.
+//
+//==========================================================================
+
+static bool SightTrace(FSightContext &context, AActor *t1, AActor *t2, int flags)
+{
+	bool res;
+	sector_t *sec;
+	double lookheight = t1->Z() + t1->Height*0.75;
+	t1->GetPortalTransition(lookheight, &sec);
 
-	// An unobstructed LOS is possible.
-	// Now look from eyes of t1 to any part of t2.
+	double bottomslope = t2->Z() - lookheight;
+	double topslope = bottomslope + t2->Height;
+	SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
 
-	validcount++;
-	portals.Clear();
+	context.portals.Clear();
+
+	SightCheck s(&context);
+	s.init(t1, t2, sec, &task, flags);
+	res = s.P_SightPathTraverse ();
+	if (context.record != nullptr && context.portals.Size() > 0)
+	{
+		context.record->portals = true;
+	}
+	if (!res)
 	{
-		sector_t *sec;
-		double lookheight = t1->Z() + t1->Height*0.75;
-		t1->GetPortalTransition(lookheight, &sec);
+		double dist = t1->Distance2D(t2);
+		for (unsigned i = 0; i < context.portals.Size(); i++)
+		{
+			context.portals[i].Frac += 1 / dist;
+			s.init(t1, t2, NULL, &context.portals[i], flags);
+			if (s.P_SightPathTraverse())
+			{
+				res = true;
+				break;
+			}
+		}
+	}
+	return res;
+}
+
+//==========================================================================
+//
+// Sight cache
+//
+// P_CheckSightBatch traces a set of checks on the worker threads before they
+// are needed, and P_CheckSight takes its trace result from here instead of
+// tracing again. An entry is only used while everything its trace read is
+// unchanged: both actors' positions, heights and sectors, the polyobjects,
+// and the state of every line it crossed and every sector it passed through,
+// including their planes and 3D floors. Scripts can change any of that
+// without the game noticing, so the state is compared value by value on
+// every lookup. A result taken from the cache is therefore always the one a
+// new trace would return, and it doesn't matter for demos and netgames who
+// made the batch, when, or on how many threads. There is at most one entry
+// for each (t1, t2, flags), so the order of the hash table doesn't matter
+// either. Traces that go through portals are not kept.
+//
+// The rejection, visibility and water checks are never cached because they
+// are cheap and the visibility check uses the random number generator.
+//
+//==========================================================================
 
-		double bottomslope = t2->Z() - lookheight;
-		double topslope = bottomslope + t2->Height;
-		SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
+struct FSightCacheEntry
+{
+	AActor *t1;
+	AActor *t2;
+	int flags;
+	unsigned next;					// next entry for the same t1
+
+	DVector3 pos1, pos2;
+	double height1, height2;
+	sector_t *sector1, *sector2;
+	int tracecompat;
+	int polymoves;
+
+	bool result;
+	FSightRecord record;
+	TArray<double> state;			// what the trace read from record
+};
+
+static TArray<FSightCacheEntry> SightCache;
+static unsigned NumSightCache;
+static TMap<AActor *, unsigned> SightCacheHeads;
+
+static void SavePlaneState(const secplane_t &plane, TArray<double> &state)
+{
+	state.Push(plane.normal.X);
+	state.Push(plane.normal.Y);
+	state.Push(plane.normal.Z);
+	state.Push(plane.D);
+	state.Push(plane.negiC);
+}
 
+static void SaveSightState(const FSightRecord &record, TArray<double> &state)
+{
+	state.Clear();
+	for (auto ld : record.lines)
+	{
+		state.Push(ld->flags);
+		state.Push(ld->activation);
+		state.Push(ld->special);
+		state.Push(ld->args[1]);
+		state.Push(ld->portalindex);
+	}
+	for (auto sec : record.sectors)
+	{
+		SavePlaneState(sec->floorplane, state);
+		SavePlaneState(sec->ceilingplane, state);
+		state.Push(sec->PortalBlocksSight(sector_t::floor));
+		state.Push(sec->PortalBlocksSight(sector_t::ceiling));
+		state.Push(sec->e->XFloor.ffloors.Size());
+		for (auto rover : sec->e->XFloor.ffloors)
+		{
+			state.Push(rover->flags);
+			SavePlaneState(*rover->top.plane, state);
+			SavePlaneState(*rover->bottom.plane, state);
+		}
+	}
+}
 
-		SightCheck s;
-		s.init(t1, t2, sec, &task, flags);
-		res = s.P_SightPathTraverse ();
-		if (!res)
+static FSightCacheEntry *FindSightCacheEntry(AActor *t1, AActor *t2, int flags)
+{
+	unsigned *head = SightCacheHeads.CheckKey(t1);
+	if (head != nullptr)
+	{
+		for (unsigned i = *head; i != ~0u; i = SightCache[i].next)
 		{
-			double dist = t1->Distance2D(t2);
-			for (unsigned i = 0; i < portals.Size(); i++)
+			if (SightCache[i].t2 == t2 && SightCache[i].flags == flags)
 			{
-				portals[i].Frac += 1 / dist;
-				s.init(t1, t2, NULL, &portals[i], flags);
-				if (s.P_SightPathTraverse())
-				{
-					res = true;
-					break;
-				}
+				return &SightCache[i];
 			}
 		}
 	}
+	return nullptr;
+}
+
+static bool CheckCachedSight(AActor *t1, AActor *t2, int flags, bool &result)
+{
+	if (NumSightCache == 0)
+		return false;
+
+	FSightCacheEntry *entry = FindSightCacheEntry(t1, t2, flags);
+	if (entry == nullptr || entry->record.portals)
+		return false;
+
+	if (entry->pos1 != t1->Pos() || entry->height1 != t1->Height || entry->sector1 != t1->Sector ||
+		entry->pos2 != t2->Pos() || entry->height2 != t2->Height || entry->sector2 != t2->Sector ||
+		entry->tracecompat != (i_compatflags & COMPATF_TRACE) || entry->polymoves != po_MoveCount)
+		return false;
+
+	static TArray<double> state;
+	SaveSightState(entry->record, state);
+	if (state.Size() != entry->state.Size() ||
+		(state.Size() > 0 && memcmp(&state[0], &entry->state[0], state.Size() * sizeof(double)) != 0))
+		return false;
+
+	result = entry->result;
+	sightcachehits++;
+	return true;
+}
+
+//==========================================================================
+//
+// P_CheckSightBatch
+//
+// Traces all the queries that aren't cached yet on the worker threads and
+// keeps the results until the end of the tic.
+//
+//==========================================================================
+
+void P_CheckSightBatch(const TArray<FSightQuery> &queries)
+{
+	SightCycles.Clock();
+
+	unsigned first = NumSightCache;
+
+	for (auto &query : queries)
+	{
+		AActor *t1 = query.t1, *t2 = query.t2;
+		if (t1 == nullptr || t2 == nullptr || SightRejected(t1->Sector, t2->Sector))
+			continue;
+		if (FindSightCacheEntry(t1, t2, query.flags) != nullptr)
+			continue;
+
+		if (NumSightCache == SightCache.Size())
+		{
+			SightCache.Reserve(1);
+		}
+		unsigned index = NumSightCache++;
+		FSightCacheEntry &entry = SightCache[index];
+		unsigned *head = SightCacheHeads.CheckKey(t1);
+
+		entry.t1 = t1;
+		entry.t2 = t2;
+		entry.flags = query.flags;
+		entry.next = head != nullptr ? *head : ~0u;
+		SightCacheHeads[t1] = index;
+		entry.pos1 = t1->Pos();
+		entry.pos2 = t2->Pos();
+		entry.height1 = t1->Height;
+		entry.height2 = t2->Height;
+		entry.sector1 = t1->Sector;
+		entry.sector2 = t2->Sector;
+		entry.tracecompat = i_compatflags & COMPATF_TRACE;
+		entry.polymoves = po_MoveCount;
+		entry.record.lines.Clear();
+		entry.record.sectors.Clear();
+		entry.record.portals = false;
+	}
+
+	if (NumSightCache > first)
+	{
+		FWorkerPool::RunParallel(NumSightCache - first, [=](int i)
+		{
+			FSightCacheEntry &entry = SightCache[first + i];
+			SightContext.record = &entry.record;
+			entry.result = SightTrace(SightContext, entry.t1, entry.t2, entry.flags);
+			SightContext.record = nullptr;
+			SaveSightState(entry.record, entry.state);
+		});
+		sightbatched += NumSightCache - first;
+	}
+
+	SightCycles.Unclock();
+}
+
+//==========================================================================
+//
+// P_ClearSightCache
+//
+// Called at the start of every tic and when the level goes away.
+//
+//==========================================================================
+
+void P_ClearSightCache()
+{
+	NumSightCache = 0;
+	SightCacheHeads.Clear();
+}
+
+/*
+=====================
+=
+= P_CheckSight
+=
+= Returns true if a straight line between t1 and t2 is unobstructed
+= look from eyes of t1 to any part of t2
+=
+= killough 4/20/98: cleaned up, made to use new LOS struct
+=
+=====================
+*/
+
+bool P_CheckSight (AActor *t1, AActor *t2, int flags)
+{
+	PROFILE_ZONE("P_CheckSight");
+	SightCycles.Clock();
+
+	bool res;
+
+	assert (t1 != NULL);
+	assert (t2 != NULL);
+	if (t1 == NULL || t2 == NULL)
+	{
+		return false;
+	}
+
+	if (!SightPrecheck(t1, t2, flags))
+	{
+		res = false;
+	}
+	else if (!CheckCachedSight(t1, t2, flags, res))
+	{
+		res = SightTrace(SightContext, t1, t2, flags);
+	}
 
-done:
 	SightCycles.Unclock();
 	return res;
 }
@@ -938,10 +1249,12 @@ DEFINE_ACTION_FUNCTION(AActor, CheckSight)
 
 ADD_STAT (sight)
 {
+	const int *sightcounts = SightContext.sightcounts;
 	FString out;
-	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d\n",
+	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d, %d batched, %d reused\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
-		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5]);
+		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5],
+		sightbatched, sightcachehits);
 	return out;
 }
 
@@ -956,5 +1269,7 @@ void P_ResetSightCounters (bool full)
 		MaxSightCycles = SightCycles;
 	}
 	SightCycles.Reset();
-	memset (sightcounts, 0, sizeof(sightcounts));
+	memset (SightContext.sightcounts, 0, sizeof(SightContext.sightcounts));
+	sightbatched = 0;
+	sightcachehits = 0;
 }
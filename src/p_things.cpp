@@ -52,6 +52,7 @@
 #include "math/cmath.h"
 #include "actorptrselect.h"
 #include "g_levellocals.h"
+#include "p_actorgrid.h"
 
 // Set of spawnable things for the Thing_Spawn and Thing_Projectile specials.
 FClassMap SpawnableThings;
@@ -722,9 +723,24 @@ int P_Thing_CheckProximity(AActor *self, PClass *classname, double distance, int
 	TThinkerIterator<AActor> it;
 	AActor *mo, *dist = nullptr;
 
+	// Unless a pointer gets set the result does not depend on the order the actors
+	// are checked in, so only those near ref need to be looked at. Owned inventory
+	// items don't move with their owners in the actor grid, and it knows nothing
+	// about portals.
+	TArray<AActor *> nearby;
+	unsigned nearbyindex = 0;
+	const bool useGrid = !ptrWillChange && P_NumPortalGroups() <= 1 &&
+		!classname->IsDescendantOf(RUNTIME_CLASS(AInventory)) &&
+		!((flags & CPXF_ANCESTOR) && RUNTIME_CLASS(AInventory)->IsDescendantOf(classname));
+
+	if (useGrid)
+	{
+		ActorGrid.CollectInRadius(ref->Pos().XY(), distance, false, nearby);
+	}
+
 	// [MC] Process of elimination, I think, will get through this as quickly and 
 	// efficiently as possible. 
-	while ((mo = it.Next()))
+	while ((mo = useGrid ? (nearbyindex < nearby.Size() ? nearby[nearbyindex++] : nullptr) : it.Next()))
 	{
 		if (mo == ref) //Don't count self.
 			continue;
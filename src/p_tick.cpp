@@ -115,6 +115,7 @@ void P_Ticker (void)
 		S_ResumeSound (false);
 
 	P_ResetSightCounters (false);
+	P_ClearSightCache ();
 	R_ClearInterpolationPath();
 
 	// Since things will be moving, it's okay to interpolate them in the renderer.
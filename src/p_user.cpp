@@ -62,6 +62,7 @@
 #include "virtual.h"
 #include "g_levellocals.h"
 #include "r_data/r_translate.h"
+#include "p_actorgrid.h"
 
 static FRandom pr_skullpop ("SkullPop");
 
@@ -3222,6 +3223,10 @@ void P_UnPredictPlayer ()
 			block = block->NextBlock;
 		}
 
+		// The actor grid does not depend on ordering, so it can simply be relinked.
+		act->GridCell = 0;
+		ActorGrid.Link(act);
+
 		act->InvSel = InvSel;
 		player->inventorytics = inventorytics;
 	}
@@ -143,6 +143,7 @@ static void ReleaseAllPolyNodes();
 polyblock_t **PolyBlockMap;
 FPolyObj *polyobjs; // list of all poly-objects on the level
 int po_NumPolyobjs;
+int po_MoveCount; // bumped every time a polyobject's lines are about to move
 polyspawns_t *polyspawns; // [RH] Let P_SpawnMapThings() find our thingies for us
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
@@ -932,7 +933,6 @@ bool FPolyObj::MovePolyobj (const DVector2 &pos, bool force)
 	FBoundingBox oldbounds = Bounds;
 	UnLinkPolyobj ();
 	DoMovePolyobj (pos);
-
 	if (!force)
 	{
 		bool blocked = false;
@@ -1010,6 +1010,7 @@ bool FPolyObj::RotatePolyobj (DAngle angle, bool fromsave)
 	bool blocked;
 	FBoundingBox oldbounds = Bounds;
 
+
 	an = Angle + angle;
 
 	UnLinkPolyobj();
@@ -1065,6 +1066,8 @@ void FPolyObj::UnLinkPolyobj ()
 	int i, j;
 	int index;
 
+	po_MoveCount++;
+
 	// remove the polyobj from each blockmap section
 	for(j = bbox[BOXBOTTOM]; j <= bbox[BOXTOP]; j++)
 	{
@@ -155,6 +155,7 @@ struct polyspawns_t
 };
 
 extern int po_NumPolyobjs;
+extern int po_MoveCount;
 extern polyspawns_t *polyspawns;	// [RH] list of polyobject things to spawn
 
 
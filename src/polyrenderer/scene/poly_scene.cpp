@@ -122,7 +122,7 @@ void RenderPolyScene::RenderSubsector(subsector_t *sub)
 	if (mainBSP)
 	{
 		int subsectorIndex = (int)(sub - subsectors);
-		for (int i = ParticlesInSubsec[subsectorIndex]; i != NO_PARTICLE; i = Particles[i].snext)
+		for (uint32_t i = ParticlesInSubsec[subsectorIndex]; i != NO_PARTICLE; i = Particles[i].snext)
 		{
 			particle_t *particle = Particles + i;
 			TranslucentObjects.push_back({ particle, sub, subsectorDepth });
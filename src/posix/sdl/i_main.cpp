@@ -207,6 +207,16 @@ int main (int argc, char **argv)
 
 	setlocale (LC_ALL, "C");
 
+	// The benchmark draws into an offscreen canvas and does not need a display
+	for (int i = 1; i < argc; i++)
+	{
+		if (stricmp (argv[i], "-benchmark") == 0)
+		{
+			setenv ("SDL_VIDEODRIVER", "dummy", 0);
+			break;
+		}
+	}
+
 	if (SDL_Init (0) < 0)
 	{
 		fprintf (stderr, "Could not initialize SDL:\n%s\n", SDL_GetError());
@@ -0,0 +1,249 @@
+/*
+** profiler.cpp
+** Hierarchical timing zones with Chrome trace export
+**
+*/
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "profiler.h"
+#include "c_dispatch.h"
+#include "doomtype.h"
+#include "files.h"
+#include "zstring.h"
+
+struct FProfileEvent
+{
+	const char *Name;
+	int64_t Start;
+	int64_t End;
+};
+
+struct FProfileThreadBuffer
+{
+	int ThreadIndex;
+	FString Name;
+	int Generation = 0;
+	std::vector<FProfileEvent> Events;
+};
+
+std::atomic<bool> FProfiler::Capturing;
+
+static std::mutex BuffersMutex;
+static std::vector<std::unique_ptr<FProfileThreadBuffer>> Buffers;
+static thread_local FProfileThreadBuffer *LocalBuffer;
+
+static std::atomic<int> CaptureGeneration;
+static int FramesLeft;
+static FString CaptureFilename;
+static int64_t CaptureStart;
+static int64_t LastFrameEnd;
+
+//==========================================================================
+//
+// Time in nanoseconds
+//
+//==========================================================================
+
+static int64_t ProfileTime()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//==========================================================================
+//
+// Returns the buffer of the calling thread. Buffers from an older capture
+// are cleared by their own thread the first time it records again.
+//
+//==========================================================================
+
+static FProfileThreadBuffer *GetLocalBuffer()
+{
+	if (LocalBuffer == nullptr)
+	{
+		std::unique_lock<std::mutex> lock(BuffersMutex);
+		Buffers.push_back(std::make_unique<FProfileThreadBuffer>());
+		LocalBuffer = Buffers.back().get();
+		LocalBuffer->ThreadIndex = (int)Buffers.size() - 1;
+		LocalBuffer->Name.Format("Thread %d", LocalBuffer->ThreadIndex);
+	}
+
+	int generation = CaptureGeneration.load(std::memory_order_relaxed);
+	if (LocalBuffer->Generation != generation)
+	{
+		LocalBuffer->Events.clear();
+		LocalBuffer->Generation = generation;
+	}
+	return LocalBuffer;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FProfiler::SetThreadName(const char *name)
+{
+	FProfileThreadBuffer *buffer = GetLocalBuffer();
+	std::unique_lock<std::mutex> lock(BuffersMutex);
+	buffer->Name = name;
+}
+
+int FProfiler::BeginZone(const char *name, int &generation)
+{
+	FProfileThreadBuffer *buffer = GetLocalBuffer();
+	generation = buffer->Generation;
+	buffer->Events.push_back({ name, ProfileTime(), -1 });
+	return (int)buffer->Events.size() - 1;
+}
+
+void FProfiler::EndZone(int index, int generation)
+{
+	// Zones still open when the capture ended, or from a previous capture, are dropped
+	FProfileThreadBuffer *buffer = LocalBuffer;
+	if (buffer != nullptr && buffer->Generation == generation && IsCapturing())
+	{
+		buffer->Events[index].End = ProfileTime();
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FProfiler::StartCapture(int frames, const char *filename)
+{
+	CaptureFilename = filename;
+	FramesLeft = frames;
+	CaptureGeneration++;
+	CaptureStart = LastFrameEnd = ProfileTime();
+	Capturing = true;
+}
+
+//==========================================================================
+//
+// Writes the trace. Must only be called while no other thread is recording.
+//
+//==========================================================================
+
+static void WriteTrace()
+{
+	rapidjson::StringBuffer output;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(output);
+	int generation = CaptureGeneration;
+	int numEvents = 0;
+
+	writer.StartObject();
+	writer.Key("traceEvents");
+	writer.StartArray();
+
+	std::unique_lock<std::mutex> lock(BuffersMutex);
+	for (auto &buffer : Buffers)
+	{
+		if (buffer->Generation != generation)
+			continue;
+
+		writer.StartObject();
+		writer.Key("name"); writer.String("thread_name");
+		writer.Key("ph"); writer.String("M");
+		writer.Key("pid"); writer.Int(1);
+		writer.Key("tid"); writer.Int(buffer->ThreadIndex);
+		writer.Key("args");
+		writer.StartObject();
+		writer.Key("name"); writer.String(buffer->Name.GetChars());
+		writer.EndObject();
+		writer.EndObject();
+
+		for (const FProfileEvent &event : buffer->Events)
+		{
+			if (event.End < 0)
+				continue;
+
+			writer.StartObject();
+			writer.Key("name"); writer.String(event.Name);
+			writer.Key("ph"); writer.String("X");
+			writer.Key("pid"); writer.Int(1);
+			writer.Key("tid"); writer.Int(buffer->ThreadIndex);
+			writer.Key("ts"); writer.Double((event.Start - CaptureStart) / 1000.0);
+			writer.Key("dur"); writer.Double((event.End - event.Start) / 1000.0);
+			writer.EndObject();
+			numEvents++;
+		}
+	}
+	lock.unlock();
+
+	writer.EndArray();
+	writer.Key("displayTimeUnit"); writer.String("ms");
+	writer.EndObject();
+
+	FileWriter *file = FileWriter::Open(CaptureFilename);
+	if (file == nullptr)
+	{
+		Printf("Could not write %s\n", CaptureFilename.GetChars());
+		return;
+	}
+	file->Write(output.GetString(), output.GetSize());
+	delete file;
+	Printf("Wrote %d profile zones to %s\n", numEvents, CaptureFilename.GetChars());
+}
+
+//==========================================================================
+//
+// Called by the main thread after each frame.
+//
+//==========================================================================
+
+void FProfiler::EndFrame()
+{
+	if (!IsCapturing())
+		return;
+
+	FProfileThreadBuffer *buffer = GetLocalBuffer();
+	int64_t now = ProfileTime();
+	buffer->Events.push_back({ "Frame", LastFrameEnd, now });
+	LastFrameEnd = now;
+
+	if (--FramesLeft <= 0)
+	{
+		Capturing = false;
+		WriteTrace();
+	}
+}
+
+//==========================================================================
+//
+// profilecapture [frames] [filename]
+//
+//==========================================================================
+
+CCMD(profilecapture)
+{
+	if (FProfiler::IsCapturing())
+	{
+		Printf("A profile capture is already running\n");
+		return;
+	}
+
+	int frames = argv.argc() > 1 ? atoi(argv[1]) : 10;
+	const char *filename = argv.argc() > 2 ? argv[2] : "profile.json";
+	if (frames <= 0)
+	{
+		Printf("Usage: profilecapture [frames] [filename]\n");
+		return;
+	}
+
+	Printf("Capturing %d frames to %s\n", frames, filename);
+	FProfiler::StartCapture(frames, filename);
+}
@@ -0,0 +1,57 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <atomic>
+
+// Hierarchical timing zones.
+//
+// A zone is timed from the construction of an FProfileZone to the end of
+// its scope. Zones are only recorded while a capture started with the
+// profilecapture console command is running. Every thread records into its
+// own buffer, and when the requested number of frames has been captured
+// all buffers are written out as a Chrome trace (load it in chrome://tracing).
+//
+// The zone name must be a string literal, since only the pointer is stored.
+
+class FProfiler
+{
+public:
+	static bool IsCapturing() { return Capturing.load(std::memory_order_relaxed); }
+
+	static void StartCapture(int frames, const char *filename);
+	static void EndFrame();
+	static void SetThreadName(const char *name);
+
+	static int BeginZone(const char *name, int &generation);
+	static void EndZone(int index, int generation);
+
+private:
+	static std::atomic<bool> Capturing;
+};
+
+class FProfileZone
+{
+public:
+	FProfileZone(const char *name)
+	{
+		Index = FProfiler::IsCapturing() ? FProfiler::BeginZone(name, Generation) : -1;
+	}
+
+	~FProfileZone()
+	{
+		if (Index != -1) FProfiler::EndZone(Index, Generation);
+	}
+
+	FProfileZone(const FProfileZone &) = delete;
+	FProfileZone &operator=(const FProfileZone &) = delete;
+
+private:
+	int Index;
+	int Generation;
+};
+
+#define PROFILE_ZONE_NAME2(line) profilezone_##line
+#define PROFILE_ZONE_NAME(line) PROFILE_ZONE_NAME2(line)
+#define PROFILE_ZONE(name) FProfileZone PROFILE_ZONE_NAME(__LINE__)(name)
+
+#endif //__PROFILER_H__
@@ -12,6 +12,7 @@ class player_t;
 struct sector_t;
 class FCanvasTexture;
 class FileWriter;
+class DCanvas;
 
 struct FRenderer
 {
@@ -40,6 +41,9 @@ struct FRenderer
 	// renders view to a savegame picture
 	virtual void WriteSavePic (player_t *player, FileWriter *file, int width, int height) = 0;
 
+	// renders the view into a system memory canvas. Returns false if the renderer cannot do that.
+	virtual bool RenderViewToCanvas (AActor *viewpoint, DCanvas *canvas) { return false; }
+
 	// draws player sprites with hardware acceleration (only useful for software rendering)
 	virtual void DrawRemainingPlayerSprites() {}
 
@@ -230,6 +230,17 @@ int FRFFLump::FillCache()
 	if (Flags & LUMPF_BLOODCRYPT)
 	{
 		int cryptlen = MIN<int> (LumpSize, 256);
+
+		if (res < 0)
+		{
+			// The cache points into the file's read-only data, so it has to
+			// be copied before it can be decrypted.
+			char *copy = new char[LumpSize];
+			memcpy(copy, Cache, LumpSize);
+			Cache = copy;
+			RefCount = res = 1;
+		}
+
 		uint8_t *data = (uint8_t *)Cache;
 		
 		for (int i = 0; i < cryptlen; ++i)
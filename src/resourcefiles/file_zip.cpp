@@ -51,7 +51,7 @@
 //
 //==========================================================================
 
-static bool UncompressZipLump(char *Cache, FileReader *Reader, int Method, int LumpSize, int CompressedSize, int GPFlags)
+static bool UncompressZipLump(char *Cache, FileReader *Reader, int Method, int LumpSize, int CompressedSize, int GPFlags, bool quiet = false)
 {
 	try
 	{
@@ -104,16 +104,17 @@ static bool UncompressZipLump(char *Cache, FileReader *Reader, int Method, int L
 	}
 	catch (CRecoverableError &err)
 	{
-		Printf("%s\n", err.GetMessage());
+		if (!quiet) Printf("%s\n", err.GetMessage());
 		return false;
 	}
 	return true;
 }
 
-bool FCompressedBuffer::Decompress(char *destbuffer)
+// Pass quiet when calling this from a worker thread.
+bool FCompressedBuffer::Decompress(char *destbuffer, bool quiet)
 {
 	MemoryReader mr(mBuffer, mCompressedSize);
-	return UncompressZipLump(destbuffer, &mr, mMethod, mSize, mCompressedSize, mZipFlags);
+	return UncompressZipLump(destbuffer, &mr, mMethod, mSize, mCompressedSize, mZipFlags, quiet);
 }
 
 //-----------------------------------------------------------------------
@@ -473,6 +474,17 @@ int FZipLump::FillCache()
 //
 //==========================================================================
 
+bool FZipLump::IsCompressed()
+{
+	return Method != METHOD_STORED;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
 int FZipLump::GetFileOffset()
 {
 	if (Method != METHOD_STORED) return -1;
@@ -243,6 +243,7 @@ void *FResourceLump::CacheLump()
 	if (Cache != NULL)
 	{
 		if (RefCount > 0) RefCount++;
+		else if (RefCount == 0) RefCount = 1;	// prefetched
 	}
 	else if (LumpSize > 0)
 	{
@@ -296,7 +297,7 @@ FResourceFile *FResourceFile::OpenResourceFile(const char *filename, FileReader
 	{
 		try
 		{
-			file = new FileReader(filename);
+			file = new MappedFileReader(filename);
 			mustclose = true;
 		}
 		catch (CRecoverableError &)
@@ -18,7 +18,7 @@ struct FCompressedBuffer
 	unsigned mCRC32;
 	char *mBuffer;
 
-	bool Decompress(char *destbuffer);
+	bool Decompress(char *destbuffer, bool quiet = false);
 	void Clean()
 	{
 		mSize = mCompressedSize = 0;
@@ -66,10 +66,16 @@ struct FResourceLump
 	virtual FileReader *NewReader();
 	virtual int GetFileOffset() { return -1; }
 	virtual int GetIndexNum() const { return 0; }
+	virtual bool IsCompressed() { return false; }
 	void LumpNameSetup(FString iname);
 	void CheckEmbedded();
 	virtual FCompressedBuffer GetRawData();
 
+	// The returned data belongs to the lump and may be a view into the
+	// file's read-only memory mapping. It must not be modified; callers
+	// that need to change it have to work on a copy (see Wads.ReadLump).
+	// A cache with a reference count of 0 was filled by Wads.PrefetchLumps
+	// and is handed to the first caller.
 	void *CacheLump();
 	int ReleaseCache();
 
@@ -511,6 +511,25 @@ void S_PrecacheLevel ()
 			chan->SoundID.MarkUsed();
 		}
 
+		// Decompress the sounds that need to be loaded all at once.
+		TArray<int> lumps;
+		for (i = 1; i < S_sfx.Size(); ++i)
+		{
+			sfxinfo_t *sfx = &S_sfx[i];
+			if (sfx->bUsed && !sfx->bPlayerReserve && !sfx->bRandomHeader)
+			{
+				while (sfx->link != sfxinfo_t::NO_LINK && !sfx->bRandomHeader)
+				{
+					sfx = &S_sfx[sfx->link];
+				}
+				if (!sfx->bRandomHeader && !sfx->data.isValid() && sfx->lumpnum >= 0)
+				{
+					lumps.Push(sfx->lumpnum);
+				}
+			}
+		}
+		Wads.PrefetchLumps(lumps);
+
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (S_sfx[i].bUsed)
@@ -518,6 +537,7 @@ void S_PrecacheLevel ()
 				S_CacheSound (&S_sfx[i]);
 			}
 		}
+		Wads.ReleasePrefetchedLumps(lumps);
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (!S_sfx[i].bUsed && S_sfx[i].link == sfxinfo_t::NO_LINK)
@@ -2855,6 +2855,21 @@ error:
 	return nullptr;
 }
 
+//==========================================================================
+//
+// FxAddSub :: GetTextureCountAddress
+//
+// The texture count can change at run time, so the bounds check for
+// texture indices reads it from the texture manager.
+//
+//==========================================================================
+
+void *FxAddSub::GetTextureCountAddress()
+{
+	auto * ptr = (FArray*)&TexMan.Textures;
+	return &ptr->Count;
+}
+
 //==========================================================================
 //
 //
@@ -2945,8 +2960,7 @@ ExpEmit FxAddSub::Emit(VMFunctionBuilder *build)
 
 texcheck:
 	// Do a bounds check for the texture index. Note that count can change at run time so this needs to read the value from the texture manager.
-	auto * ptr = (FArray*)&TexMan.Textures;
-	auto * countptr = &ptr->Count;
+	void * countptr = GetTextureCountAddress();
 	ExpEmit bndp(build, REGT_POINTER);
 	ExpEmit bndc(build, REGT_INT);
 	build->Emit(OP_LKP, bndp.RegNum, build->GetConstantAddress(countptr, ATAG_GENERIC));
@@ -6666,42 +6680,75 @@ FxExpression *FxCVar::Resolve(FCompileContext &ctx)
 	return this;
 }
 
+//==========================================================================
+//
+// FxCVar :: GetValueAddress
+//
+// Returns the address the VM reads the CVar's value from.
+//
+//==========================================================================
+
+void *FxCVar::GetValueAddress(FBaseCVar *cvar)
+{
+	switch (cvar->GetRealType())
+	{
+	case CVAR_Int:
+		return &static_cast<FIntCVar *>(cvar)->Value;
+
+	case CVAR_Color:
+		return &static_cast<FColorCVar *>(cvar)->Value;
+
+	case CVAR_Float:
+		return &static_cast<FFloatCVar *>(cvar)->Value;
+
+	case CVAR_Bool:
+		return &static_cast<FBoolCVar *>(cvar)->Value;
+
+	case CVAR_String:
+		return &static_cast<FStringCVar *>(cvar)->Value;
+
+	case CVAR_DummyBool:
+		return &static_cast<FFlagCVar *>(cvar)->ValueVar.Value;
+
+	case CVAR_DummyInt:
+		return &static_cast<FMaskCVar *>(cvar)->ValueVar.Value;
+
+	default:
+		return nullptr;
+	}
+}
+
 ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 {
 	ExpEmit dest(build, ValueType->GetRegType());
 	ExpEmit addr(build, REGT_POINTER);
 	int nul = build->GetConstantInt(0);
+	build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(GetValueAddress(CVar), ATAG_GENERIC));
 	switch (CVar->GetRealType())
 	{
 	case CVAR_Int:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FIntCVar *>(CVar)->Value, ATAG_GENERIC));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Color:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FColorCVar *>(CVar)->Value, ATAG_GENERIC));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Float:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FFloatCVar *>(CVar)->Value, ATAG_GENERIC));
 		build->Emit(OP_LSP, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Bool:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FBoolCVar *>(CVar)->Value, ATAG_GENERIC));
 		build->Emit(OP_LBU, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_String:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FStringCVar *>(CVar)->Value, ATAG_GENERIC));
 		build->Emit(OP_LCS, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_DummyBool:
 	{
 		auto cv = static_cast<FFlagCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value, ATAG_GENERIC));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(1));
@@ -6711,7 +6758,6 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	case CVAR_DummyInt:
 	{
 		auto cv = static_cast<FMaskCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value, ATAG_GENERIC));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(cv->BitVal));
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
@@ -11178,3 +11224,23 @@ ExpEmit FxStaticArray::Emit(VMFunctionBuilder *build)
 	}
 	return ExpEmit();
 }
+
+//==========================================================================
+//
+// CreateBuiltinFunctions
+//
+// Normally the builtins are created by the first function that calls
+// them. Creating them all before compiling anything keeps the list of
+// VM functions the same no matter which functions get compiled, which
+// the script cache depends on.
+//
+//==========================================================================
+
+void CreateBuiltinFunctions()
+{
+	FindBuiltinFunction(NAME_BuiltinRandom, BuiltinRandom);
+	FindBuiltinFunction(NAME_BuiltinFRandom, BuiltinFRandom);
+	FindBuiltinFunction(NAME_BuiltinCallLineSpecial, BuiltinCallLineSpecial);
+	FindBuiltinFunction(NAME_BuiltinNameToClass, BuiltinNameToClass);
+	FindBuiltinFunction(NAME_BuiltinClassCast, BuiltinClassCast);
+}
@@ -931,6 +931,7 @@ public:
 	FxAddSub(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+	static void *GetTextureCountAddress();
 };
 
 //==========================================================================
@@ -1357,6 +1358,7 @@ public:
 	FxCVar(FBaseCVar*, const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+	static void *GetValueAddress(FBaseCVar *cvar);
 };
 
 
@@ -2140,4 +2142,6 @@ public:
 	}
 };
 
+void CreateBuiltinFunctions();
+
 #endif
@@ -599,6 +599,7 @@ DEFINE_ACTION_FUNCTION(FDynArray_Ptr, Push)
 {
 	PARAM_SELF_STRUCT_PROLOGUE(FDynArray_Ptr);
 	PARAM_POINTER(val, void);
+	if (param[paramnum].atag == ATAG_OBJECT) GC::Remember((DObject*)val);
 	ACTION_RETURN_INT(self->Push(val));
 }
 
@@ -622,6 +623,7 @@ DEFINE_ACTION_FUNCTION(FDynArray_Ptr, Insert)
 	PARAM_SELF_STRUCT_PROLOGUE(FDynArray_Ptr);
 	PARAM_INT(index);
 	PARAM_POINTER(val, void);
+	if (param[paramnum].atag == ATAG_OBJECT) GC::Remember((DObject*)val);
 	self->Insert(index, val);
 	return 0;
 }
@@ -0,0 +1,1017 @@
+/*
+** scriptcache.cpp
+** Stores compiled script functions on disk
+**
+*/
+
+#include <zlib.h>
+#include <algorithm>
+
+#include "actor.h"
+#include "scriptcache.h"
+#include "codegen.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "m_random.h"
+#include "m_misc.h"
+#include "m_swap.h"
+#include "cmdlib.h"
+#include "md5.h"
+#include "version.h"
+#include "w_wad.h"
+#include "s_sound.h"
+#include "doomstat.h"
+#include "stats.h"
+#include "thingdef.h"
+
+CVAR(Bool, vm_cachescripts, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+FScriptCache ScriptCache;
+
+enum
+{
+	CACHE_VERSION = 1,
+
+	// What a function record contains
+	REC_UNCACHED = 0,
+	REC_CACHED,
+
+	// How an address constant is stored
+	KA_NULL = 0,
+	KA_FUNCTION,		// index into VMFunction::AllFunctions
+	KA_CLASS,			// index into PClass::AllClasses
+	KA_STATE,			// owning class and index into its states
+	KA_RNG,				// CRC of the RNG's name
+	KA_GLOBAL,			// global variable, CVar value or similar, by name and offset
+
+	// How a type is stored
+	TY_BASIC = 0,		// index into BasicTypes
+	TY_CLASS,
+	TY_CLASSPOINTER,
+	TY_POINTER,
+	TY_DYNARRAY,
+};
+
+//==========================================================================
+//
+// Buffers for the cache contents. The cache is only ever read by the same
+// build on the same machine, so everything is stored in native byte order.
+// The reader never reads past the end of its data; if something doesn't
+// fit, it returns zeros and marks itself as failed.
+//
+//==========================================================================
+
+class FCacheWriter
+{
+public:
+	TArray<uint8_t> Data;
+
+	void Write(const void *buf, size_t len)
+	{
+		if (len > 0)
+		{
+			unsigned pos = Data.Reserve((unsigned)len);
+			memcpy(&Data[pos], buf, len);
+		}
+	}
+
+	void WriteByte(uint8_t v)
+	{
+		Data.Push(v);
+	}
+
+	void WriteLong(uint32_t v)
+	{
+		Write(&v, 4);
+	}
+
+	void WriteString(const char *str)
+	{
+		uint32_t len = (uint32_t)strlen(str);
+		WriteLong(len);
+		Write(str, len);
+	}
+};
+
+class FCacheReader
+{
+public:
+	FCacheReader(const uint8_t *data, size_t len) : Pos(data), End(data + len) {}
+
+	bool Failed = false;
+
+	const uint8_t *Skip(size_t len)
+	{
+		if (Failed || size_t(End - Pos) < len)
+		{
+			Failed = true;
+			return nullptr;
+		}
+		const uint8_t *p = Pos;
+		Pos += len;
+		return p;
+	}
+
+	void Read(void *buf, size_t len)
+	{
+		const uint8_t *p = Skip(len);
+		if (p != nullptr) memcpy(buf, p, len);
+		else memset(buf, 0, len);
+	}
+
+	uint8_t ReadByte()
+	{
+		uint8_t v;
+		Read(&v, 1);
+		return v;
+	}
+
+	uint32_t ReadLong()
+	{
+		uint32_t v;
+		Read(&v, 4);
+		return v;
+	}
+
+	// For array sizes. Every element takes at least a byte, so this can't be
+	// more than what is left.
+	uint32_t ReadCount()
+	{
+		uint32_t v = ReadLong();
+		if (v > size_t(End - Pos))
+		{
+			Failed = true;
+			v = 0;
+		}
+		return v;
+	}
+
+	FString ReadString()
+	{
+		uint32_t len = ReadLong();
+		const uint8_t *p = Skip(len);
+		return p != nullptr ? FString((const char *)p, len) : FString();
+	}
+
+private:
+	const uint8_t *Pos, *End;
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static FString CreateCacheName(bool create)
+{
+	FString path = M_GetCachePath(create);
+	if (create) CreatePath(path);
+	path << "/scripts.gzc";
+	return path;
+}
+
+static void UpdateString(MD5Context &md5, const char *str)
+{
+	md5.Update((const uint8_t *)str, (unsigned)strlen(str) + 1);
+}
+
+// Native structs don't always have a size, so this also looks at their fields.
+static size_t TypeExtent(PType *type)
+{
+	size_t size = type->Size;
+	if (type->IsKindOf(RUNTIME_CLASS(PStruct)) && !type->IsKindOf(RUNTIME_CLASS(PClass)))
+	{
+		auto it = type->Symbols.GetIterator();
+		PSymbolTable::MapType::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto field = dyn_cast<PField>(pair->Value);
+			if (field != nullptr)
+			{
+				size = MAX(size, field->Offset + TypeExtent(field->Type));
+			}
+		}
+	}
+	return size;
+}
+
+// One line of text for every field in a symbol table.
+static void AddFieldLayout(TArray<FString> &layout, const char *owner, PSymbolTable &symbols)
+{
+	auto it = symbols.GetIterator();
+	PSymbolTable::MapType::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		auto field = dyn_cast<PField>(pair->Value);
+		if (field != nullptr)
+		{
+			layout.Push(FStringf("%s.%s %u %s:%u %u %d", owner, field->SymbolName.GetChars(), (unsigned)field->Offset,
+				field->Type->mDescriptiveName.GetChars(), field->Type->Size, field->Flags, field->BitValue));
+		}
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: AddLump
+//
+// Called by the parsers for every script lump they read.
+//
+//==========================================================================
+
+void FScriptCache::AddLump(int lumpnum)
+{
+	Lumps.Push(lumpnum);
+}
+
+//==========================================================================
+//
+// FScriptCache :: CreateLookups
+//
+// Collects everything that the constant tables of compiled functions can
+// point to, so that the pointers can be stored as something which can be
+// found again in the next session.
+//
+//==========================================================================
+
+void FScriptCache::CreateLookups()
+{
+	for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+	{
+		FunctionIndex[VMFunction::AllFunctions[i]] = i;
+	}
+	for (unsigned i = 0; i < PClass::AllClasses.Size(); i++)
+	{
+		ClassIndex[PClass::AllClasses[i]] = i;
+	}
+
+	// Global variables are accessed through their absolute address, possibly with
+	// an offset if only a member of them is used.
+	for (unsigned i = 0; i < Namespaces.AllNamespaces.Size(); i++)
+	{
+		auto it = Namespaces.AllNamespaces[i]->Symbols.GetIterator();
+		PSymbolTable::MapType::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto field = dyn_cast<PField>(pair->Value);
+			if (field != nullptr)
+			{
+				FString name;
+				name.Format("field:%u:%s", i, field->SymbolName.GetChars());
+				Globals.Push({ (uint8_t *)field->Offset, MAX<size_t>(TypeExtent(field->Type), 1), name });
+			}
+		}
+	}
+
+	// The flag and mask CVars read the value of another CVar, so they need no entry of their own.
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		if (var->GetRealType() != CVAR_DummyBool && var->GetRealType() != CVAR_DummyInt)
+		{
+			void *addr = FxCVar::GetValueAddress(var);
+			if (addr != nullptr)
+			{
+				Globals.Push({ (uint8_t *)addr, 1, FString("cvar:") + var->GetName() });
+			}
+		}
+	}
+
+	Globals.Push({ (uint8_t *)FxAddSub::GetTextureCountAddress(), sizeof(int), "texcount" });
+
+	std::sort(&Globals[0], &Globals[0] + Globals.Size(), [](const FGlobalAddress &a, const FGlobalAddress &b) { return a.Address < b.Address; });
+	for (auto &global : Globals)
+	{
+		GlobalsByName[global.Name] = global.Address;
+	}
+
+	PType *const basictypes[] =
+	{
+		TypeVoid, TypeSInt8, TypeUInt8, TypeSInt16, TypeUInt16, TypeSInt32, TypeUInt32, TypeBool, TypeFloat32, TypeFloat64,
+		TypeString, TypeName, TypeSound, TypeColor, TypeTextureID, TypeSpriteID, TypeVector2, TypeVector3, TypeColorStruct,
+		TypeStringStruct, TypeState, TypeFont, TypeStateLabel, TypeNullPtr, TypeVoidPtr,
+	};
+	for (auto type : basictypes)
+	{
+		BasicTypes.Push(type);
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: CalcKey
+//
+// Everything the generated code depends on goes into the key. Apart from
+// the scripts themselves these are the tables that the code refers to by
+// index: names, sounds, classes and functions. The code also has the
+// offsets, types and flag bits of native fields built in, and those can
+// change without the scripts or the git hash changing, so the layout of
+// every field the compiler knows and the actor flag tables go in as well.
+//
+//==========================================================================
+
+void FScriptCache::CalcKey(unsigned numfunctions)
+{
+	MD5Context md5;
+	md5.Init();
+
+	uint32_t header[] = { CACHE_VERSION, (uint32_t)sizeof(void *), numfunctions };
+	md5.Update((const uint8_t *)header, sizeof(header));
+	UpdateString(md5, GetGitHash());
+	UpdateString(md5, GetVersionString());
+
+	// The lumps were just parsed, so this is mostly a matter of inflating them again.
+	Wads.PrefetchLumps(Lumps);
+	for (int lumpnum : Lumps)
+	{
+		UpdateString(md5, Wads.GetLumpFullPath(lumpnum));
+		FMemLump data = Wads.ReadLump(lumpnum);
+		md5.Update((const uint8_t *)data.GetMem(), Wads.LumpLength(lumpnum));
+	}
+	Wads.ReleasePrefetchedLumps(Lumps);
+
+	int numnames = FName::GetNumNames();
+	for (int i = 0; i < numnames; i++)
+	{
+		UpdateString(md5, FName(ENamedName(i)).GetChars());
+	}
+	for (auto &sfx : S_sfx)
+	{
+		UpdateString(md5, sfx.name);
+	}
+	for (auto cls : PClass::AllClasses)
+	{
+		UpdateString(md5, cls->TypeName.GetChars());
+		md5.Update((const uint8_t *)&cls->Size, sizeof(cls->Size));
+	}
+	for (auto func : VMFunction::AllFunctions)
+	{
+		UpdateString(md5, func->PrintableName);
+	}
+
+	// The type table is hashed by address, so the layout gets sorted to come out the same every time.
+	TArray<FString> layout;
+	for (size_t i = 0; i < FTypeTable::HASH_SIZE; i++)
+	{
+		for (PType *type = TypeTable.TypeHash[i]; type != nullptr; type = type->HashNext)
+		{
+			AddFieldLayout(layout, FStringf("%s:%u", type->mDescriptiveName.GetChars(), type->Size), type->Symbols);
+		}
+	}
+	for (auto cls : PClass::AllClasses)
+	{
+		AddFieldLayout(layout, FStringf("class %s:%u", cls->TypeName.GetChars(), cls->Size), cls->Symbols);
+	}
+	for (unsigned i = 0; i < Namespaces.AllNamespaces.Size(); i++)
+	{
+		AddFieldLayout(layout, FStringf("namespace %u", i), Namespaces.AllNamespaces[i]->Symbols);
+	}
+	std::sort(&layout[0], &layout[0] + layout.Size(), [](const FString &a, const FString &b) { return a.Compare(b) < 0; });
+	for (auto &line : layout)
+	{
+		UpdateString(md5, line);
+	}
+
+	const FFlagDef *defs;
+	int numdefs;
+	for (unsigned i = 0; (defs = GetFlagList(i, &numdefs)) != nullptr; i++)
+	{
+		for (int j = 0; j < numdefs; j++)
+		{
+			UpdateString(md5, defs[j].name);
+			int def[] = { (int)defs[j].flagbit, defs[j].structoffset, defs[j].fieldsize, defs[j].varflags };
+			md5.Update((const uint8_t *)def, sizeof(def));
+		}
+	}
+	md5.Final(Key);
+}
+
+//==========================================================================
+//
+// FScriptCache :: ReadCache
+//
+//==========================================================================
+
+bool FScriptCache::ReadCache()
+{
+	char magic[4];
+	uint8_t key[16];
+	uint32_t size;
+	bool ok = false;
+
+	FString path = CreateCacheName(false);
+	FILE *f = fopen(path, "rb");
+	if (f == nullptr) return false;
+
+	if (fread(magic, 1, 4, f) == 4 && !memcmp(magic, "GZSC", 4) &&
+		fread(key, 1, 16, f) == 16 && !memcmp(key, Key, 16) &&
+		fread(&size, 4, 1, f) == 1)
+	{
+		long start = ftell(f);
+		fseek(f, 0, SEEK_END);
+		long end = ftell(f);
+		fseek(f, start, SEEK_SET);
+
+		// zlib can't compress better than about 1:1000, so anything larger is a broken file.
+		if (start > 0 && end > start && size > 0 && size / 1024 < unsigned(end - start))
+		{
+			TArray<uint8_t> compressed;
+			compressed.Resize(end - start);
+			if (fread(&compressed[0], 1, end - start, f) == size_t(end - start))
+			{
+				uLongf outlen = size;
+				CacheData.Resize(size);
+				ok = uncompress(&CacheData[0], &outlen, &compressed[0], end - start) == Z_OK && outlen == size;
+			}
+		}
+	}
+	fclose(f);
+
+	if (!ok)
+	{
+		CacheData.Clear();
+	}
+	ReadPos = 0;
+	return ok;
+}
+
+//==========================================================================
+//
+// FScriptCache :: WriteCache
+//
+//==========================================================================
+
+void FScriptCache::WriteCache()
+{
+	if (Output.Size() == 0) return;
+
+	uLongf outlen = compressBound(Output.Size());
+	TArray<uint8_t> compressed;
+	compressed.Resize(outlen);
+	if (compress(&compressed[0], &outlen, &Output[0], Output.Size()) != Z_OK)
+	{
+		return;
+	}
+
+	FString path = CreateCacheName(true);
+	FILE *f = fopen(path, "wb");
+	if (f == nullptr)
+	{
+		Printf("Cannot open script cache %s for writing\n", path.GetChars());
+		return;
+	}
+
+	uint32_t size = Output.Size();
+	if (fwrite("GZSC", 1, 4, f) != 4 || fwrite(Key, 1, 16, f) != 16 || fwrite(&size, 4, 1, f) != 1 ||
+		fwrite(&compressed[0], 1, outlen, f) != outlen)
+	{
+		Printf("Error saving script cache %s\n", path.GetChars());
+	}
+	fclose(f);
+}
+
+//==========================================================================
+//
+// FScriptCache :: Begin
+//
+// Called before the functions get built, with all classes and their
+// function declarations already in place.
+//
+//==========================================================================
+
+void FScriptCache::Begin(unsigned numfunctions)
+{
+	Active = vm_cachescripts;
+	if (!Active)
+	{
+		return;
+	}
+
+	cycle_t timer;
+	timer.Reset(); timer.Clock();
+
+	NumFunctions = numfunctions;
+	CreateLookups();
+	CalcKey(numfunctions);
+	Loaded = ReadCache();
+
+	timer.Unclock();
+	DPrintf(DMSG_NOTIFY, "Script cache %s (%.1f ms)\n", Loaded ? "loaded" : "not usable", timer.TimeMS());
+}
+
+//==========================================================================
+//
+// FScriptCache :: End
+//
+// If the cache was not usable and all functions compiled without errors,
+// a new one gets written.
+//
+//==========================================================================
+
+void FScriptCache::End(bool success)
+{
+	if (Active)
+	{
+		if (Loaded)
+		{
+			DPrintf(DMSG_NOTIFY, "%u of %u script functions loaded from the cache\n", NumLoaded, NumFunctions);
+		}
+		if (OutOfSync)
+		{
+			// Something in the compiler doesn't depend on the key alone, so this cache will never work.
+			Printf("Script cache %s is out of date; removing it\n", CreateCacheName(false).GetChars());
+			remove(CreateCacheName(false));
+		}
+		else if (!Loaded && success)
+		{
+			WriteCache();
+		}
+	}
+	Reset();
+}
+
+void FScriptCache::Reset()
+{
+	Lumps.Clear();
+	Active = Loaded = OutOfSync = false;
+	NumFunctions = NumLoaded = 0;
+	CacheData.Clear();
+	CacheData.ShrinkToFit();
+	ReadPos = 0;
+	Output.Clear();
+	Output.ShrinkToFit();
+	FunctionIndex.Clear();
+	ClassIndex.Clear();
+	Globals.Clear();
+	Globals.ShrinkToFit();
+	GlobalsByName.Clear();
+	BasicTypes.Clear();
+}
+
+//==========================================================================
+//
+// FScriptCache :: WriteType
+//
+// Only the types that may be needed to construct a function's locals or
+// the prototype of a state function are supported.
+//
+//==========================================================================
+
+bool FScriptCache::WriteType(FCacheWriter &out, PType *type)
+{
+	int basic = BasicTypes.Find(type);
+	if (basic < (int)BasicTypes.Size())
+	{
+		out.WriteByte(TY_BASIC);
+		out.WriteByte(basic);
+		return true;
+	}
+	if (auto index = ClassIndex.CheckKey(type))
+	{
+		out.WriteByte(TY_CLASS);
+		out.WriteLong(*index);
+		return true;
+	}
+	if (auto cp = dyn_cast<PClassPointer>(type))
+	{
+		auto index = ClassIndex.CheckKey(cp->ClassRestriction);
+		if (index == nullptr) return false;
+		out.WriteByte(TY_CLASSPOINTER);
+		out.WriteLong(*index);
+		return true;
+	}
+	if (auto ptr = dyn_cast<PPointer>(type))
+	{
+		out.WriteByte(TY_POINTER);
+		out.WriteByte(ptr->IsConst);
+		return WriteType(out, ptr->PointedType);
+	}
+	if (auto array = dyn_cast<PDynArray>(type))
+	{
+		out.WriteByte(TY_DYNARRAY);
+		return WriteType(out, array->ElementType);
+	}
+	return false;
+}
+
+PType *FScriptCache::ReadType(FCacheReader &in)
+{
+	switch (in.ReadByte())
+	{
+	case TY_BASIC:
+	{
+		unsigned index = in.ReadByte();
+		return index < BasicTypes.Size() ? BasicTypes[index] : nullptr;
+	}
+
+	case TY_CLASS:
+	{
+		unsigned index = in.ReadLong();
+		return index < PClass::AllClasses.Size() ? PClass::AllClasses[index] : nullptr;
+	}
+
+	case TY_CLASSPOINTER:
+	{
+		unsigned index = in.ReadLong();
+		return index < PClass::AllClasses.Size() ? NewClassPointer(PClass::AllClasses[index]) : nullptr;
+	}
+
+	case TY_POINTER:
+	{
+		bool isconst = !!in.ReadByte();
+		PType *pointed = ReadType(in);
+		return pointed != nullptr ? NewPointer(pointed, isconst) : nullptr;
+	}
+
+	case TY_DYNARRAY:
+	{
+		PType *element = ReadType(in);
+		return element != nullptr ? NewDynArray(element) : nullptr;
+	}
+
+	default:
+		return nullptr;
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: WriteAddress
+//
+// The tag doesn't tell what an address constant is, apart from RNGs, so
+// this checks everything it may be. Anything that isn't found makes the
+// function uncacheable.
+//
+//==========================================================================
+
+bool FScriptCache::WriteAddress(FCacheWriter &out, void *ptr, uint8_t tag)
+{
+	out.WriteByte(tag);
+	if (ptr == nullptr)
+	{
+		out.WriteByte(KA_NULL);
+		return true;
+	}
+	if (tag == ATAG_RNG)
+	{
+		uint32_t crc = static_cast<FRandom *>(ptr)->GetNameCRC();
+		if (FRandom::StaticFindRNG(crc) != ptr) return false;
+		out.WriteByte(KA_RNG);
+		out.WriteLong(crc);
+		return true;
+	}
+	if (tag == ATAG_OBJECT)
+	{
+		if (auto index = FunctionIndex.CheckKey(ptr))
+		{
+			out.WriteByte(KA_FUNCTION);
+			out.WriteLong(*index);
+			return true;
+		}
+		if (auto index = ClassIndex.CheckKey(ptr))
+		{
+			out.WriteByte(KA_CLASS);
+			out.WriteLong(*index);
+			return true;
+		}
+		return false;
+	}
+	if (tag == ATAG_GENERIC)
+	{
+		// Find the last global that starts at or before the address.
+		uint8_t *addr = (uint8_t *)ptr;
+		auto global = std::upper_bound(&Globals[0], &Globals[0] + Globals.Size(), addr,
+			[](uint8_t *a, const FGlobalAddress &g) { return a < g.Address; });
+		if (global != &Globals[0] && addr < global[-1].Address + global[-1].Size)
+		{
+			out.WriteByte(KA_GLOBAL);
+			out.WriteString(global[-1].Name);
+			out.WriteLong(uint32_t(addr - global[-1].Address));
+			return true;
+		}
+
+		// ATAG_STATE is the same as ATAG_GENERIC.
+		FState *state = (FState *)ptr;
+		PClassActor *owner = FState::StaticFindStateOwner(state);
+		if (owner != nullptr)
+		{
+			out.WriteByte(KA_STATE);
+			out.WriteLong(ClassIndex[owner]);
+			out.WriteLong(uint32_t(state - owner->OwnedStates));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FScriptCache::ReadAddress(FCacheReader &in, void *&ptr, uint8_t &tag)
+{
+	tag = in.ReadByte();
+	switch (in.ReadByte())
+	{
+	case KA_NULL:
+		ptr = nullptr;
+		return true;
+
+	case KA_FUNCTION:
+	{
+		unsigned index = in.ReadLong();
+		if (index >= VMFunction::AllFunctions.Size()) return false;
+		ptr = VMFunction::AllFunctions[index];
+		return true;
+	}
+
+	case KA_CLASS:
+	{
+		unsigned index = in.ReadLong();
+		if (index >= PClass::AllClasses.Size()) return false;
+		ptr = PClass::AllClasses[index];
+		return true;
+	}
+
+	case KA_STATE:
+	{
+		unsigned index = in.ReadLong();
+		unsigned state = in.ReadLong();
+		if (index >= PClass::AllClasses.Size()) return false;
+		auto owner = dyn_cast<PClassActor>(PClass::AllClasses[index]);
+		if (owner == nullptr || state >= (unsigned)owner->NumOwnedStates) return false;
+		ptr = owner->OwnedStates + state;
+		return true;
+	}
+
+	case KA_RNG:
+		ptr = FRandom::StaticFindRNG(in.ReadLong());
+		return true;
+
+	case KA_GLOBAL:
+	{
+		FString name = in.ReadString();
+		uint32_t offset = in.ReadLong();
+		auto addr = GlobalsByName.CheckKey(name);
+		if (addr == nullptr) return false;
+		ptr = *addr + offset;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: WriteFunction
+//
+//==========================================================================
+
+bool FScriptCache::WriteFunction(FCacheWriter &out, VMScriptFunction *func, bool anonymous, int firstname)
+{
+	// The names this function created, so they can be created in the same order again.
+	int numnames = FName::GetNumNames();
+	out.WriteLong(firstname);
+	out.WriteLong(numnames - firstname);
+	for (int i = firstname; i < numnames; i++)
+	{
+		out.WriteString(FName(ENamedName(i)).GetChars());
+	}
+
+	out.WriteByte(anonymous);
+	if (anonymous)
+	{
+		auto &rettypes = func->Proto->ReturnTypes;
+		out.WriteLong(rettypes.Size());
+		for (auto type : rettypes)
+		{
+			if (!WriteType(out, type)) return false;
+		}
+	}
+
+	out.WriteByte(func->NumArgs);
+	out.WriteByte(func->Unsafe);
+	out.WriteLong(func->ExtraSpace);
+	out.WriteByte(func->NumRegD);
+	out.WriteByte(func->NumRegF);
+	out.WriteByte(func->NumRegS);
+	out.WriteByte(func->NumRegA);
+	out.WriteLong(func->MaxParam);
+	out.WriteString(func->SourceFileName);
+
+	out.WriteLong(func->SpecialInits.Size());
+	for (auto &init : func->SpecialInits)
+	{
+		if (!WriteType(out, const_cast<PType *>(init.first))) return false;
+		out.WriteLong(init.second);
+	}
+
+	out.WriteLong(func->CodeSize);
+	out.Write(func->Code, func->CodeSize * sizeof(VMOP));
+	out.WriteLong(func->LineInfoCount);
+	out.Write(func->LineInfo, func->LineInfoCount * sizeof(FStatementInfo));
+	out.WriteLong(func->NumKonstD);
+	out.Write(func->KonstD, func->NumKonstD * sizeof(int));
+	out.WriteLong(func->NumKonstF);
+	out.Write(func->KonstF, func->NumKonstF * sizeof(double));
+	out.WriteLong(func->NumKonstS);
+	for (int i = 0; i < func->NumKonstS; i++)
+	{
+		out.WriteString(func->KonstS[i]);
+	}
+	out.WriteLong(func->NumKonstA);
+	for (int i = 0; i < func->NumKonstA; i++)
+	{
+		if (!WriteAddress(out, func->KonstA[i].v, func->KonstATags()[i])) return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FScriptCache :: StoreFunction
+//
+// Every function gets a record, even the ones that can't be cached, so
+// that the records can be matched to the functions when loading them.
+//
+//==========================================================================
+
+void FScriptCache::StoreFunction(const FString &name, VMScriptFunction *func, bool anonymous, int firstname)
+{
+	if (!Active || Loaded)
+	{
+		return;
+	}
+
+	FCacheWriter rec;
+	rec.WriteString(name);
+	rec.WriteByte(REC_CACHED);
+	if (!WriteFunction(rec, func, anonymous, firstname))
+	{
+		rec.Data.Clear();
+		rec.WriteString(name);
+		rec.WriteByte(REC_UNCACHED);
+	}
+
+	uint32_t size = rec.Data.Size();
+	unsigned pos = Output.Reserve(4 + size);
+	memcpy(&Output[pos], &size, 4);
+	memcpy(&Output[pos + 4], &rec.Data[0], size);
+}
+
+//==========================================================================
+//
+// FScriptCache :: LoadFunction
+//
+// Must be called for every function in the same order in which they were
+// stored. Returns false if the function needs to be compiled.
+//
+//==========================================================================
+
+bool FScriptCache::LoadFunction(const FString &name, VMScriptFunction *func, const TArray<PType *> &argtypes)
+{
+	if (!Loaded)
+	{
+		return false;
+	}
+
+	FCacheReader file(&CacheData[0] + ReadPos, CacheData.Size() - ReadPos);
+	uint32_t size = file.ReadLong();
+	const uint8_t *data = file.Skip(size);
+	if (data == nullptr)
+	{
+		Loaded = false;
+		OutOfSync = true;
+		return false;
+	}
+	ReadPos += 4 + size;
+
+	FCacheReader in(data, size);
+	if (in.ReadString().Compare(name) != 0)
+	{
+		// The records no longer line up with the functions, so none of the following ones can be used.
+		Loaded = false;
+		OutOfSync = true;
+		return false;
+	}
+	if (in.ReadByte() != REC_CACHED)
+	{
+		return false;
+	}
+
+	// The names this function created must get the same indices as before.
+	int firstname = in.ReadLong();
+	unsigned numnames = in.ReadLong();
+	if (firstname != FName::GetNumNames())
+	{
+		OutOfSync = true;
+		return false;
+	}
+	for (unsigned i = 0; i < numnames; i++)
+	{
+		FName newname(in.ReadString());
+		if (in.Failed || newname.GetIndex() != firstname + (int)i)
+		{
+			OutOfSync = true;
+			return false;
+		}
+	}
+
+	PPrototype *proto = nullptr;
+	if (in.ReadByte())
+	{
+		TArray<PType *> rettypes;
+		rettypes.Resize(in.ReadCount());
+		for (auto &type : rettypes)
+		{
+			if ((type = ReadType(in)) == nullptr) return false;
+		}
+		proto = NewPrototype(rettypes, argtypes);
+	}
+
+	int numargs = in.ReadByte();
+	bool unsafe = !!in.ReadByte();
+	int extraspace = in.ReadLong();
+	VM_UBYTE numregs[4];
+	in.Read(numregs, 4);
+	int maxparam = in.ReadLong();
+	FString sourcefile = in.ReadString();
+
+	TArray<FTypeAndOffset> specialinits;
+	specialinits.Resize(in.ReadCount());
+	for (auto &init : specialinits)
+	{
+		if ((init.first = ReadType(in)) == nullptr) return false;
+		init.second = in.ReadLong();
+	}
+
+	// The tables are copied straight from the cache data.
+	unsigned codesize = in.ReadLong();
+	const uint8_t *code = in.Skip(codesize * sizeof(VMOP));
+	unsigned numlines = in.ReadLong();
+	const uint8_t *lines = in.Skip(numlines * sizeof(FStatementInfo));
+	unsigned numkonstd = in.ReadLong();
+	const uint8_t *konstd = in.Skip(numkonstd * sizeof(int));
+	unsigned numkonstf = in.ReadLong();
+	const uint8_t *konstf = in.Skip(numkonstf * sizeof(double));
+	TArray<FString> konsts;
+	konsts.Resize(in.ReadCount());
+	for (auto &str : konsts)
+	{
+		str = in.ReadString();
+	}
+	TArray<void *> konsta;
+	konsta.Resize(in.ReadCount());
+	TArray<VM_ATAG> konstatags;
+	konstatags.Resize(konsta.Size());
+	for (unsigned i = 0; i < konsta.Size(); i++)
+	{
+		if (!ReadAddress(in, konsta[i], konstatags[i])) return false;
+	}
+	if (in.Failed || codesize == 0 || numkonstd > 65535 || numkonstf > 65535 || konsts.Size() > 65535 || konsta.Size() > 65535 || numlines > 65535)
+	{
+		OutOfSync = true;
+		return false;
+	}
+
+	func->Alloc(codesize, numkonstd, numkonstf, konsts.Size(), konsta.Size(), numlines);
+	memcpy(func->Code, code, codesize * sizeof(VMOP));
+	if (numlines > 0) memcpy(func->LineInfo, lines, numlines * sizeof(FStatementInfo));
+	if (numkonstd > 0) memcpy(func->KonstD, konstd, numkonstd * sizeof(int));
+	if (numkonstf > 0) memcpy(func->KonstF, konstf, numkonstf * sizeof(double));
+	for (unsigned i = 0; i < konsts.Size(); i++)
+	{
+		func->KonstS[i] = konsts[i];
+	}
+	for (unsigned i = 0; i < konsta.Size(); i++)
+	{
+		func->KonstA[i].v = konsta[i];
+		func->KonstATags()[i] = konstatags[i];
+	}
+
+	if (func->Proto == nullptr)
+	{
+		func->Proto = proto;
+	}
+	func->NumArgs = numargs;
+	func->Unsafe = unsafe;
+	func->ExtraSpace = extraspace;
+	func->NumRegD = numregs[0];
+	func->NumRegF = numregs[1];
+	func->NumRegS = numregs[2];
+	func->NumRegA = numregs[3];
+	func->MaxParam = maxparam;
+	func->SourceFileName = sourcefile;
+	func->SpecialInits = std::move(specialinits);
+	NumLoaded++;
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+CCMD(clearscriptcache)
+{
+	remove(CreateCacheName(false));
+}
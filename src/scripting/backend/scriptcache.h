@@ -0,0 +1,74 @@
+#ifndef SCRIPTCACHE_H
+#define SCRIPTCACHE_H
+
+#include "tarray.h"
+#include "zstring.h"
+
+class PType;
+class VMScriptFunction;
+class FCacheWriter;
+class FCacheReader;
+
+// Keeps the code of all compiled script functions on disk, so that the next
+// launch with the same scripts and the same engine can skip resolving and
+// emitting them.
+//
+// The cache is keyed by the contents of all ZScript and DECORATE lumps that
+// were parsed, the engine build, the name and sound tables and the lists of
+// classes and VM functions at the time the functions are built. Pointers in
+// the constant tables are stored in a form that can be looked up again in
+// the next session. Functions that reference something which can't be
+// stored that way are always compiled.
+
+class FScriptCache
+{
+public:
+	void AddLump(int lumpnum);
+
+	void Begin(unsigned numfunctions);
+	bool LoadFunction(const FString &name, VMScriptFunction *func, const TArray<PType *> &argtypes);
+	void StoreFunction(const FString &name, VMScriptFunction *func, bool anonymous, int firstname);
+	void End(bool success);
+
+private:
+	struct FGlobalAddress
+	{
+		uint8_t *Address;
+		size_t Size;
+		FString Name;
+	};
+
+	void CreateLookups();
+	void CalcKey(unsigned numfunctions);
+	bool ReadCache();
+	void WriteCache();
+	void Reset();
+
+	bool WriteFunction(FCacheWriter &out, VMScriptFunction *func, bool anonymous, int firstname);
+	bool WriteType(FCacheWriter &out, PType *type);
+	bool WriteAddress(FCacheWriter &out, void *ptr, uint8_t tag);
+	PType *ReadType(FCacheReader &in);
+	bool ReadAddress(FCacheReader &in, void *&ptr, uint8_t &tag);
+
+	TArray<int> Lumps;
+	bool Active = false;		// caching is enabled for this build
+	bool Loaded = false;		// the cache file matches the current scripts
+	bool OutOfSync = false;		// the cache file matched, but its functions didn't
+	uint8_t Key[16];
+	unsigned NumFunctions = 0;
+	unsigned NumLoaded = 0;
+
+	TArray<uint8_t> CacheData;
+	unsigned ReadPos = 0;
+	TArray<uint8_t> Output;
+
+	TMap<void *, unsigned> FunctionIndex;
+	TMap<void *, unsigned> ClassIndex;
+	TArray<FGlobalAddress> Globals;		// sorted by address
+	TMap<FString, uint8_t *> GlobalsByName;
+	TArray<PType *> BasicTypes;
+};
+
+extern FScriptCache ScriptCache;
+
+#endif
@@ -33,6 +33,7 @@
 
 #include "vmbuilder.h"
 #include "codegen.h"
+#include "scriptcache.h"
 #include "info.h"
 #include "m_argv.h"
 #include "thingdef.h"
@@ -851,10 +852,21 @@ void FFunctionBuildList::Build()
 
 	if (Args->CheckParm("-dumpdisasm")) dump = fopen("disasm.txt", "w");
 
+	CreateBuiltinFunctions();
+	// A disassembly dump needs everything to be compiled.
+	if (dump == nullptr) ScriptCache.Begin(mItems.Size());
+
 	for (auto &item : mItems)
 	{
 		assert(item.Code != NULL);
 
+		if (ScriptCache.LoadFunction(item.PrintableName, item.Function, item.Func->Variants[0].Proto->ArgumentTypes))
+		{
+			delete item.Code;
+			continue;
+		}
+		int firstname = FName::GetNumNames();
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
 
@@ -932,6 +944,7 @@ void FFunctionBuildList::Build()
 						sfunc->NumKonstA * sizeof(void*) + sfunc->NumKonstF * sizeof(double) + sfunc->NumKonstS * sizeof(FString);
 				}
 				sfunc->Unsafe = ctx.Unsafe;
+				ScriptCache.StoreFunction(item.PrintableName, sfunc, item.Func->SymbolName == NAME_None, firstname);
 			}
 			catch (CRecoverableError &err)
 			{
@@ -951,6 +964,7 @@ void FFunctionBuildList::Build()
 		fclose(dump);
 	}
 	FScriptPosition::StrictErrors = false;
+	ScriptCache.End(FScriptPosition::ErrorCounter == 0);
 	mItems.Clear();
 	mItems.ShrinkToFit();
 	FxAlloc.FreeAllBlocks();
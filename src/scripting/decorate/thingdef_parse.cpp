@@ -50,6 +50,7 @@
 #include "doomerrors.h"
 #include "i_system.h"
 #include "backend/codegen.h"
+#include "backend/scriptcache.h"
 #include "w_wad.h"
 #include "v_video.h"
 #include "v_text.h"
@@ -1270,6 +1271,7 @@ void ParseDecorate (FScanner &sc, PNamespace *ns)
 			}
 			FScanner newscanner;
 			newscanner.Open(sc.String);
+			ScriptCache.AddLump(newscanner.LumpNum);
 			ParseDecorate(newscanner, ns);
 			break;
 		}
@@ -1329,10 +1331,18 @@ void ParseDecorate (FScanner &sc, PNamespace *ns)
 void ParseAllDecorate()
 {
 	int lastlump = 0, lump;
+	TArray<int> lumps;
 
 	while ((lump = Wads.FindLump("DECORATE", &lastlump)) != -1)
 	{
-		FScanner sc(lump);
+		lumps.Push(lump);
+	}
+	Wads.PrefetchLumps(lumps);
+
+	for (int lumpnum : lumps)
+	{
+		FScanner sc(lumpnum);
+		ScriptCache.AddLump(lumpnum);
 		auto ns = Namespaces.NewNamespace(sc.LumpNum);
 		ParseDecorate(sc, ns);
 	}
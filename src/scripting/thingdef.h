@@ -27,6 +27,7 @@ struct FFlagDef
 };
 
 FFlagDef *FindFlag (const PClass *type, const char *part1, const char *part2, bool strict = false);
+const FFlagDef *GetFlagList(unsigned index, int *numdefs);
 void HandleDeprecatedFlags(AActor *defaults, PClassActor *info, bool set, int index);
 bool CheckDeprecatedFlags(const AActor *actor, PClassActor *info, int index);
 const char *GetFlagName(unsigned int flagnum, int flagoffset);
@@ -525,6 +525,19 @@ static FFlagDef *FindFlag (FFlagDef *flags, int numflags, const char *flag)
 	return NULL;
 }
 
+//==========================================================================
+//
+// Returns one of the flag tables, or null past the last one
+//
+//==========================================================================
+
+const FFlagDef *GetFlagList(unsigned index, int *numdefs)
+{
+	if (index >= NUM_FLAG_LISTS) return nullptr;
+	*numdefs = FlagLists[index].NumDefs;
+	return FlagLists[index].Defs;
+}
+
 //==========================================================================
 //
 // Finds a flag that may have a qualified name
@@ -891,6 +891,9 @@ public:
 	VM_UHALF NumKonstA;
 	VM_UHALF MaxParam;		// Maximum number of parameters this function has on the stack at once
 	VM_UBYTE NumArgs;		// Number of arguments this function takes
+	VM_UBYTE JitState;		// whether the JIT has compiled this function yet
+	bool JitPure;			// compiled code has no side effects, so it can be compared against the interpreter
+	void *JitFunc;			// compiled code, or null if the function runs in the interpreter
 	TArray<FTypeAndOffset> SpecialInits;	// list of all contents on the extra stack which require construction and destruction
 
 	void InitExtra(void *addr);
@@ -995,7 +998,9 @@ enum EVMEngine
 {
 	VMEngine_Default,
 	VMEngine_Unchecked,
-	VMEngine_Checked
+	VMEngine_Checked,
+	VMEngine_JIT,
+	VMEngine_JITCompare		// runs side effect free functions in both the JIT and the interpreter and compares the results
 };
 
 extern thread_local VMFrameStack GlobalVMStack;
@@ -40,6 +40,8 @@
 #include "textures/textures.h"
 #include "math/cmath.h"
 #include "stats.h"
+#include "v_text.h"
+#include "vmjit.h"
 
 extern cycle_t VMCycles[10];
 extern int VMCalls[10];
@@ -156,13 +158,400 @@ VMExec_Checked::Exec
 
 thread_local VMFrameStack GlobalVMStack;
 
+static bool JitCompareMode;
+
+
+//===========================================================================
+//
+// VMExec_Interpreter
+//
+//===========================================================================
+
+static int VMExec_Interpreter(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
+{
+#ifdef NDEBUG
+	return VMExec_Unchecked::Exec(stack, pc, ret, numret);
+#else
+	return VMExec_Checked::Exec(stack, pc, ret, numret);
+#endif
+}
+
+//===========================================================================
+//
+// JitParam
+//
+// Helpers for the JIT compiled code. These must not throw.
+//
+//===========================================================================
+
+void JitParam(JitContext *ctx, const VMOP *pc)
+{
+	VMFrame *f = ctx->Frame;
+	VMScriptFunction *sfunc = ctx->Func;
+	const VMRegisters reg(f);
+	int c = pc->c;
+
+	assert(f->NumParam < sfunc->MaxParam);
+	VMValue *param = &reg.param[f->NumParam++];
+	if (pc->op == OP_PARAMI)
+	{
+		::new(param) VMValue(pc->i24);
+		return;
+	}
+	switch (pc->b)
+	{
+	case REGT_NIL:
+		::new(param) VMValue();
+		break;
+	case REGT_INT:
+		::new(param) VMValue(reg.d[c]);
+		break;
+	case REGT_INT | REGT_ADDROF:
+		::new(param) VMValue(&reg.d[c], ATAG_GENERIC);
+		break;
+	case REGT_INT | REGT_KONST:
+		::new(param) VMValue(sfunc->KonstD[c]);
+		break;
+	case REGT_STRING:
+		::new(param) VMValue(reg.s[c]);
+		break;
+	case REGT_STRING | REGT_ADDROF:
+		::new(param) VMValue(&reg.s[c], ATAG_GENERIC);
+		break;
+	case REGT_STRING | REGT_KONST:
+		::new(param) VMValue(sfunc->KonstS[c]);
+		break;
+	case REGT_POINTER:
+		::new(param) VMValue(reg.a[c], reg.atag[c]);
+		break;
+	case REGT_POINTER | REGT_ADDROF:
+		::new(param) VMValue(&reg.a[c], ATAG_GENERIC);
+		break;
+	case REGT_POINTER | REGT_KONST:
+		::new(param) VMValue(sfunc->KonstA[c].v, sfunc->KonstATags()[c]);
+		break;
+	case REGT_FLOAT:
+		::new(param) VMValue(reg.f[c]);
+		break;
+	case REGT_FLOAT | REGT_MULTIREG2:
+		::new(param) VMValue(reg.f[c]);
+		::new(param + 1) VMValue(reg.f[c + 1]);
+		f->NumParam++;
+		break;
+	case REGT_FLOAT | REGT_MULTIREG3:
+		::new(param) VMValue(reg.f[c]);
+		::new(param + 1) VMValue(reg.f[c + 1]);
+		::new(param + 2) VMValue(reg.f[c + 2]);
+		f->NumParam += 2;
+		break;
+	case REGT_FLOAT | REGT_ADDROF:
+		::new(param) VMValue(&reg.f[c], ATAG_GENERIC);
+		break;
+	case REGT_FLOAT | REGT_KONST:
+		::new(param) VMValue(sfunc->KonstF[c]);
+		break;
+	default:
+		assert(0);
+		break;
+	}
+}
+
+//===========================================================================
+//
+// JitDoCall
+//
+// Same as the interpreter's CALL and TAIL, except that the frame of the
+// callee is always created through VMExec.
+//
+//===========================================================================
+
+static int JitDoCall(VMFrameStack *stack, VMFunction *call, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	if (call->VarFlags & VARF_Native)
+	{
+		try
+		{
+			VMCycles[0].Unclock();
+			numret = static_cast<VMNativeFunction *>(call)->NativeCall(params, call->DefaultArgs, numparams, ret, numret);
+			VMCycles[0].Clock();
+			return numret;
+		}
+		catch (CVMAbortException &err)
+		{
+			err.MaybePrintMessage();
+			err.stacktrace.AppendFormat("Called from %s\n", call->PrintableName.GetChars());
+			throw;
+		}
+	}
+
+	VMCalls[0]++;
+	VMScriptFunction *script = static_cast<VMScriptFunction *>(call);
+	VMFrame *newf = stack->AllocFrame(script);
+	VMFillParams(params, newf, numparams);
+	try
+	{
+		numret = VMExec(stack, script->Code, ret, numret);
+	}
+	catch (...)
+	{
+		stack->PopFrame();
+		throw;
+	}
+	stack->PopFrame();
+	return numret;
+}
+
+static void JitCatch(JitContext *ctx, const VMOP *pc)
+{
+	try
+	{
+		throw;
+	}
+	catch (CVMAbortException &err)
+	{
+		VMScriptFunction *sfunc = ctx->Func;
+		err.MaybePrintMessage();
+		err.stacktrace.AppendFormat("Called from %s at %s, line %d\n", sfunc->PrintableName.GetChars(), sfunc->SourceFileName.GetChars(), sfunc->PCToLine(pc));
+		*ctx->Exception = std::current_exception();
+	}
+	catch (...)
+	{
+		*ctx->Exception = std::current_exception();
+	}
+}
+
+int JitCall(JitContext *ctx, const VMOP *pc)
+{
+	VMFrame *f = ctx->Frame;
+	const VMRegisters reg(f);
+	VMFunction *call = (VMFunction *)(pc->op == OP_CALL_K ? ctx->Func->KonstA[pc->a].v : reg.a[pc->a]);
+	int b = pc->b;
+	int c = pc->c;
+
+	try
+	{
+		VMReturn returns[MAX_RETURNS];
+		VMExec_Unchecked::FillReturns(reg, f, returns, pc + 1, c);
+		int numret = JitDoCall(ctx->Stack, call, reg.param + f->NumParam - b, b, returns, c);
+		assert(numret == c && "Number of parameters returned differs from what was expected by the caller");
+		for (; b != 0; --b)
+		{
+			reg.param[--f->NumParam].~VMValue();
+		}
+		return 0;
+	}
+	catch (...)
+	{
+		JitCatch(ctx, pc);
+		return JIT_EXCEPTION;
+	}
+}
+
+int JitTailCall(JitContext *ctx, const VMOP *pc)
+{
+	VMFrame *f = ctx->Frame;
+	const VMRegisters reg(f);
+	VMFunction *call = (VMFunction *)(pc->op == OP_TAIL_K ? ctx->Func->KonstA[pc->a].v : reg.a[pc->a]);
+
+	try
+	{
+		return JitDoCall(ctx->Stack, call, reg.param + f->NumParam - pc->b, pc->b, ctx->Ret, ctx->NumRet);
+	}
+	catch (...)
+	{
+		JitCatch(ctx, pc);
+		return JIT_EXCEPTION;
+	}
+}
+
+void JitSetReturn(JitContext *ctx, const VMOP *pc)
+{
+	VMReturn *ret = &ctx->Ret[pc->a & ~RET_FINAL];
+	if (pc->op == OP_RETI)
+	{
+		ret->SetInt(pc->i16);
+	}
+	else
+	{
+		VMExec_Unchecked::SetReturn(VMRegisters(ctx->Frame), ctx->Frame, ret, pc->b, pc->c);
+	}
+}
+
+void JitWriteBarrier(JitContext *ctx, const VMOP *pc)
+{
+	GC::WriteBarrier((DObject *)ctx->RegA[pc->b]);
+}
+
+//===========================================================================
+//
+// VMExec_JIT
+//
+// Runs the compiled code of the function in the top frame, if it has any.
+//
+//===========================================================================
+
+static int RunJit(JitFuncPtr func, VMFrameStack *stack, VMReturn *ret, int numret)
+{
+	VMFrame *f = stack->TopFrame();
+	const VMRegisters reg(f);
+	std::exception_ptr exception;
+	JitContext ctx;
+
+	ctx.Stack = stack;
+	ctx.Frame = f;
+	ctx.Func = static_cast<VMScriptFunction *>(f->Func);
+	ctx.RegD = reg.d;
+	ctx.RegF = reg.f;
+	ctx.RegA = reg.a;
+	ctx.RegATag = reg.atag;
+	ctx.Ret = ret;
+	ctx.NumRet = numret;
+	ctx.ResumeIndex = 0;
+	ctx.Exception = &exception;
+
+	int result = func(&ctx);
+	if (result == JIT_RESUME)
+	{
+		return VMExec_Interpreter(stack, ctx.Func->Code + ctx.ResumeIndex, ret, numret);
+	}
+	else if (result == JIT_EXCEPTION)
+	{
+		std::rethrow_exception(exception);
+	}
+	return result;
+}
+
+//===========================================================================
+//
+// The register and return value state of a frame, for the compare mode
+//
+//===========================================================================
+
+struct FJitCompareState
+{
+	TArray<int> RegD;
+	TArray<double> RegF;
+	TArray<FString> RegS;
+	TArray<void *> RegA;
+	TArray<VM_ATAG> RegATag;
+	TArray<uint8_t> Returns;
+
+	static int ReturnSize(const VMReturn &ret)
+	{
+		switch (ret.RegType & REGT_TYPE)
+		{
+		case REGT_INT:		return sizeof(int);
+		case REGT_FLOAT:	return sizeof(double) * ((ret.RegType & REGT_MULTIREG3) ? 3 : (ret.RegType & REGT_MULTIREG2) ? 2 : 1);
+		case REGT_POINTER:	return sizeof(void *);
+		default:			return 0;
+		}
+	}
+
+	void Save(const VMFrame *f, const VMReturn *ret, int numret)
+	{
+		const VMRegisters reg(f);
+		RegD.Resize(f->NumRegD);
+		RegF.Resize(f->NumRegF);
+		RegA.Resize(f->NumRegA);
+		RegATag.Resize(f->NumRegA);
+		RegS.Clear();
+		for (int i = 0; i < f->NumRegD; i++) RegD[i] = reg.d[i];
+		for (int i = 0; i < f->NumRegF; i++) RegF[i] = reg.f[i];
+		for (int i = 0; i < f->NumRegS; i++) RegS.Push(reg.s[i]);
+		for (int i = 0; i < f->NumRegA; i++) RegA[i] = reg.a[i], RegATag[i] = reg.atag[i];
+
+		Returns.Clear();
+		for (int i = 0; i < numret; i++)
+		{
+			const uint8_t *src = (const uint8_t *)ret[i].Location;
+			for (int j = ReturnSize(ret[i]); j > 0; j--) Returns.Push(*src++);
+		}
+	}
+
+	void Restore(VMFrame *f) const
+	{
+		const VMRegisters reg(f);
+		for (int i = 0; i < f->NumRegD; i++) reg.d[i] = RegD[i];
+		for (int i = 0; i < f->NumRegF; i++) reg.f[i] = RegF[i];
+		for (int i = 0; i < f->NumRegS; i++) reg.s[i] = RegS[i];
+		for (int i = 0; i < f->NumRegA; i++) reg.a[i] = RegA[i], reg.atag[i] = RegATag[i];
+	}
+
+	bool operator==(const FJitCompareState &other) const
+	{
+		return RegD == other.RegD && (RegF.Size() == 0 || memcmp(&RegF[0], &other.RegF[0], RegF.Size() * sizeof(double)) == 0) &&
+			RegS == other.RegS && RegA == other.RegA && RegATag == other.RegATag && Returns == other.Returns;
+	}
+};
+
+//===========================================================================
+//
+// JitCompare
+//
+// Runs a side effect free function in the interpreter first, then in the
+// JIT from the same starting state, and complains if the results differ.
+// The function is handed to the interpreter from then on.
+//
+//===========================================================================
+
+static int JitCompare(JitFuncPtr func, VMFrameStack *stack, VMReturn *ret, int numret)
+{
+	VMFrame *f = stack->TopFrame();
+	VMScriptFunction *sfunc = static_cast<VMScriptFunction *>(f->Func);
+
+	for (int i = 0; i < numret; i++)
+	{
+		// Strings cannot be compared as raw memory
+		if (FJitCompareState::ReturnSize(ret[i]) == 0)
+		{
+			return RunJit(func, stack, ret, numret);
+		}
+	}
+
+	FJitCompareState entry, interpreted, compiled;
+	entry.Save(f, ret, numret);
+	int interpretedret = VMExec_Interpreter(stack, sfunc->Code, ret, numret);
+	interpreted.Save(f, ret, numret);
+	entry.Restore(f);
+	int compiledret = RunJit(func, stack, ret, numret);
+	compiled.Save(f, ret, numret);
+
+	if (interpretedret != compiledret || !(interpreted == compiled))
+	{
+		Printf(TEXTCOLOR_RED "JIT result differs from the interpreter in %s\n", sfunc->PrintableName.GetChars());
+		sfunc->JitState = JIT_Failed;
+		sfunc->JitFunc = nullptr;
+	}
+	return compiledret;
+}
+
+static int VMExec_JIT(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
+{
+	VMScriptFunction *sfunc = static_cast<VMScriptFunction *>(stack->TopFrame()->Func);
+	if (pc == sfunc->Code)
+	{
+		JitFuncPtr func = JitGetFunc(sfunc);
+		if (func != nullptr)
+		{
+			if (JitCompareMode && sfunc->JitPure)
+			{
+				return JitCompare(func, stack, ret, numret);
+			}
+			return RunJit(func, stack, ret, numret);
+		}
+	}
+	return VMExec_Interpreter(stack, pc, ret, numret);
+}
+
 
 //===========================================================================
 //
 // VMSelectEngine
 //
 // Selects the VM engine, either checked or unchecked. Default will decide
-// based on the NDEBUG preprocessor definition.
+// based on the NDEBUG preprocessor definition. The JIT compiles all script
+// functions right away and uses the default interpreter for anything it
+// cannot handle.
 //
 //===========================================================================
 
@@ -183,6 +572,12 @@ void VMSelectEngine(EVMEngine engine)
 	case VMEngine_Checked:
 		VMExec = VMExec_Checked::Exec;
 		break;
+	case VMEngine_JIT:
+	case VMEngine_JITCompare:
+		JitCompareMode = engine == VMEngine_JITCompare;
+		Printf("JIT compiled %d script functions\n", JitCompileAll());
+		VMExec = VMExec_JIT;
+		break;
 	}
 }
 
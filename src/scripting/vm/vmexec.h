@@ -372,6 +372,7 @@ begin:
 	OP(SO_R):
 		ASSERTA(a); ASSERTA(B); ASSERTD(C);
 		GETADDR(PA,RC,X_WRITE_NIL);
+		*(void **)ptr = reg.a[B];
 		GC::WriteBarrier((DObject*)*(void **)ptr);
 		NEXTOP;
 	OP(SV2):
@@ -697,7 +698,7 @@ begin:
 				VMFillParams(reg.param + f->NumParam - b, newf, b);
 				try
 				{
-					numret = Exec(stack, script->Code, returns, C);
+					numret = VMExec(stack, script->Code, returns, C);
 				}
 				catch(...)
 				{
@@ -755,7 +756,7 @@ begin:
 				VMFillParams(reg.param + f->NumParam - B, newf, B);
 				try
 				{
-					numret = Exec(stack, script->Code, ret, numret);
+					numret = VMExec(stack, script->Code, ret, numret);
 				}
 				catch(...)
 				{
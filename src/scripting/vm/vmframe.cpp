@@ -68,6 +68,9 @@ VMScriptFunction::VMScriptFunction(FName name)
 	NumKonstA = 0;
 	MaxParam = 0;
 	NumArgs = 0;
+	JitState = 0;
+	JitPure = false;
+	JitFunc = nullptr;
 }
 
 VMScriptFunction::~VMScriptFunction()
@@ -0,0 +1,913 @@
+/*
+** vmjit.cpp
+** Translates VM bytecode into x86-64 machine code
+**
+**---------------------------------------------------------------------------
+**
+** The generated code keeps all VM registers in the frame, exactly where
+** the interpreter has them. This keeps the translation simple: every
+** instruction is compiled on its own, and whenever the compiled code meets
+** something it does not handle (an unsupported instruction, a null pointer
+** or a division by zero that needs to throw) it stores the instruction
+** index and returns, so the interpreter can pick up from there.
+**
+** Calls, parameters and return values go through helper functions in
+** vmexec.cpp that share the interpreter's code. The helpers catch all
+** exceptions, because the generated code has no unwind information.
+**
+** Functions using TRY cannot be compiled since the interpreter keeps
+** its exception handler stack in local variables.
+**
+*/
+
+#include <stddef.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "dobject.h"
+#include "templates.h"
+#include "vmjit.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+//==========================================================================
+//
+// Executable memory
+//
+// Code is never freed individually. Script functions live as long as
+// the class data, which is only released at shutdown.
+//
+//==========================================================================
+
+static uint8_t *JitBlock;
+static size_t JitBlockPos, JitBlockSize;
+
+static void *AllocJitMemory(size_t size)
+{
+	size = (size + 15) & ~15;
+	if (JitBlock == nullptr || JitBlockPos + size > JitBlockSize)
+	{
+		size_t blocksize = MAX<size_t>(size, 1024 * 1024);
+#ifdef _WIN32
+		void *mem = VirtualAlloc(nullptr, blocksize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+		void *mem = mmap(nullptr, blocksize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) mem = nullptr;
+#endif
+		if (mem == nullptr)
+		{
+			return nullptr;
+		}
+		JitBlock = (uint8_t *)mem;
+		JitBlockPos = 0;
+		JitBlockSize = blocksize;
+	}
+	void *result = JitBlock + JitBlockPos;
+	JitBlockPos += size;
+	return result;
+}
+
+//==========================================================================
+//
+// FJitAssembler
+//
+// Just enough of an x86-64 encoder for the code below.
+//
+//==========================================================================
+
+enum
+{
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+enum
+{
+	XMM0, XMM1, XMM2
+};
+
+enum
+{
+	CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+	CC_P = 0xa, CC_NP = 0xb, CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf
+};
+
+// Registers holding the context and the VM register file in the generated code
+enum
+{
+	CTX = RBX,
+	REGD = R12,
+	REGF = R13,
+	REGA = R14,
+	REGATAG = R15,
+};
+
+#ifdef _WIN32
+enum { ARG0 = RCX, ARG1 = RDX };
+#else
+enum { ARG0 = RDI, ARG1 = RSI };
+#endif
+
+#define CTXOFS(field)	((int)offsetof(JitContext, field))
+#define RD(i)			REGD, (i) * 4
+#define RF(i)			REGF, (i) * 8
+#define RA(i)			REGA, (i) * 8
+#define RATAG(i)		REGATAG, (i)
+
+class FJitAssembler
+{
+public:
+	TArray<uint8_t> Code;
+
+	int Pos() const { return Code.Size(); }
+
+	void Byte(int b) { Code.Push((uint8_t)b); }
+	void Dword(uint32_t v) { for (int i = 0; i < 4; i++) Byte(v >> (i * 8)); }
+	void Qword(uint64_t v) { for (int i = 0; i < 8; i++) Byte(int(v >> (i * 8))); }
+
+	void Rex(bool w, int reg, int rm)
+	{
+		int rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+		if (rex != 0x40) Byte(rex);
+	}
+
+	void ModRMMem(int reg, int base, int disp)
+	{
+		int mod = (disp == 0 && (base & 7) != RBP) ? 0 : (disp >= -128 && disp <= 127) ? 1 : 2;
+		Byte((mod << 6) | ((reg & 7) << 3) | (base & 7));
+		if ((base & 7) == RSP) Byte(0x24);
+		if (mod == 1) Byte(disp);
+		else if (mod == 2) Dword(disp);
+	}
+
+	void ModRMReg(int reg, int rm)
+	{
+		Byte(0xc0 | ((reg & 7) << 3) | (rm & 7));
+	}
+
+	void Opcode(int prefix, bool w, int reg, int rm, int opcode)
+	{
+		if (prefix != 0) Byte(prefix);
+		Rex(w, reg, rm);
+		if (opcode > 0xff) Byte(opcode >> 8);
+		Byte(opcode);
+	}
+
+	// op reg, [base + disp]
+	void OpMem(int prefix, bool w, int opcode, int reg, int base, int disp)
+	{
+		Opcode(prefix, w, reg, base, opcode);
+		ModRMMem(reg, base, disp);
+	}
+
+	// op reg, rm
+	void OpReg(int prefix, bool w, int opcode, int reg, int rm)
+	{
+		Opcode(prefix, w, reg, rm, opcode);
+		ModRMReg(reg, rm);
+	}
+
+	void Load32(int reg, int base, int disp) { OpMem(0, false, 0x8b, reg, base, disp); }
+	void Store32(int base, int disp, int reg) { OpMem(0, false, 0x89, reg, base, disp); }
+	void Load64(int reg, int base, int disp) { OpMem(0, true, 0x8b, reg, base, disp); }
+	void Store64(int base, int disp, int reg) { OpMem(0, true, 0x89, reg, base, disp); }
+	void StoreImm32(int base, int disp, int imm) { OpMem(0, false, 0xc7, 0, base, disp); Dword(imm); }
+	void StoreImm8(int base, int disp, int imm) { OpMem(0, false, 0xc6, 0, base, disp); Byte(imm); }
+	void Mov64(int dst, int src) { OpReg(0, true, 0x89, src, dst); }
+	void MovImm32(int reg, int imm) { Rex(false, 0, reg); Byte(0xb8 + (reg & 7)); Dword(imm); }
+	void MovImm64(int reg, uint64_t imm) { Rex(true, 0, reg); Byte(0xb8 + (reg & 7)); Qword(imm); }
+	void MovImmPtr(int reg, const void *ptr) { MovImm64(reg, (uint64_t)(uintptr_t)ptr); }
+
+	// 0x03 add, 0x0b or, 0x23 and, 0x2b sub, 0x33 xor, 0x3b cmp
+	void AluMem(int opcode, int reg, int base, int disp) { OpMem(0, false, opcode, reg, base, disp); }
+	void AluReg(int opcode, int reg, int rm) { OpReg(0, false, opcode, reg, rm); }
+	// 0 add, 1 or, 4 and, 5 sub, 6 xor, 7 cmp
+	void AluImm(int ext, int reg, int imm) { OpReg(0, false, 0x81, ext, reg); Dword(imm); }
+
+	void Push(int reg) { Rex(false, 0, reg); Byte(0x50 + (reg & 7)); }
+	void Pop(int reg) { Rex(false, 0, reg); Byte(0x58 + (reg & 7)); }
+	void Ret() { Byte(0xc3); }
+	void CallReg(int reg) { OpReg(0, false, 0xff, 2, reg); }
+
+	// Float ops with a memory or register source: prefix 0xf2 for double, 0xf3 for single precision
+	void SseMem(int prefix, int opcode, int xmm, int base, int disp) { OpMem(prefix, false, opcode, xmm, base, disp); }
+	void SseReg(int prefix, int opcode, int xmm, int rm) { OpReg(prefix, false, opcode, xmm, rm); }
+	void LoadSD(int xmm, int base, int disp) { SseMem(0xf2, 0x0f10, xmm, base, disp); }
+	void StoreSD(int base, int disp, int xmm) { SseMem(0xf2, 0x0f11, xmm, base, disp); }
+	void LoadKonstSD(int xmm, double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		MovImm64(RAX, bits);
+		OpReg(0x66, true, 0x0f6e, xmm, RAX);	// movq xmm, rax
+	}
+
+	void Setcc(int cc, int reg) { OpReg(0, false, 0x0f90 | cc, 0, reg); }
+	void Cmov(int cc, int reg, int rm) { OpReg(0, false, 0x0f40 | cc, reg, rm); }
+
+	// Jumps with a 32 bit displacement. Returns the position of the displacement.
+	int Jcc(int cc) { Byte(0x0f); Byte(0x80 | cc); Dword(0); return Pos() - 4; }
+	int Jmp() { Byte(0xe9); Dword(0); return Pos() - 4; }
+
+	void Patch(int at, int target)
+	{
+		int rel = target - (at + 4);
+		for (int i = 0; i < 4; i++) Code[at + i] = uint8_t(rel >> (i * 8));
+	}
+
+	void Bind(int at) { Patch(at, Pos()); }
+};
+
+//==========================================================================
+//
+// FJitCompiler
+//
+//==========================================================================
+
+class FJitCompiler
+{
+public:
+	FJitCompiler(VMScriptFunction *func) : Func(func) {}
+	JitFuncPtr Compile();
+
+	bool Pure = true;
+
+private:
+	enum { EPILOGUE = -1 };
+
+	struct FFixup
+	{
+		int Pos;
+		int Target;
+	};
+
+	VMScriptFunction *Func;
+	FJitAssembler as;
+	TArray<int> Labels;
+	TArray<FFixup> Fixups;
+
+	void JumpTo(int at, int target) { Fixups.Push({ at, target }); }
+	bool EmitOp(int i, const VMOP *pc);
+	void EmitExit(int i);
+	void EmitExitIfNull(int i, int reg);
+	void EmitAddress(int i, int ptrreg, int offsetreg);
+	bool EmitCmpJmp(int i, int cc, bool check);
+	void EmitHelper(const void *helper, const VMOP *pc);
+	bool IsJmp(int i) { return i < Func->CodeSize && Func->Code[i].op == OP_JMP; }
+	int JmpTarget(int i) { return i + 1 + Func->Code[i].i24; }
+};
+
+//==========================================================================
+//
+// Leaves the compiled code and lets the interpreter run instruction i.
+//
+//==========================================================================
+
+void FJitCompiler::EmitExit(int i)
+{
+	as.StoreImm32(CTX, CTXOFS(ResumeIndex), i);
+	as.MovImm32(RAX, JIT_RESUME);
+	JumpTo(as.Jmp(), EPILOGUE);
+}
+
+void FJitCompiler::EmitExitIfNull(int i, int reg)
+{
+	as.OpReg(0, true, 0x85, reg, reg);		// test reg, reg
+	int ok = as.Jcc(CC_NE);
+	EmitExit(i);
+	as.Bind(ok);
+}
+
+//==========================================================================
+//
+// Loads the address for a memory access into RAX, leaving the compiled code
+// if the pointer is null so that the interpreter can throw. The constant
+// offset, if any, is used as displacement by the caller.
+//
+//==========================================================================
+
+void FJitCompiler::EmitAddress(int i, int ptrreg, int offsetreg)
+{
+	as.Load64(RAX, RA(ptrreg));
+	EmitExitIfNull(i, RAX);
+	if (offsetreg >= 0)
+	{
+		as.OpMem(0, true, 0x63, RCX, RD(offsetreg));	// movsxd rcx, dword
+		as.OpReg(0, true, 0x01, RCX, RAX);				// add rax, rcx
+	}
+}
+
+//==========================================================================
+//
+// Compare instructions are always followed by a JMP that is taken if the
+// result matches the check bit, otherwise the JMP is skipped.
+//
+//==========================================================================
+
+bool FJitCompiler::EmitCmpJmp(int i, int cc, bool check)
+{
+	if (!IsJmp(i + 1))
+	{
+		return false;
+	}
+	JumpTo(as.Jcc(check ? cc : cc ^ 1), JmpTarget(i + 1));
+	JumpTo(as.Jmp(), i + 2);
+	return true;
+}
+
+//==========================================================================
+//
+// Calls helper(ctx, pc)
+//
+//==========================================================================
+
+void FJitCompiler::EmitHelper(const void *helper, const VMOP *pc)
+{
+	as.Mov64(ARG0, CTX);
+	as.MovImmPtr(ARG1, pc);
+	as.MovImmPtr(RAX, helper);
+	as.CallReg(RAX);
+}
+
+//==========================================================================
+//
+// Generates code for a single instruction. Returns false if the
+// instruction is not supported, in which case it is left to the interpreter.
+//
+//==========================================================================
+
+bool FJitCompiler::EmitOp(int i, const VMOP *pc)
+{
+	const int *konstd = Func->KonstD;
+	const double *konstf = Func->KonstF;
+	int a = pc->a, B = pc->b, C = pc->c;
+	int cc;
+
+	switch (pc->op)
+	{
+	case OP_NOP:
+	case OP_RESULT:		// skipped by the preceding call
+		return true;
+
+	// Constants are embedded into the code.
+	case OP_LI:
+		as.StoreImm32(RD(a), pc->i16);
+		return true;
+	case OP_LK:
+		as.StoreImm32(RD(a), konstd[pc->i16u]);
+		return true;
+	case OP_LKF:
+		as.LoadKonstSD(XMM0, konstf[pc->i16u]);
+		as.StoreSD(RF(a), XMM0);
+		return true;
+	case OP_LKP:
+		as.MovImmPtr(RAX, Func->KonstA[pc->i16u].v);
+		as.Store64(RA(a), RAX);
+		as.StoreImm8(RATAG(a), Func->KonstATags()[pc->i16u]);
+		return true;
+
+	// Moves
+	case OP_MOVE:
+		as.Load32(RAX, RD(B));
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_MOVEF:
+	case OP_MOVEV2:
+	case OP_MOVEV3:
+	{
+		int count = pc->op == OP_MOVEF ? 1 : pc->op == OP_MOVEV2 ? 2 : 3;
+		for (int j = 0; j < count; j++)
+		{
+			as.Load64(RAX, RF(B + j));
+			as.Store64(RF(a + j), RAX);
+		}
+		return true;
+	}
+	case OP_MOVEA:
+		as.Load64(RAX, RA(B));
+		as.Store64(RA(a), RAX);
+		as.OpMem(0, false, 0x0fb6, RAX, RATAG(B));		// movzx eax, byte
+		as.OpMem(0, false, 0x88, RAX, RATAG(a));		// mov byte, al
+		return true;
+
+	case OP_CAST:
+		if (C == CAST_I2F)
+		{
+			as.SseMem(0xf2, 0x0f2a, XMM0, RD(B));		// cvtsi2sd
+			as.StoreSD(RF(a), XMM0);
+			return true;
+		}
+		else if (C == CAST_F2I)
+		{
+			as.SseMem(0xf2, 0x0f2c, RAX, RF(B));		// cvttsd2si
+			as.Store32(RD(a), RAX);
+			return true;
+		}
+		return false;
+
+	// Loads
+	case OP_LB: case OP_LB_R:
+	case OP_LH: case OP_LH_R:
+	case OP_LW: case OP_LW_R:
+	case OP_LBU: case OP_LBU_R:
+	case OP_LHU: case OP_LHU_R:
+	{
+		bool k = pc->op == OP_LB || pc->op == OP_LH || pc->op == OP_LW || pc->op == OP_LBU || pc->op == OP_LHU;
+		int disp = k ? konstd[C] : 0;
+		EmitAddress(i, B, k ? -1 : C);
+		switch (pc->op)
+		{
+		case OP_LB: case OP_LB_R:	as.OpMem(0, false, 0x0fbe, RAX, RAX, disp); break;
+		case OP_LH: case OP_LH_R:	as.OpMem(0, false, 0x0fbf, RAX, RAX, disp); break;
+		case OP_LW: case OP_LW_R:	as.Load32(RAX, RAX, disp); break;
+		case OP_LBU: case OP_LBU_R:	as.OpMem(0, false, 0x0fb6, RAX, RAX, disp); break;
+		default:					as.OpMem(0, false, 0x0fb7, RAX, RAX, disp); break;
+		}
+		as.Store32(RD(a), RAX);
+		return true;
+	}
+	case OP_LSP:
+	case OP_LSP_R:
+		EmitAddress(i, B, pc->op == OP_LSP ? -1 : C);
+		as.SseMem(0xf3, 0x0f5a, XMM0, RAX, pc->op == OP_LSP ? konstd[C] : 0);	// cvtss2sd
+		as.StoreSD(RF(a), XMM0);
+		return true;
+	case OP_LDP:
+	case OP_LDP_R:
+		EmitAddress(i, B, pc->op == OP_LDP ? -1 : C);
+		as.LoadSD(XMM0, RAX, pc->op == OP_LDP ? konstd[C] : 0);
+		as.StoreSD(RF(a), XMM0);
+		return true;
+	case OP_LP:
+	case OP_LP_R:
+		EmitAddress(i, B, pc->op == OP_LP ? -1 : C);
+		as.Load64(RAX, RAX, pc->op == OP_LP ? konstd[C] : 0);
+		as.Store64(RA(a), RAX);
+		as.StoreImm8(RATAG(a), ATAG_GENERIC);
+		return true;
+
+	// Stores
+	case OP_SB: case OP_SB_R:
+	case OP_SH: case OP_SH_R:
+	case OP_SW: case OP_SW_R:
+	{
+		bool k = pc->op == OP_SB || pc->op == OP_SH || pc->op == OP_SW;
+		int disp = k ? konstd[C] : 0;
+		EmitAddress(i, a, k ? -1 : C);
+		as.Load32(RCX, RD(B));
+		switch (pc->op)
+		{
+		case OP_SB: case OP_SB_R:	as.OpMem(0, false, 0x88, RCX, RAX, disp); break;
+		case OP_SH: case OP_SH_R:	as.OpMem(0x66, false, 0x89, RCX, RAX, disp); break;
+		default:					as.Store32(RAX, disp, RCX); break;
+		}
+		Pure = false;
+		return true;
+	}
+	case OP_SSP:
+	case OP_SSP_R:
+		EmitAddress(i, a, pc->op == OP_SSP ? -1 : C);
+		as.SseMem(0xf2, 0x0f5a, XMM0, RF(B));		// cvtsd2ss
+		as.SseMem(0xf3, 0x0f11, XMM0, RAX, pc->op == OP_SSP ? konstd[C] : 0);
+		Pure = false;
+		return true;
+	case OP_SDP:
+	case OP_SDP_R:
+		EmitAddress(i, a, pc->op == OP_SDP ? -1 : C);
+		as.LoadSD(XMM0, RF(B));
+		as.StoreSD(RAX, pc->op == OP_SDP ? konstd[C] : 0, XMM0);
+		Pure = false;
+		return true;
+	case OP_SP:
+	case OP_SP_R:
+		EmitAddress(i, a, pc->op == OP_SP ? -1 : C);
+		as.Load64(RCX, RA(B));
+		as.Store64(RAX, pc->op == OP_SP ? konstd[C] : 0, RCX);
+		Pure = false;
+		return true;
+	case OP_SO:
+	case OP_SO_R:
+		EmitAddress(i, a, pc->op == OP_SO ? -1 : C);
+		as.Load64(RCX, RA(B));
+		as.Store64(RAX, pc->op == OP_SO ? konstd[C] : 0, RCX);
+		EmitHelper((const void *)JitWriteBarrier, pc);
+		Pure = false;
+		return true;
+
+	// Control flow
+	case OP_JMP:
+		JumpTo(as.Jmp(), JmpTarget(i));
+		return true;
+	case OP_TEST:
+	case OP_TESTN:
+		as.Load32(RAX, RD(a));
+		if (pc->op == OP_TESTN) as.OpReg(0, false, 0xf7, 3, RAX);	// neg eax
+		as.AluImm(7, RAX, pc->i16u);
+		JumpTo(as.Jcc(CC_NE), i + 2);
+		return true;
+
+	case OP_PARAM:
+	case OP_PARAMI:
+		EmitHelper((const void *)JitParam, pc);
+		Pure = false;
+		return true;
+	case OP_CALL:
+	case OP_CALL_K:
+		EmitHelper((const void *)JitCall, pc);
+		as.OpReg(0, false, 0x85, RAX, RAX);			// test eax, eax
+		JumpTo(as.Jcc(CC_NE), EPILOGUE);
+		JumpTo(as.Jmp(), i + 1 + C);
+		Pure = false;
+		return true;
+	case OP_TAIL:
+	case OP_TAIL_K:
+		EmitHelper((const void *)JitTailCall, pc);
+		JumpTo(as.Jmp(), EPILOGUE);
+		Pure = false;
+		return true;
+
+	case OP_RET:
+	case OP_RETI:
+	{
+		if (pc->op == OP_RET && B == REGT_NIL)
+		{
+			as.MovImm32(RAX, 0);
+			JumpTo(as.Jmp(), EPILOGUE);
+			return true;
+		}
+		int retnum = a & ~RET_FINAL;
+		as.Load32(RCX, CTX, CTXOFS(NumRet));
+		as.AluImm(7, RCX, retnum);
+		int skip = as.Jcc(CC_LE);
+		EmitHelper((const void *)JitSetReturn, pc);
+		as.Bind(skip);
+		if (a & RET_FINAL)
+		{
+			// return retnum < numret ? retnum + 1 : numret;
+			as.Load32(RCX, CTX, CTXOFS(NumRet));
+			as.MovImm32(RAX, retnum + 1);
+			as.AluReg(0x3b, RAX, RCX);
+			as.Cmov(CC_G, RAX, RCX);
+			JumpTo(as.Jmp(), EPILOGUE);
+		}
+		return true;
+	}
+
+	// Integer math
+	case OP_ADD_RR: case OP_SUB_RR: case OP_AND_RR: case OP_OR_RR: case OP_XOR_RR:
+	{
+		static const int opcodes[] = { 0x03, 0x2b, 0x23, 0x0b, 0x33 };
+		int index = pc->op == OP_ADD_RR ? 0 : pc->op == OP_SUB_RR ? 1 : pc->op == OP_AND_RR ? 2 : pc->op == OP_OR_RR ? 3 : 4;
+		as.Load32(RAX, RD(B));
+		as.AluMem(opcodes[index], RAX, RD(C));
+		as.Store32(RD(a), RAX);
+		return true;
+	}
+	case OP_ADD_RK: case OP_SUB_RK: case OP_AND_RK: case OP_OR_RK: case OP_XOR_RK: case OP_ADDI:
+	{
+		static const int exts[] = { 0, 5, 4, 1, 6 };
+		int index = pc->op == OP_ADD_RK ? 0 : pc->op == OP_SUB_RK ? 1 : pc->op == OP_AND_RK ? 2 : pc->op == OP_OR_RK ? 3 : pc->op == OP_XOR_RK ? 4 : 0;
+		as.Load32(RAX, RD(B));
+		as.AluImm(exts[index], RAX, pc->op == OP_ADDI ? pc->cs : konstd[C]);
+		as.Store32(RD(a), RAX);
+		return true;
+	}
+	case OP_SUB_KR:
+		as.MovImm32(RAX, konstd[B]);
+		as.AluMem(0x2b, RAX, RD(C));
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_MUL_RR:
+		as.Load32(RAX, RD(B));
+		as.OpMem(0, false, 0x0faf, RAX, RD(C));		// imul eax, dword
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_MUL_RK:
+		as.Load32(RCX, RD(B));
+		as.OpReg(0, false, 0x69, RAX, RCX);			// imul eax, ecx, imm32
+		as.Dword(konstd[C]);
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_SLL_RI: case OP_SRL_RI: case OP_SRA_RI:
+		as.Load32(RAX, RD(B));
+		as.OpReg(0, false, 0xc1, pc->op == OP_SLL_RI ? 4 : pc->op == OP_SRL_RI ? 5 : 7, RAX);
+		as.Byte(C);
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_SLL_RR: case OP_SRL_RR: case OP_SRA_RR: case OP_SLL_KR: case OP_SRA_KR:
+	{
+		if (pc->op == OP_SLL_KR || pc->op == OP_SRA_KR) as.MovImm32(RAX, konstd[B]);
+		else as.Load32(RAX, RD(B));
+		as.Load32(RCX, RD(C));
+		int ext = (pc->op == OP_SLL_RR || pc->op == OP_SLL_KR) ? 4 : pc->op == OP_SRL_RR ? 5 : 7;
+		as.OpReg(0, false, 0xd3, ext, RAX);			// shift eax, cl
+		as.Store32(RD(a), RAX);
+		return true;
+	}
+	case OP_MIN_RR: case OP_MIN_RK: case OP_MAX_RR: case OP_MAX_RK:
+		as.Load32(RAX, RD(B));
+		if (pc->op == OP_MIN_RR || pc->op == OP_MAX_RR) as.Load32(RCX, RD(C));
+		else as.MovImm32(RCX, konstd[C]);
+		as.AluReg(0x3b, RAX, RCX);
+		as.Cmov((pc->op == OP_MIN_RR || pc->op == OP_MIN_RK) ? CC_GE : CC_LE, RAX, RCX);
+		as.Store32(RD(a), RAX);
+		return true;
+	case OP_NEG:
+	case OP_NOT:
+		as.Load32(RAX, RD(B));
+		as.OpReg(0, false, 0xf7, pc->op == OP_NEG ? 3 : 2, RAX);
+		as.Store32(RD(a), RAX);
+		return true;
+
+	// Integer compares
+	case OP_EQ_R: case OP_EQ_K:
+	case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:
+	case OP_LE_RR: case OP_LE_RK: case OP_LE_KR:
+	case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:
+	case OP_LEU_RR: case OP_LEU_RK: case OP_LEU_KR:
+		switch (pc->op)
+		{
+		case OP_EQ_K: case OP_LT_RK: case OP_LE_RK: case OP_LTU_RK: case OP_LEU_RK:
+			as.Load32(RAX, RD(B));
+			as.AluImm(7, RAX, konstd[C]);
+			break;
+		case OP_LT_KR: case OP_LE_KR: case OP_LTU_KR: case OP_LEU_KR:
+			as.MovImm32(RAX, konstd[B]);
+			as.AluMem(0x3b, RAX, RD(C));
+			break;
+		default:
+			as.Load32(RAX, RD(B));
+			as.AluMem(0x3b, RAX, RD(C));
+			break;
+		}
+		switch (pc->op)
+		{
+		case OP_EQ_R: case OP_EQ_K:						cc = CC_E; break;
+		case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:	cc = CC_L; break;
+		case OP_LE_RR: case OP_LE_RK: case OP_LE_KR:	cc = CC_LE; break;
+		case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:	cc = CC_B; break;
+		default:										cc = CC_BE; break;
+		}
+		return EmitCmpJmp(i, cc, a & CMP_CHECK);
+
+	case OP_EQA_R:
+	case OP_EQA_K:
+		as.Load64(RAX, RA(B));
+		if (pc->op == OP_EQA_R) as.Load64(RCX, RA(C));
+		else as.MovImmPtr(RCX, Func->KonstA[C].v);
+		as.OpReg(0, true, 0x3b, RAX, RCX);
+		return EmitCmpJmp(i, CC_E, a & CMP_CHECK);
+
+	// Float math
+	case OP_ADDF_RR: case OP_ADDF_RK:
+	case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:
+	case OP_MULF_RR: case OP_MULF_RK:
+	case OP_DIVF_RR: case OP_DIVF_RK: case OP_DIVF_KR:
+	case OP_MINF_RR: case OP_MINF_RK:
+	case OP_MAXF_RR: case OP_MAXF_RK:
+	{
+		bool kb = pc->op == OP_SUBF_KR || pc->op == OP_DIVF_KR;
+		bool kc = pc->op == OP_ADDF_RK || pc->op == OP_SUBF_RK || pc->op == OP_MULF_RK || pc->op == OP_DIVF_RK || pc->op == OP_MINF_RK || pc->op == OP_MAXF_RK;
+		int opcode;
+		switch (pc->op)
+		{
+		case OP_ADDF_RR: case OP_ADDF_RK:					opcode = 0x0f58; break;
+		case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:	opcode = 0x0f5c; break;
+		case OP_MULF_RR: case OP_MULF_RK:					opcode = 0x0f59; break;
+		case OP_DIVF_RR: case OP_DIVF_RK: case OP_DIVF_KR:	opcode = 0x0f5e; break;
+		case OP_MINF_RR: case OP_MINF_RK:					opcode = 0x0f5d; break;	// minsd matches b < c ? b : c
+		default:											opcode = 0x0f5f; break;	// maxsd matches b > c ? b : c
+		}
+		if (kc) as.LoadKonstSD(XMM1, konstf[C]);
+		else as.LoadSD(XMM1, RF(C));
+		if (opcode == 0x0f5e)
+		{
+			// Division by zero throws in the interpreter
+			if (kc && konstf[C] == 0.)
+			{
+				EmitExit(i);
+				return true;
+			}
+			else if (!kc)
+			{
+				as.SseReg(0x66, 0x0f57, XMM2, XMM2);		// xorpd xmm2, xmm2
+				as.SseReg(0x66, 0x0f2e, XMM1, XMM2);		// ucomisd xmm1, xmm2
+				int unordered = as.Jcc(CC_P);
+				int nonzero = as.Jcc(CC_NE);
+				EmitExit(i);
+				as.Bind(unordered);
+				as.Bind(nonzero);
+			}
+		}
+		if (kb) as.LoadKonstSD(XMM0, konstf[B]);
+		else as.LoadSD(XMM0, RF(B));
+		as.SseReg(0xf2, opcode, XMM0, XMM1);
+		as.StoreSD(RF(a), XMM0);
+		return true;
+	}
+	case OP_FLOP:
+		if (C == FLOP_ABS || C == FLOP_NEG)
+		{
+			as.Load64(RAX, RF(B));
+			as.OpReg(0, true, 0x0fba, C == FLOP_ABS ? 6 : 7, RAX);	// btr/btc rax, 63
+			as.Byte(63);
+			as.Store64(RF(a), RAX);
+			return true;
+		}
+		return false;
+
+	// Float compares
+	case OP_EQF_R: case OP_EQF_K:
+	case OP_LTF_RR: case OP_LTF_RK: case OP_LTF_KR:
+	case OP_LEF_RR: case OP_LEF_RK: case OP_LEF_KR:
+	{
+		if (a & CMP_APPROX)
+		{
+			return false;
+		}
+		bool kb = pc->op == OP_LTF_KR || pc->op == OP_LEF_KR;
+		bool kc = pc->op == OP_EQF_K || pc->op == OP_LTF_RK || pc->op == OP_LEF_RK;
+		if (kb) as.LoadKonstSD(XMM0, konstf[B]);
+		else as.LoadSD(XMM0, RF(B));
+		if (kc) as.LoadKonstSD(XMM1, konstf[C]);
+		else as.LoadSD(XMM1, RF(C));
+		if (pc->op == OP_EQF_R || pc->op == OP_EQF_K)
+		{
+			// Equal and ordered
+			as.SseReg(0x66, 0x0f2e, XMM0, XMM1);
+			as.Setcc(CC_E, RAX);
+			as.Setcc(CC_NP, RCX);
+			as.OpReg(0, false, 0x20, RCX, RAX);		// and al, cl
+			as.OpReg(0, false, 0x84, RAX, RAX);		// test al, al
+			cc = CC_NE;
+		}
+		else
+		{
+			// b < c is c > b, which is false for unordered values
+			as.SseReg(0x66, 0x0f2e, XMM1, XMM0);
+			cc = (pc->op == OP_LTF_RR || pc->op == OP_LTF_RK || pc->op == OP_LTF_KR) ? CC_A : CC_AE;
+		}
+		return EmitCmpJmp(i, cc, a & CMP_CHECK);
+	}
+
+	case OP_TRY:
+	case OP_UNTRY:
+	case OP_THROW:
+	case OP_CATCH:
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FJitCompiler :: Compile
+//
+//==========================================================================
+
+JitFuncPtr FJitCompiler::Compile()
+{
+	// The interpreter's exception handlers cannot be resumed into.
+	for (int i = 0; i < Func->CodeSize; i++)
+	{
+		int op = Func->Code[i].op;
+		if (op == OP_TRY || op == OP_UNTRY || op == OP_THROW || op == OP_CATCH)
+		{
+			return nullptr;
+		}
+	}
+
+	// Prologue. Five pushes and the shadow space keep the stack 16 byte aligned for the helpers.
+	as.Push(RBX);
+	as.Push(R12);
+	as.Push(R13);
+	as.Push(R14);
+	as.Push(R15);
+	as.OpReg(0, true, 0x81, 5, RSP);	// sub rsp, 32
+	as.Dword(32);
+	as.Mov64(CTX, ARG0);
+	as.Load64(REGD, CTX, CTXOFS(RegD));
+	as.Load64(REGF, CTX, CTXOFS(RegF));
+	as.Load64(REGA, CTX, CTXOFS(RegA));
+	as.Load64(REGATAG, CTX, CTXOFS(RegATag));
+
+	int supported = 0;
+	Labels.Resize(Func->CodeSize + 1);
+	for (int i = 0; i < Func->CodeSize; i++)
+	{
+		Labels[i] = as.Pos();
+		size_t start = as.Code.Size();
+		if (EmitOp(i, &Func->Code[i]))
+		{
+			supported++;
+		}
+		else
+		{
+			// Nothing after this instruction runs compiled code unless it is a jump target.
+			as.Code.Resize((unsigned)start);
+			EmitExit(i);
+			Pure = false;
+			if (i == 0)
+			{
+				return nullptr;
+			}
+		}
+	}
+	Labels[Func->CodeSize] = as.Pos();
+
+	// Falling off the end, which the code generator never produces
+	as.MovImm32(RAX, 0);
+
+	int epilogue = as.Pos();
+	as.OpReg(0, true, 0x81, 0, RSP);	// add rsp, 32
+	as.Dword(32);
+	as.Pop(R15);
+	as.Pop(R14);
+	as.Pop(R13);
+	as.Pop(R12);
+	as.Pop(RBX);
+	as.Ret();
+
+	for (auto &fixup : Fixups)
+	{
+		if (fixup.Target == EPILOGUE)
+		{
+			as.Patch(fixup.Pos, epilogue);
+		}
+		else if ((unsigned)fixup.Target <= (unsigned)Func->CodeSize)
+		{
+			as.Patch(fixup.Pos, Labels[fixup.Target]);
+		}
+		else
+		{
+			return nullptr;
+		}
+	}
+
+	void *mem = AllocJitMemory(as.Code.Size());
+	if (mem == nullptr)
+	{
+		return nullptr;
+	}
+	memcpy(mem, &as.Code[0], as.Code.Size());
+	return (JitFuncPtr)mem;
+}
+
+#else
+
+// No code generator for this CPU. Everything runs in the interpreter.
+class FJitCompiler
+{
+public:
+	FJitCompiler(VMScriptFunction *func) {}
+	JitFuncPtr Compile() { return nullptr; }
+	bool Pure = false;
+};
+
+#endif
+
+//==========================================================================
+//
+// JitGetFunc
+//
+//==========================================================================
+
+JitFuncPtr JitGetFunc(VMScriptFunction *func)
+{
+	if (func->JitState == JIT_NotCompiled)
+	{
+		FJitCompiler compiler(func);
+		func->JitFunc = (void *)compiler.Compile();
+		func->JitState = func->JitFunc != nullptr ? JIT_Compiled : JIT_Failed;
+		func->JitPure = compiler.Pure;
+	}
+	return (JitFuncPtr)func->JitFunc;
+}
+
+//==========================================================================
+//
+// JitCompileAll
+//
+//==========================================================================
+
+int JitCompileAll()
+{
+	int count = 0;
+	for (auto func : VMFunction::AllFunctions)
+	{
+		if (!(func->VarFlags & VARF_Native))
+		{
+			auto sfunc = static_cast<VMScriptFunction *>(func);
+			if (sfunc->Code != nullptr && JitGetFunc(sfunc) != nullptr)
+			{
+				count++;
+			}
+		}
+	}
+	return count;
+}
@@ -0,0 +1,58 @@
+#ifndef VMJIT_H
+#define VMJIT_H
+
+#include <exception>
+#include "vm.h"
+
+// Interface between the JIT compiled code and the rest of the VM.
+// Compiled code works directly on the registers in the VM frame, so
+// it can leave the function at any instruction and let the interpreter
+// continue from there.
+
+struct JitContext
+{
+	VMFrameStack *Stack;
+	VMFrame *Frame;
+	VMScriptFunction *Func;
+	int *RegD;
+	double *RegF;
+	void **RegA;
+	VM_ATAG *RegATag;
+	VMReturn *Ret;
+	int NumRet;
+	int ResumeIndex;				// instruction the interpreter continues at for JIT_RESUME
+	std::exception_ptr *Exception;	// exception caught by a helper for JIT_EXCEPTION
+};
+
+enum
+{
+	JIT_RESUME = -1,		// continue in the interpreter at ResumeIndex
+	JIT_EXCEPTION = -2,		// rethrow *Exception
+};
+
+enum
+{
+	JIT_NotCompiled,
+	JIT_Compiled,
+	JIT_Failed,
+};
+
+typedef int (*JitFuncPtr)(JitContext *ctx);
+
+// Compiles the function if that was not attempted yet. Returns nullptr
+// if the function has to run in the interpreter.
+JitFuncPtr JitGetFunc(VMScriptFunction *func);
+
+// Compiles all script functions in advance and returns the number of successes.
+int JitCompileAll();
+
+// Helpers called by the compiled code for instructions that are not generated inline.
+// They are implemented in vmexec.cpp since they share code with the interpreter,
+// and none of them may let an exception pass through the compiled code.
+void JitParam(JitContext *ctx, const VMOP *pc);
+int JitCall(JitContext *ctx, const VMOP *pc);
+int JitTailCall(JitContext *ctx, const VMOP *pc);
+void JitSetReturn(JitContext *ctx, const VMOP *pc);
+void JitWriteBarrier(JitContext *ctx, const VMOP *pc);
+
+#endif
@@ -44,6 +44,7 @@
 #include "version.h"
 #include "zcc_parser.h"
 #include "zcc_compile.h"
+#include "backend/scriptcache.h"
 
 TArray<FString> Includes;
 TArray<FScriptPosition> IncludeLocs;
@@ -261,6 +262,7 @@ static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void
 	}
 	FScanner &sc = *pSC;
 	sc.SetParseVersion(state.ParseVersion);
+	ScriptCache.AddLump(lump);
 	state.sc = &sc;
 
 	while (sc.GetToken())
@@ -392,8 +394,19 @@ static void DoParse(int lumpnum)
 	}
 
 	ParseSingleFile(&sc, nullptr, lumpnum, parser, state);
+	unsigned prefetched = 0;
 	for (unsigned i = 0; i < Includes.Size(); i++)
 	{
+		if (i == prefetched)
+		{
+			// Decompress all includes that are known so far at once.
+			TArray<int> lumps;
+			for (; prefetched < Includes.Size(); prefetched++)
+			{
+				lumps.Push(Wads.CheckNumForFullName(Includes[prefetched], true));
+			}
+			Wads.PrefetchLumps(lumps);
+		}
 		lumpnum = Wads.CheckNumForFullName(Includes[i], true);
 		if (lumpnum == -1)
 		{
@@ -476,9 +489,16 @@ void ParseScripts()
 	int lump, lastlump = 0;
 	FScriptPosition::ResetErrorCounter();
 
+	TArray<int> lumps;
 	while ((lump = Wads.FindLump("ZSCRIPT", &lastlump)) != -1)
 	{
-		DoParse(lump);
+		lumps.Push(lump);
+	}
+	Wads.PrefetchLumps(lumps);
+
+	for (int lumpnum : lumps)
+	{
+		DoParse(lumpnum);
 	}
 }
 
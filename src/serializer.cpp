@@ -69,6 +69,9 @@
 char nulspace[1024 * 1024 * 4];
 bool save_full = false;	// for testing. Should be removed afterward.
 
+EXTERN_CVAR(Bool, save_formatted)
+EXTERN_CVAR(Bool, save_binary)
+
 int utf8_encode(int32_t codepoint, char *buffer, int *size)
 {
 	if (codepoint < 0)
@@ -229,6 +232,396 @@ struct FJSONObject
 	}
 };
 
+//==========================================================================
+//
+// Binary savegame format
+//
+// This stores the same tree of objects, arrays and values as the JSON
+// writer, so everything that reads a savegame works the same with both.
+// Keys and strings are written only once and referenced by index afterward,
+// integers are written as varints and floating point values as raw bits.
+// Since no number formatting is involved and the output is a lot smaller
+// this is considerably faster to write and compress than JSON.
+//
+// Inside an object each member starts with a varint: 0 ends the object,
+// 1 is followed by the key as a new string and any higher value n refers
+// to entry n - 2 of the string table. The value follows as one of the
+// tags below.
+//
+//==========================================================================
+
+enum
+{
+	BIN_NULL,
+	BIN_FALSE,
+	BIN_TRUE,
+	BIN_UINT,		// varint
+	BIN_NEGINT,		// varint of ~value
+	BIN_FLOAT,		// a double that can be stored as a float without loss
+	BIN_DOUBLE,
+	BIN_STRING,		// varint length and the characters, adds a string table entry
+	BIN_STRINGREF,	// varint index into the string table
+	BIN_OBJECT,
+	BIN_ARRAY,
+	BIN_END,		// ends an array
+};
+
+static const uint8_t BinaryMagic[] = { 'G', 'Z', 'B', 'S', 1 };
+static const int BINARY_MAX_DEPTH = 256;
+
+static bool IsBinarySave(const char *buffer, size_t length)
+{
+	return length >= sizeof(BinaryMagic) && !memcmp(buffer, BinaryMagic, sizeof(BinaryMagic));
+}
+
+//==========================================================================
+//
+// Has the same interface as the RapidJSON writers so that FWriter can
+// use it in their place.
+//
+//==========================================================================
+
+class FBinaryWriter
+{
+	TArray<uint8_t> mBuffer;
+	TArray<FString> mStrings;
+	TMap<FString, unsigned> mStringIndex;
+	TMap<const char *, unsigned> mPointerIndex;	// most keys are string literals, so this avoids hashing them each time.
+
+	void WriteByte(uint8_t b)
+	{
+		mBuffer.Push(b);
+	}
+
+	void WriteVarint(uint64_t v)
+	{
+		uint8_t p[10];
+		int len = 0;
+		while (v >= 0x80)
+		{
+			p[len++] = uint8_t(v | 0x80);
+			v >>= 7;
+		}
+		p[len++] = uint8_t(v);
+		WriteBytes(p, len);
+	}
+
+	void WriteBytes(const void *data, size_t len)
+	{
+		if (len > 0) memcpy(&mBuffer[mBuffer.Reserve((unsigned)len)], data, len);
+	}
+
+	void WriteFixed(uint64_t v, int bytes)
+	{
+		uint8_t *p = &mBuffer[mBuffer.Reserve(bytes)];
+		for (int i = 0; i < bytes; i++)
+		{
+			p[i] = uint8_t(v >> (i * 8));
+		}
+	}
+
+	// Returns the string table index of the given string or -1 if it is new.
+	// New strings are added to the table.
+	int FindString(const char *k)
+	{
+		auto pindex = mPointerIndex.CheckKey(k);
+		if (pindex != nullptr && mStrings[*pindex].Compare(k) == 0)
+		{
+			return *pindex;
+		}
+		FString str = k;
+		auto sindex = mStringIndex.CheckKey(str);
+		if (sindex != nullptr)
+		{
+			mPointerIndex[k] = *sindex;
+			return *sindex;
+		}
+		unsigned index = mStrings.Push(str);
+		mStringIndex[str] = index;
+		mPointerIndex[k] = index;
+		return -1;
+	}
+
+	void WriteString(const char *k)
+	{
+		size_t len = strlen(k);
+		WriteVarint(len);
+		WriteBytes(k, len);
+	}
+
+public:
+	FBinaryWriter()
+	{
+		WriteBytes(BinaryMagic, sizeof(BinaryMagic));
+	}
+
+	const char *GetString() const
+	{
+		return (const char *)&mBuffer[0];
+	}
+
+	size_t GetSize() const
+	{
+		return mBuffer.Size();
+	}
+
+	void StartObject()
+	{
+		WriteByte(BIN_OBJECT);
+	}
+
+	void EndObject()
+	{
+		WriteVarint(0);
+	}
+
+	void StartArray()
+	{
+		WriteByte(BIN_ARRAY);
+	}
+
+	void EndArray()
+	{
+		WriteByte(BIN_END);
+	}
+
+	void Key(const char *k)
+	{
+		int index = FindString(k);
+		if (index < 0)
+		{
+			WriteVarint(1);
+			WriteString(k);
+		}
+		else
+		{
+			WriteVarint(uint64_t(index) + 2);
+		}
+	}
+
+	void Null()
+	{
+		WriteByte(BIN_NULL);
+	}
+
+	void String(const char *k)
+	{
+		int index = FindString(k);
+		if (index < 0)
+		{
+			WriteByte(BIN_STRING);
+			WriteString(k);
+		}
+		else
+		{
+			WriteByte(BIN_STRINGREF);
+			WriteVarint(index);
+		}
+	}
+
+	void Bool(bool k)
+	{
+		WriteByte(k ? BIN_TRUE : BIN_FALSE);
+	}
+
+	void Int64(int64_t k)
+	{
+		if (k >= 0)
+		{
+			WriteByte(BIN_UINT);
+			WriteVarint(uint64_t(k));
+		}
+		else
+		{
+			WriteByte(BIN_NEGINT);
+			WriteVarint(~uint64_t(k));
+		}
+	}
+
+	void Uint64(uint64_t k)
+	{
+		WriteByte(BIN_UINT);
+		WriteVarint(k);
+	}
+
+	void Double(double k)
+	{
+		float f = (float)k;
+		if (f == k)
+		{
+			uint32_t bits;
+			memcpy(&bits, &f, 4);
+			WriteByte(BIN_FLOAT);
+			WriteFixed(bits, 4);
+		}
+		else
+		{
+			uint64_t bits;
+			memcpy(&bits, &k, 8);
+			WriteByte(BIN_DOUBLE);
+			WriteFixed(bits, 8);
+		}
+	}
+};
+
+//==========================================================================
+//
+// Turns binary savegame data back into SAX events so that it can populate
+// the same document the JSON parser creates.
+//
+//==========================================================================
+
+class FBinaryReader
+{
+	struct FStringRef
+	{
+		const char *Chars;
+		unsigned Length;
+	};
+
+	const uint8_t *mPos;
+	const uint8_t *mEnd;
+	TArray<FStringRef> mStrings;
+
+	bool ReadVarint(uint64_t &v)
+	{
+		v = 0;
+		for (int shift = 0; shift < 64 && mPos < mEnd; shift += 7)
+		{
+			uint8_t b = *mPos++;
+			v |= uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) return true;
+		}
+		return false;
+	}
+
+	bool ReadFixed(uint64_t &v, int bytes)
+	{
+		if (mEnd - mPos < bytes) return false;
+		v = 0;
+		for (int i = 0; i < bytes; i++)
+		{
+			v |= uint64_t(mPos[i]) << (i * 8);
+		}
+		mPos += bytes;
+		return true;
+	}
+
+	bool ReadNewString(FStringRef &str)
+	{
+		uint64_t len;
+		if (!ReadVarint(len) || len > uint64_t(mEnd - mPos)) return false;
+		str.Chars = (const char *)mPos;
+		str.Length = (unsigned)len;
+		mPos += len;
+		mStrings.Push(str);
+		return true;
+	}
+
+	bool ReadStringRef(uint64_t index, FStringRef &str)
+	{
+		if (index >= mStrings.Size()) return false;
+		str = mStrings[(unsigned)index];
+		return true;
+	}
+
+	template<class Handler> bool ReadValue(Handler &h, uint8_t tag, int depth)
+	{
+		uint64_t v;
+		FStringRef str;
+
+		switch (tag)
+		{
+		case BIN_NULL:
+			return h.Null();
+
+		case BIN_FALSE:
+		case BIN_TRUE:
+			return h.Bool(tag == BIN_TRUE);
+
+		case BIN_UINT:
+			return ReadVarint(v) && h.Uint64(v);
+
+		case BIN_NEGINT:
+			return ReadVarint(v) && h.Int64(int64_t(~v));
+
+		case BIN_FLOAT:
+		{
+			if (!ReadFixed(v, 4)) return false;
+			uint32_t bits = uint32_t(v);
+			float f;
+			memcpy(&f, &bits, 4);
+			return h.Double(f);
+		}
+
+		case BIN_DOUBLE:
+		{
+			if (!ReadFixed(v, 8)) return false;
+			double d;
+			memcpy(&d, &v, 8);
+			return h.Double(d);
+		}
+
+		case BIN_STRING:
+			return ReadNewString(str) && h.String(str.Chars, str.Length, true);
+
+		case BIN_STRINGREF:
+			return ReadVarint(v) && ReadStringRef(v, str) && h.String(str.Chars, str.Length, true);
+
+		case BIN_OBJECT:
+		{
+			if (depth >= BINARY_MAX_DEPTH || !h.StartObject()) return false;
+			unsigned count = 0;
+			while (ReadVarint(v))
+			{
+				if (v == 0) return h.EndObject(count);
+				if (v == 1)
+				{
+					if (!ReadNewString(str)) return false;
+				}
+				else if (!ReadStringRef(v - 2, str)) return false;
+
+				if (!h.Key(str.Chars, str.Length, true) || mPos == mEnd) return false;
+				uint8_t valtag = *mPos++;
+				if (!ReadValue(h, valtag, depth + 1)) return false;
+				count++;
+			}
+			return false;
+		}
+
+		case BIN_ARRAY:
+		{
+			if (depth >= BINARY_MAX_DEPTH || !h.StartArray()) return false;
+			unsigned count = 0;
+			while (mPos < mEnd)
+			{
+				uint8_t valtag = *mPos++;
+				if (valtag == BIN_END) return h.EndArray(count);
+				if (!ReadValue(h, valtag, depth + 1)) return false;
+				count++;
+			}
+			return false;
+		}
+
+		default:
+			return false;
+		}
+	}
+
+public:
+	FBinaryReader(const char *buffer, size_t length)
+	{
+		mPos = (const uint8_t *)buffer + sizeof(BinaryMagic);
+		mEnd = (const uint8_t *)buffer + length;
+	}
+
+	// Generator interface for rapidjson::Document::Populate.
+	template<class Handler> bool operator()(Handler &h)
+	{
+		return mPos < mEnd && ReadValue(h, *mPos++, 0);
+	}
+};
+
 //==========================================================================
 //
 // some wrapper stuff to keep the RapidJSON dependencies out of the global headers.
@@ -243,21 +636,27 @@ struct FWriter
 
 	Writer *mWriter1;
 	PrettyWriter *mWriter2;
+	FBinaryWriter *mWriter3;
 	TArray<bool> mInObject;
 	rapidjson::StringBuffer mOutString;
 	TArray<DObject *> mDObjects;
 	TMap<DObject *, int> mObjectMap;
 	
-	FWriter(bool pretty)
+	FWriter(bool pretty, bool binary)
 	{
-		if (!pretty)
+		mWriter1 = nullptr;
+		mWriter2 = nullptr;
+		mWriter3 = nullptr;
+		if (binary)
+		{
+			mWriter3 = new FBinaryWriter;
+		}
+		else if (!pretty)
 		{
 			mWriter1 = new Writer(mOutString);
-			mWriter2 = nullptr;
 		}
 		else
 		{
-			mWriter1 = nullptr;
 			mWriter2 = new PrettyWriter(mOutString);
 		}
 	}
@@ -266,6 +665,18 @@ struct FWriter
 	{
 		if (mWriter1) delete mWriter1;
 		if (mWriter2) delete mWriter2;
+		if (mWriter3) delete mWriter3;
+	}
+
+	const char *GetOutput(size_t &len)
+	{
+		if (mWriter3)
+		{
+			len = mWriter3->GetSize();
+			return mWriter3->GetString();
+		}
+		len = mOutString.GetSize();
+		return mOutString.GetString();
 	}
 
 
@@ -278,36 +689,42 @@ struct FWriter
 	{
 		if (mWriter1) mWriter1->StartObject();
 		else if (mWriter2) mWriter2->StartObject();
+		else if (mWriter3) mWriter3->StartObject();
 	}
 
 	void EndObject()
 	{
 		if (mWriter1) mWriter1->EndObject();
 		else if (mWriter2) mWriter2->EndObject();
+		else if (mWriter3) mWriter3->EndObject();
 	}
 
 	void StartArray()
 	{
 		if (mWriter1) mWriter1->StartArray();
 		else if (mWriter2) mWriter2->StartArray();
+		else if (mWriter3) mWriter3->StartArray();
 	}
 
 	void EndArray()
 	{
 		if (mWriter1) mWriter1->EndArray();
 		else if (mWriter2) mWriter2->EndArray();
+		else if (mWriter3) mWriter3->EndArray();
 	}
 
 	void Key(const char *k)
 	{
 		if (mWriter1) mWriter1->Key(k);
 		else if (mWriter2) mWriter2->Key(k);
+		else if (mWriter3) mWriter3->Key(k);
 	}
 
 	void Null()
 	{
 		if (mWriter1) mWriter1->Null();
 		else if (mWriter2) mWriter2->Null();
+		else if (mWriter3) mWriter3->Null();
 	}
 
 	void String(const char *k)
@@ -315,6 +732,7 @@ struct FWriter
 		k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void String(const char *k, int size)
@@ -322,36 +740,42 @@ struct FWriter
 		k = StringToUnicode(k, size);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void Bool(bool k)
 	{
 		if (mWriter1) mWriter1->Bool(k);
 		else if (mWriter2) mWriter2->Bool(k);
+		else if (mWriter3) mWriter3->Bool(k);
 	}
 
 	void Int(int32_t k)
 	{
 		if (mWriter1) mWriter1->Int(k);
 		else if (mWriter2) mWriter2->Int(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Int64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Int64(k);
 		else if (mWriter2) mWriter2->Int64(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Uint(uint32_t k)
 	{
 		if (mWriter1) mWriter1->Uint(k);
 		else if (mWriter2) mWriter2->Uint(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Uint64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Uint64(k);
 		else if (mWriter2) mWriter2->Uint64(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Double(double k)
@@ -364,6 +788,10 @@ struct FWriter
 		{
 			mWriter2->Double(k);
 		}
+		else if (mWriter3)
+		{
+			mWriter3->Double(k);
+		}
 	}
 
 };
@@ -382,11 +810,20 @@ struct FReader
 	rapidjson::Value *mKeyValue = nullptr;
 	int mPlayers[MAXPLAYERS];
 	bool mObjectsRead = false;
+	bool mValid = true;
 
 	FReader(const char *buffer, size_t length)
 	{
-		rapidjson::Document doc;
-		mDoc.Parse(buffer, length);
+		if (IsBinarySave(buffer, length))
+		{
+			FBinaryReader binreader(buffer, length);
+			mDoc.Populate(binreader);
+			mValid = mDoc.IsObject();
+		}
+		else
+		{
+			mDoc.Parse(buffer, length);
+		}
 		mObjects.Push(FJSONObject(&mDoc));
 		memset(mPlayers, -1, sizeof(mPlayers));
 	}
@@ -432,11 +869,39 @@ bool FSerializer::OpenWriter(bool pretty)
 	if (w != nullptr || r != nullptr) return false;
 
 	mErrors = 0;
-	w = new FWriter(pretty);
+	w = new FWriter(pretty, false);
+	BeginObject(nullptr);
+	return true;
+}
+
+//==========================================================================
+//
+// Writes the same data as OpenWriter but in the binary format,
+// which OpenReader recognizes by itself.
+//
+//==========================================================================
+
+bool FSerializer::OpenBinaryWriter()
+{
+	if (w != nullptr || r != nullptr) return false;
+
+	mErrors = 0;
+	w = new FWriter(false, true);
 	BeginObject(nullptr);
 	return true;
 }
 
+//==========================================================================
+//
+// Writes the current level with the format selected by save_binary.
+//
+//==========================================================================
+
+bool FSerializer::OpenSaveWriter()
+{
+	return save_binary ? OpenBinaryWriter() : OpenWriter(save_formatted);
+}
+
 //==========================================================================
 //
 //
@@ -449,6 +914,12 @@ bool FSerializer::OpenReader(const char *buffer, size_t length)
 
 	mErrors = 0;
 	r = new FReader(buffer, length);
+	if (!r->mValid)
+	{
+		delete r;
+		r = nullptr;
+		return false;
+	}
 	return true;
 }
 
@@ -475,6 +946,12 @@ bool FSerializer::OpenReader(FCompressedBuffer *input)
 		r = new FReader(unpacked, input->mSize);
 		delete[] unpacked;
 	}
+	if (!r->mValid)
+	{
+		delete r;
+		r = nullptr;
+		return false;
+	}
 	return true;
 }
 
@@ -1088,11 +1565,13 @@ const char *FSerializer::GetOutput(unsigned *len)
 	if (isReading()) return nullptr;
 	WriteObjects();
 	EndObject();
+	size_t size;
+	const char *output = w->GetOutput(size);
 	if (len != nullptr)
 	{
-		*len = (unsigned)w->mOutString.GetSize();
+		*len = (unsigned)size;
 	}
-	return w->mOutString.GetString();
+	return output;
 }
 
 //==========================================================================
@@ -1104,19 +1583,60 @@ const char *FSerializer::GetOutput(unsigned *len)
 FCompressedBuffer FSerializer::GetCompressedOutput()
 {
 	if (isReading()) return{ 0,0,0,0,0,nullptr };
-	FCompressedBuffer buff;
 	WriteObjects();
 	EndObject();
-	buff.mSize = (unsigned)w->mOutString.GetSize();
+	size_t size;
+	const char *output = w->GetOutput(size);
+	return CompressBuffer(output, (unsigned)size);
+}
+
+//==========================================================================
+//
+// Returns the output without compressing it, so that this can be done
+// later by CompressBuffer, possibly on another thread.
+//
+//==========================================================================
+
+FCompressedBuffer FSerializer::GetStoredOutput()
+{
+	if (isReading()) return{ 0,0,0,0,0,nullptr };
+	WriteObjects();
+	EndObject();
+	size_t size;
+	const char *output = w->GetOutput(size);
+
+	FCompressedBuffer buff;
+	buff.mSize = buff.mCompressedSize = (unsigned)size;
+	buff.mMethod = METHOD_STORED;
+	buff.mZipFlags = 0;
+	buff.mCRC32 = crc32(0, (const Bytef*)output, buff.mSize);
+	buff.mBuffer = new char[size + 1];
+	memcpy(buff.mBuffer, output, size);
+	buff.mBuffer[size] = 0;
+	return buff;
+}
+
+//==========================================================================
+//
+// Compresses the given data in the form FCompressedBuffer needs.
+// This does not access any global state and is safe to call from
+// other threads.
+//
+//==========================================================================
+
+FCompressedBuffer FSerializer::CompressBuffer(const char *data, unsigned size)
+{
+	FCompressedBuffer buff;
+	buff.mSize = size;
 	buff.mZipFlags = 0;
-	buff.mCRC32 = crc32(0, (const Bytef*)w->mOutString.GetString(), buff.mSize);
+	buff.mCRC32 = crc32(0, (const Bytef*)data, buff.mSize);
 
 	uint8_t *compressbuf = new uint8_t[buff.mSize+1];
 
 	z_stream stream;
 	int err;
 
-	stream.next_in = (Bytef *)w->mOutString.GetString();
+	stream.next_in = (Bytef *)data;
 	stream.avail_in = buff.mSize;
 	stream.next_out = (Bytef*)compressbuf;
 	stream.avail_out = buff.mSize;
@@ -1150,9 +1670,10 @@ FCompressedBuffer FSerializer::GetCompressedOutput()
 	}
 
 error:
-	memcpy(compressbuf, w->mOutString.GetString(), buff.mSize + 1);
+	memcpy(compressbuf, data, buff.mSize);
 	buff.mCompressedSize = buff.mSize;
 	buff.mMethod = METHOD_STORED;
+	buff.mBuffer = (char*)compressbuf;
 	return buff;
 }
 
@@ -1647,6 +2168,7 @@ FSerializer &Serialize(FSerializer &arc, const char *key, DObject *&value, DObje
 					if (index >= 0 && index < (int)arc.r->mDObjects.Size())
 					{
 						value = arc.r->mDObjects[index];
+						GC::Remember(value);
 					}
 					else
 					{
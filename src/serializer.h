@@ -68,6 +68,8 @@ public:
 		Close();
 	}
 	bool OpenWriter(bool pretty = true);
+	bool OpenBinaryWriter();
+	bool OpenSaveWriter();
 	bool OpenReader(const char *buffer, size_t length);
 	bool OpenReader(FCompressedBuffer *input);
 	void Close();
@@ -80,6 +82,8 @@ public:
 	const char *GetKey();
 	const char *GetOutput(unsigned *len = nullptr);
 	FCompressedBuffer GetCompressedOutput();
+	FCompressedBuffer GetStoredOutput();
+	static FCompressedBuffer CompressBuffer(const char *data, unsigned size);
 	FSerializer &Args(const char *key, int *args, int *defargs, int special);
 	FSerializer &Terrain(const char *key, int &terrain, int *def = nullptr);
 	FSerializer &Sprite(const char *key, int32_t &spritenum, int32_t *def);
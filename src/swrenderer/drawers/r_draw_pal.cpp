@@ -38,7 +38,7 @@
 #endif
 
 #ifndef NO_SSE
-#include <xmmintrin.h>
+#include <emmintrin.h>
 #endif
 #include "templates.h"
 #include "doomtype.h"
@@ -53,6 +53,9 @@
 // [SP] r_blendmethod - false = rgb555 matching (ZDoom classic), true = rgb666 (refactored)
 CVAR(Bool, r_blendmethod, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
 
+// Draw the common spans and columns four pixels at a time
+CVAR(Bool, r_simdpaldrawers, true, 0)
+
 /*
 	[RH] This translucency algorithm is based on DOSDoom 0.65's, but uses
 	a 32k RGB table instead of an 8k one. At least on my machine, it's
@@ -96,6 +99,127 @@ CVAR(Bool, r_blendmethod, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
 
 namespace swrenderer
 {
+#ifndef NO_SSE
+	// Helpers for the r_simdpaldrawers paths. The table lookups stay scalar
+	// since SSE2 has no gather, but the texture coordinates and the RGB32k
+	// blend math are done for four pixels at once. Every step matches the
+	// scalar loops exactly, so both paths produce the same output.
+	namespace
+	{
+		enum class PalBlend { Opaque, Add, AddClamp, SubClamp, RevSubClamp };
+
+		// Turns the summed Col2RGB values of four pixels into RGB32k indices
+		template<PalBlend BlendT>
+		inline void BlendRGB32k4(const uint32_t *fg2rgb, const uint32_t *bg2rgb, const uint8_t *fg, const uint8_t *bg, uint8_t *out)
+		{
+			if (BlendT == PalBlend::Opaque)
+			{
+				for (int i = 0; i < 4; i++)
+					out[i] = fg[i];
+				return;
+			}
+
+			__m128i f = _mm_setr_epi32(fg2rgb[fg[0]], fg2rgb[fg[1]], fg2rgb[fg[2]], fg2rgb[fg[3]]);
+			__m128i b = _mm_setr_epi32(bg2rgb[bg[0]], bg2rgb[bg[1]], bg2rgb[bg[2]], bg2rgb[bg[3]]);
+			__m128i a;
+
+			if (BlendT == PalBlend::Add)
+			{
+				a = _mm_or_si128(_mm_add_epi32(f, b), _mm_set1_epi32(0x1f07c1f));
+			}
+			else if (BlendT == PalBlend::AddClamp)
+			{
+				a = _mm_add_epi32(f, b);
+				__m128i c = _mm_and_si128(a, _mm_set1_epi32(0x40100400));
+				a = _mm_and_si128(_mm_or_si128(a, _mm_set1_epi32(0x01f07c1f)), _mm_set1_epi32(0x3fffffff));
+				c = _mm_sub_epi32(c, _mm_srli_epi32(c, 5));
+				a = _mm_or_si128(a, c);
+			}
+			else
+			{
+				if (BlendT == PalBlend::SubClamp)
+					a = _mm_sub_epi32(_mm_or_si128(f, _mm_set1_epi32(0x40100400)), b);
+				else
+					a = _mm_sub_epi32(_mm_or_si128(b, _mm_set1_epi32(0x40100400)), f);
+				__m128i c = _mm_and_si128(a, _mm_set1_epi32(0x40100400));
+				c = _mm_sub_epi32(c, _mm_srli_epi32(c, 5));
+				a = _mm_or_si128(_mm_and_si128(a, c), _mm_set1_epi32(0x01f07c1f));
+			}
+
+			uint32_t index[4];
+			_mm_storeu_si128((__m128i*)index, _mm_and_si128(a, _mm_srli_epi32(a, 15)));
+			for (int i = 0; i < 4; i++)
+				out[i] = RGB32k.All[index[i]];
+		}
+
+		// Draws the column four rows at a time and leaves the remaining rows to the caller
+		template<PalBlend BlendT>
+		inline void DrawColumn4(uint8_t *&dest, int pitch, fixed_t &frac, fixed_t fracstep, int &count, const uint8_t *source, const uint8_t *colormap, const uint32_t *fg2rgb, const uint32_t *bg2rgb)
+		{
+			__m128i mfrac = _mm_setr_epi32(frac, frac + fracstep, frac + fracstep * 2, frac + fracstep * 3);
+			__m128i mstep = _mm_set1_epi32(fracstep * 4);
+
+			while (count >= 4)
+			{
+				uint32_t texel[4];
+				_mm_storeu_si128((__m128i*)texel, _mm_srai_epi32(mfrac, FRACBITS));
+				mfrac = _mm_add_epi32(mfrac, mstep);
+
+				uint8_t fg[4], bg[4], out[4];
+				for (int i = 0; i < 4; i++)
+				{
+					fg[i] = colormap[source[(int)texel[i]]];
+					if (BlendT != PalBlend::Opaque)
+						bg[i] = dest[i * pitch];
+				}
+
+				BlendRGB32k4<BlendT>(fg2rgb, bg2rgb, fg, bg, out);
+				for (int i = 0; i < 4; i++)
+					dest[i * pitch] = out[i];
+
+				dest += pitch * 4;
+				frac += fracstep * 4;
+				count -= 4;
+			}
+		}
+
+		// Draws the span four pixels at a time and leaves the remaining pixels to the caller
+		template<PalBlend BlendT>
+		inline void DrawSpan4(uint8_t *&dest, dsfixed_t &xfrac, dsfixed_t &yfrac, dsfixed_t xstep, dsfixed_t ystep, int xbits, int ybits, int &count, const uint8_t *source, const uint8_t *colormap, const uint32_t *fg2rgb, const uint32_t *bg2rgb)
+		{
+			__m128i xshift = _mm_cvtsi32_si128(32 - ybits - xbits);
+			__m128i yshift = _mm_cvtsi32_si128(32 - ybits);
+			__m128i xmask = _mm_set1_epi32(((1 << xbits) - 1) << ybits);
+			__m128i mxfrac = _mm_setr_epi32(xfrac, xfrac + xstep, xfrac + xstep * 2, xfrac + xstep * 3);
+			__m128i myfrac = _mm_setr_epi32(yfrac, yfrac + ystep, yfrac + ystep * 2, yfrac + ystep * 3);
+			__m128i mxstep = _mm_set1_epi32(xstep * 4);
+			__m128i mystep = _mm_set1_epi32(ystep * 4);
+
+			while (count >= 4)
+			{
+				uint32_t spot[4];
+				__m128i mspot = _mm_add_epi32(_mm_and_si128(_mm_srl_epi32(mxfrac, xshift), xmask), _mm_srl_epi32(myfrac, yshift));
+				_mm_storeu_si128((__m128i*)spot, mspot);
+				mxfrac = _mm_add_epi32(mxfrac, mxstep);
+				myfrac = _mm_add_epi32(myfrac, mystep);
+
+				uint8_t fg[4], out[4];
+				for (int i = 0; i < 4; i++)
+					fg[i] = colormap[source[spot[i]]];
+
+				BlendRGB32k4<BlendT>(fg2rgb, bg2rgb, fg, dest, out);
+				for (int i = 0; i < 4; i++)
+					dest[i] = out[i];
+
+				dest += 4;
+				xfrac += xstep * 4;
+				yfrac += ystep * 4;
+				count -= 4;
+			}
+		}
+	}
+#endif
+
 	PalWall1Command::PalWall1Command(const WallDrawerArgs &args) : args(args)
 	{
 	}
@@ -901,6 +1025,15 @@ namespace swrenderer
 		uint32_t dynlight = args.DynamicLight();
 		if (dynlight == 0)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers)
+			{
+				DrawColumn4<PalBlend::Opaque>(dest, pitch, frac, fracstep, count, source, colormap, nullptr, nullptr);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			do
 			{
 				*dest = colormap[source[frac >> FRACBITS]];
@@ -1220,6 +1353,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers)
+			{
+				DrawColumn4<PalBlend::Add>(dest, pitch, frac, fracstep, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			do
 			{
 				uint32_t fg = colormap[source[frac >> FRACBITS]];
@@ -1443,6 +1585,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers)
+			{
+				DrawColumn4<PalBlend::AddClamp>(dest, pitch, frac, fracstep, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			do
 			{
 				uint32_t a = fg2rgb[colormap[source[frac >> FRACBITS]]] + bg2rgb[*dest];
@@ -1572,6 +1723,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers)
+			{
+				DrawColumn4<PalBlend::SubClamp>(dest, pitch, frac, fracstep, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			do
 			{
 				uint32_t a = (fg2rgb[colormap[source[frac >> FRACBITS]]] | 0x40100400) - bg2rgb[*dest];
@@ -1699,6 +1859,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers)
+			{
+				DrawColumn4<PalBlend::RevSubClamp>(dest, pitch, frac, fracstep, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			do
 			{
 				uint32_t a = (bg2rgb[*dest] | 0x40100400) - fg2rgb[colormap[source[frac >> FRACBITS]]];
@@ -1992,6 +2161,15 @@ namespace swrenderer
 		float viewpos_x = _viewpos_x;
 		float step_viewpos_x = _step_viewpos_x;
 
+#ifndef NO_SSE
+		if (r_simdpaldrawers && num_dynlights == 0)
+		{
+			DrawSpan4<PalBlend::Opaque>(dest, xfrac, yfrac, xstep, ystep, _xbits, _ybits, count, source, colormap, nullptr, nullptr);
+			if (count == 0)
+				return;
+		}
+#endif
+
 		if (_xbits == 6 && _ybits == 6 && num_dynlights == 0)
 		{
 			// 64x64 is the most common case by far, so special case it.
@@ -2158,6 +2336,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers && num_dynlights == 0)
+			{
+				DrawSpan4<PalBlend::Add>(dest, xfrac, yfrac, xstep, ystep, _xbits, _ybits, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			if (_xbits == 6 && _ybits == 6)
 			{
 				// 64x64 is the most common case by far, so special case it.
@@ -2415,6 +2602,15 @@ namespace swrenderer
 
 		if (!r_blendmethod)
 		{
+#ifndef NO_SSE
+			if (r_simdpaldrawers && num_dynlights == 0)
+			{
+				DrawSpan4<PalBlend::AddClamp>(dest, xfrac, yfrac, xstep, ystep, _xbits, _ybits, count, source, colormap, fg2rgb, bg2rgb);
+				if (count == 0)
+					return;
+			}
+#endif
+
 			if (_xbits == 6 && _ybits == 6)
 			{
 				// 64x64 is the most common case by far, so special case it.
@@ -16,6 +16,7 @@ namespace swrenderer
 	public:
 		PalWall1Command(const WallDrawerArgs &args);
 		FString DebugInfo() override { return "PalWallCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 
 	protected:
 		inline static uint8_t AddLights(const DrawerLight *lights, int num_lights, float viewpos_z, uint8_t fg, uint8_t material);
@@ -35,6 +36,7 @@ namespace swrenderer
 	public:
 		PalSkyCommand(const SkyDrawerArgs &args);
 		FString DebugInfo() override { return "PalSkyCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 
 	protected:
 		SkyDrawerArgs args;
@@ -48,6 +50,7 @@ namespace swrenderer
 	public:
 		PalColumnCommand(const SpriteDrawerArgs &args);
 		FString DebugInfo() override { return "PalColumnCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 
 	protected:
 		uint8_t AddLights(uint8_t fg, uint8_t material, uint32_t lit_r, uint32_t lit_g, uint32_t lit_b);
@@ -78,6 +81,8 @@ namespace swrenderer
 		DrawFuzzColumnPalCommand(const SpriteDrawerArgs &args);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override { return "DrawFuzzColumnPalCommand"; }
+		// The fuzz effect reads the rows above and below, which another tile may be drawing.
+		bool GetRowRange(int &y1, int &y2) override { return false; }
 
 	private:
 		int _yl;
@@ -93,6 +98,7 @@ namespace swrenderer
 	public:
 		PalSpanCommand(const SpanDrawerArgs &args);
 		FString DebugInfo() override { return "PalSpanCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y; y2 = _y + 1; return true; }
 
 	protected:
 		inline static uint8_t AddLights(const DrawerLight *lights, int num_lights, float viewpos_x, uint8_t fg, uint8_t material);
@@ -134,6 +140,7 @@ namespace swrenderer
 		DrawTiltedSpanPalCommand(const SpanDrawerArgs &args, int y, int x1, int x2, const FVector3 &plane_sz, const FVector3 &plane_su, const FVector3 &plane_sv, bool plane_shade, int planeshade, float planelightfloat, fixed_t pviewx, fixed_t pviewy, FDynamicColormap *basecolormap);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override { return "DrawTiltedSpanPalCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = y; y2 = y + 1; return true; }
 
 	private:
 		void CalcTiltedLighting(double lval, double lend, int width, DrawerThread *thread);
@@ -164,6 +171,7 @@ namespace swrenderer
 		DrawColoredSpanPalCommand(const SpanDrawerArgs &args, int y, int x1, int x2);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override { return "DrawColoredSpanPalCommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = y; y2 = y + 1; return true; }
 
 	private:
 		int y;
@@ -178,6 +186,7 @@ namespace swrenderer
 	public:
 		DrawFogBoundaryLinePalCommand(const SpanDrawerArgs &args, int y, int x1, int x2);
 		void Execute(DrawerThread *thread) override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = y; y2 = y + 1; return true; }
 
 	private:
 		int y, x1, x2;
@@ -191,6 +200,7 @@ namespace swrenderer
 		DrawParticleColumnPalCommand(uint8_t *dest, int dest_y, int pitch, int count, uint32_t fg, uint32_t alpha, uint32_t fracposx);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _dest_y; y2 = _dest_y + _count; return true; }
 
 	private:
 		uint8_t *_dest;
@@ -88,6 +88,8 @@ namespace swrenderer
 		DrawFuzzColumnRGBACommand(const SpriteDrawerArgs &drawerargs);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		// The fuzz effect reads the rows above and below, which another tile may be drawing.
+		bool GetRowRange(int &y1, int &y2) override { return false; }
 	};
 
 	class FillSpanRGBACommand : public DrawerCommand
@@ -103,6 +105,7 @@ namespace swrenderer
 		FillSpanRGBACommand(const SpanDrawerArgs &drawerargs);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y; y2 = _y + 1; return true; }
 	};
 
 	class DrawFogBoundaryLineRGBACommand : public DrawerCommand
@@ -118,6 +121,7 @@ namespace swrenderer
 		DrawFogBoundaryLineRGBACommand(const SpanDrawerArgs &drawerargs, int y, int x, int x2);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y; y2 = _y + 1; return true; }
 	};
 
 	class DrawTiltedSpanRGBACommand : public DrawerCommand
@@ -144,6 +148,7 @@ namespace swrenderer
 		DrawTiltedSpanRGBACommand(const SpanDrawerArgs &drawerargs, int y, int x1, int x2, const FVector3 &plane_sz, const FVector3 &plane_su, const FVector3 &plane_sv, bool plane_shade, int planeshade, float planelightfloat, fixed_t pviewx, fixed_t pviewy);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y; y2 = _y + 1; return true; }
 	};
 
 	class DrawColoredSpanRGBACommand : public DrawerCommand
@@ -160,6 +165,7 @@ namespace swrenderer
 
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y; y2 = _y + 1; return true; }
 	};
 
 	class FillTransColumnRGBACommand : public DrawerCommand
@@ -177,6 +183,7 @@ namespace swrenderer
 		FillTransColumnRGBACommand(const DrawerArgs &drawerargs, int x, int y1, int y2, int color, int a);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _y1; y2 = _y2 + 1; return true; }
 	};
 
 	class ApplySpecialColormapRGBACommand : public DrawerCommand
@@ -196,6 +203,7 @@ namespace swrenderer
 		ApplySpecialColormapRGBACommand(FSpecialColormap *colormap, DFrameBuffer *screen);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override { return "ApplySpecialColormapRGBACommand"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = 0; y2 = height; return true; }
 	};
 
 	template<typename CommandType, typename BlendMode>
@@ -222,6 +230,7 @@ namespace swrenderer
 		DrawParticleColumnRGBACommand(uint32_t *dest, int dest_y, int pitch, int count, uint32_t fg, uint32_t alpha, uint32_t fracposx);
 		void Execute(DrawerThread *thread) override;
 		FString DebugInfo() override;
+		bool GetRowRange(int &y1, int &y2) override { y1 = _dest_y; y2 = _dest_y + _count; return true; }
 
 	private:
 		uint32_t *_dest;
@@ -280,6 +289,10 @@ namespace swrenderer
 
 		void DrawColoredSpan(const SpanDrawerArgs &args, int y, int x1, int x2) override { Queue->Push<DrawColoredSpanRGBACommand>(args, y, x1, x2); }
 		void DrawFogBoundaryLine(const SpanDrawerArgs &args, int y, int x1, int x2) override { Queue->Push<DrawFogBoundaryLineRGBACommand>(args, y, x1, x2); }
+
+		// Drawers using AVX2 for the wall, sprite, span and sky commands.
+		// Returns null if the CPU does not support it or if they were not compiled in.
+		static std::unique_ptr<SWTruecolorDrawers> CreateAVX2(DrawerCommandQueuePtr queue);
 	};
 
 	/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,124 @@
+/*
+**  AVX2 versions of the truecolor drawers
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+// This file is compiled for the baseline CPU. Only the AVX2 drawer
+// headers are compiled with AVX2 enabled, by wrapping them in a target
+// pragma. Everything they depend on has to be included before that, so
+// that inline functions and templates shared with other files don't get
+// instantiated with AVX2 instructions. Nothing in the AVX2 part may run
+// before CreateAVX2 has checked that the CPU supports it.
+
+#include <stddef.h>
+
+#include "templates.h"
+#include "doomdef.h"
+#include "r_draw_rgba.h"
+#include "swrenderer/viewport/r_viewport.h"
+#include "x86.h"
+
+#if !defined(NO_SSE) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+
+#include "r_draw_wall32_sse2.h"
+#include "r_draw_sprite32_sse2.h"
+#include "r_draw_span32_sse2.h"
+#include "r_draw_sky32_sse2.h"
+#include "swrenderer/viewport/r_walldrawer.h"
+#include "swrenderer/viewport/r_skydrawer.h"
+
+// MSVC allows the AVX2 intrinsics anywhere, without /arch:AVX2.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "r_draw_wall32_avx2.h"
+#include "r_draw_sprite32_avx2.h"
+#include "r_draw_span32_avx2.h"
+#include "r_draw_sky32_avx2.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+namespace swrenderer
+{
+	class SWTruecolorDrawersAVX2 : public SWTruecolorDrawers
+	{
+	public:
+		using SWTruecolorDrawers::SWTruecolorDrawers;
+
+		void DrawWallColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWall32AVX2Command>(args); }
+		void DrawWallMaskedColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWallMasked32AVX2Command>(args); }
+		void DrawWallAddColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWallAddClamp32AVX2Command>(args); }
+		void DrawWallAddClampColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWallAddClamp32AVX2Command>(args); }
+		void DrawWallSubClampColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWallSubClamp32AVX2Command>(args); }
+		void DrawWallRevSubClampColumn(const WallDrawerArgs &args) override { Queue->Push<DrawWallRevSubClamp32AVX2Command>(args); }
+		void DrawSingleSkyColumn(const SkyDrawerArgs &args) override { Queue->Push<DrawSkySingle32AVX2Command>(args); }
+		void DrawDoubleSkyColumn(const SkyDrawerArgs &args) override { Queue->Push<DrawSkyDouble32AVX2Command>(args); }
+		void DrawColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSprite32AVX2Command>(args); }
+		void FillColumn(const SpriteDrawerArgs &args) override { Queue->Push<FillSprite32AVX2Command>(args); }
+		void FillAddColumn(const SpriteDrawerArgs &args) override { Queue->Push<FillSpriteAddClamp32AVX2Command>(args); }
+		void FillAddClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<FillSpriteAddClamp32AVX2Command>(args); }
+		void FillSubClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<FillSpriteSubClamp32AVX2Command>(args); }
+		void FillRevSubClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<FillSpriteRevSubClamp32AVX2Command>(args); }
+		void DrawAddColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteAddClamp32AVX2Command>(args); }
+		void DrawTranslatedColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteTranslated32AVX2Command>(args); }
+		void DrawTranslatedAddColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteTranslatedAddClamp32AVX2Command>(args); }
+		void DrawShadedColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteShaded32AVX2Command>(args); }
+		void DrawAddClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteAddClamp32AVX2Command>(args); }
+		void DrawAddClampTranslatedColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteTranslatedAddClamp32AVX2Command>(args); }
+		void DrawSubClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteSubClamp32AVX2Command>(args); }
+		void DrawSubClampTranslatedColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteTranslatedSubClamp32AVX2Command>(args); }
+		void DrawRevSubClampColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteRevSubClamp32AVX2Command>(args); }
+		void DrawRevSubClampTranslatedColumn(const SpriteDrawerArgs &args) override { Queue->Push<DrawSpriteTranslatedRevSubClamp32AVX2Command>(args); }
+
+		// Same mapping as SWTruecolorDrawers
+		void DrawSpan(const SpanDrawerArgs &args) override { Queue->Push<DrawSpan32AVX2Command>(args); }
+		void DrawSpanMasked(const SpanDrawerArgs &args) override { Queue->Push<DrawSpanMasked32AVX2Command>(args); }
+		void DrawSpanTranslucent(const SpanDrawerArgs &args) override { Queue->Push<DrawSpanTranslucent32AVX2Command>(args); }
+		void DrawSpanMaskedTranslucent(const SpanDrawerArgs &args) override { Queue->Push<DrawSpanAddClamp32AVX2Command>(args); }
+		void DrawSpanAddClamp(const SpanDrawerArgs &args) override { Queue->Push<DrawSpanTranslucent32AVX2Command>(args); }
+		void DrawSpanMaskedAddClamp(const SpanDrawerArgs &args) override { Queue->Push<DrawSpanAddClamp32AVX2Command>(args); }
+	};
+
+	std::unique_ptr<SWTruecolorDrawers> SWTruecolorDrawers::CreateAVX2(DrawerCommandQueuePtr queue)
+	{
+		if (!CPU.bAVX2)
+			return nullptr;
+		return std::make_unique<SWTruecolorDrawersAVX2>(queue);
+	}
+}
+
+#else
+
+namespace swrenderer
+{
+	std::unique_ptr<SWTruecolorDrawers> SWTruecolorDrawers::CreateAVX2(DrawerCommandQueuePtr queue)
+	{
+		return nullptr;
+	}
+}
+
+#endif
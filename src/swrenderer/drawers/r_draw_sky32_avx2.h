@@ -0,0 +1,201 @@
+/*
+**  AVX2 drawer commands for the sky
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw32_avx2.h"
+#include "swrenderer/viewport/r_skydrawer.h"
+
+namespace swrenderer
+{
+	namespace DrawSky32AVX2TModes
+	{
+		enum class SkyModes { Single, Double };
+		struct SingleSky { static const int Mode = (int)SkyModes::Single; };
+		struct DoubleSky { static const int Mode = (int)SkyModes::Double; };
+	}
+
+	// Same as DrawSkySingle32Command and DrawSkyDouble32Command, but the fades are blended four rows at a time
+	template<typename SkyT>
+	class DrawSky32AVX2T : public DrawerCommand
+	{
+	protected:
+		SkyDrawerArgs args;
+
+	public:
+		DrawSky32AVX2T(const SkyDrawerArgs &args) : args(args) { }
+
+		void Execute(DrawerThread *thread) override
+		{
+			uint32_t *dest = (uint32_t *)args.Dest();
+			int count = args.Count();
+			int pitch = RenderViewport::Instance()->RenderTarget->GetPitch();
+			const uint32_t *source0 = (const uint32_t *)args.FrontTexturePixels();
+			const uint32_t *source1 = (const uint32_t *)args.BackTexturePixels();
+			int textureheight0 = args.FrontTextureHeight();
+			uint32_t maxtextureheight1 = SkyT::Mode == (int)DrawSky32AVX2TModes::SkyModes::Double ? args.BackTextureHeight() - 1 : 0;
+
+			int32_t frac = args.TextureVPos();
+			int32_t fracstep = args.TextureVStep();
+
+			uint32_t solid_top = args.SolidTopColor();
+			uint32_t solid_bottom = args.SolidBottomColor();
+			bool fadeSky = args.FadeSky();
+
+			// Find bands for top solid color, top fade, center textured, bottom fade, bottom solid color:
+			int start_fade = 2; // How fast it should fade out
+			int fade_length = (1 << (24 - start_fade));
+			int start_fadetop_y = (-frac) / fracstep;
+			int end_fadetop_y = (fade_length - frac) / fracstep;
+			int start_fadebottom_y = ((2 << 24) - fade_length - frac) / fracstep;
+			int end_fadebottom_y = ((2 << 24) - frac) / fracstep;
+			start_fadetop_y = clamp(start_fadetop_y, 0, count);
+			end_fadetop_y = clamp(end_fadetop_y, 0, count);
+			start_fadebottom_y = clamp(start_fadebottom_y, 0, count);
+			end_fadebottom_y = clamp(end_fadebottom_y, 0, count);
+
+			int num_cores = thread->num_cores;
+			int skipped = thread->skipped_by_thread(args.DestY());
+			dest = thread->dest_for_thread(args.DestY(), pitch, dest);
+			frac += fracstep * skipped;
+			fracstep *= num_cores;
+			pitch *= num_cores;
+
+			if (!fadeSky)
+			{
+				count = thread->count_for_thread(args.DestY(), count);
+
+				for (int index = 0; index < count; index++)
+				{
+					*dest = Sample(frac, source0, source1, textureheight0, maxtextureheight1);
+					dest += pitch;
+					frac += fracstep;
+				}
+
+				return;
+			}
+
+			// The SSE2 version blends the bottom fade with the top color as well
+			__m256i solid_top_fill = AVX2::SpreadColor(solid_top);
+
+			int index = skipped;
+
+			// Top solid color:
+			while (index < start_fadetop_y)
+			{
+				*dest = solid_top;
+				dest += pitch;
+				frac += fracstep;
+				index += num_cores;
+			}
+
+			// Top fade:
+			while (index < end_fadetop_y)
+			{
+				uint32_t fg[4] = { 0, 0, 0, 0 };
+				uint32_t alpha[4] = { 0, 0, 0, 0 };
+				int n = 0;
+				while (n < 4 && index < end_fadetop_y)
+				{
+					fg[n] = Sample(frac, source0, source1, textureheight0, maxtextureheight1);
+					alpha[n] = MAX(MIN(frac >> (16 - start_fade), 256), 0);
+					frac += fracstep;
+					index += num_cores;
+					n++;
+				}
+
+				dest = Fade(dest, pitch, n, fg, alpha, solid_top_fill);
+			}
+
+			// Textured center:
+			while (index < start_fadebottom_y)
+			{
+				*dest = Sample(frac, source0, source1, textureheight0, maxtextureheight1);
+
+				frac += fracstep;
+				dest += pitch;
+				index += num_cores;
+			}
+
+			// Fade bottom:
+			while (index < end_fadebottom_y)
+			{
+				uint32_t fg[4] = { 0, 0, 0, 0 };
+				uint32_t alpha[4] = { 0, 0, 0, 0 };
+				int n = 0;
+				while (n < 4 && index < end_fadebottom_y)
+				{
+					fg[n] = Sample(frac, source0, source1, textureheight0, maxtextureheight1);
+					alpha[n] = MAX(MIN(((2 << 24) - frac) >> (16 - start_fade), 256), 0);
+					frac += fracstep;
+					index += num_cores;
+					n++;
+				}
+
+				dest = Fade(dest, pitch, n, fg, alpha, solid_top_fill);
+			}
+
+			// Bottom solid color:
+			while (index < count)
+			{
+				*dest = solid_bottom;
+				dest += pitch;
+				index += num_cores;
+			}
+		}
+
+		FORCEINLINE uint32_t Sample(int32_t frac, const uint32_t *source0, const uint32_t *source1, int textureheight0, uint32_t maxtextureheight1)
+		{
+			uint32_t sample_index = (((((uint32_t)frac) << 8) >> FRACBITS) * textureheight0) >> FRACBITS;
+			uint32_t fg = source0[sample_index];
+			if (SkyT::Mode == (int)DrawSky32AVX2TModes::SkyModes::Double && fg == 0)
+			{
+				uint32_t sample_index2 = MIN(sample_index, maxtextureheight1);
+				fg = source1[sample_index2];
+			}
+			return fg;
+		}
+
+		FORCEINLINE uint32_t *VECTORCALL Fade(uint32_t *dest, int pitch, int n, const uint32_t *fg, const uint32_t *alpha, __m256i fill)
+		{
+			__m256i malpha = AVX2::PerPixel(alpha);
+			__m256i inv_alpha = _mm256_sub_epi16(_mm256_set1_epi16(256), malpha);
+
+			__m256i c = AVX2::Unpack(fg);
+			c = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c, malpha), _mm256_mullo_epi16(fill, inv_alpha)), 8);
+
+			uint32_t outcolor[4];
+			_mm_storeu_si128((__m128i*)outcolor, AVX2::Pack(c));
+			for (int i = 0; i < n; i++)
+			{
+				*dest = outcolor[i];
+				dest += pitch;
+			}
+			return dest;
+		}
+
+		FString DebugInfo() override { return "DrawSky32AVX2T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
+	};
+
+	typedef DrawSky32AVX2T<DrawSky32AVX2TModes::SingleSky> DrawSkySingle32AVX2Command;
+	typedef DrawSky32AVX2T<DrawSky32AVX2TModes::DoubleSky> DrawSkyDouble32AVX2Command;
+}
@@ -155,6 +155,7 @@ namespace swrenderer
 		}
 		
 		FString DebugInfo() override { return "DrawSkySingle32Command"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 	};
 	
 	class DrawSkyDouble32Command : public DrawerCommand
@@ -310,5 +311,6 @@ namespace swrenderer
 		}
 		
 		FString DebugInfo() override { return "DrawSkyDouble32Command"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 	};
 }
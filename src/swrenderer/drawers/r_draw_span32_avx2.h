@@ -0,0 +1,378 @@
+/*
+**  AVX2 drawer commands for spans
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw32_avx2.h"
+#include "swrenderer/drawers/r_draw_span32_sse2.h"
+
+namespace swrenderer
+{
+	// Four pixel version of DrawSpan32T
+	template<typename BlendT>
+	class DrawSpan32AVX2T : public DrawerCommand
+	{
+	protected:
+		SpanDrawerArgs args;
+
+	public:
+		DrawSpan32AVX2T(const SpanDrawerArgs &drawerargs) : args(drawerargs) { }
+
+		struct TextureData
+		{
+			uint32_t xbits;
+			uint32_t ybits;
+			uint32_t xstep;
+			uint32_t ystep;
+			uint32_t xfrac;
+			uint32_t yfrac;
+			uint32_t yshift;
+			uint32_t xshift;
+			uint32_t xmask;
+			const uint32_t *source;
+		};
+
+		void Execute(DrawerThread *thread) override
+		{
+			using namespace DrawSpan32TModes;
+
+			if (thread->line_skipped_by_thread(args.DestY())) return;
+			
+			TextureData texdata;
+			texdata.xbits = args.TextureWidthBits();
+			texdata.ybits = args.TextureHeightBits();
+			texdata.xstep = args.TextureUStep();
+			texdata.ystep = args.TextureVStep();
+			texdata.xfrac = args.TextureUPos();
+			texdata.yfrac = args.TextureVPos();
+			texdata.yshift = 32 - texdata.ybits;
+			texdata.xshift = texdata.yshift - texdata.xbits;
+			texdata.xmask = ((1 << texdata.xbits) - 1) << texdata.ybits;
+			
+			texdata.source = (const uint32_t*)args.TexturePixels();
+			
+			double lod = args.TextureLOD();
+			bool mipmapped = args.MipmappedTexture();
+			
+			bool magnifying = lod < 0.0;
+			if (r_mipmap && mipmapped)
+			{
+				int level = (int)lod;
+				while (level > 0)
+				{
+					if (texdata.xbits <= 2 || texdata.ybits <= 2)
+						break;
+
+					texdata.source += (1 << (texdata.xbits)) * (1 << (texdata.ybits));
+					texdata.xbits -= 1;
+					texdata.ybits -= 1;
+					level--;
+				}
+			}
+
+			bool is_nearest_filter = !((magnifying && r_magfilter) || (!magnifying && r_minfilter));
+			bool is_64x64 = texdata.xbits == 6 && texdata.ybits == 6;
+			
+			auto shade_constants = args.ColormapConstants();
+			if (shade_constants.simple_shade)
+			{
+				if (is_nearest_filter)
+				{
+					if (is_64x64)
+						Loop<SimpleShade, NearestFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<SimpleShade, NearestFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+				else
+				{
+					if (is_64x64)
+						Loop<SimpleShade, LinearFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<SimpleShade, LinearFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+			}
+			else
+			{
+				if (is_nearest_filter)
+				{
+					if (is_64x64)
+						Loop<AdvancedShade, NearestFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<AdvancedShade, NearestFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+				else
+				{
+					if (is_64x64)
+						Loop<AdvancedShade, LinearFilter, TextureSize64x64>(thread, texdata, shade_constants);
+					else
+						Loop<AdvancedShade, LinearFilter, TextureSizeAny>(thread, texdata, shade_constants);
+				}
+			}
+		}
+
+		template<typename ShadeModeT, typename FilterModeT, typename TextureSizeT>
+		FORCEINLINE void VECTORCALL Loop(DrawerThread *thread, TextureData texdata, ShadeConstants shade_constants)
+		{
+			using namespace DrawSpan32TModes;
+
+			// Shade constants
+			int light = 256 - (args.Light() >> (FRACBITS - 8));
+			__m256i mlight = _mm256_broadcastsi128_si256(_mm_set_epi16(256, light, light, light, 256, light, light, light));
+			__m128i inv_light = _mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light);
+
+			__m256i inv_desaturate, shade_fade, shade_light;
+			int desaturate;
+			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			{
+				inv_desaturate = _mm256_broadcastsi128_si256(_mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate));
+				__m128i fade = _mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue);
+				shade_fade = _mm256_broadcastsi128_si256(_mm_mullo_epi16(fade, inv_light));
+				shade_light = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue));
+				desaturate = shade_constants.desaturate;
+			}
+			else
+			{
+				inv_desaturate = _mm256_setzero_si256();
+				shade_fade = _mm256_setzero_si256();
+				shade_light = _mm256_setzero_si256();
+				desaturate = 0;
+			}
+
+			auto lights = args.dc_lights;
+			auto num_lights = args.dc_num_lights;
+			float vpx = args.dc_viewpos.X;
+			float stepvpx = args.dc_viewpos_step.X;
+			__m128 viewpos_x = _mm_setr_ps(vpx, vpx + stepvpx, 0.0f, 0.0f);
+			__m128 step_viewpos_x = _mm_set1_ps(stepvpx * 2.0f);
+
+			int count = args.DestX2() - args.DestX1() + 1;
+			uint32_t *dest = (uint32_t*)RenderViewport::Instance()->GetDest(args.DestX1(), args.DestY());
+
+			if (FilterModeT::Mode == (int)FilterModes::Linear)
+			{
+				texdata.xfrac -= 1 << (31 - texdata.xbits);
+				texdata.yfrac -= 1 << (31 - texdata.ybits);
+			}
+
+			uint32_t srcalpha = args.SrcAlpha() >> (FRACBITS - 8);
+			uint32_t destalpha = args.DestAlpha() >> (FRACBITS - 8);
+
+			for (int index = 0; index < count; index += 4)
+			{
+				int n = MIN(count - index, 4);
+
+				uint32_t desttmp[4] = { 0, 0, 0, 0 };
+				uint32_t ifgcolor[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < n; i++)
+				{
+					if (BlendT::Mode != (int)SpanBlendModes::Opaque)
+						desttmp[i] = dest[index + i];
+
+					ifgcolor[i] = Sample<FilterModeT, TextureSizeT>(texdata.xbits, texdata.ybits, texdata.xstep, texdata.ystep, texdata.xfrac, texdata.yfrac, texdata.yshift, texdata.xshift, texdata.xmask, texdata.source);
+					texdata.xfrac += texdata.xstep;
+					texdata.yfrac += texdata.ystep;
+				}
+
+				__m256i bgcolor = AVX2::Unpack(desttmp);
+				__m256i fgcolor = AVX2::Unpack(ifgcolor);
+				__m128 viewpos = AVX2::NextViewpos(viewpos_x, step_viewpos_x);
+
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor, desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos);
+				__m128i outcolor = Blend(fgcolor, bgcolor, srcalpha, destalpha, ifgcolor);
+
+				if (n == 4)
+				{
+					_mm_storeu_si128((__m128i*)(dest + index), outcolor);
+				}
+				else
+				{
+					_mm_storeu_si128((__m128i*)desttmp, outcolor);
+					for (int i = 0; i < n; i++)
+						dest[index + i] = desttmp[i];
+				}
+			}
+		}
+
+		template<typename FilterModeT, typename TextureSizeT>
+		FORCEINLINE unsigned int VECTORCALL Sample(uint32_t xbits, uint32_t ybits, uint32_t xstep, uint32_t ystep, uint32_t xfrac, uint32_t yfrac, uint32_t yshift, uint32_t xshift, uint32_t xmask, const uint32_t *source)
+		{
+			using namespace DrawSpan32TModes;
+
+			if (FilterModeT::Mode == (int)FilterModes::Nearest && TextureSizeT::Mode == (int)SpanTextureSize::Size64x64)
+			{
+				int sample_index = ((xfrac >> (32 - 6 - 6)) & (63 * 64)) + (yfrac >> (32 - 6));
+				return source[sample_index];
+			}
+			else if (FilterModeT::Mode == (int)FilterModes::Nearest)
+			{
+				int sample_index = ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+				return source[sample_index];
+			}
+			else
+			{
+				uint32_t xxbits, yybits;
+				if (TextureSizeT::Mode == (int)SpanTextureSize::Size64x64)
+				{
+					xxbits = 26;
+					yybits = 26;
+				}
+				else
+				{
+					xxbits = 32 - xbits;
+					yybits = 32 - ybits;
+				}
+
+				uint32_t xxshift = (32 - xxbits);
+				uint32_t yyshift = (32 - yybits);
+				uint32_t xxmask = (1 << xxshift) - 1;
+				uint32_t yymask = (1 << yyshift) - 1;
+				uint32_t x = xfrac >> xxbits;
+				uint32_t y = yfrac >> yybits;
+
+				uint32_t p00 = source[((y & yymask) + ((x & xxmask) << yyshift))];
+				uint32_t p01 = source[(((y + 1) & yymask) + ((x & xxmask) << yyshift))];
+				uint32_t p10 = source[((y & yymask) + (((x + 1) & xxmask) << yyshift))];
+				uint32_t p11 = source[(((y + 1) & yymask) + (((x + 1) & xxmask) << yyshift))];
+
+				uint32_t inv_b = (xfrac >> (xxbits - 4)) & 15;
+				uint32_t inv_a = (yfrac >> (yybits - 4)) & 15;
+				uint32_t a = 16 - inv_a;
+				uint32_t b = 16 - inv_b;
+
+				uint32_t sred = (RPART(p00) * (a * b) + RPART(p01) * (inv_a * b) + RPART(p10) * (a * inv_b) + RPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				uint32_t sgreen = (GPART(p00) * (a * b) + GPART(p01) * (inv_a * b) + GPART(p10) * (a * inv_b) + GPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				uint32_t sblue = (BPART(p00) * (a * b) + BPART(p01) * (inv_a * b) + BPART(p10) * (a * inv_b) + BPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				uint32_t salpha = (APART(p00) * (a * b) + APART(p01) * (inv_a * b) + APART(p10) * (a * inv_b) + APART(p11) * (inv_a * inv_b) + 127) >> 8;
+
+				return (salpha << 24) | (sred << 16) | (sgreen << 8) | sblue;
+			}
+		}
+
+		template<typename ShadeModeT>
+		FORCEINLINE __m256i VECTORCALL Shade(__m256i fgcolor, __m256i mlight, const uint32_t *ifgcolor, int desaturate, __m256i inv_desaturate, __m256i shade_fade, __m256i shade_light, const DrawerLight *lights, int num_lights, __m128 viewpos_x)
+		{
+			using namespace DrawSpan32TModes;
+
+			__m256i material = fgcolor;
+			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
+			{
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, mlight), 8);
+			}
+			else
+			{
+				__m256i intensity = AVX2::Intensity(ifgcolor, desaturate);
+
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(fgcolor, inv_desaturate), intensity), 8);
+				fgcolor = _mm256_mullo_epi16(fgcolor, mlight);
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(shade_fade, fgcolor), 8);
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, shade_light), 8);
+			}
+
+			return AddLights(material, fgcolor, lights, num_lights, viewpos_x);
+		}
+
+		FORCEINLINE __m256i VECTORCALL AddLights(__m256i material, __m256i fgcolor, const DrawerLight *lights, int num_lights, __m128 viewpos_x)
+		{
+			__m256i lit = _mm256_setzero_si256();
+
+			for (int i = 0; i != num_lights; i++)
+			{
+				__m128 light_x = _mm_set1_ps(lights[i].x);
+				__m128 light_y = _mm_set1_ps(lights[i].y);
+				__m128 light_z = _mm_set1_ps(lights[i].z);
+				__m128 light_radius = _mm_set1_ps(lights[i].radius);
+				__m128 m256 = _mm_set1_ps(256.0f);
+
+				// L = light-pos
+				// dist = sqrt(dot(L, L))
+				// distance_attenuation = 1 - MIN(dist * (1/radius), 1)
+				__m128 Lyz2 = light_y; // L.y*L.y + L.z*L.z
+				__m128 Lx = _mm_sub_ps(light_x, viewpos_x);
+				__m128 dist2 = _mm_add_ps(Lyz2, _mm_mul_ps(Lx, Lx));
+				__m128 rcp_dist = _mm_rsqrt_ps(dist2);
+				__m128 dist = _mm_mul_ps(dist2, rcp_dist);
+				__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
+
+				// The simple light type
+				__m128 simple_attenuation = distance_attenuation;
+
+				// The point light type
+				// diffuse = dot(N,L) * attenuation
+				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_z, rcp_dist), distance_attenuation);
+
+				__m128 is_attenuated = _mm_cmpeq_ps(light_z, _mm_setzero_ps());
+				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
+
+				__m256i light_color = AVX2::SpreadColor(lights[i].color);
+				lit = _mm256_add_epi16(lit, _mm256_srli_epi16(_mm256_mullo_epi16(light_color, AVX2::SpreadPerPixel(attenuation)), 8));
+			}
+
+			fgcolor = _mm256_add_epi16(fgcolor, _mm256_srli_epi16(_mm256_mullo_epi16(material, lit), 8));
+			fgcolor = _mm256_min_epi16(fgcolor, _mm256_set1_epi16(255));
+			return fgcolor;
+		}
+
+		FORCEINLINE __m128i VECTORCALL Blend(__m256i fgcolor, __m256i bgcolor, uint32_t srcalpha, uint32_t destalpha, const uint32_t *ifgcolor)
+		{
+			using namespace DrawSpan32TModes;
+
+			if (BlendT::Mode == (int)SpanBlendModes::Opaque)
+			{
+				return AVX2::Pack(fgcolor);
+			}
+			else if (BlendT::Mode == (int)SpanBlendModes::Masked)
+			{
+				return AVX2::BlendMasked(fgcolor, bgcolor);
+			}
+			else if (BlendT::Mode == (int)SpanBlendModes::Translucent)
+			{
+				fgcolor = _mm256_mullo_epi16(fgcolor, _mm256_set1_epi16(srcalpha));
+				bgcolor = _mm256_mullo_epi16(bgcolor, _mm256_set1_epi16(destalpha));
+				return AVX2::BlendClamp<AVX2::BlendOp::Add>(fgcolor, bgcolor);
+			}
+			else
+			{
+				__m256i fgalpha, bgalpha;
+				AVX2::BlendAlpha(ifgcolor, srcalpha, destalpha, fgalpha, bgalpha);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, fgalpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, bgalpha);
+
+				if (BlendT::Mode == (int)SpanBlendModes::AddClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Add>(fgcolor, bgcolor);
+				else if (BlendT::Mode == (int)SpanBlendModes::SubClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Sub>(fgcolor, bgcolor);
+				else
+					return AVX2::BlendClamp<AVX2::BlendOp::RevSub>(fgcolor, bgcolor);
+			}
+		}
+
+		FString DebugInfo() override { return "DrawSpan32AVX2T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + 1; return true; }
+	};
+
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::OpaqueSpan> DrawSpan32AVX2Command;
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::MaskedSpan> DrawSpanMasked32AVX2Command;
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::TranslucentSpan> DrawSpanTranslucent32AVX2Command;
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::AddClampSpan> DrawSpanAddClamp32AVX2Command;
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::SubClampSpan> DrawSpanSubClamp32AVX2Command;
+	typedef DrawSpan32AVX2T<DrawSpan32TModes::RevSubClampSpan> DrawSpanRevSubClamp32AVX2Command;
+}
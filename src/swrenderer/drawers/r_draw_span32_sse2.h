@@ -506,6 +506,7 @@ namespace swrenderer
 		}
 
 		FString DebugInfo() override { return "DrawSpan32T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + 1; return true; }
 	};
 
 	typedef DrawSpan32T<DrawSpan32TModes::OpaqueSpan> DrawSpan32Command;
@@ -0,0 +1,340 @@
+/*
+**  AVX2 drawer commands for sprites
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw32_avx2.h"
+#include "swrenderer/drawers/r_draw_sprite32_sse2.h"
+
+namespace swrenderer
+{
+	// Four pixel version of DrawSprite32T
+	template<typename BlendT, typename SamplerT>
+	class DrawSprite32AVX2T : public DrawerCommand
+	{
+	protected:
+		SpriteDrawerArgs args;
+
+	public:
+		DrawSprite32AVX2T(const SpriteDrawerArgs &drawerargs) : args(drawerargs) { }
+
+		void Execute(DrawerThread *thread) override
+		{
+			using namespace DrawSprite32TModes;
+
+			auto shade_constants = args.ColormapConstants();
+			if (SamplerT::Mode == (int)SpriteSamplers::Texture)
+			{
+				const uint32_t *source2 = (const uint32_t*)args.TexturePixels2();
+				bool is_nearest_filter = (source2 == nullptr);
+
+				if (shade_constants.simple_shade)
+				{
+					if (is_nearest_filter)
+						Loop<SimpleShade, NearestFilter>(thread, shade_constants);
+					else
+						Loop<SimpleShade, LinearFilter>(thread, shade_constants);
+				}
+				else
+				{
+					if (is_nearest_filter)
+						Loop<AdvancedShade, NearestFilter>(thread, shade_constants);
+					else
+						Loop<AdvancedShade, LinearFilter>(thread, shade_constants);
+				}
+			}
+			else // no linear filtering for translated, shaded or fill
+			{
+				if (shade_constants.simple_shade)
+				{
+					Loop<SimpleShade, NearestFilter>(thread, shade_constants);
+				}
+				else
+				{
+					Loop<AdvancedShade, NearestFilter>(thread, shade_constants);
+				}
+			}
+		}
+
+		template<typename ShadeModeT, typename FilterModeT>
+		FORCEINLINE void VECTORCALL Loop(DrawerThread *thread, ShadeConstants shade_constants)
+		{
+			using namespace DrawSprite32TModes;
+
+			const uint32_t *source;
+			const uint32_t *source2;
+			const uint8_t *colormap;
+			const uint32_t *translation;
+
+			if (SamplerT::Mode == (int)SpriteSamplers::Shaded || SamplerT::Mode == (int)SpriteSamplers::Translated)
+			{
+				source = (const uint32_t*)args.TexturePixels();
+				source2 = nullptr;
+				colormap = args.Colormap();
+				translation = (const uint32_t*)args.TranslationMap();
+			}
+			else
+			{
+				source = (const uint32_t*)args.TexturePixels();
+				source2 = (const uint32_t*)args.TexturePixels2();
+				colormap = nullptr;
+				translation = nullptr;
+			}
+
+			int textureheight = args.TextureHeight();
+			uint32_t one = ((0x80000000 + textureheight - 1) / textureheight) * 2 + 1;
+
+			// Shade constants
+			__m256i dynlight = AVX2::SpreadColor(args.DynamicLight());
+			int light = 256 - (args.Light() >> (FRACBITS - 8));
+			__m256i mlight = _mm256_broadcastsi128_si256(_mm_set_epi16(256, light, light, light, 256, light, light, light));
+
+			__m256i inv_desaturate, shade_fade, shade_light;
+			int desaturate;
+			__m256i lightcontrib;
+			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			{
+				__m128i inv_light = _mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light);
+				inv_desaturate = _mm256_broadcastsi128_si256(_mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate));
+				__m128i fade = _mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue);
+				shade_fade = _mm256_broadcastsi128_si256(_mm_mullo_epi16(fade, inv_light));
+				shade_light = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue));
+				desaturate = shade_constants.desaturate;
+
+				lightcontrib = _mm256_min_epi16(_mm256_add_epi16(mlight, dynlight), _mm256_set1_epi16(256));
+				lightcontrib = _mm256_sub_epi16(lightcontrib, mlight);
+			}
+			else
+			{
+				inv_desaturate = _mm256_setzero_si256();
+				shade_fade = _mm256_setzero_si256();
+				shade_light = _mm256_setzero_si256();
+				desaturate = 0;
+				lightcontrib = _mm256_setzero_si256();
+
+				mlight = _mm256_min_epi16(_mm256_add_epi16(mlight, dynlight), _mm256_set1_epi16(256));
+			}
+
+			int count = args.Count();
+			int pitch = RenderViewport::Instance()->RenderTarget->GetPitch();
+			uint32_t fracstep = args.TextureVStep();
+			uint32_t frac = args.TextureVPos();
+			uint32_t texturefracx = args.TextureUPos();
+			uint32_t *dest = (uint32_t*)args.Dest();
+			int dest_y = args.DestY();
+
+			count = thread->count_for_thread(dest_y, count);
+			if (count <= 0) return;
+			frac += thread->skipped_by_thread(dest_y) * fracstep;
+			dest = thread->dest_for_thread(dest_y, pitch, dest);
+			fracstep *= thread->num_cores;
+			pitch *= thread->num_cores;
+
+			if (FilterModeT::Mode == (int)FilterModes::Linear)
+			{
+				frac -= one / 2;
+			}
+
+			uint32_t srcalpha = args.SrcAlpha() >> (FRACBITS - 8);
+			uint32_t destalpha = args.DestAlpha() >> (FRACBITS - 8);
+			uint32_t srccolor = args.SrcColorBgra();
+			uint32_t color = LightBgra::shade_pal_index_simple(args.SolidColor(), light);
+
+			for (int index = 0; index < count; index += 4)
+			{
+				int n = MIN(count - index, 4);
+				uint32_t *line = dest + index * pitch;
+
+				uint32_t desttmp[4] = { 0, 0, 0, 0 };
+				uint32_t ifgcolor[4] = { 0, 0, 0, 0 };
+				uint32_t ifgshade[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < n; i++)
+				{
+					if (BlendT::Mode != (int)SpriteBlendModes::Opaque && BlendT::Mode != (int)SpriteBlendModes::Copy)
+						desttmp[i] = line[i * pitch];
+
+					ifgcolor[i] = Sample<FilterModeT>(frac, source, source2, translation, textureheight, one, texturefracx, color, srccolor);
+					ifgshade[i] = SampleShade(frac, source, colormap);
+					frac += fracstep;
+				}
+
+				__m256i bgcolor = AVX2::Unpack(desttmp);
+				__m256i fgcolor = AVX2::Unpack(ifgcolor);
+
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor, desaturate, inv_desaturate, shade_fade, shade_light, lightcontrib);
+				_mm_storeu_si128((__m128i*)desttmp, Blend(fgcolor, bgcolor, ifgcolor, ifgshade, srcalpha, destalpha));
+
+				for (int i = 0; i < n; i++)
+					line[i * pitch] = desttmp[i];
+			}
+		}
+
+		template<typename FilterModeT>
+		FORCEINLINE unsigned int VECTORCALL Sample(uint32_t frac, const uint32_t *source, const uint32_t *source2, const uint32_t *translation, int textureheight, uint32_t one, uint32_t texturefracx, uint32_t color, uint32_t srccolor)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (SamplerT::Mode == (int)SpriteSamplers::Shaded)
+			{
+				return color;
+			}
+			else if (SamplerT::Mode == (int)SpriteSamplers::Translated)
+			{
+				const uint8_t *sourcepal = (const uint8_t *)source;
+				return translation[sourcepal[frac >> FRACBITS]];
+			}
+			else if (SamplerT::Mode == (int)SpriteSamplers::Fill)
+			{
+				return srccolor;
+			}
+			else if (FilterModeT::Mode == (int)FilterModes::Nearest)
+			{
+				int sample_index = (((frac << 2) >> FRACBITS) * textureheight) >> FRACBITS;
+				return source[sample_index];
+			}
+			else
+			{
+				// Clamp to edge
+				unsigned int frac_y0 = (clamp<unsigned int>(frac, 0, 1 << 30) >> (FRACBITS - 2)) * textureheight;
+				unsigned int frac_y1 = (clamp<unsigned int>(frac + one, 0, 1 << 30) >> (FRACBITS - 2)) * textureheight;
+				unsigned int y0 = frac_y0 >> FRACBITS;
+				unsigned int y1 = frac_y1 >> FRACBITS;
+
+				unsigned int p00 = source[y0];
+				unsigned int p01 = source[y1];
+				unsigned int p10 = source2[y0];
+				unsigned int p11 = source2[y1];
+
+				unsigned int inv_b = texturefracx;
+				unsigned int inv_a = (frac_y1 >> (FRACBITS - 4)) & 15;
+				unsigned int a = 16 - inv_a;
+				unsigned int b = 16 - inv_b;
+
+				unsigned int sred = (RPART(p00) * (a * b) + RPART(p01) * (inv_a * b) + RPART(p10) * (a * inv_b) + RPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int sgreen = (GPART(p00) * (a * b) + GPART(p01) * (inv_a * b) + GPART(p10) * (a * inv_b) + GPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int sblue = (BPART(p00) * (a * b) + BPART(p01) * (inv_a * b) + BPART(p10) * (a * inv_b) + BPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int salpha = (APART(p00) * (a * b) + APART(p01) * (inv_a * b) + APART(p10) * (a * inv_b) + APART(p11) * (inv_a * inv_b) + 127) >> 8;
+
+				return (salpha << 24) | (sred << 16) | (sgreen << 8) | sblue;
+			}
+		}
+
+		FORCEINLINE unsigned int VECTORCALL SampleShade(uint32_t frac, const uint32_t *source, const uint8_t *colormap)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (SamplerT::Mode == (int)SpriteSamplers::Shaded)
+			{
+				const uint8_t *sourcepal = (const uint8_t *)source;
+				unsigned int sampleshadeout = colormap[sourcepal[frac >> FRACBITS]];
+				return clamp<unsigned int>(sampleshadeout, 0, 64) * 4;
+			}
+			else
+			{
+				return 0;
+			}
+		}
+
+		template<typename ShadeModeT>
+		FORCEINLINE __m256i VECTORCALL Shade(__m256i fgcolor, __m256i mlight, const uint32_t *ifgcolor, int desaturate, __m256i inv_desaturate, __m256i shade_fade, __m256i shade_light, __m256i lightcontrib)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (BlendT::Mode == (int)SpriteBlendModes::Copy || BlendT::Mode == (int)SpriteBlendModes::Shaded)
+				return fgcolor;
+
+			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
+			{
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, mlight), 8);
+				return fgcolor;
+			}
+			else
+			{
+				__m256i lit_dynlight = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, lightcontrib), 8);
+				__m256i intensity = AVX2::Intensity(ifgcolor, desaturate);
+
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(fgcolor, inv_desaturate), intensity), 8);
+				fgcolor = _mm256_mullo_epi16(fgcolor, mlight);
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(shade_fade, fgcolor), 8);
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, shade_light), 8);
+
+				fgcolor = _mm256_add_epi16(fgcolor, lit_dynlight);
+				fgcolor = _mm256_min_epi16(fgcolor, _mm256_set1_epi16(256));
+				return fgcolor;
+			}
+		}
+
+		FORCEINLINE __m128i VECTORCALL Blend(__m256i fgcolor, __m256i bgcolor, const uint32_t *ifgcolor, const uint32_t *ifgshade, uint32_t srcalpha, uint32_t destalpha)
+		{
+			using namespace DrawSprite32TModes;
+
+			if (BlendT::Mode == (int)SpriteBlendModes::Opaque || BlendT::Mode == (int)SpriteBlendModes::Copy)
+			{
+				return AVX2::Pack(fgcolor);
+			}
+			else if (BlendT::Mode == (int)SpriteBlendModes::Shaded)
+			{
+				__m256i alpha = AVX2::PerPixel(ifgshade);
+				__m256i inv_alpha = _mm256_sub_epi16(_mm256_set1_epi16(256), alpha);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, alpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, inv_alpha);
+				__m256i outcolor = _mm256_srli_epi16(_mm256_add_epi16(fgcolor, bgcolor), 8);
+				return _mm_or_si128(AVX2::Pack(outcolor), _mm_set1_epi32(0xff000000));
+			}
+			else
+			{
+				__m256i fgalpha, bgalpha;
+				AVX2::BlendAlpha(ifgcolor, srcalpha, destalpha, fgalpha, bgalpha);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, fgalpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, bgalpha);
+
+				if (BlendT::Mode == (int)SpriteBlendModes::AddClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Add>(fgcolor, bgcolor);
+				else if (BlendT::Mode == (int)SpriteBlendModes::SubClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Sub>(fgcolor, bgcolor);
+				else
+					return AVX2::BlendClamp<AVX2::BlendOp::RevSub>(fgcolor, bgcolor);
+			}
+		}
+
+		FString DebugInfo() override { return "DrawSprite32AVX2T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
+	};
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::TextureSampler> DrawSprite32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::TextureSampler> DrawSpriteRevSubClamp32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::FillSampler> FillSprite32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::FillSampler> FillSpriteAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::FillSampler> FillSpriteSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::FillSampler> FillSpriteRevSubClamp32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::ShadedSprite, DrawSprite32TModes::ShadedSampler> DrawSpriteShaded32AVX2Command;
+
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::OpaqueSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslated32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::AddClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedAddClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::SubClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedSubClamp32AVX2Command;
+	typedef DrawSprite32AVX2T<DrawSprite32TModes::RevSubClampSprite, DrawSprite32TModes::TranslatedSampler> DrawSpriteTranslatedRevSubClamp32AVX2Command;
+}
@@ -433,6 +433,7 @@ namespace swrenderer
 		}
 
 		FString DebugInfo() override { return "DrawSprite32T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 	};
 
 	typedef DrawSprite32T<DrawSprite32TModes::CopySprite, DrawSprite32TModes::TextureSampler> DrawSpriteCopy32Command;
@@ -0,0 +1,292 @@
+/*
+**  AVX2 drawer commands for walls
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw32_avx2.h"
+#include "swrenderer/drawers/r_draw_wall32_sse2.h"
+#include "swrenderer/viewport/r_walldrawer.h"
+
+namespace swrenderer
+{
+	// Four pixel version of DrawWall32T
+	template<typename BlendT>
+	class DrawWall32AVX2T : public DrawerCommand
+	{
+	protected:
+		WallDrawerArgs args;
+
+	public:
+		DrawWall32AVX2T(const WallDrawerArgs &drawerargs) : args(drawerargs) { }
+
+		void Execute(DrawerThread *thread) override
+		{
+			using namespace DrawWall32TModes;
+
+			const uint32_t *source2 = (const uint32_t*)args.TexturePixels2();
+			bool is_nearest_filter = (source2 == nullptr);
+			auto shade_constants = args.ColormapConstants();
+			if (shade_constants.simple_shade)
+			{
+				if (is_nearest_filter)
+					Loop<SimpleShade, NearestFilter>(thread, shade_constants);
+				else
+					Loop<SimpleShade, LinearFilter>(thread, shade_constants);
+			}
+			else
+			{
+				if (is_nearest_filter)
+					Loop<AdvancedShade, NearestFilter>(thread, shade_constants);
+				else
+					Loop<AdvancedShade, LinearFilter>(thread, shade_constants);
+			}
+		}
+
+		template<typename ShadeModeT, typename FilterModeT>
+		FORCEINLINE void VECTORCALL Loop(DrawerThread *thread, ShadeConstants shade_constants)
+		{
+			using namespace DrawWall32TModes;
+
+			const uint32_t *source = (const uint32_t*)args.TexturePixels();
+			const uint32_t *source2 = (const uint32_t*)args.TexturePixels2();
+			int textureheight = args.TextureHeight();
+			uint32_t one = ((0x80000000 + textureheight - 1) / textureheight) * 2 + 1;
+
+			// Shade constants
+			int light = 256 - (args.Light() >> (FRACBITS - 8));
+			__m256i mlight = _mm256_broadcastsi128_si256(_mm_set_epi16(256, light, light, light, 256, light, light, light));
+			__m128i inv_light = _mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light);
+
+			__m256i inv_desaturate, shade_fade, shade_light;
+			int desaturate;
+			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
+			{
+				inv_desaturate = _mm256_broadcastsi128_si256(_mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate));
+				__m128i fade = _mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue);
+				shade_fade = _mm256_broadcastsi128_si256(_mm_mullo_epi16(fade, inv_light));
+				shade_light = _mm256_broadcastsi128_si256(_mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue));
+				desaturate = shade_constants.desaturate;
+			}
+			else
+			{
+				inv_desaturate = _mm256_setzero_si256();
+				shade_fade = _mm256_setzero_si256();
+				shade_light = _mm256_setzero_si256();
+				desaturate = 0;
+			}
+
+			int count = args.Count();
+			int pitch = RenderViewport::Instance()->RenderTarget->GetPitch();
+			uint32_t fracstep = args.TextureVStep();
+			uint32_t frac = args.TextureVPos();
+			uint32_t texturefracx = args.TextureUPos();
+			uint32_t *dest = (uint32_t*)args.Dest();
+			int dest_y = args.DestY();
+
+			auto lights = args.dc_lights;
+			auto num_lights = args.dc_num_lights;
+			float vpz = args.dc_viewpos.Z + args.dc_viewpos_step.Z * thread->skipped_by_thread(dest_y);
+			float stepvpz = args.dc_viewpos_step.Z * thread->num_cores;
+			__m128 viewpos_z = _mm_setr_ps(vpz, vpz + stepvpz, 0.0f, 0.0f);
+			__m128 step_viewpos_z = _mm_set1_ps(stepvpz * 2.0f);
+
+			count = thread->count_for_thread(dest_y, count);
+			if (count <= 0) return;
+			frac += thread->skipped_by_thread(dest_y) * fracstep;
+			dest = thread->dest_for_thread(dest_y, pitch, dest);
+			fracstep *= thread->num_cores;
+			pitch *= thread->num_cores;
+
+			if (FilterModeT::Mode == (int)FilterModes::Linear)
+			{
+				frac -= one / 2;
+			}
+
+			uint32_t srcalpha = args.SrcAlpha() >> (FRACBITS - 8);
+			uint32_t destalpha = args.DestAlpha() >> (FRACBITS - 8);
+
+			for (int index = 0; index < count; index += 4)
+			{
+				int n = MIN(count - index, 4);
+				uint32_t *line = dest + index * pitch;
+
+				uint32_t desttmp[4] = { 0, 0, 0, 0 };
+				uint32_t ifgcolor[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < n; i++)
+				{
+					if (BlendT::Mode != (int)WallBlendModes::Opaque)
+						desttmp[i] = line[i * pitch];
+
+					ifgcolor[i] = Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
+					frac += fracstep;
+				}
+
+				__m256i bgcolor = AVX2::Unpack(desttmp);
+				__m256i fgcolor = AVX2::Unpack(ifgcolor);
+				__m128 viewpos = AVX2::NextViewpos(viewpos_z, step_viewpos_z);
+
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor, desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos);
+				_mm_storeu_si128((__m128i*)desttmp, Blend(fgcolor, bgcolor, ifgcolor, srcalpha, destalpha));
+
+				for (int i = 0; i < n; i++)
+					line[i * pitch] = desttmp[i];
+			}
+		}
+
+		template<typename FilterModeT>
+		FORCEINLINE unsigned int VECTORCALL Sample(uint32_t frac, const uint32_t *source, const uint32_t *source2, int textureheight, uint32_t one, uint32_t texturefracx)
+		{
+			using namespace DrawWall32TModes;
+
+			if (FilterModeT::Mode == (int)FilterModes::Nearest)
+			{
+				int sample_index = ((frac >> FRACBITS) * textureheight) >> FRACBITS;
+				return source[sample_index];
+			}
+			else
+			{
+				unsigned int frac_y0 = (frac >> FRACBITS) * textureheight;
+				unsigned int frac_y1 = ((frac + one) >> FRACBITS) * textureheight;
+				unsigned int y0 = frac_y0 >> FRACBITS;
+				unsigned int y1 = frac_y1 >> FRACBITS;
+
+				unsigned int p00 = source[y0];
+				unsigned int p01 = source[y1];
+				unsigned int p10 = source2[y0];
+				unsigned int p11 = source2[y1];
+
+				unsigned int inv_b = texturefracx;
+				unsigned int inv_a = (frac_y1 >> (FRACBITS - 4)) & 15;
+				unsigned int a = 16 - inv_a;
+				unsigned int b = 16 - inv_b;
+
+				unsigned int sred = (RPART(p00) * (a * b) + RPART(p01) * (inv_a * b) + RPART(p10) * (a * inv_b) + RPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int sgreen = (GPART(p00) * (a * b) + GPART(p01) * (inv_a * b) + GPART(p10) * (a * inv_b) + GPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int sblue = (BPART(p00) * (a * b) + BPART(p01) * (inv_a * b) + BPART(p10) * (a * inv_b) + BPART(p11) * (inv_a * inv_b) + 127) >> 8;
+				unsigned int salpha = (APART(p00) * (a * b) + APART(p01) * (inv_a * b) + APART(p10) * (a * inv_b) + APART(p11) * (inv_a * inv_b) + 127) >> 8;
+
+				return (salpha << 24) | (sred << 16) | (sgreen << 8) | sblue;
+			}
+		}
+
+		template<typename ShadeModeT>
+		FORCEINLINE __m256i VECTORCALL Shade(__m256i fgcolor, __m256i mlight, const uint32_t *ifgcolor, int desaturate, __m256i inv_desaturate, __m256i shade_fade, __m256i shade_light, const DrawerLight *lights, int num_lights, __m128 viewpos_z)
+		{
+			using namespace DrawWall32TModes;
+
+			__m256i material = fgcolor;
+			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
+			{
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, mlight), 8);
+			}
+			else
+			{
+				__m256i intensity = AVX2::Intensity(ifgcolor, desaturate);
+
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(fgcolor, inv_desaturate), intensity), 8);
+				fgcolor = _mm256_mullo_epi16(fgcolor, mlight);
+				fgcolor = _mm256_srli_epi16(_mm256_add_epi16(shade_fade, fgcolor), 8);
+				fgcolor = _mm256_srli_epi16(_mm256_mullo_epi16(fgcolor, shade_light), 8);
+			}
+
+			return AddLights(material, fgcolor, lights, num_lights, viewpos_z);
+		}
+
+		FORCEINLINE __m256i VECTORCALL AddLights(__m256i material, __m256i fgcolor, const DrawerLight *lights, int num_lights, __m128 viewpos_z)
+		{
+			__m256i lit = _mm256_setzero_si256();
+
+			for (int i = 0; i != num_lights; i++)
+			{
+				__m128 light_x = _mm_set1_ps(lights[i].x);
+				__m128 light_y = _mm_set1_ps(lights[i].y);
+				__m128 light_z = _mm_set1_ps(lights[i].z);
+				__m128 light_radius = _mm_set1_ps(lights[i].radius);
+				__m128 m256 = _mm_set1_ps(256.0f);
+
+				// L = light-pos
+				// dist = sqrt(dot(L, L))
+				// distance_attenuation = 1 - MIN(dist * (1/radius), 1)
+				__m128 Lxy2 = light_x; // L.x*L.x + L.y*L.y
+				__m128 Lz = _mm_sub_ps(light_z, viewpos_z);
+				__m128 dist2 = _mm_add_ps(Lxy2, _mm_mul_ps(Lz, Lz));
+				__m128 rcp_dist = _mm_rsqrt_ps(dist2);
+				__m128 dist = _mm_mul_ps(dist2, rcp_dist);
+				__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
+
+				// The simple light type
+				__m128 simple_attenuation = distance_attenuation;
+
+				// The point light type
+				// diffuse = dot(N,L) * attenuation
+				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_y, rcp_dist), distance_attenuation);
+
+				__m128 is_attenuated = _mm_cmpeq_ps(light_y, _mm_setzero_ps());
+				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
+
+				__m256i light_color = AVX2::SpreadColor(lights[i].color);
+				lit = _mm256_add_epi16(lit, _mm256_srli_epi16(_mm256_mullo_epi16(light_color, AVX2::SpreadPerPixel(attenuation)), 8));
+			}
+
+			fgcolor = _mm256_add_epi16(fgcolor, _mm256_srli_epi16(_mm256_mullo_epi16(material, lit), 8));
+			fgcolor = _mm256_min_epi16(fgcolor, _mm256_set1_epi16(255));
+			return fgcolor;
+		}
+
+		FORCEINLINE __m128i VECTORCALL Blend(__m256i fgcolor, __m256i bgcolor, const uint32_t *ifgcolor, uint32_t srcalpha, uint32_t destalpha)
+		{
+			using namespace DrawWall32TModes;
+
+			if (BlendT::Mode == (int)WallBlendModes::Opaque)
+			{
+				return AVX2::Pack(fgcolor);
+			}
+			else if (BlendT::Mode == (int)WallBlendModes::Masked)
+			{
+				return AVX2::BlendMasked(fgcolor, bgcolor);
+			}
+			else
+			{
+				__m256i fgalpha, bgalpha;
+				AVX2::BlendAlpha(ifgcolor, srcalpha, destalpha, fgalpha, bgalpha);
+
+				fgcolor = _mm256_mullo_epi16(fgcolor, fgalpha);
+				bgcolor = _mm256_mullo_epi16(bgcolor, bgalpha);
+
+				if (BlendT::Mode == (int)WallBlendModes::AddClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Add>(fgcolor, bgcolor);
+				else if (BlendT::Mode == (int)WallBlendModes::SubClamp)
+					return AVX2::BlendClamp<AVX2::BlendOp::Sub>(fgcolor, bgcolor);
+				else
+					return AVX2::BlendClamp<AVX2::BlendOp::RevSub>(fgcolor, bgcolor);
+			}
+		}
+
+		FString DebugInfo() override { return "DrawWall32AVX2T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
+	};
+
+	typedef DrawWall32AVX2T<DrawWall32TModes::OpaqueWall> DrawWall32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::MaskedWall> DrawWallMasked32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::AddClampWall> DrawWallAddClamp32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::SubClampWall> DrawWallSubClamp32AVX2Command;
+	typedef DrawWall32AVX2T<DrawWall32TModes::RevSubClampWall> DrawWallRevSubClamp32AVX2Command;
+}
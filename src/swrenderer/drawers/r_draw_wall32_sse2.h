@@ -405,6 +405,7 @@ namespace swrenderer
 		}
 
 		FString DebugInfo() override { return "DrawWall32T"; }
+		bool GetRowRange(int &y1, int &y2) override { y1 = args.DestY(); y2 = y1 + args.Count(); return true; }
 	};
 
 	typedef DrawWall32T<DrawWall32TModes::OpaqueWall> DrawWall32Command;
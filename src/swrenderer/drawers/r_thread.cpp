@@ -33,8 +33,11 @@
 #include "r_thread.h"
 #include "swrenderer/r_memory.h"
 #include "swrenderer/r_renderthread.h"
+#include "profiler.h"
 
 CVAR(Bool, r_multithreaded, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR(Bool, r_drawertiles, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR(Int, r_drawertileheight, 32, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -63,14 +66,16 @@ void DrawerThreads::Execute(const std::vector<DrawerCommandQueuePtr> &queues)
 	
 	auto queue = Instance();
 
+	queue->StartThreads();
+
 	// Give worker threads something to do:
 
 	std::unique_lock<std::mutex> start_lock(queue->start_mutex);
 	queue->active_commands = queues;
+	queue->tiled_run = r_drawertiles && queue->BinCommands();
 	queue->run_id++;
 	start_lock.unlock();
 
-	queue->StartThreads();
 	queue->start_condition.notify_all();
 
 	// Do one thread ourselves:
@@ -79,46 +84,19 @@ void DrawerThreads::Execute(const std::vector<DrawerCommandQueuePtr> &queues)
 	thread.core = 0;
 	thread.num_cores = (int)(queue->threads.size() + 1);
 
-	struct TryCatchData
-	{
-		DrawerThreads *queue;
-		DrawerThread *thread;
-		size_t list_index;
-		size_t command_index;
-	} data;
-
+	TryCatchData data;
 	data.queue = queue;
 	data.thread = &thread;
-	data.list_index = 0;
-	data.command_index = 0;
+	data.command = nullptr;
 	VectoredTryCatch(&data,
 	[](void *data)
 	{
-		TryCatchData *d = (TryCatchData*)data;
-
-		for (int pass = 0; pass < d->queue->num_passes; pass++)
-		{
-			d->thread->pass_start_y = pass * d->queue->rows_in_pass;
-			d->thread->pass_end_y = (pass + 1) * d->queue->rows_in_pass;
-			if (pass + 1 == d->queue->num_passes)
-				d->thread->pass_end_y = MAX(d->thread->pass_end_y, MAXHEIGHT);
-
-			for (auto &list : d->queue->active_commands)
-			{
-				size_t size = list->commands.size();
-				for (d->command_index = 0; d->command_index < size; d->command_index++)
-				{
-					auto &command = list->commands[d->command_index];
-					command->Execute(d->thread);
-				}
-				d->list_index++;
-			}
-		}
+		WorkerExecute((TryCatchData*)data);
 	},
 	[](void *data, const char *reason, bool fatal)
 	{
 		TryCatchData *d = (TryCatchData*)data;
-		ReportDrawerError(d->queue->active_commands[d->list_index]->commands[d->command_index], true, reason, fatal);
+		ReportDrawerError(d->command, true, reason, fatal);
 	});
 
 	// Wait for everyone to finish:
@@ -145,9 +123,137 @@ void DrawerThreads::Execute(const std::vector<DrawerCommandQueuePtr> &queues)
 		list->Clear();
 	}
 	queue->active_commands.clear();
+	for (int i = 0; i < queue->num_tiles; i++)
+		queue->tile_commands[i].clear();
+	queue->num_tiles = 0;
 	queue->finished_threads = 0;
 }
 
+void DrawerThreads::WorkerExecute(TryCatchData *d)
+{
+	PROFILE_ZONE("DrawerThread");
+
+	if (d->queue->tiled_run)
+		WorkerExecuteTiles(d);
+	else
+		WorkerExecuteScanlines(d);
+}
+
+void DrawerThreads::WorkerExecuteScanlines(TryCatchData *d)
+{
+	for (int pass = 0; pass < d->queue->num_passes; pass++)
+	{
+		d->thread->pass_start_y = pass * d->queue->rows_in_pass;
+		d->thread->pass_end_y = (pass + 1) * d->queue->rows_in_pass;
+		if (pass + 1 == d->queue->num_passes)
+			d->thread->pass_end_y = MAX(d->thread->pass_end_y, MAXHEIGHT);
+
+		for (auto &list : d->queue->active_commands)
+		{
+			for (auto command : list->commands)
+			{
+				d->command = command;
+				command->Execute(d->thread);
+			}
+		}
+	}
+}
+
+void DrawerThreads::WorkerExecuteTiles(TryCatchData *d)
+{
+	DrawerThreads *queue = d->queue;
+	DrawerThread *thread = d->thread;
+
+	// Each tile is drawn completely by one thread, so the drawers should not skip any lines within it
+	int worker = thread->core;
+	int num_workers = thread->num_cores;
+	thread->core = 0;
+	thread->num_cores = 1;
+
+	int tile;
+	while (queue->NextTile(worker, tile))
+	{
+		thread->pass_start_y = tile * queue->tile_height;
+		thread->pass_end_y = (tile + 1) * queue->tile_height;
+
+		for (auto command : queue->tile_commands[tile])
+		{
+			d->command = command;
+			command->Execute(thread);
+		}
+	}
+
+	thread->core = worker;
+	thread->num_cores = num_workers;
+	thread->pass_start_y = 0;
+	thread->pass_end_y = MAXHEIGHT;
+}
+
+bool DrawerThreads::BinCommands()
+{
+	// Find the rows touched by the batch. If any command cannot tell, fall back to scanline interleaving.
+	int max_y = 0;
+	for (auto &list : active_commands)
+	{
+		for (auto command : list->commands)
+		{
+			int y1, y2;
+			if (!command->GetRowRange(y1, y2))
+				return false;
+			max_y = MAX(max_y, y2);
+		}
+	}
+
+	int num_workers = (int)threads.size() + 1;
+	if (num_tile_queues != num_workers)
+	{
+		tile_queues.reset(new DrawerTileQueue[num_workers]);
+		num_tile_queues = num_workers;
+	}
+
+	tile_height = clamp((int)r_drawertileheight, 8, MAXHEIGHT);
+	num_tiles = (MIN(max_y, MAXHEIGHT) + tile_height - 1) / tile_height;
+	if ((int)tile_commands.size() < num_tiles)
+		tile_commands.resize(num_tiles);
+
+	// Commands keep their submission order within each tile
+	for (auto &list : active_commands)
+	{
+		for (auto command : list->commands)
+		{
+			int y1, y2;
+			command->GetRowRange(y1, y2);
+			y1 = MAX(y1, 0);
+			y2 = MIN(y2, num_tiles * tile_height);
+			if (y1 >= y2)
+				continue;
+
+			int last_tile = (y2 - 1) / tile_height;
+			for (int tile = y1 / tile_height; tile <= last_tile; tile++)
+				tile_commands[tile].push_back(command);
+		}
+	}
+
+	// Hand each worker a contiguous range of tiles to start with
+	for (int i = 0; i < num_workers; i++)
+		tile_queues[i].Reset(num_tiles * i / num_workers, num_tiles * (i + 1) / num_workers);
+
+	return true;
+}
+
+bool DrawerThreads::NextTile(int worker, int &tile)
+{
+	if (tile_queues[worker].PopFront(tile))
+		return true;
+
+	for (int i = 1; i < num_tile_queues; i++)
+	{
+		if (tile_queues[(worker + i) % num_tile_queues].StealBack(tile))
+			return true;
+	}
+	return false;
+}
+
 void DrawerThreads::StartThreads()
 {
 	if (!threads.empty())
@@ -167,6 +273,8 @@ void DrawerThreads::StartThreads()
 		thread->num_cores = num_threads;
 		thread->thread = std::thread([=]()
 		{
+			FProfiler::SetThreadName("Drawer thread");
+
 			int run_id = 0;
 			while (true)
 			{
@@ -180,46 +288,19 @@ void DrawerThreads::StartThreads()
 
 				// Do the work:
 
-				struct TryCatchData
-				{
-					DrawerThreads *queue;
-					DrawerThread *thread;
-					size_t list_index;
-					size_t command_index;
-				} data;
-
+				TryCatchData data;
 				data.queue = queue;
 				data.thread = thread;
-				data.list_index = 0;
-				data.command_index = 0;
+				data.command = nullptr;
 				VectoredTryCatch(&data,
 				[](void *data)
 				{
-					TryCatchData *d = (TryCatchData*)data;
-
-					for (int pass = 0; pass < d->queue->num_passes; pass++)
-					{
-						d->thread->pass_start_y = pass * d->queue->rows_in_pass;
-						d->thread->pass_end_y = (pass + 1) * d->queue->rows_in_pass;
-						if (pass + 1 == d->queue->num_passes)
-							d->thread->pass_end_y = MAX(d->thread->pass_end_y, MAXHEIGHT);
-
-						for (auto &list : d->queue->active_commands)
-						{
-							size_t size = list->commands.size();
-							for (d->command_index = 0; d->command_index < size; d->command_index++)
-							{
-								auto &command = list->commands[d->command_index];
-								command->Execute(d->thread);
-							}
-							d->list_index++;
-						}
-					}
+					WorkerExecute((TryCatchData*)data);
 				},
 				[](void *data, const char *reason, bool fatal)
 				{
 					TryCatchData *d = (TryCatchData*)data;
-					ReportDrawerError(d->queue->active_commands[d->list_index]->commands[d->command_index], true, reason, fatal);
+					ReportDrawerError(d->command, true, reason, fatal);
 				});
 
 				// Notify main thread that we finished:
@@ -247,12 +328,15 @@ void DrawerThreads::StopThreads()
 
 void DrawerThreads::ReportDrawerError(DrawerCommand *command, bool worker_thread, const char *reason, bool fatal)
 {
+	// The error can happen before the first command has been picked.
+	FString info = command ? command->DebugInfo() : FString("no command");
+
 	if (worker_thread)
 	{
 		std::unique_lock<std::mutex> end_lock(Instance()->end_mutex);
 		if (Instance()->thread_error.IsEmpty() || (!Instance()->thread_error_fatal && fatal))
 		{
-			Instance()->thread_error = reason + (FString)": " + command->DebugInfo();
+			Instance()->thread_error = reason + (FString)": " + info;
 			Instance()->thread_error_fatal = fatal;
 		}
 	}
@@ -260,9 +344,9 @@ void DrawerThreads::ReportDrawerError(DrawerCommand *command, bool worker_thread
 	{
 		static bool first = true;
 		if (fatal)
-			I_FatalError("%s: %s", reason, command->DebugInfo().GetChars());
+			I_FatalError("%s: %s", reason, info.GetChars());
 		else if (first)
-			Printf("%s: %s\n", reason, command->DebugInfo().GetChars());
+			Printf("%s: %s\n", reason, info.GetChars());
 		first = false;
 	}
 }
@@ -276,6 +360,35 @@ void VectoredTryCatch(void *data, void(*tryBlock)(void *data), void(*catchBlock)
 
 #endif
 
+/////////////////////////////////////////////////////////////////////////////
+
+void DrawerTileQueue::Reset(int first, int last)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	front = first;
+	back = last;
+}
+
+bool DrawerTileQueue::PopFront(int &tile)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (front == back)
+		return false;
+	tile = front++;
+	return true;
+}
+
+bool DrawerTileQueue::StealBack(int &tile)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (front == back)
+		return false;
+	tile = --back;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 DrawerCommandQueue::DrawerCommandQueue(swrenderer::RenderThread *renderthread) : renderthread(renderthread)
 {
 }
@@ -33,6 +33,9 @@
 // Use multiple threads when drawing
 EXTERN_CVAR(Bool, r_multithreaded)
 
+// Split drawer work into tiles of rows instead of interleaved scanlines
+EXTERN_CVAR(Bool, r_drawertiles)
+
 // Worker data for each thread executing drawer commands
 class DrawerThread
 {
@@ -107,6 +110,10 @@ public:
 
 	virtual void Execute(DrawerThread *thread) = 0;
 	virtual FString DebugInfo() = 0;
+
+	// Rows [y1, y2) written by the command. Used for binning the command into tiles.
+	// Commands that cannot be restricted to a row range return false, which forces scanline scheduling.
+	virtual bool GetRowRange(int &y1, int &y2) { return false; }
 };
 
 void VectoredTryCatch(void *data, void(*tryBlock)(void *data), void(*catchBlock)(void *data, const char *reason, bool fatal));
@@ -114,6 +121,20 @@ void VectoredTryCatch(void *data, void(*tryBlock)(void *data), void(*catchBlock)
 class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
 
+// Range of tiles owned by a worker thread. The owner takes tiles from the front while idle workers steal from the back.
+class DrawerTileQueue
+{
+public:
+	void Reset(int first, int last);
+	bool PopFront(int &tile);
+	bool StealBack(int &tile);
+
+private:
+	std::mutex mutex;
+	int front = 0;
+	int back = 0;
+};
+
 class DrawerThreads
 {
 public:
@@ -129,6 +150,20 @@ private:
 
 	static DrawerThreads *Instance();
 	static void ReportDrawerError(DrawerCommand *command, bool worker_thread, const char *reason, bool fatal);
+
+	struct TryCatchData
+	{
+		DrawerThreads *queue;
+		DrawerThread *thread;
+		DrawerCommand *command;
+	};
+
+	static void WorkerExecute(TryCatchData *d);
+	static void WorkerExecuteScanlines(TryCatchData *d);
+	static void WorkerExecuteTiles(TryCatchData *d);
+
+	bool BinCommands();
+	bool NextTile(int worker, int &tile);
 	
 	std::vector<DrawerThread> threads;
 
@@ -148,6 +183,14 @@ private:
 	DrawerThread single_core_thread;
 	int num_passes = 1;
 	int rows_in_pass = MAXHEIGHT;
+
+	// Tiled execution state for the active batch
+	bool tiled_run = false;
+	int tile_height = 0;
+	int num_tiles = 0;
+	std::vector<std::vector<DrawerCommand *>> tile_commands;
+	std::unique_ptr<DrawerTileQueue[]> tile_queues;
+	int num_tile_queues = 0;
 	
 	friend class DrawerCommandQueue;
 };
@@ -54,6 +54,9 @@
 #include "swrenderer/viewport/r_viewport.h"
 #include "r_memory.h"
 
+// Use the AVX2 truecolor drawers when the CPU supports them
+CVAR(Bool, r_avx2drawers, true, 0);
+
 namespace swrenderer
 {
 	RenderThread::RenderThread(RenderScene *scene, bool mainThread)
@@ -72,6 +75,7 @@ namespace swrenderer
 		DrawSegments = std::make_unique<DrawSegmentList>(this);
 		ClipSegments = std::make_unique<RenderClipSegment>();
 		tc_drawers = std::make_unique<SWTruecolorDrawers>(DrawQueue);
+		tc_avx2_drawers = SWTruecolorDrawers::CreateAVX2(DrawQueue);
 		pal_drawers = std::make_unique<SWPalDrawers>(DrawQueue);
 	}
 
@@ -82,7 +86,7 @@ namespace swrenderer
 	SWPixelFormatDrawers *RenderThread::Drawers()
 	{
 		if (RenderViewport::Instance()->RenderTarget->IsBgra())
-			return tc_drawers.get();
+			return (tc_avx2_drawers && r_avx2drawers) ? tc_avx2_drawers.get() : tc_drawers.get();
 		else
 			return pal_drawers.get();
 	}
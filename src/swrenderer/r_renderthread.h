@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <thread>
+#include "stats.h"
 
 class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
@@ -56,6 +57,9 @@ namespace swrenderer
 		int X2 = MAXWIDTH;
 		bool MainThread = false;
 
+		// Time spent rendering the slice in the last frame
+		cycle_t SliceCycles;
+
 		std::unique_ptr<RenderMemory> FrameMemory;
 		std::unique_ptr<RenderOpaquePass> OpaquePass;
 		std::unique_ptr<RenderTranslucentPass> TranslucentPass;
@@ -78,6 +82,7 @@ namespace swrenderer
 		
 	private:
 		std::unique_ptr<SWTruecolorDrawers> tc_drawers;
+		std::unique_ptr<SWTruecolorDrawers> tc_avx2_drawers;
 		std::unique_ptr<SWPalDrawers> pal_drawers;
 	};
 }
@@ -45,10 +45,15 @@
 #include "scene/r_3dfloors.h"
 #include "scene/r_portal.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
 #include "r_data/voxels.h"
 #include "drawers/r_draw_rgba.h"
 #include "polyrenderer/poly_renderer.h"
 #include "p_setup.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "v_text.h"
+#include "x86.h"
 
 void gl_ParseDefs();
 void gl_InitData();
@@ -56,8 +61,11 @@ void gl_SetActorLights(AActor *);
 void gl_PreprocessLevel();
 void gl_CleanLevelData();
 
+extern int currentrenderer;
+
 EXTERN_CVAR(Bool, r_shadercolormaps)
 EXTERN_CVAR(Float, maxviewpitch)	// [SP] CVAR from GZDoom
+EXTERN_CVAR(Bool, r_avx2drawers)
 
 CUSTOM_CVAR(Bool, r_polyrenderer, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
@@ -101,6 +109,13 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 
 	if (tex != NULL)
 	{
+		// Paletted images are decoded in the background and get their spans
+		// on first use. Truecolor images are still made here, since making
+		// them reads the lumps again.
+		if (cache != 0 && !isbgra && FTextureDecoder::Queue(tex))
+		{
+			return;
+		}
 		if (cache & FTextureManager::HIT_Columnmode)
 		{
 			const FTexture::Span *spanp;
@@ -116,7 +131,7 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 			else
 				tex->GetPixels ();
 		}
-		else
+		else if (tex->DecodeUsers == 0)	// patches of a texture that is being composited
 		{
 			tex->Unload ();
 		}
@@ -125,6 +140,8 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 
 void FSoftwareRenderer::Precache(BYTE *texhitlist, TMap<PClassActor*, bool> &actorhitlist)
 {
+	FTextureDecoder::Clear();
+
 	BYTE *spritelist = new BYTE[sprites.Size()];
 	TMap<PClassActor*, bool>::Iterator it(actorhitlist);
 	TMap<PClassActor*, bool>::Pair *pair;
@@ -166,14 +183,23 @@ void FSoftwareRenderer::Precache(BYTE *texhitlist, TMap<PClassActor*, bool> &act
 	delete[] spritelist;
 
 	int cnt = TexMan.NumTextures();
+	FTexturePrefetcher prefetch;
+	for (int i = cnt - 1; i >= 0; i--)
+	{
+		if (texhitlist[i]) prefetch.Add(TexMan.ByIndex(i));
+	}
 	for (int i = cnt - 1; i >= 0; i--)
 	{
+		if (texhitlist[i]) prefetch.Next();
 		PrecacheTexture(TexMan.ByIndex(i), texhitlist[i]);
 	}
 }
 
 void FSoftwareRenderer::RenderView(player_t *player)
 {
+	FTextureDecoder::Update();
+	TexMan.TrimCache();
+
 	if (r_polyrenderer)
 		PolyRenderer::Instance()->RenderView(player);
 	else
@@ -211,6 +237,17 @@ void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int wi
 	delete pic;
 }
 
+bool FSoftwareRenderer::RenderViewToCanvas(AActor *viewpoint, DCanvas *canvas)
+{
+	canvas->Lock();
+	if (r_polyrenderer)
+		PolyRenderer::Instance()->RenderViewToCanvas(viewpoint, canvas, 0, 0, canvas->GetWidth(), canvas->GetHeight(), false);
+	else
+		mScene.RenderViewToCanvas(viewpoint, canvas, 0, 0, canvas->GetWidth(), canvas->GetHeight());
+	canvas->Unlock();
+	return true;
+}
+
 void FSoftwareRenderer::DrawRemainingPlayerSprites()
 {
 	if (!r_polyrenderer)
@@ -336,3 +373,95 @@ void FSoftwareRenderer::CleanLevelData()
 {
 	gl_CleanLevelData();
 }
+
+//==========================================================================
+//
+// CCMD drawercheck
+//
+// Renders the current view in true color once with the AVX2 drawers and
+// twice with the SSE2 drawers, and reports the pixels where they differ.
+// Both must produce exactly the same image. The second SSE2 render
+// catches views that changed in between, like animated warp textures.
+// There is no scalar version of the wall, sprite and span drawers to
+// compare against.
+//
+//==========================================================================
+
+static void RenderDrawerCheckView(AActor *camera, DCanvas *canvas, bool avx2, TArray<uint32_t> &pixels)
+{
+	int savedfuzzpos = fuzzpos;
+	r_avx2drawers = avx2;
+	Renderer->RenderViewToCanvas(camera, canvas);
+	fuzzpos = savedfuzzpos;
+
+	int width = canvas->GetWidth();
+	int height = canvas->GetHeight();
+	pixels.Resize(width * height);
+	canvas->Lock();
+	const uint32_t *src = (const uint32_t *)canvas->GetBuffer();
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(&pixels[y * width], src + y * canvas->GetPitch(), width * sizeof(uint32_t));
+	}
+	canvas->Unlock();
+}
+
+static unsigned CountPixelDifferences(const TArray<uint32_t> &a, const TArray<uint32_t> &b)
+{
+	unsigned count = 0;
+	for (unsigned i = 0; i < a.Size(); i++)
+	{
+		// The alpha channel isn't written by every drawer.
+		if ((a[i] ^ b[i]) & 0xffffff) count++;
+	}
+	return count;
+}
+
+CCMD(drawercheck)
+{
+	if (currentrenderer != 0 || r_polyrenderer)
+	{
+		Printf("drawercheck needs the software renderer\n");
+		return;
+	}
+	if (gamestate != GS_LEVEL || players[consoleplayer].camera == nullptr)
+	{
+		Printf("drawercheck needs a level\n");
+		return;
+	}
+	if (!CPU.bAVX2)
+	{
+		Printf("This CPU doesn't support AVX2\n");
+		return;
+	}
+
+	DCanvas *canvas = new DSimpleCanvas(SCREENWIDTH, SCREENHEIGHT, true);
+	canvas->ObjectFlags |= OF_Fixed;
+
+	bool savedavx2 = r_avx2drawers;
+	TArray<uint32_t> sse2, avx2, sse2again;
+	AActor *camera = players[consoleplayer].camera;
+	RenderDrawerCheckView(camera, canvas, false, sse2);
+	RenderDrawerCheckView(camera, canvas, true, avx2);
+	RenderDrawerCheckView(camera, canvas, false, sse2again);
+	r_avx2drawers = savedavx2;
+
+	canvas->Destroy();
+	canvas->ObjectFlags |= OF_YesReallyDelete;
+	delete canvas;
+
+	if (CountPixelDifferences(sse2, sse2again) != 0)
+	{
+		Printf("The view changed while checking, try again in a static view\n");
+		return;
+	}
+	unsigned count = CountPixelDifferences(sse2, avx2);
+	if (count == 0)
+	{
+		Printf("The AVX2 and SSE2 drawers match (%u pixels)\n", sse2.Size());
+	}
+	else
+	{
+		Printf(TEXTCOLOR_RED "The AVX2 and SSE2 drawers differ in %u of %u pixels\n", count, sse2.Size());
+	}
+}
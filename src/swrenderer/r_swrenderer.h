@@ -24,6 +24,9 @@ struct FSoftwareRenderer : public FRenderer
 	// renders view to a savegame picture
 	void WriteSavePic (player_t *player, FileWriter *file, int width, int height) override;
 
+	// renders the view into a system memory canvas
+	bool RenderViewToCanvas (AActor *viewpoint, DCanvas *canvas) override;
+
 	// draws player sprites with hardware acceleration (only useful for software rendering)
 	void DrawRemainingPlayerSprites() override;
 
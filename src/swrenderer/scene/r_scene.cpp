@@ -49,15 +49,25 @@
 #include "swrenderer/r_memory.h"
 #include "swrenderer/r_renderthread.h"
 #include "swrenderer/things/r_playersprite.h"
+#include "profiler.h"
 
 EXTERN_CVAR(Bool, r_shadercolormaps)
 EXTERN_CVAR(Int, r_clearbuffer)
 
+// Not archived: textures still get loaded from the scene threads, which isn't safe yet.
 CVAR(Bool, r_scene_multithreaded, false, 0);
+CVAR(Bool, r_scene_adaptiveslices, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 namespace swrenderer
 {
-	cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles;
+	cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles, DrawerCycles;
+
+	struct SliceStat
+	{
+		int X1, X2;
+		double TimeMS;
+	};
+	static std::vector<SliceStat> SliceStats;
 	
 	RenderScene::RenderScene()
 	{
@@ -119,7 +129,10 @@ namespace swrenderer
 		{
 			queues.push_back((*it)->DrawQueue);
 		}
+		PROFILE_ZONE("Drawers");
+		DrawerCycles.Clock();
 		DrawerThreads::Execute(queues);
+		DrawerCycles.Unclock();
 
 		//using namespace std::chrono_literals;
 		//std::this_thread::sleep_for(0.5s);
@@ -127,10 +140,13 @@ namespace swrenderer
 
 	void RenderScene::RenderActorView(AActor *actor, bool dontmaplines)
 	{
+		PROFILE_ZONE("RenderActorView");
+
 		WallCycles.Reset();
 		PlaneCycles.Reset();
 		MaskedCycles.Reset();
 		WallScanCycles.Reset();
+		DrawerCycles.Reset();
 		
 		R_SetupFrame(actor);
 		CameraLight::Instance()->SetCamera(actor);
@@ -183,12 +199,14 @@ namespace swrenderer
 			StartThreads(numThreads);
 		}
 
+		UpdateSliceSplits(numThreads);
+
 		// Setup threads:
 		std::unique_lock<std::mutex> start_lock(start_mutex);
 		for (int i = 0; i < numThreads; i++)
 		{
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			Threads[i]->X1 = (int)(SliceSplits[i] * viewwidth + 0.5);
+			Threads[i]->X2 = (int)(SliceSplits[i + 1] * viewwidth + 0.5);
 		}
 		run_id++;
 		start_lock.unlock();
@@ -210,10 +228,71 @@ namespace swrenderer
 			end_condition.wait(end_lock, [&]() { return finished_threads == Threads.size(); });
 			finished_threads = 0;
 		}
+
+		SliceStats.resize(numThreads);
+		for (int i = 0; i < numThreads; i++)
+		{
+			SliceStats[i].X1 = Threads[i]->X1;
+			SliceStats[i].X2 = Threads[i]->X2;
+			SliceStats[i].TimeMS = Threads[i]->SliceCycles.TimeMS();
+		}
+	}
+
+	void RenderScene::UpdateSliceSplits(int numThreads)
+	{
+		if ((int)SliceSplits.size() != numThreads + 1 || !r_scene_adaptiveslices)
+		{
+			SliceSplits.resize(numThreads + 1);
+			for (int i = 0; i <= numThreads; i++)
+				SliceSplits[i] = i / (double)numThreads;
+			return;
+		}
+
+		// Move the splits so that each slice gets an equal share of the time spent in the last frame.
+		// Within a slice the time is assumed to be spread evenly across its columns.
+		double totalTime = 0.0;
+		for (int i = 0; i < numThreads; i++)
+			totalTime += Threads[i]->SliceCycles.Time();
+		if (totalTime <= 0.0)
+			return;
+
+		NewSliceSplits.resize(numThreads + 1);
+		NewSliceSplits[0] = 0.0;
+		NewSliceSplits[numThreads] = 1.0;
+
+		int slice = 0;
+		double accumulated = 0.0;
+		for (int i = 1; i < numThreads; i++)
+		{
+			double wanted = totalTime * i / numThreads;
+			while (slice < numThreads - 1 && accumulated + Threads[slice]->SliceCycles.Time() < wanted)
+			{
+				accumulated += Threads[slice]->SliceCycles.Time();
+				slice++;
+			}
+
+			double sliceTime = Threads[slice]->SliceCycles.Time();
+			double t = sliceTime > 0.0 ? clamp((wanted - accumulated) / sliceTime, 0.0, 1.0) : 0.5;
+			NewSliceSplits[i] = SliceSplits[slice] + (SliceSplits[slice + 1] - SliceSplits[slice]) * t;
+		}
+
+		// Only go halfway towards the new splits to avoid oscillating, and keep a minimum width for each slice
+		double minWidth = 0.25 / numThreads;
+		for (int i = 1; i < numThreads; i++)
+		{
+			double split = (SliceSplits[i] + NewSliceSplits[i]) * 0.5;
+			split = MAX(split, SliceSplits[i - 1] + minWidth);
+			split = MIN(split, 1.0 - (numThreads - i) * minWidth);
+			SliceSplits[i] = split;
+		}
 	}
 
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		PROFILE_ZONE("RenderThreadSlice");
+		thread->SliceCycles.Reset();
+		thread->SliceCycles.Clock();
+
 		thread->FrameMemory->Clear();
 		thread->Clip3D->Cleanup();
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
@@ -236,8 +315,11 @@ namespace swrenderer
 		if (thread->MainThread)
 			WallCycles.Clock();
 
-		thread->OpaquePass->RenderScene();
-		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
+		{
+			PROFILE_ZONE("Walls");
+			thread->OpaquePass->RenderScene();
+			thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
+		}
 
 		if (thread == MainThread())
 			WallCycles.Unclock();
@@ -250,8 +332,11 @@ namespace swrenderer
 			if (thread->MainThread)
 				PlaneCycles.Clock();
 
-			thread->PlaneList->Render();
-			thread->Portal->RenderPlanePortals();
+			{
+				PROFILE_ZONE("Planes");
+				thread->PlaneList->Render();
+				thread->Portal->RenderPlanePortals();
+			}
 
 			if (thread->MainThread)
 				PlaneCycles.Unclock();
@@ -264,7 +349,10 @@ namespace swrenderer
 			if (thread->MainThread)
 				MaskedCycles.Clock();
 
-			thread->TranslucentPass->Render();
+			{
+				PROFILE_ZONE("Masked");
+				thread->TranslucentPass->Render();
+			}
 
 			if (thread->MainThread)
 				MaskedCycles.Unclock();
@@ -272,6 +360,8 @@ namespace swrenderer
 			if (thread->MainThread)
 				NetUpdate();
 		}
+
+		thread->SliceCycles.Unclock();
 	}
 
 	void RenderScene::StartThreads(size_t numThreads)
@@ -283,6 +373,8 @@ namespace swrenderer
 			int start_run_id = run_id;
 			thread->thread = std::thread([=]()
 			{
+				FProfiler::SetThreadName("Scene thread");
+
 				int last_run_id = start_run_id;
 				while (true)
 				{
@@ -405,6 +497,23 @@ namespace swrenderer
 		return out;
 	}
 
+	ADD_STAT(sceneslices)
+	{
+		FString out;
+		double total = 0.0, longest = 0.0;
+		for (const auto &stat : SliceStats)
+		{
+			total += stat.TimeMS;
+			longest = MAX(longest, stat.TimeMS);
+		}
+		out.Format("slices=%d  longest=%04.1f ms  average=%04.1f ms\n", (int)SliceStats.size(), longest, SliceStats.empty() ? 0.0 : total / SliceStats.size());
+		for (size_t i = 0; i < SliceStats.size(); i++)
+		{
+			out.AppendFormat("%d: x=%d-%d  %04.1f ms\n", (int)i, SliceStats[i].X1, SliceStats[i].X2, SliceStats[i].TimeMS);
+		}
+		return out;
+	}
+
 	static double bestwallcycles = HUGE_VAL;
 
 	ADD_STAT(wallcycles)
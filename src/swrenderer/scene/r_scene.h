@@ -26,7 +26,7 @@ extern cycle_t FrameCycles;
 
 namespace swrenderer
 {
-	extern cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles;
+	extern cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles, DrawerCycles;
 
 	class RenderThread;
 	
@@ -54,6 +54,7 @@ namespace swrenderer
 		void RenderDrawQueues();
 		void RenderThreadSlices();
 		void RenderThreadSlice(RenderThread *thread);
+		void UpdateSliceSplits(int numThreads);
 
 		void StartThreads(size_t numThreads);
 		void StopThreads();
@@ -62,6 +63,8 @@ namespace swrenderer
 		int clearcolor = 0;
 
 		std::vector<std::unique_ptr<RenderThread>> Threads;
+		std::vector<double> SliceSplits;
+		std::vector<double> NewSliceSplits;
 		std::mutex start_mutex;
 		std::condition_variable start_condition;
 		bool shutdown_flag = false;
@@ -138,6 +138,7 @@ void FAutomapTexture::MakeTexture ()
 	const uint8_t *indata = (const uint8_t *)data.GetMem();
 
 	Pixels = new uint8_t[Width * Height];
+	TrackCache(Width * Height);
 
 	for (x = 0; x < Width; ++x)
 	{
@@ -156,6 +157,7 @@ void FAutomapTexture::MakeTexture ()
 
 const uint8_t *FAutomapTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -171,6 +173,7 @@ const uint8_t *FAutomapTexture::GetPixels ()
 
 const uint8_t *FAutomapTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
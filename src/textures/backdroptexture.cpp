@@ -218,6 +218,7 @@ void FBackdropTexture::Unload()
 {
 	if (Pixels != nullptr) delete[] Pixels;
 	Pixels = nullptr;
+	FTexture::Unload();
 }
 
 //=============================================================================
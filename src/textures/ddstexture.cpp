@@ -436,6 +436,7 @@ FTextureFormat FDDSTexture::GetFormat()
 
 const uint8_t *FDDSTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -470,6 +471,7 @@ const uint8_t *FDDSTexture::GetColumn (unsigned int column, const Span **spans_o
 
 const uint8_t *FDDSTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -488,6 +490,7 @@ void FDDSTexture::MakeTexture ()
 	FWadLump lump = Wads.OpenLumpNum (SourceLump);
 
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 
 	lump.Seek (sizeof(DDSURFACEDESC2) + 4, SEEK_SET);
 
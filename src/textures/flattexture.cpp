@@ -149,6 +149,7 @@ void FFlatTexture::Unload ()
 
 const uint8_t *FFlatTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -179,6 +180,7 @@ const uint8_t *FFlatTexture::GetColumn (unsigned int column, const Span **spans_
 
 const uint8_t *FFlatTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -196,6 +198,7 @@ void FFlatTexture::MakeTexture ()
 {
 	FWadLump lump = Wads.OpenLumpNum (SourceLump);
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 	long numread = lump.Read (Pixels, Width*Height);
 	if (numread < Width*Height)
 	{
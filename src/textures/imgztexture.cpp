@@ -153,6 +153,7 @@ void FIMGZTexture::Unload ()
 
 const uint8_t *FIMGZTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -187,6 +188,7 @@ const uint8_t *FIMGZTexture::GetColumn (unsigned int column, const Span **spans_
 
 const uint8_t *FIMGZTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -220,6 +222,7 @@ void FIMGZTexture::MakeTexture ()
 
 	CalcBitSize ();
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 	dest_p = Pixels;
 
 	// Convert the source image from row-major to column-major format
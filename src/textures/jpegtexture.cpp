@@ -46,6 +46,7 @@ extern "C"
 #include "bitmap.h"
 #include "v_video.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
 
 
 struct FLumpSourceMgr : public jpeg_source_mgr
@@ -173,6 +174,13 @@ void JPEG_OutputMessage (j_common_ptr cinfo)
 	Printf (TEXTCOLOR_ORANGE "JPEG failure: %s\n", buffer);
 }
 
+// The background decoder must not print anything. If it fails, the texture
+// is decoded again on the main thread, which reports the error.
+
+static void JPEG_NoMessage (j_common_ptr cinfo)
+{
+}
+
 //==========================================================================
 //
 // A JPEG texture
@@ -191,6 +199,7 @@ public:
 	FTextureFormat GetFormat ();
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL);
 	bool UseBasePalette();
+	FTextureDecodeJob *CreateDecodeJob() override;
 
 protected:
 
@@ -198,8 +207,10 @@ protected:
 	Span DummySpans[2];
 
 	void MakeTexture ();
+	uint8_t *ReadPixels (FileReader *lump, bool quiet);
 
 	friend class FTexture;
+	friend class FJPEGDecodeJob;
 };
 
 //==========================================================================
@@ -284,6 +295,7 @@ FJPEGTexture::FJPEGTexture (int lumpnum, int width, int height)
 
 FJPEGTexture::~FJPEGTexture ()
 {
+	StopDecoding ();
 	Unload ();
 }
 
@@ -319,6 +331,7 @@ FTextureFormat FJPEGTexture::GetFormat()
 
 const uint8_t *FJPEGTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -349,6 +362,7 @@ const uint8_t *FJPEGTexture::GetColumn (unsigned int column, const Span **spans_
 
 const uint8_t *FJPEGTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -364,28 +378,45 @@ const uint8_t *FJPEGTexture::GetPixels ()
 
 void FJPEGTexture::MakeTexture ()
 {
-	FWadLump lump = Wads.OpenLumpNum (SourceLump);
+	Pixels = FTextureDecoder::Finish(this);
+	if (Pixels == NULL)
+	{
+		FWadLump lump = Wads.OpenLumpNum (SourceLump);
+		Pixels = ReadPixels(&lump, false);
+	}
+	TrackCache(Width * Height);
+}
+
+//==========================================================================
+//
+// Decodes the image into a new buffer. With quiet set, nothing is printed
+// and NULL is returned if the image can't be decoded.
+//
+//==========================================================================
+
+uint8_t *FJPEGTexture::ReadPixels (FileReader *lump, bool quiet)
+{
 	JSAMPLE *buff = NULL;
 
 	jpeg_decompress_struct cinfo;
 	jpeg_error_mgr jerr;
 
-	Pixels = new uint8_t[Width * Height];
-	memset (Pixels, 0xBA, Width * Height);
+	uint8_t *pixels = new uint8_t[Width * Height];
+	memset (pixels, 0xBA, Width * Height);
 
 	cinfo.err = jpeg_std_error(&jerr);
-	cinfo.err->output_message = JPEG_OutputMessage;
+	cinfo.err->output_message = quiet ? JPEG_NoMessage : JPEG_OutputMessage;
 	cinfo.err->error_exit = JPEG_ErrorExit;
 	jpeg_create_decompress(&cinfo);
 	try
 	{
-		FLumpSourceMgr sourcemgr(&lump, &cinfo);
+		FLumpSourceMgr sourcemgr(lump, &cinfo);
 		jpeg_read_header(&cinfo, TRUE);
 		if (!((cinfo.out_color_space == JCS_RGB && cinfo.num_components == 3) ||
 			  (cinfo.out_color_space == JCS_CMYK && cinfo.num_components == 4) ||
 			  (cinfo.out_color_space == JCS_GRAYSCALE && cinfo.num_components == 1)))
 		{
-			Printf (TEXTCOLOR_ORANGE "Unsupported color format\n");
+			if (!quiet) Printf (TEXTCOLOR_ORANGE "Unsupported color format\n");
 			throw -1;
 		}
 
@@ -398,7 +429,7 @@ void FJPEGTexture::MakeTexture ()
 		{
 			int num_scanlines = jpeg_read_scanlines(&cinfo, &buff, 1);
 			uint8_t *in = buff;
-			uint8_t *out = Pixels + y;
+			uint8_t *out = pixels + y;
 			switch (cinfo.out_color_space)
 			{
 			case JCS_RGB:
@@ -446,13 +477,62 @@ void FJPEGTexture::MakeTexture ()
 	}
 	catch (int)
 	{
-		Printf (TEXTCOLOR_ORANGE "   in texture %s\n", Name.GetChars());
 		jpeg_destroy_decompress(&cinfo);
+		if (quiet)
+		{
+			delete[] pixels;
+			pixels = NULL;
+		}
+		else
+		{
+			Printf (TEXTCOLOR_ORANGE "   in texture %s\n", Name.GetChars());
+		}
 	}
 	if (buff != NULL)
 	{
 		delete[] buff;
 	}
+	return pixels;
+}
+
+//==========================================================================
+//
+// The lump is read on the main thread, since the resource files' readers
+// can't be shared.
+//
+//==========================================================================
+
+class FJPEGDecodeJob : public FTextureDecodeJob
+{
+public:
+	FJPEGDecodeJob(FJPEGTexture *tex) : FTextureDecodeJob(tex) {}
+
+	bool Prepare() override
+	{
+		int lumpnum = Texture->SourceLump;
+		Data.Resize(Wads.LumpLength(lumpnum));
+		if (Data.Size() == 0) return false;
+		Wads.ReadLump(lumpnum, &Data[0]);
+		return true;
+	}
+
+	uint8_t *Decode() override
+	{
+		MemoryReader reader((const char *)&Data[0], Data.Size());
+		return static_cast<FJPEGTexture *>(Texture)->ReadPixels(&reader, true);
+	}
+
+private:
+	TArray<uint8_t> Data;
+};
+
+FTextureDecodeJob *FJPEGTexture::CreateDecodeJob ()
+{
+	if (SourceLump < 0)
+	{
+		return NULL;
+	}
+	return new FJPEGDecodeJob(this);
 }
 
 
@@ -51,6 +51,7 @@
 #include "cmdlib.h"
 #include "m_fixed.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
 #include "r_data/colormaps.h"
 
 // On the Alpha, accessing the shorts directly if they aren't aligned on a
@@ -167,6 +168,7 @@ public:
 	FTexture *GetRedirect(bool wantwarped);
 	FTexture *GetRawTexture();
 	void ResolvePatches();
+	FTextureDecodeJob *CreateDecodeJob() override;
 
 protected:
 	uint8_t *Pixels;
@@ -207,6 +209,8 @@ protected:
 private:
 	void CheckForHacks ();
 	void ParsePatch(FScanner &sc, TexPart & part, TexInit &init);
+
+	friend class FMultiPatchDecodeJob;
 };
 
 //==========================================================================
@@ -309,6 +313,7 @@ FMultiPatchTexture::FMultiPatchTexture (const void *texdef, FPatchLookup *patchl
 
 FMultiPatchTexture::~FMultiPatchTexture ()
 {
+	StopDecoding ();
 	Unload ();
 	if (Parts != NULL)
 	{
@@ -370,6 +375,7 @@ void FMultiPatchTexture::Unload ()
 
 const uint8_t *FMultiPatchTexture::GetPixels ()
 {
+	MarkUsed();
 	if (bRedirect)
 	{
 		return Parts->Texture->GetPixels ();
@@ -389,6 +395,7 @@ const uint8_t *FMultiPatchTexture::GetPixels ()
 
 const uint8_t *FMultiPatchTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (bRedirect)
 	{
 		return Parts->Texture->GetColumn (column, spans_out);
@@ -489,7 +496,15 @@ void FMultiPatchTexture::MakeTexture ()
 	uint8_t blendwork[256];
 	bool hasTranslucent = false;
 
+	Pixels = FTextureDecoder::Finish(this);
+	if (Pixels != NULL)
+	{
+		TrackCache(numpix);
+		return;
+	}
+
 	Pixels = new uint8_t[numpix];
+	TrackCache(numpix);
 	memset (Pixels, 0, numpix);
 
 	for (int i = 0; i < NumParts; ++i)
@@ -542,6 +557,105 @@ void FMultiPatchTexture::MakeTexture ()
 	}
 }
 
+//==========================================================================
+//
+// Composites a multipatch texture whose patches are all copied without
+// blending. The patches' pixels and translations are collected on the main
+// thread, so that compositing doesn't need to call any of their methods.
+//
+//==========================================================================
+
+class FMultiPatchDecodeJob : public FTextureDecodeJob
+{
+public:
+	FMultiPatchDecodeJob(FMultiPatchTexture *tex) : FTextureDecodeJob(tex)
+	{
+		for (int i = 0; i < tex->NumParts; ++i)
+		{
+			if (!tex->Parts[i].Texture->bHasCanvas)	// cannot use camera textures as patch.
+			{
+				Sources.Push(tex->Parts[i].Texture);
+			}
+		}
+	}
+
+	bool Prepare() override
+	{
+		FMultiPatchTexture *tex = static_cast<FMultiPatchTexture *>(Texture);
+		uint8_t blendwork[256];
+
+		Width = tex->Width;
+		Height = tex->Height;
+		NumPixels = Width * Height + (1 << tex->HeightBits) - Height;
+		for (int i = 0; i < tex->NumParts; ++i)
+		{
+			if (tex->Parts[i].Texture->bHasCanvas) continue;
+
+			FPart part;
+			part.Texture = tex->Parts[i].Texture;
+			part.Pixels = part.Texture->GetPixels();
+			part.OriginX = tex->Parts[i].OriginX;
+			part.OriginY = tex->Parts[i].OriginY;
+			part.Rotate = tex->Parts[i].Rotate;
+
+			uint8_t *trans = tex->Parts[i].Translation ? tex->Parts[i].Translation->Remap : NULL;
+			if (tex->Parts[i].Blend != 0)
+			{
+				trans = GetBlendMap(tex->Parts[i].Blend, blendwork);
+			}
+			part.Translated = trans != NULL;
+			if (trans != NULL)
+			{
+				memcpy(part.Translation, trans, 256);
+			}
+			Parts.Push(part);
+		}
+		return true;
+	}
+
+	uint8_t *Decode() override
+	{
+		uint8_t *pixels = new uint8_t[NumPixels];
+		memset(pixels, 0, NumPixels);
+		for (auto &part : Parts)
+		{
+			part.Texture->CopyPixelsToBlock(part.Pixels, pixels, Width, Height,
+				part.OriginX, part.OriginY, part.Rotate, part.Translated ? part.Translation : NULL);
+		}
+		return pixels;
+	}
+
+private:
+	struct FPart
+	{
+		FTexture *Texture;
+		const uint8_t *Pixels;
+		int OriginX, OriginY, Rotate;
+		bool Translated;
+		uint8_t Translation[256];
+	};
+
+	TArray<FPart> Parts;
+	int Width, Height, NumPixels;
+};
+
+FTextureDecodeJob *FMultiPatchTexture::CreateDecodeJob ()
+{
+	// Translucent patches are composited in true color, which reads their lumps.
+	if (bRedirect || NumParts == 0)
+	{
+		return NULL;
+	}
+	for (int i = 0; i < NumParts; ++i)
+	{
+		if (Parts[i].op != OP_COPY)
+		{
+			return NULL;
+		}
+	}
+	return new FMultiPatchDecodeJob(this);
+}
+
 //===========================================================================
 //
 // FMultipatchTexture::CopyTrueColorPixels
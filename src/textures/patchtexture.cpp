@@ -195,6 +195,7 @@ void FPatchTexture::Unload ()
 
 const uint8_t *FPatchTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -210,6 +211,7 @@ const uint8_t *FPatchTexture::GetPixels ()
 
 const uint8_t *FPatchTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -286,6 +288,7 @@ void FPatchTexture::MakeTexture ()
 	if (hackflag)
 	{
 		Pixels = new uint8_t[Width * Height];
+		TrackCache(Width * Height);
 		uint8_t *out;
 
 		// Draw the image to the buffer
@@ -309,6 +312,7 @@ void FPatchTexture::MakeTexture ()
 	numspans = Width;
 
 	Pixels = new uint8_t[numpix];
+	TrackCache(numpix);
 	memset (Pixels, 0, numpix);
 
 	// Draw the image to the buffer
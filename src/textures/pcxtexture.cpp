@@ -213,6 +213,7 @@ FTextureFormat FPCXTexture::GetFormat()
 
 const uint8_t *FPCXTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -243,6 +244,7 @@ const uint8_t *FPCXTexture::GetColumn (unsigned int column, const Span **spans_o
 
 const uint8_t *FPCXTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -469,6 +471,7 @@ void FPCXTexture::MakeTexture()
 
 	bitcount = header.bitsPerPixel * header.numColorPlanes;
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 
 	if (bitcount < 24)
 	{
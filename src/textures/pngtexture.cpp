@@ -41,6 +41,7 @@
 #include "bitmap.h"
 #include "v_palette.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
 
 //==========================================================================
 //
@@ -60,6 +61,7 @@ public:
 	FTextureFormat GetFormat ();
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL);
 	bool UseBasePalette();
+	FTextureDecodeJob *CreateDecodeJob() override;
 
 protected:
 
@@ -79,8 +81,10 @@ protected:
 	uint32_t StartOfIDAT;
 
 	void MakeTexture ();
+	uint8_t *ReadPixels (FileReader *lump);
 
 	friend class FTexture;
+	friend class FPNGDecodeJob;
 };
 
 
@@ -352,6 +356,7 @@ FPNGTexture::FPNGTexture (FileReader &lump, int lumpnum, const FString &filename
 
 FPNGTexture::~FPNGTexture ()
 {
+	StopDecoding ();
 	Unload ();
 	if (Spans != NULL)
 	{
@@ -407,6 +412,7 @@ FTextureFormat FPNGTexture::GetFormat()
 
 const uint8_t *FPNGTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -441,6 +447,7 @@ const uint8_t *FPNGTexture::GetColumn (unsigned int column, const Span **spans_o
 
 const uint8_t *FPNGTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -457,21 +464,38 @@ const uint8_t *FPNGTexture::GetPixels ()
 
 void FPNGTexture::MakeTexture ()
 {
-	FileReader *lump;
-
-	if (SourceLump >= 0)
-	{
-		lump = new FWadLump(Wads.OpenLumpNum(SourceLump));
-	}
-	else
+	Pixels = FTextureDecoder::Finish(this);
+	if (Pixels == NULL)
 	{
-		lump = fr;// new FileReader(SourceFile.GetChars());
+		FileReader *lump;
+
+		if (SourceLump >= 0)
+		{
+			lump = new FWadLump(Wads.OpenLumpNum(SourceLump));
+		}
+		else
+		{
+			lump = fr;// new FileReader(SourceFile.GetChars());
+		}
+		Pixels = ReadPixels(lump);
+		if (lump != fr) delete lump;
 	}
+	TrackCache(Width*Height);
+}
 
-	Pixels = new uint8_t[Width*Height];
+//==========================================================================
+//
+// Decodes the image into a new buffer. This must not touch anything but
+// the lump, since it is also called by the background decoder.
+//
+//==========================================================================
+
+uint8_t *FPNGTexture::ReadPixels (FileReader *lump)
+{
+	uint8_t *pixels = new uint8_t[Width*Height];
 	if (StartOfIDAT == 0)
 	{
-		memset (Pixels, 0x99, Width*Height);
+		memset (pixels, 0x99, Width*Height);
 	}
 	else
 	{
@@ -482,17 +506,17 @@ void FPNGTexture::MakeTexture ()
 
 		if (ColorType == 0 || ColorType == 3)	/* Grayscale and paletted */
 		{
-			M_ReadIDAT (lump, Pixels, Width, Height, Width, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
+			M_ReadIDAT (lump, pixels, Width, Height, Width, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
 
 			if (Width == Height)
 			{
 				if (PaletteMap != NULL)
 				{
-					FlipSquareBlockRemap (Pixels, Width, Height, PaletteMap);
+					FlipSquareBlockRemap (pixels, Width, Height, PaletteMap);
 				}
 				else
 				{
-					FlipSquareBlock (Pixels, Width, Height);
+					FlipSquareBlock (pixels, Width, Height);
 				}
 			}
 			else
@@ -500,14 +524,14 @@ void FPNGTexture::MakeTexture ()
 				uint8_t *newpix = new uint8_t[Width*Height];
 				if (PaletteMap != NULL)
 				{
-					FlipNonSquareBlockRemap (newpix, Pixels, Width, Height, Width, PaletteMap);
+					FlipNonSquareBlockRemap (newpix, pixels, Width, Height, Width, PaletteMap);
 				}
 				else
 				{
-					FlipNonSquareBlock (newpix, Pixels, Width, Height, Width);
+					FlipNonSquareBlock (newpix, pixels, Width, Height, Width);
 				}
-				uint8_t *oldpix = Pixels;
-				Pixels = newpix;
+				uint8_t *oldpix = pixels;
+				pixels = newpix;
 				delete[] oldpix;
 			}
 		}
@@ -520,7 +544,7 @@ void FPNGTexture::MakeTexture ()
 
 			M_ReadIDAT (lump, tempix, Width, Height, Width*bytesPerPixel, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
 			in = tempix;
-			out = Pixels;
+			out = pixels;
 
 			// Convert from source format to paletted, column-major.
 			// Formats with alpha maps are reduced to only 1 bit of alpha.
@@ -602,7 +626,47 @@ void FPNGTexture::MakeTexture ()
 			delete[] tempix;
 		}
 	}
-	if (lump != fr) delete lump;
+	return pixels;
+}
+
+//==========================================================================
+//
+// The lump is read on the main thread, since the resource files' readers
+// can't be shared.
+//
+//==========================================================================
+
+class FPNGDecodeJob : public FTextureDecodeJob
+{
+public:
+	FPNGDecodeJob(FPNGTexture *tex) : FTextureDecodeJob(tex) {}
+
+	bool Prepare() override
+	{
+		int lumpnum = Texture->SourceLump;
+		Data.Resize(Wads.LumpLength(lumpnum));
+		if (Data.Size() == 0) return false;
+		Wads.ReadLump(lumpnum, &Data[0]);
+		return true;
+	}
+
+	uint8_t *Decode() override
+	{
+		MemoryReader reader((const char *)&Data[0], Data.Size());
+		return static_cast<FPNGTexture *>(Texture)->ReadPixels(&reader);
+	}
+
+private:
+	TArray<uint8_t> Data;
+};
+
+FTextureDecodeJob *FPNGTexture::CreateDecodeJob ()
+{
+	if (SourceLump < 0 || StartOfIDAT == 0)
+	{
+		return NULL;
+	}
+	return new FPNGDecodeJob(this);
 }
 
 //===========================================================================
@@ -217,6 +217,7 @@ void FRawPageTexture::Unload ()
 
 const uint8_t *FRawPageTexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -240,6 +241,7 @@ const uint8_t *FRawPageTexture::GetColumn (unsigned int column, const Span **spa
 
 const uint8_t *FRawPageTexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -261,6 +263,7 @@ void FRawPageTexture::MakeTexture ()
 	uint8_t *dest_p;
 
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 	dest_p = Pixels;
 
 	// Convert the source image from row-major to column-major format
@@ -45,6 +45,7 @@
 #include "v_video.h"
 #include "m_fixed.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
 #include "v_palette.h"
 
 typedef bool (*CheckFunc)(FileReader & file);
@@ -57,6 +58,8 @@ struct TexCreateInfo
 };
 
 BYTE FTexture::GrayMap[256];
+size_t FTexture::CacheTotal;
+unsigned FTexture::CacheFrame;
 
 void FTexture::InitGrayMap()
 {
@@ -174,11 +177,47 @@ FTexture::~FTexture ()
 	FTexture *link = Wads.GetLinkedTexture(SourceLump);
 	if (link == this) Wads.SetLinkedTexture(SourceLump, NULL);
 	KillNative();
+	CacheTotal -= CacheBytes;
+	// By now the subclass has freed everything a decoder thread could read.
+	assert(DecodeJob == nullptr && DecodeUsers == 0);
 }
 
 void FTexture::Unload()
 {
 	PixelsBgra = std::vector<uint32_t>();
+	CacheTotal -= CacheBytes;
+	CacheBytes = 0;
+}
+
+//==========================================================================
+//
+// Waits for or drops any background decoding that reads this texture.
+// Textures that can be decoded in the background must call this in their
+// destructors, before they free anything the job uses, and so must the
+// owners of textures that are not in the texture manager.
+//
+//==========================================================================
+
+void FTexture::StopDecoding()
+{
+	if (DecodeJob != nullptr || DecodeUsers > 0)
+	{
+		FTextureDecoder::Clear();
+	}
+}
+
+//==========================================================================
+//
+// Records decoded data that was allocated (or freed, if bytes is negative)
+// for this texture outside of what Unload knows about.
+//
+//==========================================================================
+
+void FTexture::TrackCache(ptrdiff_t bytes)
+{
+	CacheBytes += bytes;
+	CacheTotal += bytes;
+	MarkUsed();
 }
 
 const uint32_t *FTexture::GetColumnBgra(unsigned int column, const Span **spans_out)
@@ -194,6 +233,7 @@ const uint32_t *FTexture::GetColumnBgra(unsigned int column, const Span **spans_
 
 const uint32_t *FTexture::GetPixelsBgra()
 {
+	MarkUsed();
 	if (PixelsBgra.empty() || CheckModified())
 	{
 		if (!GetColumn(0, nullptr))
@@ -379,7 +419,9 @@ void FTexture::CreatePixelsBgraWithMipmaps()
 		int h = MAX(Height >> i, 1);
 		buffersize += w * h;
 	}
+	ptrdiff_t oldsize = PixelsBgra.size();
 	PixelsBgra.resize(buffersize, 0xffff0000);
+	TrackCache((buffersize - oldsize) * 4);
 }
 
 int FTexture::MipmapLevels() const
@@ -557,7 +599,14 @@ void FTexture::GenerateBgraMipmapsFast()
 
 void FTexture::CopyToBlock (BYTE *dest, int dwidth, int dheight, int xpos, int ypos, int rotate, const BYTE *translation)
 {
-	const BYTE *pixels = GetPixels();
+	CopyPixelsToBlock(GetPixels(), dest, dwidth, dheight, xpos, ypos, rotate, translation);
+}
+
+// Same as above for pixels that were already retrieved. Since it doesn't
+// call GetPixels, it can be used by the background decoder.
+
+void FTexture::CopyPixelsToBlock (const BYTE *pixels, BYTE *dest, int dwidth, int dheight, int xpos, int ypos, int rotate, const BYTE *translation) const
+{
 	int srcwidth = Width;
 	int srcheight = Height;
 	int step_x = Height;
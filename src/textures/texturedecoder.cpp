@@ -0,0 +1,379 @@
+/*
+** texturedecoder.cpp
+** Decodes textures on background threads
+**
+*/
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#include "doomtype.h"
+#include "templates.h"
+#include "i_system.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "profiler.h"
+#include "textures/textures.h"
+#include "textures/texturedecoder.h"
+
+CVAR(Bool, r_backgrounddecode, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Decoding doesn't need to be done in a hurry, so leave some cores alone.
+enum { MAX_DECODE_THREADS = 4 };
+
+enum
+{
+	JOB_Waiting,	// some of the sources are still being decoded
+	JOB_Queued,
+	JOB_Running,
+	JOB_Done,
+};
+
+static std::vector<std::thread> Threads;
+static std::once_flag StartOnce;
+static bool ShutdownFlag;
+
+static std::mutex QueueMutex;						// guards everything below
+static std::condition_variable QueueCondition;		// a job was queued or the threads must stop
+static std::condition_variable DoneCondition;		// a job has finished
+static std::deque<FTextureDecodeJob *> Pending;
+static int NumRunning;
+
+static unsigned NumDecoded, NumDecodedOnDemand, NumFailed, NumWaits;
+static cycle_t WaitTime;
+
+// All jobs that haven't been released yet. Only used by the main thread.
+static TArray<FTextureDecodeJob *> Jobs;
+
+//==========================================================================
+//
+// Jobs may throw when they hit bad data, like the JPEG decoder does.
+//
+//==========================================================================
+
+static uint8_t *RunJob(FTextureDecodeJob *job)
+{
+	try
+	{
+		return job->Decode();
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void StopThreads()
+{
+	std::unique_lock<std::mutex> lock(QueueMutex);
+	ShutdownFlag = true;
+	lock.unlock();
+	QueueCondition.notify_all();
+	for (auto &thread : Threads)
+	{
+		thread.join();
+	}
+	Threads.clear();
+}
+
+static void StartThreads()
+{
+	int numThreads = (int)std::thread::hardware_concurrency() - 1;
+	numThreads = clamp(numThreads, 1, (int)MAX_DECODE_THREADS);
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		Threads.push_back(std::thread([]()
+		{
+			FProfiler::SetThreadName("Texture decoder");
+
+			std::unique_lock<std::mutex> lock(QueueMutex);
+			while (true)
+			{
+				QueueCondition.wait(lock, []() { return !Pending.empty() || ShutdownFlag; });
+				if (ShutdownFlag)
+					break;
+
+				FTextureDecodeJob *job = Pending.front();
+				Pending.pop_front();
+				job->State = JOB_Running;
+				NumRunning++;
+				lock.unlock();
+
+				uint8_t *pixels = RunJob(job);
+
+				lock.lock();
+				job->Pixels = pixels;
+				job->State = JOB_Done;
+				NumRunning--;
+				if (pixels != nullptr) NumDecoded++;
+				else NumFailed++;
+				DoneCondition.notify_all();
+			}
+		}));
+	}
+	atterm(StopThreads);
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Queue
+//
+// The sources of a job that aren't resident yet are queued first. Those
+// that can't be decoded in the background are made when the job starts.
+//
+//==========================================================================
+
+bool FTextureDecoder::Queue(FTexture *tex)
+{
+	if (!r_backgrounddecode)
+	{
+		return false;
+	}
+	if (tex->DecodeJob != nullptr || tex->GetCacheBytes() > 0)
+	{
+		return true;
+	}
+
+	FTextureDecodeJob *job = tex->CreateDecodeJob();
+	if (job == nullptr)
+	{
+		return false;
+	}
+	std::call_once(StartOnce, StartThreads);
+
+	tex->DecodeJob = job;
+	Jobs.Push(job);
+	for (auto source : job->Sources)
+	{
+		if (source->GetCacheBytes() == 0)
+		{
+			Queue(source);
+		}
+	}
+	Start(job);
+	return true;
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Start
+//
+// Hands a waiting job to the decoder threads if none of its sources are
+// still being decoded. The sources are made resident and cannot be
+// evicted until the job has been released.
+//
+//==========================================================================
+
+void FTextureDecoder::Start(FTextureDecodeJob *job)
+{
+	{
+		std::unique_lock<std::mutex> lock(QueueMutex);
+		for (auto source : job->Sources)
+		{
+			if (source->DecodeJob != nullptr && source->DecodeJob->State != JOB_Done)
+			{
+				return;
+			}
+		}
+	}
+
+	for (auto source : job->Sources)
+	{
+		source->GetPixels();
+		source->DecodeUsers++;
+	}
+	job->State = JOB_Queued;
+	if (!job->Prepare())
+	{
+		Release(job);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(QueueMutex);
+	Pending.push_back(job);
+	lock.unlock();
+	QueueCondition.notify_one();
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Finish
+//
+// A job that no decoder thread has picked up yet is run right here, so
+// the main thread only has to wait for jobs that are already running.
+//
+//==========================================================================
+
+uint8_t *FTextureDecoder::Finish(FTexture *tex)
+{
+	FTextureDecodeJob *job = tex->DecodeJob;
+	if (job == nullptr)
+	{
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(QueueMutex);
+	if (job->State == JOB_Waiting)
+	{
+		lock.unlock();
+		Release(job);
+		return nullptr;
+	}
+	if (job->State == JOB_Queued)
+	{
+		Pending.erase(std::find(Pending.begin(), Pending.end(), job));
+		job->State = JOB_Running;
+		lock.unlock();
+
+		uint8_t *pixels = RunJob(job);
+
+		lock.lock();
+		job->Pixels = pixels;
+		job->State = JOB_Done;
+		if (pixels != nullptr) NumDecodedOnDemand++;
+		else NumFailed++;
+	}
+	else if (job->State == JOB_Running)
+	{
+		NumWaits++;
+		WaitTime.Clock();
+		DoneCondition.wait(lock, [=]() { return job->State == JOB_Done; });
+		WaitTime.Unclock();
+	}
+	uint8_t *pixels = job->Pixels;
+	job->Pixels = nullptr;
+	lock.unlock();
+
+	Release(job);
+	return pixels;
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Release
+//
+//==========================================================================
+
+void FTextureDecoder::Release(FTextureDecodeJob *job)
+{
+	if (job->State != JOB_Waiting)
+	{
+		for (auto source : job->Sources)
+		{
+			source->DecodeUsers--;
+		}
+	}
+	delete[] job->Pixels;
+	job->Texture->DecodeJob = nullptr;
+	Jobs.Delete(Jobs.Find(job));
+	delete job;
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Update
+//
+// Called by the software renderer before each frame. Making a texture
+// resident can release other jobs, so this works on a list of textures
+// instead of the jobs themselves.
+//
+//==========================================================================
+
+void FTextureDecoder::Update()
+{
+	if (Jobs.Size() == 0)
+	{
+		return;
+	}
+
+	TArray<FTexture *> finished, waiting;
+	{
+		std::unique_lock<std::mutex> lock(QueueMutex);
+		for (auto job : Jobs)
+		{
+			if (job->State == JOB_Done) finished.Push(job->Texture);
+			else if (job->State == JOB_Waiting) waiting.Push(job->Texture);
+		}
+	}
+
+	for (auto tex : finished)
+	{
+		if (tex->DecodeJob != nullptr)
+		{
+			tex->GetPixels();
+			// The texture may have been made some other way in the meantime.
+			if (tex->DecodeJob != nullptr) Release(tex->DecodeJob);
+		}
+	}
+	for (auto tex : waiting)
+	{
+		if (tex->DecodeJob != nullptr && tex->DecodeJob->State == JOB_Waiting)
+		{
+			Start(tex->DecodeJob);
+		}
+	}
+}
+
+//==========================================================================
+//
+// FTextureDecoder :: Clear
+//
+// Waits for the running jobs and drops everything that was decoded.
+//
+//==========================================================================
+
+void FTextureDecoder::Clear()
+{
+	if (Jobs.Size() == 0)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(QueueMutex);
+	for (auto job : Pending)
+	{
+		job->State = JOB_Done;
+	}
+	Pending.clear();
+	DoneCondition.wait(lock, []() { return NumRunning == 0; });
+	lock.unlock();
+
+	while (Jobs.Size() > 0)
+	{
+		Release(Jobs.Last());
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(texdecode)
+{
+	int counts[4] = { 0, 0, 0, 0 };
+
+	std::unique_lock<std::mutex> lock(QueueMutex);
+	for (auto job : Jobs)
+	{
+		counts[job->State]++;
+	}
+
+	FString out;
+	out.Format("Jobs: %d waiting, %d queued, %d running, %d done  Decoded: %u (%u on demand, %u failed)  Waits: %u (%2.3f ms)",
+		counts[JOB_Waiting], counts[JOB_Queued], counts[JOB_Running], counts[JOB_Done],
+		NumDecoded + NumDecodedOnDemand, NumDecodedOnDemand, NumFailed, NumWaits, WaitTime.TimeMS());
+	return out;
+}
@@ -0,0 +1,57 @@
+#ifndef __TEXTUREDECODER_H__
+#define __TEXTUREDECODER_H__
+
+#include "tarray.h"
+
+class FTexture;
+
+// Decodes the paletted pixels of a texture on one of the decoder threads.
+//
+// Prepare runs on the main thread once all the job's sources are resident,
+// and must collect everything Decode needs: Decode runs on a decoder thread
+// and must neither touch the file system nor call any virtual methods of
+// textures, since either could change state the main thread is using.
+// Decode returns a buffer allocated with new[], or NULL if it failed, in
+// which case the texture is made on the main thread as usual so that any
+// errors get reported there.
+
+class FTextureDecodeJob
+{
+public:
+	FTextureDecodeJob(FTexture *tex) : Texture(tex) {}
+	virtual ~FTextureDecodeJob() {}
+
+	virtual bool Prepare() = 0;
+	virtual uint8_t *Decode() = 0;
+
+	FTexture *const Texture;
+	TArray<FTexture *> Sources;		// textures whose pixels Decode reads
+
+	// Used by FTextureDecoder
+	int State = 0;
+	uint8_t *Pixels = nullptr;
+};
+
+// Runs texture decode jobs in the background.
+//
+// Queue starts decoding a texture and returns false if the texture can't be
+// decoded in the background. Finish is called by MakeTexture and returns the
+// texture's decoded pixels, waiting for them if they are still being worked
+// on, or NULL if the texture has no job or decoding it failed. Update starts
+// the jobs whose sources have become available and hands finished pixels to
+// their textures. Clear drops all jobs.
+
+class FTextureDecoder
+{
+public:
+	static bool Queue(FTexture *tex);
+	static uint8_t *Finish(FTexture *tex);
+	static void Update();
+	static void Clear();
+
+private:
+	static void Start(FTextureDecodeJob *job);
+	static void Release(FTextureDecodeJob *job);
+};
+
+#endif //__TEXTUREDECODER_H__
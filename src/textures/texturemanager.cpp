@@ -34,6 +34,8 @@
 **
 */
 
+#include <algorithm>
+
 #include "doomtype.h"
 #include "doomstat.h"
 #include "w_wad.h"
@@ -53,9 +55,16 @@
 #include "r_renderer.h"
 #include "r_sky.h"
 #include "textures/textures.h"
+#include "textures/texturedecoder.h"
+#include "stats.h"
 
 FTextureManager TexMan;
 
+CVAR(Int, r_texcachesize, 512, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// in MB, 0 = unlimited
+
+static unsigned TexCacheEvictions;
+static size_t TexCacheEvictedBytes;
+
 CUSTOM_CVAR(Bool, vid_nopalsubstitutions, false, CVAR_ARCHIVE)
 {
 	// This is in case the sky texture has been substituted.
@@ -97,6 +106,7 @@ FTextureManager::~FTextureManager ()
 
 void FTextureManager::DeleteAll()
 {
+	FTextureDecoder::Clear();
 	for (unsigned int i = 0; i < Textures.Size(); ++i)
 	{
 		delete Textures[i].Texture;
@@ -367,12 +377,105 @@ FTexture *FTextureManager::FindTexture(const char *texname, int usetype, BITFIEL
 
 void FTextureManager::UnloadAll ()
 {
+	FTextureDecoder::Clear();
 	for (unsigned int i = 0; i < Textures.Size(); ++i)
 	{
 		Textures[i].Texture->Unload ();
 	}
 }
 
+//==========================================================================
+//
+// FTextureManager :: TrimCache
+//
+// Called by the software renderer before it starts a new frame. All
+// drawers of the previous frame have been executed by then, so nothing
+// can still be reading from the buffers that get freed here. Textures
+// used in the last two frames are kept, even if that means staying over
+// the budget, to avoid decoding the same images over and over again.
+// Neither are textures the background decoder is reading from.
+//
+//==========================================================================
+
+void FTextureManager::TrimCache ()
+{
+	FTexture::CacheFrame++;
+
+	size_t budget = size_t(MAX<int>(r_texcachesize, 0)) << 20;
+	if (budget == 0 || FTexture::CacheTotal <= budget)
+	{
+		return;
+	}
+
+	TArray<FTexture *> candidates;
+	for (unsigned int i = 0; i < Textures.Size(); ++i)
+	{
+		FTexture *tex = Textures[i].Texture;
+		if (tex->GetCacheBytes() > 0 && !tex->bHasCanvas && tex->DecodeUsers == 0 && tex->GetCacheUseFrame() + 2 <= FTexture::CacheFrame)
+		{
+			candidates.Push(tex);
+		}
+	}
+	if (candidates.Size() == 0)
+	{
+		return;
+	}
+
+	// Oldest first; of those that were last used at the same time, free the largest first.
+	std::sort(&candidates[0], &candidates[0] + candidates.Size(), [](FTexture *a, FTexture *b)
+	{
+		if (a->GetCacheUseFrame() != b->GetCacheUseFrame()) return a->GetCacheUseFrame() < b->GetCacheUseFrame();
+		return a->GetCacheBytes() > b->GetCacheBytes();
+	});
+
+	for (unsigned int i = 0; i < candidates.Size() && FTexture::CacheTotal > budget; ++i)
+	{
+		TexCacheEvictedBytes += candidates[i]->GetCacheBytes();
+		TexCacheEvictions++;
+		candidates[i]->Unload ();
+	}
+}
+
+//==========================================================================
+//
+// Shows how much decoded image data is resident, split by texture type
+//
+//==========================================================================
+
+ADD_STAT(texcache)
+{
+	static const char *const typenames[] =
+	{
+		"Any", "Wall", "Flat", "Sprite", "WallPatch", "Build", "SkinSprite", "Decal",
+		"MiscPatch", "FontChar", "Override", "Autopage", "SkinGraphic", "Null", "Defined"
+	};
+	size_t bytes[countof(typenames)] = { 0 };
+	int counts[countof(typenames)] = { 0 };
+
+	for (int i = 0; i < TexMan.NumTextures(); ++i)
+	{
+		FTexture *tex = TexMan.ByIndex(i);
+		if (tex->GetCacheBytes() > 0)
+		{
+			unsigned type = MIN<unsigned>(tex->UseType, countof(typenames) - 1);
+			bytes[type] += tex->GetCacheBytes();
+			counts[type]++;
+		}
+	}
+
+	FString out;
+	out.Format("Resident: %zuK of %dM  Evicted: %u textures (%zuK)\n",
+		FTexture::CacheTotal >> 10, *r_texcachesize, TexCacheEvictions, TexCacheEvictedBytes >> 10);
+	for (unsigned i = 0; i < countof(typenames); ++i)
+	{
+		if (counts[i] > 0)
+		{
+			out.AppendFormat("%s: %d (%zuK)  ", typenames[i], counts[i], bytes[i] >> 10);
+		}
+	}
+	return out;
+}
+
 //==========================================================================
 //
 // FTextureManager :: AddTexture
@@ -452,6 +555,8 @@ void FTextureManager::ReplaceTexture (FTextureID picnum, FTexture *newtexture, b
 	newtexture->id = oldtexture->id;
 	if (free && !oldtexture->bKeepAround)
 	{
+		// A decoder thread may still be reading from the texture.
+		oldtexture->StopDecoding();
 		delete oldtexture;
 	}
 	else
@@ -1224,6 +1329,47 @@ DEFINE_ACTION_FUNCTION(_TexMan, GetScaledSize)
 	ACTION_RETURN_VEC2(DVector2(-1, -1));
 }
 
+//==========================================================================
+//
+// FTexturePrefetcher
+//
+// Prefetching everything a level uses at once would hold all of it in
+// memory at the same time, so this only keeps up to BATCH_BYTES ahead.
+//
+//==========================================================================
+
+FTexturePrefetcher::~FTexturePrefetcher()
+{
+	Wads.ReleasePrefetchedLumps(Batch);
+}
+
+void FTexturePrefetcher::Add(FTexture *tex)
+{
+	SourceLumps.Push(tex != nullptr ? tex->GetSourceLump() : -1);
+}
+
+void FTexturePrefetcher::Next()
+{
+	if (Position == BatchEnd && BatchEnd < SourceLumps.Size())
+	{
+		Wads.ReleasePrefetchedLumps(Batch);
+		Batch.Clear();
+
+		int bytes = 0;
+		while (BatchEnd < SourceLumps.Size() && bytes < BATCH_BYTES)
+		{
+			int lump = SourceLumps[BatchEnd++];
+			if (lump >= 0)
+			{
+				Batch.Push(lump);
+				bytes += Wads.LumpLength(lump);
+			}
+		}
+		Wads.PrefetchLumps(Batch);
+	}
+	Position++;
+}
+
 //==========================================================================
 //
 // FTextureID::operator+
@@ -131,6 +131,7 @@ enum FTextureFormat
 };
 
 class FNativeTexture;
+class FTextureDecodeJob;
 
 // Base texture class
 class FTexture
@@ -217,6 +218,24 @@ public:
 
 	virtual void Unload ();
 
+	// Software renderer pixel cache bookkeeping. The textures that hold
+	// the most decoded data and were used the longest ago are unloaded
+	// first when the cache exceeds r_texcachesize.
+	void MarkUsed() { CacheUseFrame = CacheFrame; }
+	size_t GetCacheBytes() const { return CacheBytes; }
+	unsigned GetCacheUseFrame() const { return CacheUseFrame; }
+
+	static size_t CacheTotal;		// decoded bytes held by all textures
+	static unsigned CacheFrame;		// advanced once per rendered frame
+
+	// Background decoding, see texturedecoder.h. Returns NULL if this
+	// texture can only be made on the main thread.
+	virtual FTextureDecodeJob *CreateDecodeJob() { return nullptr; }
+
+	FTextureDecodeJob *DecodeJob = nullptr;	// the job decoding this texture
+	int DecodeUsers = 0;					// jobs reading this texture's pixels
+	void StopDecoding();
+
 	// Returns the native pixel format for this image
 	virtual FTextureFormat GetFormat();
 
@@ -252,6 +271,7 @@ public:
 	}
 
 	void CopyToBlock (BYTE *dest, int dwidth, int dheight, int x, int y, int rotate, const BYTE *translation=NULL);
+	void CopyPixelsToBlock (const BYTE *pixels, BYTE *dest, int dwidth, int dheight, int x, int y, int rotate, const BYTE *translation) const;
 
 	// Returns true if the next call to GetPixels() will return an image different from the
 	// last call to GetPixels(). This should be considered valid only if a call to CheckModified()
@@ -284,6 +304,7 @@ protected:
 
 	FTexture (const char *name = NULL, int lumpnum = -1);
 
+	void TrackCache(ptrdiff_t bytes);
 	Span **CreateSpans (const BYTE *pixels) const;
 	void FreeSpans (Span **spans) const;
 	void CalcBitSize ();
@@ -306,6 +327,8 @@ protected:
 	int MipmapLevels() const;
 
 private:
+	size_t CacheBytes = 0;
+	unsigned CacheUseFrame = 0;
 	bool bSWSkyColorDone = false;
 	PalEntry FloorSkyColor;
 	PalEntry CeilingSkyColor;
@@ -467,6 +490,7 @@ public:
 	void ReplaceTexture (FTextureID picnum, FTexture *newtexture, bool free);
 
 	void UnloadAll ();
+	void TrimCache ();
 
 	int NumTextures () const { return (int)Textures.Size(); }
 
@@ -540,6 +564,24 @@ public:
 	};
 };
 
+// Decompresses the source lumps of the textures a precache loop is about to
+// make a batch at a time, and frees each batch once the loop is past it.
+class FTexturePrefetcher
+{
+public:
+	~FTexturePrefetcher();
+	void Add(FTexture *tex);	// in the order the textures are going to be made
+	void Next();				// before making each texture that was added
+
+private:
+	enum { BATCH_BYTES = 16 << 20 };
+
+	TArray<int> SourceLumps;
+	TArray<int> Batch;
+	unsigned Position = 0;
+	unsigned BatchEnd = 0;
+};
+
 // A texture that doesn't really exist
 class FDummyTexture : public FTexture
 {
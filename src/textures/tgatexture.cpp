@@ -203,6 +203,7 @@ FTextureFormat FTGATexture::GetFormat()
 
 const uint8_t *FTGATexture::GetColumn (unsigned int column, const Span **spans_out)
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -237,6 +238,7 @@ const uint8_t *FTGATexture::GetColumn (unsigned int column, const Span **spans_o
 
 const uint8_t *FTGATexture::GetPixels ()
 {
+	MarkUsed();
 	if (Pixels == NULL)
 	{
 		MakeTexture ();
@@ -297,6 +299,7 @@ void FTGATexture::MakeTexture ()
 	uint8_t * buffer;
 
 	Pixels = new uint8_t[Width*Height];
+	TrackCache(Width*Height);
 	lump.Read(&hdr, sizeof(hdr));
 	lump.Seek(hdr.id_len, SEEK_CUR);
 	
@@ -59,6 +59,7 @@ FWarpTexture::~FWarpTexture ()
 		FreeSpans (Spans);
 		Spans = NULL;
 	}
+	SourcePic->StopDecoding ();
 	delete SourcePic;
 }
 
@@ -74,7 +75,11 @@ void FWarpTexture::Unload ()
 		FreeSpans (Spans);
 		Spans = NULL;
 	}
-	SourcePic->Unload ();
+	// The source can be a patch that a decoder thread is compositing.
+	if (SourcePic->DecodeUsers == 0)
+	{
+		SourcePic->Unload ();
+	}
 	FTexture::Unload();
 }
 
@@ -96,6 +101,7 @@ const BYTE *FWarpTexture::GetPixels ()
 
 const uint32_t *FWarpTexture::GetPixelsBgra()
 {
+	MarkUsed();
 	DWORD time = r_FrameTime;
 	if (Pixels == NULL || time != GenTime)
 	{
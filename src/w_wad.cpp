@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <algorithm>
 
 #include "doomtype.h"
 #include "m_argv.h"
@@ -49,7 +50,6 @@
 #include "c_dispatch.h"
 #include "w_wad.h"
 #include "w_zip.h"
-#include "m_crc32.h"
 #include "v_text.h"
 #include "templates.h"
 #include "gi.h"
@@ -57,6 +57,8 @@
 #include "resourcefiles/resourcefile.h"
 #include "md5.h"
 #include "doomstat.h"
+#include "stats.h"
+#include "workerpool.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -71,6 +73,41 @@ struct FWadCollection::LumpRecord
 	FResourceLump *lump;
 };
 
+// Times all name lookups when the game is started with -lumpstats.
+// Only the outermost lookup is timed when they call each other.
+// The counters are not synchronized, so name lookups must stay on the
+// main thread. The worker threads that decompress lumps and decode
+// textures are handed lump numbers and data, never names.
+class FLumpLookupTimer
+{
+public:
+	FLumpLookupTimer()
+	{
+		if (Enabled && Depth++ == 0)
+		{
+			Count++;
+			Time.Clock();
+		}
+	}
+	~FLumpLookupTimer()
+	{
+		if (Enabled && --Depth == 0)
+		{
+			Time.Unclock();
+		}
+	}
+
+	static bool Enabled;
+	static int Depth;
+	static unsigned Count;
+	static cycle_t Time;
+};
+
+bool FLumpLookupTimer::Enabled;
+int FLumpLookupTimer::Depth;
+unsigned FLumpLookupTimer::Count;
+cycle_t FLumpLookupTimer::Time;
+
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 extern bool nospriterename;
 
@@ -106,8 +143,8 @@ void uppercopy (char *to, const char *from)
 }
 
 FWadCollection::FWadCollection ()
-: FirstLumpIndex(NULL), NextLumpIndex(NULL),
-  FirstLumpIndex_FullName(NULL), NextLumpIndex_FullName(NULL), 
+: NameIndexMask(0), FullNameIndexMask(0),
+  NextLumpIndex(NULL), NextLumpIndex_FullName(NULL),
   NumLumps(0)
 {
 }
@@ -119,21 +156,14 @@ FWadCollection::~FWadCollection ()
 
 void FWadCollection::DeleteAll ()
 {
-	if (FirstLumpIndex != NULL)
-	{
-		delete[] FirstLumpIndex;
-		FirstLumpIndex = NULL;
-	}
+	NameIndex.Clear();
+	FullNameIndex.Clear();
+	NameIndexMask = FullNameIndexMask = 0;
 	if (NextLumpIndex != NULL)
 	{
 		delete[] NextLumpIndex;
 		NextLumpIndex = NULL;
 	}
-	if (FirstLumpIndex_FullName != NULL)
-	{
-		delete[] FirstLumpIndex_FullName;
-		FirstLumpIndex_FullName = NULL;
-	}
 	if (NextLumpIndex_FullName != NULL)
 	{
 		delete[] NextLumpIndex_FullName;
@@ -169,6 +199,11 @@ void FWadCollection::InitMultipleFiles (TArray<FString> &filenames)
 
 	// open all the files, load headers, and count lumps
 	DeleteAll();
+	if (Args->CheckParm ("-lumpstats"))
+	{
+		FLumpLookupTimer::Enabled = true;
+		FLumpLookupTimer::Time.Reset();
+	}
 	numfiles = 0;
 
 	for(unsigned i=0;i<filenames.Size(); i++)
@@ -187,9 +222,7 @@ void FWadCollection::InitMultipleFiles (TArray<FString> &filenames)
 	FixMacHexen();
 
 	// [RH] Set up hash table
-	FirstLumpIndex = new uint32_t[NumLumps];
 	NextLumpIndex = new uint32_t[NumLumps];
-	FirstLumpIndex_FullName = new uint32_t[NumLumps];
 	NextLumpIndex_FullName = new uint32_t[NumLumps];
 	InitHashChains ();
 	LumpInfo.ShrinkToFit();
@@ -245,7 +278,7 @@ void FWadCollection::AddFile (const char *filename, FileReader *wadinfo)
 		{
 			try
 			{
-				wadinfo = new FileReader(filename);
+				wadinfo = new MappedFileReader(filename);
 			}
 			catch (CRecoverableError &err)
 			{ // Didn't find file
@@ -426,6 +459,7 @@ int FWadCollection::GetNumWads () const
 
 int FWadCollection::CheckNumForName (const char *name, int space)
 {
+	FLumpLookupTimer timer;
 	union
 	{
 		char uname[8];
@@ -446,24 +480,26 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	i = NameIndex[FindNameSlot (qname, space)].Lump;
 
-	while (i != NULL_INDEX)
+	// If the lump is from one of the special namespaces exclusive to Zips
+	// the check has to be done differently:
+	// If we find a lump with this name in the global namespace that does not come
+	// from a Zip return that, if it is newer. WADs don't know these namespaces
+	// and single lumps must work as well.
+	if (space > ns_specialzipdirectory)
 	{
-		FResourceLump *lump = LumpInfo[i].lump;
+		uint32_t j = NameIndex[FindNameSlot (qname, ns_global)].Lump;
 
-		if (lump->qwName == qname)
+		while (j != NULL_INDEX && (i == NULL_INDEX || j > i))
 		{
-			if (lump->Namespace == space) break;
-			// If the lump is from one of the special namespaces exclusive to Zips
-			// the check has to be done differently:
-			// If we find a lump with this name in the global namespace that does not come
-			// from a Zip return that. WADs don't know these namespaces and single lumps must
-			// work as well.
-			if (space > ns_specialzipdirectory && lump->Namespace == ns_global && 
-				!(lump->Flags & LUMPF_ZIPFILE)) break;
+			if (!(LumpInfo[j].lump->Flags & LUMPF_ZIPFILE))
+			{
+				i = j;
+				break;
+			}
+			j = NextLumpIndex[j];
 		}
-		i = NextLumpIndex[i];
 	}
 
 	return i != NULL_INDEX ? i : -1;
@@ -471,7 +507,7 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 
 int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bool exact)
 {
-	FResourceLump *lump;
+	FLumpLookupTimer timer;
 	union
 	{
 		char uname[8];
@@ -485,15 +521,13 @@ int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bo
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
+	i = NameIndex[FindNameSlot (qname, space)].Lump;
 
 	// If exact is true if will only find lumps in the same WAD, otherwise
 	// also those in earlier WADs.
 
 	while (i != NULL_INDEX &&
-		(lump = LumpInfo[i].lump, lump->qwName != qname ||
-		lump->Namespace != space ||
-		 (exact? (LumpInfo[i].wadnum != wadnum) : (LumpInfo[i].wadnum > wadnum)) ))
+		(exact? (LumpInfo[i].wadnum != wadnum) : (LumpInfo[i].wadnum > wadnum)))
 	{
 		i = NextLumpIndex[i];
 	}
@@ -543,6 +577,7 @@ int FWadCollection::GetNumForName (const char *name, int space)
 
 int FWadCollection::CheckNumForFullName (const char *name, bool trynormal, int namespc)
 {
+	FLumpLookupTimer timer;
 	uint32_t i;
 
 	if (name == NULL)
@@ -550,12 +585,7 @@ int FWadCollection::CheckNumForFullName (const char *name, bool trynormal, int n
 		return -1;
 	}
 
-	i = FirstLumpIndex_FullName[MakeKey(name) % NumLumps];
-
-	while (i != NULL_INDEX && stricmp(name, LumpInfo[i].lump->FullName))
-	{
-		i = NextLumpIndex_FullName[i];
-	}
+	i = FullNameIndex[FindFullNameSlot (name, MakeKey (name))].Lump;
 
 	if (i != NULL_INDEX) return i;
 
@@ -568,6 +598,7 @@ int FWadCollection::CheckNumForFullName (const char *name, bool trynormal, int n
 
 int FWadCollection::CheckNumForFullName (const char *name, int wadnum)
 {
+	FLumpLookupTimer timer;
 	uint32_t i;
 
 	if (wadnum < 0)
@@ -575,10 +606,9 @@ int FWadCollection::CheckNumForFullName (const char *name, int wadnum)
 		return CheckNumForFullName (name);
 	}
 
-	i = FirstLumpIndex_FullName[MakeKey (name) % NumLumps];
+	i = FullNameIndex[FindFullNameSlot (name, MakeKey (name))].Lump;
 
-	while (i != NULL_INDEX && 
-		(stricmp(name, LumpInfo[i].lump->FullName) || LumpInfo[i].wadnum != wadnum))
+	while (i != NULL_INDEX && LumpInfo[i].wadnum != wadnum)
 	{
 		i = NextLumpIndex_FullName[i];
 	}
@@ -692,64 +722,104 @@ int FWadCollection::GetLumpFlags (int lump)
 
 //==========================================================================
 //
-// W_LumpNameHash
-//
-// NOTE: s should already be uppercase, in contrast to the BOOM version.
+// W_InitHashChains
 //
-// Hash function used for lump names.
-// Must be mod'ed with table size.
-// Can be used for any 8-character names.
+// Prepares the lumpinfos for hashing.
+// (Hey! This looks suspiciously like something from Boom! :-)
 //
 //==========================================================================
 
-uint32_t FWadCollection::LumpNameHash (const char *s)
+void FWadCollection::InitHashChains (void)
 {
-	const uint32_t *table = GetCRCTable ();;
-	uint32_t hash = 0xffffffff;
-	int i;
+	unsigned int i, size;
 
-	for (i = 8; i > 0 && *s; --i, ++s)
+	// Keep both indices at most half full so that probe sequences stay short.
+	for (size = 16; size < NumLumps * 2; size <<= 1)
 	{
-		hash = CRC1 (hash, *s, table);
 	}
-	return hash ^ 0xffffffff;
+
+	NameIndex.Resize (size);
+	FullNameIndex.Resize (size);
+	NameIndexMask = FullNameIndexMask = size - 1;
+	memset (&NameIndex[0], 255, size * sizeof(NameIndex[0]));
+	memset (&FullNameIndex[0], 255, size * sizeof(FullNameIndex[0]));
+	memset (NextLumpIndex, 255, NumLumps*sizeof(NextLumpIndex[0]));
+	memset (NextLumpIndex_FullName, 255, NumLumps*sizeof(NextLumpIndex_FullName[0]));
+
+	// Now set up the chains. Later lumps go in front, so the index always
+	// points at the one that overrides all others with the same name.
+	for (i = 0; i < (unsigned)NumLumps; i++)
+	{
+		FResourceLump *lump = LumpInfo[i].lump;
+		FLumpNameSlot &slot = NameIndex[FindNameSlot (lump->qwName, lump->Namespace)];
+
+		slot.Name = lump->qwName;
+		slot.Namespace = lump->Namespace;
+		NextLumpIndex[i] = slot.Lump;
+		slot.Lump = i;
+
+		// Do the same for the full paths
+		if (lump->FullName.IsNotEmpty())
+		{
+			uint32_t hash = MakeKey (lump->FullName);
+			FFullNameSlot &fullslot = FullNameIndex[FindFullNameSlot (lump->FullName, hash)];
+
+			fullslot.Hash = hash;
+			NextLumpIndex_FullName[i] = fullslot.Lump;
+			fullslot.Lump = i;
+		}
+	}
 }
 
 //==========================================================================
 //
-// W_InitHashChains
+// FindNameSlot
 //
-// Prepares the lumpinfos for hashing.
-// (Hey! This looks suspiciously like something from Boom! :-)
+// Returns the index slot for a short name and namespace. If the name is
+// not in the index, this is the empty slot where it would be inserted.
+// The name is compared as a single 64 bit value.
 //
 //==========================================================================
 
-void FWadCollection::InitHashChains (void)
+uint32_t FWadCollection::FindNameSlot (QWORD name, int space) const
 {
-	char name[8];
-	unsigned int i, j;
+	QWORD hash = (name + space) * 0x9E3779B97F4A7C15ull;
+	uint32_t slot = uint32_t(hash >> 32) & NameIndexMask;
 
-	// Mark all buckets as empty
-	memset (FirstLumpIndex, 255, NumLumps*sizeof(FirstLumpIndex[0]));
-	memset (NextLumpIndex, 255, NumLumps*sizeof(NextLumpIndex[0]));
-	memset (FirstLumpIndex_FullName, 255, NumLumps*sizeof(FirstLumpIndex_FullName[0]));
-	memset (NextLumpIndex_FullName, 255, NumLumps*sizeof(NextLumpIndex_FullName[0]));
+	while (true)
+	{
+		const FLumpNameSlot &entry = NameIndex[slot];
 
-	// Now set up the chains
-	for (i = 0; i < (unsigned)NumLumps; i++)
+		if (entry.Lump == NULL_INDEX || (entry.Name == name && entry.Namespace == space))
+		{
+			return slot;
+		}
+		slot = (slot + 1) & NameIndexMask;
+	}
+}
+
+//==========================================================================
+//
+// FindFullNameSlot
+//
+// Same as above for full names, where 'hash' is MakeKey(name).
+//
+//==========================================================================
+
+uint32_t FWadCollection::FindFullNameSlot (const char *name, uint32_t hash) const
+{
+	uint32_t slot = hash & FullNameIndexMask;
+
+	while (true)
 	{
-		uppercopy (name, LumpInfo[i].lump->Name);
-		j = LumpNameHash (name) % NumLumps;
-		NextLumpIndex[i] = FirstLumpIndex[j];
-		FirstLumpIndex[j] = i;
+		const FFullNameSlot &entry = FullNameIndex[slot];
 
-		// Do the same for the full paths
-		if (LumpInfo[i].lump->FullName.IsNotEmpty())
+		if (entry.Lump == NULL_INDEX ||
+			(entry.Hash == hash && !stricmp (name, LumpInfo[entry.Lump].lump->FullName)))
 		{
-			j = MakeKey(LumpInfo[i].lump->FullName) % NumLumps;
-			NextLumpIndex_FullName[i] = FirstLumpIndex_FullName[j];
-			FirstLumpIndex_FullName[j] = i;
+			return slot;
 		}
+		slot = (slot + 1) & FullNameIndexMask;
 	}
 }
 
@@ -1443,6 +1513,103 @@ bool FWadCollection::IsUncompressedFile(int lump) const
 	return (f != NULL && f->GetFile() != NULL);
 }
 
+//==========================================================================
+//
+// PrefetchLumps
+//
+// Decompresses all of the given lumps that come from Zips, using all
+// worker threads. The data is kept in the lumps' caches until the next
+// CacheLump call takes it over, so loading them afterwards doesn't have
+// to wait for inflate. The compressed data is read on this thread, since
+// the archive's FileReader can't be shared.
+//
+//==========================================================================
+
+void FWadCollection::PrefetchLumps(const TArray<int> &lumps)
+{
+	struct FPrefetchJob
+	{
+		FResourceLump *Lump;
+		FCompressedBuffer Data;
+		char *Cache;
+	};
+
+	if (lumps.Size() == 0)
+	{
+		return;
+	}
+
+	// Sorting reads the compressed data in file order and gets rid of duplicates.
+	TArray<int> sorted = lumps;
+	std::sort(&sorted[0], &sorted[0] + sorted.Size());
+
+	TArray<FPrefetchJob> jobs;
+	int last = -1;
+	for (int lumpnum : sorted)
+	{
+		if (lumpnum == last || (unsigned)lumpnum >= NumLumps)
+		{
+			continue;
+		}
+		last = lumpnum;
+
+		FResourceLump *lump = LumpInfo[lumpnum].lump;
+		if (lump->Cache == nullptr && lump->LumpSize > 0 && lump->IsCompressed())
+		{
+			jobs.Push({ lump, lump->GetRawData(), nullptr });
+		}
+	}
+
+	FWorkerPool::RunParallel(jobs.Size(), [&](int i)
+	{
+		FPrefetchJob &job = jobs[i];
+		char *cache = new char[job.Lump->LumpSize];
+		if (job.Data.Decompress(cache, true))
+		{
+			job.Cache = cache;
+		}
+		else
+		{
+			// Leave it to FillCache to report the error.
+			delete[] cache;
+		}
+	});
+
+	for (auto &job : jobs)
+	{
+		if (job.Cache != nullptr)
+		{
+			job.Lump->Cache = job.Cache;
+			job.Lump->RefCount = 0;
+		}
+		job.Data.Clean();
+	}
+}
+
+//==========================================================================
+//
+// ReleasePrefetchedLumps
+//
+// Frees the data of prefetched lumps that haven't been used since.
+//
+//==========================================================================
+
+void FWadCollection::ReleasePrefetchedLumps(const TArray<int> &lumps)
+{
+	for (int lumpnum : lumps)
+	{
+		if ((unsigned)lumpnum < NumLumps)
+		{
+			FResourceLump *lump = LumpInfo[lumpnum].lump;
+			if (lump->Cache != nullptr && lump->RefCount == 0)
+			{
+				delete[] lump->Cache;
+				lump->Cache = nullptr;
+			}
+		}
+	}
+}
+
 //==========================================================================
 //
 // IsEncryptedFile
@@ -1500,9 +1667,9 @@ FWadLump::FWadLump(FResourceLump *lump, bool alwayscache)
 {
 	FileReader *f = lump->GetReader();
 
-	if (f != NULL && f->GetFile() != NULL && !alwayscache)
+	if (f != NULL && f->GetFile() != NULL && f->GetBuffer() == NULL && !alwayscache)
 	{
-		// Uncompressed lump in a file
+		// Uncompressed lump in a file that is not mapped into memory
 		File = f->GetFile();
 		Length = lump->LumpSize;
 		StartPos = FilePos = lump->GetFileOffset();
@@ -1730,3 +1897,22 @@ CCMD(lumpnumfull)
 	}
 }
 #endif
+
+//==========================================================================
+//
+// CCMD lumplookupstats
+//
+// Prints the time spent in lump name lookups so far. Start the game with
+// -lumpstats +lumplookupstats to get the numbers for the startup.
+//
+//==========================================================================
+
+CCMD(lumplookupstats)
+{
+	if (!FLumpLookupTimer::Enabled)
+	{
+		Printf ("Lump lookups are only timed with -lumpstats\n");
+		return;
+	}
+	Printf ("%u lump lookups took %.3f ms\n", FLumpLookupTimer::Count, FLumpLookupTimer::Time.TimeMS());
+}
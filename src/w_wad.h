@@ -201,8 +201,6 @@ public:
 	int FindLumpMulti (const char **names, int *lastlump, bool anyns = false, int *nameindex = NULL); // same with multiple possible names
 	bool CheckLumpName (int lump, const char *name);	// [RH] True if lump's name == name
 
-	static uint32_t LumpNameHash (const char *name);		// [RH] Create hash key from an 8-char name
-
 	int LumpLength (int lump) const;
 	int GetLumpOffset (int lump);					// [RH] Returns offset of lump in the wadfile
 	int GetLumpFlags (int lump);					// Return the flags for this lump
@@ -218,6 +216,9 @@ public:
 	bool IsUncompressedFile(int lump) const;
 	bool IsEncryptedFile(int lump) const;
 
+	void PrefetchLumps(const TArray<int> &lumps);			// Decompresses lumps ahead of time on all cores
+	void ReleasePrefetchedLumps(const TArray<int> &lumps);	// Frees prefetched data nobody asked for
+
 	int GetNumLumps () const;
 	int GetNumWads () const;
 
@@ -230,17 +231,37 @@ protected:
 	TArray<FResourceFile *> Files;
 	TArray<LumpRecord> LumpInfo;
 
-	uint32_t *FirstLumpIndex;	// [RH] Hashing stuff moved out of lumpinfo structure
-	uint32_t *NextLumpIndex;
-
-	uint32_t *FirstLumpIndex_FullName;	// The same information for fully qualified paths from .zips
-	uint32_t *NextLumpIndex_FullName;
+	// Open addressing index of the last lump for each short name and namespace.
+	struct FLumpNameSlot
+	{
+		QWORD Name;
+		int Namespace;
+		uint32_t Lump;
+	};
+
+	// The same for fully qualified paths from .zips. Every path is stored only
+	// once, with its hash to skip most string compares.
+	struct FFullNameSlot
+	{
+		uint32_t Hash;
+		uint32_t Lump;
+	};
+
+	TArray<FLumpNameSlot> NameIndex;
+	TArray<FFullNameSlot> FullNameIndex;
+	uint32_t NameIndexMask;
+	uint32_t FullNameIndexMask;
+
+	uint32_t *NextLumpIndex;			// Next lower lump with the same name and namespace
+	uint32_t *NextLumpIndex_FullName;	// Next lower lump with the same full name
 
 	uint32_t NumLumps;					// Not necessarily the same as LumpInfo.Size()
 	uint32_t NumWads;
 
 	void SkinHack (int baselump);
 	void InitHashChains ();								// [RH] Set up the lumpinfo hashing
+	uint32_t FindNameSlot (QWORD name, int space) const;
+	uint32_t FindFullNameSlot (const char *name, uint32_t hash) const;
 
 private:
 	void RenameSprites();
@@ -0,0 +1,181 @@
+/*
+** workerpool.cpp
+** Generic worker threads for parallel loops
+**
+*/
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <vector>
+
+#include "workerpool.h"
+#include "profiler.h"
+#include "i_system.h"
+#include "templates.h"
+
+// Don't spread work too thin; the items are usually small.
+enum { MAX_WORKER_THREADS = 16 };
+
+static std::vector<std::thread> Threads;
+static std::once_flag StartOnce;
+static std::mutex RunMutex;			// held by the thread that currently owns the workers
+
+static std::mutex StartMutex;
+static std::condition_variable StartCondition;
+static int RunId;
+static bool ShutdownFlag;
+
+static std::mutex EndMutex;
+static std::condition_variable EndCondition;
+static size_t FinishedThreads;
+
+static const std::function<void(int)> *Work;
+static int WorkCount;
+static std::atomic<int> NextItem;
+static std::exception_ptr WorkException;
+
+//==========================================================================
+//
+// Processes work items until there are none left. Only the first
+// exception is kept; items still being claimed afterwards are skipped.
+//
+//==========================================================================
+
+static void RunItems()
+{
+	while (true)
+	{
+		int index = NextItem++;
+		if (index >= WorkCount)
+			break;
+
+		try
+		{
+			(*Work)(index);
+		}
+		catch (...)
+		{
+			std::unique_lock<std::mutex> lock(EndMutex);
+			if (!WorkException)
+				WorkException = std::current_exception();
+			NextItem = WorkCount;
+		}
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void StopThreads()
+{
+	std::unique_lock<std::mutex> lock(StartMutex);
+	ShutdownFlag = true;
+	lock.unlock();
+	StartCondition.notify_all();
+	for (auto &thread : Threads)
+	{
+		thread.join();
+	}
+	Threads.clear();
+}
+
+static void StartThreads()
+{
+	int numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 4;
+	numThreads = MIN(numThreads, (int)MAX_WORKER_THREADS);
+
+	for (int i = 1; i < numThreads; i++)
+	{
+		Threads.push_back(std::thread([]()
+		{
+			FProfiler::SetThreadName("Worker thread");
+
+			int last_run_id = 0;
+			while (true)
+			{
+				// Wait until we are signalled to run:
+				std::unique_lock<std::mutex> start_lock(StartMutex);
+				StartCondition.wait(start_lock, [&]() { return RunId != last_run_id || ShutdownFlag; });
+				if (ShutdownFlag)
+					break;
+				last_run_id = RunId;
+				start_lock.unlock();
+
+				RunItems();
+
+				// Notify the calling thread that we finished:
+				std::unique_lock<std::mutex> end_lock(EndMutex);
+				FinishedThreads++;
+				end_lock.unlock();
+				EndCondition.notify_all();
+			}
+		}));
+	}
+	atterm(StopThreads);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FWorkerPool::NumThreads()
+{
+	std::call_once(StartOnce, StartThreads);
+	return (int)Threads.size() + 1;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FWorkerPool::RunParallel(int count, const std::function<void(int)> &work)
+{
+	std::call_once(StartOnce, StartThreads);
+	std::unique_lock<std::mutex> run_lock(RunMutex, std::try_to_lock);
+
+	if (!run_lock.owns_lock() || count < 2 || Threads.empty())
+	{
+		for (int i = 0; i < count; i++)
+			work(i);
+		return;
+	}
+
+	PROFILE_ZONE("RunParallel");
+
+	Work = &work;
+	WorkCount = count;
+	NextItem = 0;
+	WorkException = nullptr;
+
+	std::unique_lock<std::mutex> start_lock(StartMutex);
+	RunId++;
+	start_lock.unlock();
+	StartCondition.notify_all();
+
+	// Do our part of the work ourselves:
+	RunItems();
+
+	// Wait for everyone to finish:
+	std::unique_lock<std::mutex> end_lock(EndMutex);
+	EndCondition.wait(end_lock, [&]() { return FinishedThreads == Threads.size(); });
+	FinishedThreads = 0;
+	std::exception_ptr exception = WorkException;
+	WorkException = nullptr;
+	end_lock.unlock();
+
+	Work = nullptr;
+	if (exception)
+		std::rethrow_exception(exception);
+}
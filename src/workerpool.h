@@ -0,0 +1,28 @@
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include <functional>
+
+// Worker threads for splitting CPU heavy work that is not tied to a
+// subsystem with its own threads (like the software renderer).
+//
+// RunParallel calls the work function once for every index, spread out
+// over the worker threads and the calling thread, and returns when all
+// calls have finished. The order in which the indices are processed is
+// undefined, so the work items must not depend on each other. If the
+// pool is already busy, for example when RunParallel is called from one
+// of its own work items, everything is run on the calling thread instead.
+//
+// An exception thrown by a work item is passed on to the caller once all
+// other items have finished.
+
+class FWorkerPool
+{
+public:
+	// Number of threads work is spread over, including the calling thread
+	static int NumThreads();
+
+	static void RunParallel(int count, const std::function<void(int)> &work);
+};
+
+#endif //__WORKERPOOL_H__
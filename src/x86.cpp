@@ -39,12 +39,35 @@ void DumpCPUInfo(const CPUInfo *cpu)
 #define __cpuid(output, func) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
 	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func));
 #endif
+#if defined(__i386__) && defined(__PIC__)
+#define __cpuidex(output, func, subfunc) \
+	__asm__ __volatile__("xchgl\t%%ebx, %1\n\t" \
+						 "cpuid\n\t" \
+						 "xchgl\t%%ebx, %1\n\t" \
+		: "=a" ((output)[0]), "=r" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) \
+		: "a" (func), "c" (subfunc));
+#else
+#define __cpuidex(output, func, subfunc) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
+	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func), "c" (subfunc));
+#endif
+#endif
+
+static uint64_t ReadXCR(unsigned int index)
+{
+#ifdef _MSC_VER
+	return _xgetbv(index);
+#else
+	// The xgetbv mnemonic is not known to older assemblers
+	unsigned int eax, edx;
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (index));
+	return ((uint64_t)edx << 32) | eax;
 #endif
+}
 
 void CheckCPUID(CPUInfo *cpu)
 {
 	int foo[4];
-	unsigned int maxext;
+	unsigned int maxstd, maxext;
 
 	memset(cpu, 0, sizeof(*cpu));
 
@@ -96,6 +119,7 @@ haveid:
 
 	// Get vendor ID
 	__cpuid(foo, 0);
+	maxstd = (unsigned int)foo[0];
 	cpu->dwVendorID[0] = foo[1];
 	cpu->dwVendorID[1] = foo[3];
 	cpu->dwVendorID[2] = foo[2];
@@ -132,6 +156,14 @@ haveid:
 		cpu->Model |= (foo[0] >> 12) & 0xF0;
 	}
 
+	// AVX2 needs the OS to save the upper halves of the YMM registers
+	// on context switches, which is reported by XCR0 bits 1 and 2.
+	if (cpu->bOSXSAVE && cpu->bAVX && maxstd >= 7 && (ReadXCR(0) & 6) == 6)
+	{
+		__cpuidex(foo, 7, 0);
+		cpu->bAVX2 = (foo[1] & (1 << 5)) != 0;
+	}
+
 	// Check for extended functions.
 	__cpuid(foo, 0x80000000);
 	maxext = (unsigned int)foo[0];
@@ -221,6 +253,8 @@ void DumpCPUInfo(const CPUInfo *cpu)
 		if (cpu->bSSSE3)		Printf(" SSSE3");
 		if (cpu->bSSE41)		Printf(" SSE4.1");
 		if (cpu->bSSE42)		Printf(" SSE4.2");
+		if (cpu->bAVX)			Printf(" AVX");
+		if (cpu->bAVX2)			Printf(" AVX2");
 		if (cpu->b3DNow)		Printf(" 3DNow!");
 		if (cpu->b3DNowPlus)	Printf(" 3DNow!+");
 		Printf ("\n");
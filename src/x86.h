@@ -3,7 +3,7 @@
 
 #include "basictypes.h"
 
-struct CPUInfo	// 92 bytes
+struct CPUInfo	// 96 bytes
 {
 	union
 	{
@@ -36,7 +36,10 @@ struct CPUInfo	// 92 bytes
 			uint32 DontCare1a:9;
 			uint32 bSSE41:1;
 			uint32 bSSE42:1;
-			uint32 DontCare2a:11;
+			uint32 DontCare2a:6;
+			uint32 bOSXSAVE:1;
+			uint32 bAVX:1;
+			uint32 DontCare2b:3;
 
 			uint32 bFPU:1;
 			uint32 bVME:1;
@@ -97,6 +100,8 @@ struct CPUInfo	// 92 bytes
 		};
 		uint32 AMD_DataL1Info;
 	};
+
+	BYTE bAVX2;		// Only set if the OS saves the AVX registers
 };
 
 